@@ -0,0 +1,32 @@
+#version 330 core
+
+// out
+out vec4 FragColor;
+
+// lights (shared by every program, see updateSceneLightClusters)
+// layout matches LightsBlock in shader.h (std140)
+layout (std140) uniform Lights {
+	vec3 ambientLight; // ambient light isn't attenuated, so every light's ambient is summed on the cpu
+	int numPointLights;
+	
+	ivec3 clusterGridSize;
+	float clusterDepthScale; // z slice = log(view depth) * scale + bias
+	float clusterDepthBias;
+};
+
+// g-buffer and light pass output
+uniform sampler2D albedoTexture;
+uniform sampler2D depthTexture;
+uniform sampler2D lightTexture;
+
+void main(){
+	ivec2 pixel = ivec2(gl_FragCoord.xy);
+	
+	// nothing was drawn here, leave the clear color
+	if(texelFetch(depthTexture, pixel, 0).r == 1) discard;
+	
+	vec3 albedo = texelFetch(albedoTexture, pixel, 0).rgb;
+	vec3 light = texelFetch(lightTexture, pixel, 0).rgb;
+	
+	FragColor = vec4(albedo*(ambientLight + light), 1);
+}
\ No newline at end of file
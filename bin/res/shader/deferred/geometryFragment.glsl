@@ -0,0 +1,34 @@
+#version 330 core
+
+// in
+in vec2 TexCoords;
+in vec3 Normal;
+in vec3 FragPos;
+in vec3 Color; // color (defined if no texture is defined)
+flat in float Layer; // texture array layer
+
+// out (g-buffer)
+layout (location=0) out vec4 Albedo;
+layout (location=1) out vec4 GNormal;
+
+// texture (same variants as lighting/fragment.glsl)
+#if defined(TEXTURED)
+uniform sampler2D texture1;
+#elif defined(TEXTURE_ARRAY)
+uniform sampler2DArray textureArray; // used instead of texture1 when the object's texture was packed (see packTextureArrays)
+#endif
+
+void main(){
+	// same base color as lighting/fragment.glsl
+#if defined(TEXTURED)
+	vec3 albedo = vec3(texture(texture1, TexCoords)) + Color;
+#elif defined(TEXTURE_ARRAY)
+	vec3 albedo = vec3(texture(textureArray, vec3(TexCoords, Layer))) + Color;
+#else
+	vec3 albedo = Color;
+#endif
+	
+	Albedo = vec4(albedo, 1);
+	
+	GNormal = vec4(Normal, 0);
+}
\ No newline at end of file
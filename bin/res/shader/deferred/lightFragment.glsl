@@ -0,0 +1,99 @@
+#version 330 core
+
+// out
+out vec4 FragColor;
+
+// per-frame camera data (shared by every program)
+layout (std140) uniform Camera {
+	mat4 view;
+	mat4 projection;
+	mat4 pv; // projection * view
+	vec3 cameraPosition;
+	mat4 inversePv; // inverse(pv)
+};
+
+// lights (shared by every program, see updateSceneLightClusters)
+// layout matches LightsBlock in shader.h (std140)
+layout (std140) uniform Lights {
+	vec3 ambientLight; // ambient light isn't attenuated, so every light's ambient is summed on the cpu
+	int numPointLights;
+	
+	ivec3 clusterGridSize;
+	float clusterDepthScale; // z slice = log(view depth) * scale + bias
+	float clusterDepthBias;
+};
+
+// every light, 3 texels each: (position, radius), (color * diffuseStrength, c), (l, q, unused, unused)
+uniform samplerBuffer lightData;
+
+// offset into clusterLightIndices and light count of each cluster
+uniform usamplerBuffer clusterData;
+uniform usamplerBuffer clusterLightIndices;
+
+// g-buffer
+uniform sampler2D normalTexture;
+uniform sampler2D depthTexture;
+
+// size of the part of the g-buffer drawn into, which can be smaller than the g-buffer (see dynamicresolution.h)
+uniform vec2 viewportSize;
+
+int getCluster(vec3 fragPos);
+vec3 calculatePointLightContribution(int light, vec3 fragPos, vec3 normal);
+
+void main(){
+	ivec2 pixel = ivec2(gl_FragCoord.xy);
+	
+	float depth = texelFetch(depthTexture, pixel, 0).r;
+	
+	// nothing was drawn here
+	if(depth == 1) discard;
+	
+	// reconstruct world position from depth
+	vec2 uv = gl_FragCoord.xy / viewportSize;
+	vec4 worldPosition = inversePv * vec4(vec3(uv, depth)*2 - 1, 1);
+	
+	vec3 fragPos = worldPosition.xyz / worldPosition.w;
+	vec3 normal = texelFetch(normalTexture, pixel, 0).xyz;
+	
+	// add up the lights that reach this pixel's cluster
+	vec3 light = vec3(0);
+	
+	uvec2 range = texelFetch(clusterData, getCluster(fragPos)).xy;
+	
+	for(uint i = range.x; i < range.x + range.y; i++){
+		light += calculatePointLightContribution(int(texelFetch(clusterLightIndices, int(i)).x), fragPos, normal);
+	}
+	
+	FragColor = vec4(light, 1);
+}
+
+// get the index of the cluster a position is in (same as lighting/fragment.glsl)
+int getCluster(vec3 fragPos){
+	vec4 clipPosition = pv * vec4(fragPos, 1);
+	
+	ivec2 tile = ivec2((clipPosition.xy / clipPosition.w * 0.5 + 0.5) * vec2(clusterGridSize.xy));
+	int slice = int(log(clipPosition.w) * clusterDepthScale + clusterDepthBias);
+	
+	ivec3 cluster = clamp(ivec3(tile, slice), ivec3(0), clusterGridSize - 1);
+	
+	return cluster.x + cluster.y*clusterGridSize.x + cluster.z*clusterGridSize.x*clusterGridSize.y;
+}
+
+// diffuse contribution of a light (same as lighting/fragment.glsl)
+vec3 calculatePointLightContribution(int light, vec3 fragPos, vec3 normal){
+	vec4 positionRadius = texelFetch(lightData, light*3);
+	vec4 colorC = texelFetch(lightData, light*3 + 1);
+	vec4 lq = texelFetch(lightData, light*3 + 2);
+	
+	vec3 lightRay = positionRadius.xyz-fragPos;
+	float distance = length(lightRay);
+	lightRay = normalize(lightRay);
+	
+	if(distance > positionRadius.w) return vec3(0);
+	
+	float diffuse = max(dot(normal, lightRay), 0);
+	
+	diffuse /= colorC.w + lq.x * distance + lq.y*distance*distance;
+	
+	return colorC.rgb * diffuse;
+}
\ No newline at end of file
@@ -0,0 +1,8 @@
+#version 330 core
+
+// fullscreen triangle, drawn with 3 vertices and no attributes (used by the light and composite passes)
+void main(){
+	vec2 position = vec2((gl_VertexID << 1) & 2, gl_VertexID & 2);
+	
+	gl_Position = vec4(position*2 - 1, 0, 1);
+}
\ No newline at end of file
@@ -0,0 +1,26 @@
+#version 330 core
+
+// position only version of lighting/vertex.glsl, for the depth pre-pass (see depthprepass.h)
+// gl_Position is computed exactly the same way so the main pass can test against the pre-pass depth
+
+layout (location=0) in vec3 vertexPosition;
+
+// per-frame camera data (shared by every program)
+layout (std140) uniform Camera {
+	mat4 view;
+	mat4 projection;
+	mat4 pv; // projection * view
+	vec3 cameraPosition;
+	mat4 inversePv; // inverse(pv)
+};
+
+// uniforms
+uniform mat4 model; // just model
+
+invariant gl_Position;
+
+void main(){
+	vec4 worldPosition = model * vec4(vertexPosition, 1);
+	
+	gl_Position = pv * worldPosition;
+}
\ No newline at end of file
@@ -1,108 +1,141 @@
 #version 330 core
 
-// structs
-
-// point light
-struct PointLight {
-	vec3 position;
-	vec3 color;
-	
-	// strength of sources
-	float ambientStrength;
-	float diffuseStrength;
-	
-	// attenuation values
-	float c;
-	float l;
-	float q;
-	
-	// range?
-	// float range;
-};
-
+// variants (see permutation.h)
+// TEXTURED: base color is texture1 + Color
+// TEXTURE_ARRAY: base color is textureArray at Layer + Color
+// neither: base color is just Color
+// LIGHTMAPPED: light comes from the lightmap, baked ahead of time, instead of going through the lights
 
 // in
 in vec2 TexCoords;
 in vec3 Normal;
 in vec3 FragPos;
+in vec3 Color; // color (defined if no texture is defined)
+flat in float Layer; // texture array layer
+in vec2 LightmapCoords; // position in the lightmap atlas
 
 // out
 out vec4 FragColor;
 
-// lights
-#define MAX_POINT_LIGHTS 48
-uniform PointLight[MAX_POINT_LIGHTS] pointLights;
-uniform int numPointLights;
+// lights (shared by every program, see updateSceneLightClusters)
+// layout matches LightsBlock in shader.h (std140)
+layout (std140) uniform Lights {
+	vec3 ambientLight; // ambient light isn't attenuated, so every light's ambient is summed on the cpu
+	int numPointLights;
+	
+	ivec3 clusterGridSize;
+	float clusterDepthScale; // z slice = log(view depth) * scale + bias
+	float clusterDepthBias;
+};
 
-// texture
-uniform sampler2D texture1;
+#ifdef LIGHTMAPPED
+// diffuse light from every point light, baked with shadows (see bakeSceneLightmap)
+uniform sampler2D lightmap;
+#else
+// per-frame camera data (shared by every program)
+layout (std140) uniform Camera {
+	mat4 view;
+	mat4 projection;
+	mat4 pv; // projection * view
+	vec3 cameraPosition;
+	mat4 inversePv; // inverse(pv)
+};
+
+// every light, 3 texels each: (position, radius), (color * diffuseStrength, c), (l, q, unused, unused)
+uniform samplerBuffer lightData;
 
-// color (defined if no texture is defined)
-uniform vec3 color;
+// offset into clusterLightIndices and light count of each cluster
+uniform usamplerBuffer clusterData;
+uniform usamplerBuffer clusterLightIndices;
+#endif
 
-// on some implementations opengl doesn't consider the pointLights active uniforms, so we "wake them up" by accessing their properties once
-// this is very annoying, I'd love to find a fix but it doesn't seem like anyone else has encountered this problem (at least on SO)
-void wakeUpPointLights();
+// texture
+#if defined(TEXTURED)
+uniform sampler2D texture1;
+#elif defined(TEXTURE_ARRAY)
+uniform sampler2DArray textureArray; // used instead of texture1 when the object's texture was packed (see packTextureArrays)
+#endif
 
-vec3 calculatePointLightContribution(PointLight light);
+vec3 getBaseColor();
+int getCluster();
+vec3 calculatePointLightContribution(int light);
 
 void main(){
-	wakeUpPointLights();
-
-	// get texture sample
-	vec3 baseColor = vec3(texture(texture1, TexCoords)) + color;
+	vec3 baseColor = getBaseColor();
 	
-	vec3 final = vec3(0);
-	//final = baseColor;
+#ifdef LIGHTMAPPED
+	// the lights were summed ahead of time
+	vec3 final = baseColor*(ambientLight + vec3(texture(lightmap, LightmapCoords)));
+#else
+	vec3 final = baseColor*ambientLight;
 	
-	// calculate lighting
-	for(int i = 0; i < numPointLights; i++){
-		PointLight light = pointLights[i];
+	// calculate lighting, only for the lights that reach this fragment's cluster
+	uvec2 range = texelFetch(clusterData, getCluster()).xy;
+	
+	for(uint i = range.x; i < range.x + range.y; i++){
+		int light = int(texelFetch(clusterLightIndices, int(i)).x);
 		
 		vec3 contribution = calculatePointLightContribution(light);
 		
 		final += baseColor*contribution;
 	}
+#endif
 	
 	FragColor = vec4(final, 1);
 }
 
-void wakeUpPointLights(){
-	pointLights[0].position;
-	pointLights[0].color;
-	pointLights[0].ambientStrength;
-	pointLights[0].diffuseStrength;
-	pointLights[0].c;
-	pointLights[0].l;
-	pointLights[0].q;
+// get the texture sample plus material color
+vec3 getBaseColor(){
+#if defined(TEXTURED)
+	return vec3(texture(texture1, TexCoords)) + Color;
+#elif defined(TEXTURE_ARRAY)
+	return vec3(texture(textureArray, vec3(TexCoords, Layer))) + Color;
+#else
+	return Color;
+#endif
+}
+
+#ifndef LIGHTMAPPED
+// get the index of the cluster this fragment is in
+int getCluster(){
+	vec4 clipPosition = pv * vec4(FragPos, 1);
+	
+	// x and y split normalized device coordinates evenly, z is exponential in view depth (which is clip w)
+	ivec2 tile = ivec2((clipPosition.xy / clipPosition.w * 0.5 + 0.5) * vec2(clusterGridSize.xy));
+	int slice = int(log(clipPosition.w) * clusterDepthScale + clusterDepthBias);
+	
+	ivec3 cluster = clamp(ivec3(tile, slice), ivec3(0), clusterGridSize - 1);
+	
+	return cluster.x + cluster.y*clusterGridSize.x + cluster.z*clusterGridSize.x*clusterGridSize.y;
 }
 
+// diffuse contribution of a light
 // expects normalized values when necessary
-vec3 calculatePointLightContribution(PointLight light){
-	// calculate ambient
-	float ambient = light.ambientStrength;
+vec3 calculatePointLightContribution(int light){
+	vec4 positionRadius = texelFetch(lightData, light*3);
+	vec4 colorC = texelFetch(lightData, light*3 + 1);
+	vec4 lq = texelFetch(lightData, light*3 + 2);
 	
 	// calculate diffuse
-	vec3 lightRay = light.position-FragPos;
+	vec3 lightRay = positionRadius.xyz-FragPos;
 	float distance = length(lightRay); // used for attenuation
 	lightRay = normalize(lightRay);
 	
-	//float diffuse = max(dot(Normal, lightRay), 0);
+	// outside of the light's radius it's too dim to see, cut it off so cluster edges don't show
+	if(distance > positionRadius.w) return vec3(0);
+	
 	float diffuse = max(dot(Normal, lightRay), 0);
-	//float diffuse = dot(Normal, lightRay);
 	//float diffuse = abs(dot(Normal, lightRay)); // fun line
 	
 	// calculate attenuation
-	float attenuation = 1 / (light.c + light.l * distance + light.q*distance*distance);
+	float attenuation = 1 / (colorC.w + lq.x * distance + lq.y*distance*distance);
 	
 	// only attenuate diffuse light
 	diffuse *= attenuation;
 	
-	// apply diffuse factor
-	diffuse *= light.diffuseStrength;
-	
-	// calculate total contribution
-	vec3 contribution = light.color * (ambient+diffuse);
+	// calculate total contribution (color is premultiplied by diffuseStrength)
+	vec3 contribution = colorC.rgb * diffuse;
 	
 	return contribution;
-}
\ No newline at end of file
+}
+#endif
\ No newline at end of file
@@ -1,23 +1,68 @@
 #version 330 core
 
+// variants (see permutation.h)
+// INSTANCED: model, normal matrix, material and lightmap rect come from per-instance attributes (see InstanceData) instead of uniforms
+
 layout (location=0) in vec3 vertexPosition;
 layout (location=1) in vec2 textureCoords;
 layout (location=2) in vec3 normal;
+layout (location=12) in vec2 lightmapCoords;
+
+#ifdef INSTANCED
+// per-instance attributes (see InstanceData)
+layout (location=3) in mat4 instanceModel; // model matrix, takes up locations 3-6
+layout (location=7) in mat3 instanceNormalMatrix; // matrix for adjusting normals for model matrix, takes up locations 7-9
+layout (location=10) in uint instanceMaterial; // index into materialData
+layout (location=13) in vec4 instanceLightmapRect; // scale (xy) and offset (zw) of the object's square of the lightmap atlas
+
+// so main is the same for both
+#define model instanceModel
+#define normalMatrix instanceNormalMatrix
+#define material instanceMaterial
+#define lightmapRect instanceLightmapRect
+#else
+layout (location=11) in uint material; // index into materialData (a constant attribute, except for batches which have one per vertex, see createStaticBatch)
+
+// uniforms
+uniform mat4 model; // just model
+uniform mat3 normalMatrix; // matrix for adjusting normals for model matrix
+uniform vec4 lightmapRect; // scale (xy) and offset (zw) of the object's square of the lightmap atlas
+#endif
 
 // out
 out vec2 TexCoords;
 out vec3 Normal;
 out vec3 FragPos;
+out vec3 Color;
+flat out float Layer;
+out vec2 LightmapCoords;
 
-// uniforms
-uniform mat4 pvm; // projection * view * model
-uniform mat4 model; // just model
-uniform mat3 normalMatrix; // matrix for adjusting normals for model matrix
+// per-frame camera data (shared by every program)
+layout (std140) uniform Camera {
+	mat4 view;
+	mat4 projection;
+	mat4 pv; // projection * view
+	vec3 cameraPosition;
+	mat4 inversePv; // inverse(pv)
+};
+
+// every material, 1 texel each: (color, texture array layer) (see MaterialTable)
+uniform samplerBuffer materialData;
+
+// must match depth/vertex.glsl (depth/instancedVertex.glsl when INSTANCED) exactly, so the main pass can test against the depth pre-pass
+invariant gl_Position;
 
 void main(){
-	gl_Position = pvm * vec4(vertexPosition, 1);
+	vec4 worldPosition = model * vec4(vertexPosition, 1);
+	
+	gl_Position = pv * worldPosition;
 
 	TexCoords = textureCoords;
 	Normal = normalize(normalMatrix * normal);
-	FragPos = vec3(model * vec4(vertexPosition, 1));
+	FragPos = vec3(worldPosition);
+	vec4 colorLayer = texelFetch(materialData, int(material));
+	
+	Color = colorLayer.rgb;
+	Layer = colorLayer.a;
+	LightmapCoords = lightmapCoords * lightmapRect.xy + lightmapRect.zw;
 }
\ No newline at end of file
@@ -0,0 +1,11 @@
+#version 330 core
+
+// overdraw visualization, every fragment that gets shaded adds the same amount with additive blending
+// so a pixel's brightness is how many times it was shaded (1 = dark red, 8 = red, 16 = yellow, 32 = white)
+
+// out
+out vec4 FragColor;
+
+void main(){
+	FragColor = vec4(1.0 / 8.0, 1.0 / 16.0, 1.0 / 32.0, 1);
+}
\ No newline at end of file
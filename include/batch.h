@@ -0,0 +1,44 @@
+// static geometry batching
+
+#ifndef VMR_BATCH_H
+#define VMR_BATCH_H
+
+// includes //
+#include <boxfaces.h>
+#include <graphics.h>
+#include <texture.h>
+#include <world.h>
+
+#include <vector>
+
+// structs //
+
+// a spatial cluster of triangles inside of a static batch
+struct StaticBatchCluster {
+	// bounding sphere (world space)
+	glm::vec3 center;
+	float radius;
+	
+	// range of the batch's element buffer this cluster occupies
+	uint32_t firstIndex;
+	uint32_t indexCount;
+};
+
+// static objects that share a texture binding, pre-transformed into world space and merged into a single vertex data
+// every vertex carries its object's material, and textures packed into the same texture array share a binding, so one batch can hold many colors and textures (see packTextureArrays)
+// once batched, changes to the original objects are not reflected in the batch
+struct StaticBatch {
+	VertexData* vertexData;
+	uint32_t materialVbo; // material of each vertex (attribute 11)
+	
+	TextureData* texture; // first texture in the batch, every other texture in it shares its binding
+	
+	// clusters, in the order they appear in the element buffer
+	std::vector<StaticBatchCluster>* clusters;
+};
+
+// methods //
+StaticBatch* createStaticBatch(std::vector<TexturedRenderableObject*>& objects, float clusterSize, BoxFaceSet* boxFaces);
+void buildSceneStaticBatches(Scene* scene, float clusterSize);
+
+#endif
\ No newline at end of file
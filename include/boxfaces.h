@@ -0,0 +1,63 @@
+// hidden face removal and face merging for static boxes
+
+#ifndef VMR_BOXFACES_H
+#define VMR_BOXFACES_H
+
+// includes //
+#include <graphics.h>
+#include <world.h>
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <map>
+#include <vector>
+
+// macros //
+
+// world space distance under which coordinates are treated as the same (touching boxes, shared edges), and slivers are dropped
+#define BOX_FACE_EPSILON 0.0001f
+
+// structs //
+
+// what's left of one of a static box's faces (or several coplanar faces merged together), a world space rectangle
+// texture and lightmap atlas coordinates are affine across a box's face, so they're kept as a value at lower plus how they change along each axis
+struct BoxFace {
+	uint32_t axis; // axis the face points along, 0 x, 1 y, 2 z
+	float direction; // 1 if it faces +axis, -1 if -axis
+	float plane; // world coordinate along axis
+	
+	// extent along the other two axes ((axis + 1) % 3 and (axis + 2) % 3)
+	glm::vec2 lower;
+	glm::vec2 upper;
+	
+	// texture coordinates (xy) and lightmap atlas coordinates (zw)
+	glm::vec4 attributes; // at lower
+	glm::vec4 attributesU; // per unit along (axis + 1) % 3
+	glm::vec4 attributesV; // per unit along (axis + 2) % 3
+	
+	uint32_t material;
+};
+
+// the faces of a set of static boxes after removing the parts covered by other boxes and merging what's left
+// objects that aren't axis aligned boxes aren't in faces and are drawn as they are
+struct BoxFaceSet {
+	std::map<TexturedRenderableObject*, std::vector<BoxFace>*>* faces; // faces each box draws instead of its vertex data, can be empty if it's completely hidden
+	
+	uint32_t trianglesBefore; // every object's triangles
+	uint32_t trianglesAfter; // with the boxes' faces replaced
+};
+
+// methods //
+void setBoxFaceOptimization(bool enabled);
+bool isBoxFaceOptimizationEnabled();
+
+bool isBoxVertexData(VertexData* vertexData);
+
+BoxFaceSet* optimizeBoxFaces(std::vector<TexturedRenderableObject*>& objects);
+BoxFaceSet* optimizeSceneBoxFaces(Scene* scene);
+void destroyBoxFaceSet(BoxFaceSet* set);
+
+void getBoxFaceGeometry(BoxFace& face, std::vector<Vertex>& vertices, std::vector<uint32_t>& indices);
+
+#endif
\ No newline at end of file
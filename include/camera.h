@@ -31,6 +31,9 @@ struct PerspectiveCamera {
 	glm::mat4 projection; // projection matrix (generally calculated once and left as is)
 	glm::mat4 view; // view matrix (generally set once per frame)
 	glm::mat4 pv; // combination of projection and view matrix (generally should be calculated once per frame for combination with model matrices)
+	
+	// if forward, view and pv are out of date with position/rotation/projection (see updateCameraMatrices)
+	bool dirty;
 };
 
 // camera management
@@ -39,6 +42,8 @@ void updateCameraProjectionMatrix(PerspectiveCamera *camera, float fov, float sc
 
 void updateCameraViewMatrix(PerspectiveCamera *camera);
 void updateCameraViewMatrix(PerspectiveCamera *camera, glm::vec3 position, glm::vec3 rotation);
+void updateCameraMatrices(PerspectiveCamera *camera);
+void setCameraPosition(PerspectiveCamera *camera, glm::vec3 position);
 void translateCamera(PerspectiveCamera *camera, glm::vec3 translation);
 void rotateCamera(PerspectiveCamera *camera, glm::vec3 rotation);
 void constrainCameraRotation(PerspectiveCamera *camera, glm::vec3 lowerBounds, glm::vec3 upperBounds);
@@ -0,0 +1,56 @@
+// deferred shading
+
+#ifndef VMR_DEFERRED_H
+#define VMR_DEFERRED_H
+
+// includes //
+#include <graphics.h>
+#include <permutation.h>
+#include <shader.h>
+#include <world.h>
+
+// structs //
+
+// deferred renderer, draws the scene's surfaces into a g-buffer first and then lights them once per pixel
+// 1. geometry pass: scene is drawn with geometryProgram/instancedGeometryProgram into albedo, normal, and depth textures
+// 2. light pass: a fullscreen pass finds each pixel's light cluster (see lightclusters.h) and adds up the diffuse light of the lights in it into lightTexture
+//    unlike forward shading, each pixel is only lit once no matter how many times it was overdrawn
+// 3. composite: albedo * (ambient + light) is written to whatever framebuffer was bound when the geometry pass started
+struct DeferredRenderer {
+	uint32_t width;
+	uint32_t height;
+	
+	// g-buffer
+	GLuint geometryFramebuffer;
+	GLuint albedoTexture; // rgb = base color
+	GLuint normalTexture; // rgb = world space normal
+	GLuint depthTexture;
+	
+	// light accumulation
+	GLuint lightFramebuffer;
+	GLuint lightTexture; // rgb = diffuse light reaching each pixel
+	
+	// framebuffer to composite into
+	GLint outputFramebuffer;
+	
+	// part of the g-buffer drawn into, the viewport when the geometry pass started (smaller than width x height under dynamic resolution)
+	GLint viewport[4];
+	GLint viewportSizeLocation; // light program's viewportSize uniform
+	
+	// empty vao for drawing fullscreen triangles (the vertex shader makes its own vertices)
+	GLuint emptyVao;
+	
+	// programs
+	ShaderPermutations* geometryPrograms; // lighting/vertex.glsl + deferred/geometryFragment.glsl
+	ShaderProgramEx* geometryProgram; // same uniforms as lighting/vertex.glsl, the draw functions switch to the variant each material needs
+	ShaderProgramEx* instancedGeometryProgram; // same attributes as lighting/vertex.glsl with INSTANCED
+	ShaderProgramEx* lightProgram;
+	ShaderProgramEx* compositeProgram;
+};
+
+// methods //
+DeferredRenderer* createDeferredRenderer(uint32_t width, uint32_t height);
+void beginDeferredGeometryPass(DeferredRenderer* renderer);
+void renderDeferredLighting(DeferredRenderer* renderer, Scene* scene);
+
+#endif
\ No newline at end of file
@@ -0,0 +1,30 @@
+// depth pre-pass
+
+#ifndef VMR_DEPTHPREPASS_H
+#define VMR_DEPTHPREPASS_H
+
+// includes //
+#include <shader.h>
+
+// structs //
+
+// lays down the depth of the whole scene before it's drawn for real, so the expensive lighting shader only runs once per pixel
+// 1. pre-pass: the scene is drawn with program/instancedProgram (position only) with color writes off
+// 2. main pass: the scene is drawn as usual, depth writes off and only fragments matching the pre-pass depth pass the depth test
+// the lighting vertex shaders declare gl_Position invariant so both passes get exactly the same depth
+struct DepthPrepass {
+	ShaderProgramEx* program; // same uniforms as lighting/vertex.glsl
+	ShaderProgramEx* instancedProgram; // same attributes as lighting/vertex.glsl with INSTANCED
+	
+	// depth state from before beginDepthPrepass, the pre-pass tests with the same func and endDepthPrepass puts both back
+	GLint depthFunc;
+	GLint depthMask;
+};
+
+// methods //
+DepthPrepass* createDepthPrepass();
+void beginDepthPrepass(DepthPrepass* prepass);
+void beginDepthPrepassMainPass(DepthPrepass* prepass);
+void endDepthPrepass(DepthPrepass* prepass);
+
+#endif
\ No newline at end of file
@@ -0,0 +1,69 @@
+// static draw lists
+
+#ifndef VMR_DRAWLIST_H
+#define VMR_DRAWLIST_H
+
+// includes //
+#include <camera.h>
+#include <graphics.h>
+#include <texture.h>
+#include <world.h>
+
+#include <vector>
+
+// structs //
+
+// a static object's draw call, with everything needed to issue it resolved when the list is compiled
+struct StaticDrawRecord {
+	VertexData* vertexData; // what instanced rendering groups by
+	
+	// range to draw, read out of the vertex data (see getVertexDataGeneration)
+	GLuint vao;
+	uint32_t first; // first index, or first vertex if count is a vertex count
+	uint32_t count;
+	uint32_t baseVertex;
+	bool indexed;
+	
+	TextureData* texture;
+	uint32_t textureBinding; // see getTextureBinding
+	
+	// bounding sphere (world space), same one isObjectCulled uses
+	glm::vec3 center;
+	float radius;
+};
+
+// records that share vertex data and a texture binding, so they can be drawn as one instance group
+struct StaticDrawRun {
+	uint32_t firstRecord;
+	uint32_t recordCount;
+};
+
+// the draw calls of every visible static object in a scene, compiled once instead of being worked out again every frame
+// records are sorted by vertex data then texture binding, and instances[i] holds record i's matrices, material and lightmap rect
+// has to be invalidated (invalidateStaticDrawList) when static objects are added or changed, moved vertex data is picked up on its own
+struct StaticDrawList {
+	std::vector<StaticDrawRecord>* records;
+	std::vector<InstanceData>* instances;
+	std::vector<StaticDrawRun>* runs;
+	
+	// one bit per record, set if it passed the last cullStaticDrawList
+	std::vector<uint64_t>* visibility;
+	uint32_t visibleCount;
+	
+	bool compiled;
+	uint32_t vertexDataGeneration; // generation the ranges were read at
+};
+
+// methods //
+StaticDrawList* createStaticDrawList();
+void invalidateStaticDrawList(StaticDrawList* list);
+void compileStaticDrawList(StaticDrawList* list, Scene* scene);
+StaticDrawList* updateSceneStaticDrawList(Scene* scene);
+
+uint32_t cullStaticDrawList(StaticDrawList* list, PerspectiveCamera* camera);
+bool isStaticDrawRecordVisible(StaticDrawList* list, uint32_t record);
+void getStaticDrawListVisible(StaticDrawList* list, std::vector<uint32_t>& visible);
+
+void drawStaticDrawRecord(StaticDrawRecord& record);
+
+#endif
\ No newline at end of file
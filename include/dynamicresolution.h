@@ -0,0 +1,48 @@
+// dynamic resolution
+
+#ifndef VMR_DYNAMICRESOLUTION_H
+#define VMR_DYNAMICRESOLUTION_H
+
+// includes //
+#include <glad/glad.h>
+
+#include <cstdint>
+
+// structs //
+
+// renders the scene into an offscreen framebuffer at a fraction of the output size, then upscales it into the output
+// the scale follows the measured gpu time, dropping when frames take longer than targetFrameTime and climbing back up when there's time to spare
+// the offscreen buffers are allocated at full size and only the bottom left renderWidth x renderHeight of them is drawn into, so changing the scale never reallocates
+struct DynamicResolution {
+	// output size
+	uint32_t width;
+	uint32_t height;
+	
+	// fraction of the output size rendered, the same for both axes so the aspect ratio doesn't change
+	float scale;
+	float minScale;
+	float maxScale;
+	
+	double targetFrameTime; // seconds of gpu time per frame to aim for
+	
+	// size of the part of the buffers drawn into this frame
+	uint32_t renderWidth;
+	uint32_t renderHeight;
+	
+	// offscreen buffers
+	GLuint framebuffer;
+	GLuint colorTexture;
+	GLuint depthRenderbuffer;
+	
+	// framebuffer to upscale into
+	GLint outputFramebuffer;
+};
+
+// methods //
+DynamicResolution* createDynamicResolution(uint32_t width, uint32_t height, double targetFrameTime);
+void setDynamicResolutionScale(DynamicResolution* resolution, float scale);
+void updateDynamicResolution(DynamicResolution* resolution, double gpuTime);
+void beginDynamicResolution(DynamicResolution* resolution);
+void endDynamicResolution(DynamicResolution* resolution);
+
+#endif
\ No newline at end of file
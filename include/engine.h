@@ -5,18 +5,75 @@
 
 // includes //
 #include <audio.h>
+#include <batch.h>
 #include <camera.h>
+#include <deferred.h>
+#include <depthprepass.h>
+#include <drawlist.h>
 #include <graphics.h>
+#include <lightclusters.h>
+#include <lightmap.h>
+#include <material.h>
 #include <mouse.h>
+#include <permutation.h>
 #include <shader.h>
 #include <texture.h>
 #include <utils.h>
 #include <world.h>
 
+// enums //
+
+// ways of submitting a scene's static objects
+typedef enum {
+	RENDER_PER_OBJECT, // one draw call per object (renderScene)
+	RENDER_INSTANCED, // one draw call per vertex data/texture pair (renderSceneInstanced)
+	RENDER_MULTI_DRAW, // one draw call per vao/texture pair, if multi-draw indirect is supported (renderSceneMultiDraw)
+	RENDER_BATCHED // one draw call per run of visible clusters in each static batch (renderSceneBatched)
+} SceneRenderMode;
+
+// structs //
+
+// render statistics, accumulated by the scene render methods until resetRenderStats is called
+struct RenderStats {
+	uint32_t drawCalls;
+	uint32_t objectsRendered; // objects, or clusters for batches, that weren't culled
+	uint32_t lightUploads; // lights written to the light data buffer
+	uint32_t vertexArrayBinds; // vao switches, pooled vertex data share a vao so these are only needed between pages
+};
+
 // methods //
+RenderStats* getRenderStats();
+void resetRenderStats();
+
+void setFrontToBackSorting(bool enabled);
+
+bool updateSceneLightBuffer(Scene* scene);
+bool updateSceneLightBuffer(Scene* scene, std::vector<PointLight*>& lights);
+void updateSceneLightClusters(Scene* scene, PerspectiveCamera* camera);
+bool updateSceneCameraBuffer(Scene* scene, PerspectiveCamera* camera);
+void updateSceneUniformBuffers(Scene* scene, PerspectiveCamera* camera);
+void updateSceneUniformBuffers(Scene* scene, PerspectiveCamera* camera, std::vector<PointLight*>& lights);
+
+void addRandomPointLights(Scene* scene, uint32_t count);
+
 void renderTexturedRenderableObject(TexturedRenderableObject* texturedRenderableObject, PerspectiveCamera* camera, ShaderProgramEx* programEx);
 void renderTexturedRenderableObjectNoBind(TexturedRenderableObject* texturedRenderableObject, PerspectiveCamera* camera, ShaderProgramEx* programEx);
 
+bool isSphereCulled(glm::vec3 center, float radius, PerspectiveCamera* camera);
+bool isObjectCulled(TexturedRenderableObject* object, PerspectiveCamera* camera);
+
 void renderScene(Scene* scene, PerspectiveCamera* camera, ShaderProgramEx* programEx);
+void collectSceneInstances(Scene* scene, PerspectiveCamera* camera, std::vector<InstanceData>& instances, std::vector<InstanceGroup>& groups);
+void sortSceneInstanceGroups(std::vector<InstanceGroup>& groups, SceneRenderMode mode);
+bool uploadSceneInstances(Scene* scene, std::vector<InstanceData>& instances);
+bool buildSceneInstances(Scene* scene, PerspectiveCamera* camera);
+void drawSceneInstancesPerObject(Scene* scene, std::vector<InstanceData>& instances, std::vector<InstanceGroup>& groups, PerspectiveCamera* camera, ShaderProgramEx* programEx);
+void drawSceneInstanced(Scene* scene, std::vector<InstanceGroup>& groups, ShaderProgramEx* programEx);
+void drawSceneMultiDraw(Scene* scene, std::vector<InstanceGroup>& groups, ShaderProgramEx* programEx);
+void drawSceneBatched(Scene* scene, PerspectiveCamera* camera, ShaderProgramEx* programEx);
+void renderSceneInstanced(Scene* scene, PerspectiveCamera* camera, ShaderProgramEx* programEx);
+void renderSceneMultiDraw(Scene* scene, PerspectiveCamera* camera, ShaderProgramEx* programEx);
+void renderSceneBatched(Scene* scene, PerspectiveCamera* camera, ShaderProgramEx* programEx);
+void renderSceneMode(Scene* scene, PerspectiveCamera* camera, SceneRenderMode mode, ShaderProgramEx* program, ShaderProgramEx* instancedProgram);
 
 #endif
\ No newline at end of file
@@ -0,0 +1,58 @@
+// swappable gl backends, so the render path can run (and be measured) without a gpu
+
+#ifndef VMR_GLBACKEND_H
+#define VMR_GLBACKEND_H
+
+// includes //
+#include <glad/glad.h>
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// enums //
+
+// where the engine's gl calls go
+typedef enum {
+	GL_BACKEND_REAL, // the driver, needs a context (the default)
+	GL_BACKEND_NULL, // nowhere, calls are discarded and return fake object names and whatever the engine needs to carry on (see glbackend.cpp)
+	GL_BACKEND_RECORDING // counted and logged with their arguments, then passed to the driver, or to the null backend if there's no context
+} GlBackend;
+
+// structs //
+
+// one call seen by the recording backend
+struct GlRecordedCall {
+	uint32_t function; // see getGlFunctionName
+	std::string arguments; // comma separated
+};
+
+// what the recording backend saw since the last clearGlRecording
+struct GlRecording {
+	std::vector<GlRecordedCall>* calls; // in order, only kept while logging calls (see setGlRecordingLog)
+	std::vector<uint64_t>* counts; // calls of each function, always kept
+	
+	uint64_t totalCalls;
+	
+	bool log;
+};
+
+// methods //
+void initGlBackend(GLADloadproc load);
+void* loadGlBackendProc(const char* name);
+
+bool setGlBackend(GlBackend backend);
+GlBackend getGlBackend();
+bool hasRealGl();
+
+uint32_t getGlFunctionCount();
+const char* getGlFunctionName(uint32_t function);
+
+GlRecording* getGlRecording();
+void clearGlRecording();
+void setGlRecordingLog(bool enabled);
+uint64_t getGlCallCount(const char* name);
+void printGlRecordingLog();
+void printGlCallCounts(uint32_t frames);
+
+#endif
\ No newline at end of file
@@ -0,0 +1,48 @@
+// gl state cache
+
+#ifndef VMR_GLSTATE_H
+#define VMR_GLSTATE_H
+
+// includes //
+#include <glad/glad.h>
+
+#include <cstdint>
+
+// macros //
+
+// texture units whose bindings are tracked, covers every unit the engine uses (object textures and the reserved units in shader.h)
+#define GL_STATE_TEXTURE_UNITS 16
+
+// structs //
+
+// gl calls that went through the state cache, and how many of them were skipped because the state was already set
+struct GlStateCounter {
+	uint32_t issued;
+	uint32_t elided;
+};
+
+// state cache activity since the last resetGlStateStats
+struct GlStateStats {
+	GlStateCounter programs; // glUseProgram
+	GlStateCounter vertexArrays; // glBindVertexArray
+	GlStateCounter textureUnits; // glActiveTexture
+	GlStateCounter textures; // glBindTexture
+	GlStateCounter uniforms; // glUniform* on well known uniforms (see setProgramExUniformInt and friends in shader.h)
+};
+
+// methods //
+void setGlStateCaching(bool enabled);
+bool isGlStateCachingEnabled();
+
+GlStateStats* getGlStateStats();
+void resetGlStateStats();
+void countGlStateCall(GlStateCounter* counter, bool issued);
+
+void useGlProgram(GLuint program);
+void deleteGlProgram(GLuint program);
+void bindGlVertexArray(GLuint vao);
+void deleteGlVertexArray(GLuint vao);
+void bindGlTexture(GLuint unit, GLenum target, GLuint texture);
+void deleteGlTexture(GLuint texture);
+
+#endif
\ No newline at end of file
@@ -14,6 +14,7 @@
 #include <camera.h>
 #include <shader.h>
 #include <texture.h>
+#include <transform.h>
 
 #include <vector>
 
@@ -21,6 +22,12 @@
 #include <assimp/scene.h>           // Output data structure
 #include <assimp/postprocess.h>     // Post processing flags
 
+// macros //
+
+// default size of a mesh pool page, vertex data too big for this gets a page of its own
+#define MESH_POOL_PAGE_VERTICES 262144
+#define MESH_POOL_PAGE_INDICES 786432
+
 // enums //
 
 // initGraphics() status
@@ -41,17 +48,56 @@ struct Vertex {
 	glm::vec3 position;
 	glm::vec2 textureCoordinates;
 	glm::vec3 normal;
+	glm::vec2 lightmapCoordinates; // second uv set, no two triangles overlap (see unwrapLightmapCoordinates), zero until unwrapped
 };
 
+struct MeshPoolPage;
+
 // vertex data
+// usually a range of a mesh pool page (vbo, vao and ebo are shared with every other vertex data in the page)
 struct VertexData {
 	uint32_t vbo; // vertex buffer object
 	uint32_t vao; // vertex array object
 	uint32_t ebo; // elements buffer object
 	
 	uint32_t vertexCount; // number of vertices
-	uint32_t indexCount; // number of indices, if ebo != 0 (otherwise 0)
+	uint32_t indexCount; // number of indices, 0 if drawn without indices
 	uint32_t sizeInBytes;
+	
+	// where the vertices/indices start in vbo/ebo (0 unless pooled), indices are relative to baseVertex
+	uint32_t baseVertex;
+	uint32_t firstIndex;
+	
+	MeshPoolPage* page; // page the vertex data was allocated from, NULL if it owns its buffers
+	
+	// cpu side copy of the vertices/indices uploaded to the gpu, used for things like static batching
+	std::vector<Vertex>* vertices;
+	std::vector<uint32_t>* indices; // empty if indexCount == 0
+};
+
+// a free range of a mesh pool page's vertices or indices
+struct MeshPoolRange {
+	uint32_t first;
+	uint32_t count;
+};
+
+// a large vertex buffer and element buffer shared by many vertex data, so they can all be drawn with one vao bound
+// every pooled vertex data uses the Vertex layout, so one vao per page is enough
+// freed ranges go back on the free lists and are merged with their neighbours, defragmentMeshPool compacts what's left
+struct MeshPoolPage {
+	uint32_t vbo;
+	uint32_t vao;
+	uint32_t ebo;
+	
+	uint32_t vertexCapacity;
+	uint32_t indexCapacity;
+	
+	// free ranges, sorted by first
+	std::vector<MeshPoolRange>* freeVertices;
+	std::vector<MeshPoolRange>* freeIndices;
+	
+	// every vertex data allocated from the page
+	std::vector<VertexData*>* allocations;
 };
 
 // mesh
@@ -62,6 +108,8 @@ struct Mesh {
 	
 	TextureData* texture; // TODO: multiple?
 	glm::vec3 color; // color if texture is null
+	
+	glm::mat4 transform; // transformation of the mesh's node relative to the model's root node
 };
 
 // model
@@ -81,21 +129,49 @@ struct Model {
 struct RenderableObject {
 	VertexData* vertexData;
 	
-	glm::vec3 position;
-	glm::vec3 rotation;
-	glm::vec3 scale;
-	
 	std::vector<glm::vec3> corners;
 	
-	glm::mat4 modelMatrix;
+	Transform* transform; // model matrix is the transform's world matrix
+};
+
+// per-instance data for instanced rendering
+// laid out to match the instance attributes in lighting/vertex.glsl with INSTANCED (locations 3-11 and 13)
+struct InstanceData {
+	glm::mat4 model;
+	glm::mat3 normalMatrix;
+	uint32_t material; // index into the scene's material table, which holds the color and texture array layer
+	glm::vec4 lightmapRect; // scale (xy) and offset (zw) from lightmap coordinates to the scene's lightmap atlas
+};
+
+// instance buffer
+// one buffer holds the instances of every group drawn in a frame, groups are selected with firstInstance
+struct InstanceBuffer {
+	uint32_t vbo; // vertex buffer object holding the last upload's InstanceData (a region of stream)
+	
+	StreamBuffer* stream;
+};
+
+// a range of instances in an instance buffer which share vertex data and texture, drawn with a single call
+struct InstanceGroup {
+	VertexData* vertexData;
+	TextureData* texture; // first texture in the group, every other texture in it shares its binding (see getTextureBinding)
+	
+	uint32_t firstInstance;
+	uint32_t instanceCount;
+	
+	float distance; // squared distance from the camera to the nearest instance, 0 unless sorting front to back
 };
 
 // window management
 InitGraphicsStatus initGraphics();
+void initHeadlessGraphics(uint32_t width, uint32_t height);
 void terminateGraphics();
 Window* createWindow(int32_t width, int32_t height, const char* title);
 bool shouldWindowClose(Window* window);
 void updateWindow(Window* window);
+void swapWindowBuffers(Window* window);
+void pollWindowEvents();
+void setWindowContextCurrent(Window* window);
 void clearWindow(float r, float g, float b);
 
 // vertex management
@@ -106,9 +182,23 @@ VertexData* createVertexData(float *vertices, uint32_t vertexCount, uint32_t siz
 VertexData* createVertexData(Vertex *vertices, uint32_t vertexCount, uint32_t sizeInBytes);
 VertexData* createVertexData(std::vector<Vertex> vertices);
 VertexData* createVertexData(std::vector<Vertex> vertices, std::vector<uint32_t> indices);
+VertexData* createStandaloneVertexData(std::vector<Vertex> vertices, std::vector<uint32_t> indices);
+bool setVertexDataVertices(VertexData* data, std::vector<Vertex>& vertices, std::vector<uint32_t>& indices);
+void deleteVertexData(VertexData* data);
 void bindVertexData(VertexData* data);
 void renderVertexData(VertexData* data);
 void renderVertexDataNoBind(VertexData* data);
+void renderVertexDataInstancedNoBind(VertexData* data, uint32_t instanceCount);
+
+// mesh pool management
+void setMeshPoolEnabled(bool enabled);
+uint32_t getVertexDataGeneration();
+void defragmentMeshPool();
+
+// instance buffer management
+InstanceBuffer* createInstanceBuffer(uint32_t capacity);
+void uploadInstanceBuffer(InstanceBuffer* buffer, std::vector<InstanceData>& instances);
+void bindVertexDataInstances(VertexData* data, InstanceBuffer* buffer, uint32_t firstInstance);
 
 // renderable object management
 RenderableObject* createRenderableObject(VertexData* vertexData, glm::vec3 position, glm::vec3 rotation, glm::vec3 scale);
@@ -0,0 +1,82 @@
+// clustered light assignment
+
+#ifndef VMR_LIGHTCLUSTERS_H
+#define VMR_LIGHTCLUSTERS_H
+
+// includes //
+#include <camera.h>
+#include <lighting.h>
+#include <shader.h>
+
+#include <glm/glm.hpp>
+
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// macros //
+
+// default grid size, x and y split the screen and z splits view depth
+#define LIGHT_CLUSTERS_X 16
+#define LIGHT_CLUSTERS_Y 9
+#define LIGHT_CLUSTERS_Z 24
+
+// assignments with fewer lights than this aren't worth starting worker threads for
+#define LIGHT_CLUSTER_THREAD_THRESHOLD 64
+
+// structs //
+
+// grid of view space clusters, each with a list of the lights that can reach it
+// the fragment shader finds its cluster and only shades those lights instead of every light in the scene
+struct LightClusterGrid {
+	// number of clusters along each axis
+	// x and y are uniform in normalized device coordinates, z slices are exponential in view depth
+	uint32_t sizeX;
+	uint32_t sizeY;
+	uint32_t sizeZ;
+	
+	// depth range covered by the z slices (the camera's near and far planes at the last assignment)
+	float near;
+	float far;
+	
+	// indexes of the lights touching each cluster, cluster index = x + y*sizeX + z*sizeX*sizeY
+	std::vector<std::vector<uint32_t>>* clusterLights;
+	
+	// view space position (xyz) and radius (w) of each light, rebuilt every assignment
+	std::vector<glm::vec4>* viewLights;
+	
+	// flattened lists for upload, clusterRanges holds the offset into lightIndices and the count of each cluster
+	std::vector<uint32_t>* clusterRanges;
+	std::vector<uint32_t>* lightIndices;
+	
+	// number of extra threads used for assignment (0 = only the calling thread)
+	// workers are started with the grid and wait for assignments, the calling thread takes part in every assignment as thread 0
+	uint32_t workerCount;
+	std::vector<std::thread*>* workers;
+	
+	std::mutex* mutex;
+	std::condition_variable* condition; // signalled when an assignment starts or a worker finishes its slices
+	uint32_t generation; // bumped every time an assignment starts
+	uint32_t busyWorkers;
+	bool quit;
+	
+	// current assignment, threads at or past threadCount sit it out
+	glm::mat4 projection;
+	uint32_t threadCount;
+	
+	// gpu copies of clusterRanges and lightIndices
+	TextureBuffer* clusterBuffer;
+	TextureBuffer* indexBuffer;
+};
+
+// methods //
+LightClusterGrid* createLightClusterGrid(uint32_t sizeX, uint32_t sizeY, uint32_t sizeZ);
+void destroyLightClusterGrid(LightClusterGrid* grid);
+void assignLightClusters(LightClusterGrid* grid, std::vector<PointLight*>& lights, PerspectiveCamera* camera);
+void uploadLightClusters(LightClusterGrid* grid);
+void bindLightClusters(LightClusterGrid* grid);
+float getLightClusterDepthScale(LightClusterGrid* grid);
+float getLightClusterDepthBias(LightClusterGrid* grid);
+
+#endif
\ No newline at end of file
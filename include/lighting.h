@@ -6,6 +6,13 @@
 // includes //
 #include <glm/glm.hpp>
 
+#include <cmath>
+
+// macros //
+
+// a light's diffuse contribution below this is considered invisible, used to find its radius of influence
+#define LIGHT_INFLUENCE_CUTOFF (1.0f / 256.0f)
+
 // structs //
 
 // point light
@@ -22,11 +29,20 @@ struct PointLight {
 	float l;
 	float q;
 	
-	// range?
-	// float range;
+	// distance past which the light's diffuse contribution drops below LIGHT_INFLUENCE_CUTOFF (see updatePointLightRadius)
+	// HUGE_VALF if the light never attenuates below the cutoff
+	float radius;
+	
+	// set when the light has changed since it was last uploaded (see updateSceneLightBuffer)
+	bool dirty;
 };
 
 // point light management
 PointLight* createPointLight(glm::vec3 position, glm::vec3 color, float ambientStrength, float diffuseStrength, float c, float l, float q);
+void setPointLightPosition(PointLight* light, glm::vec3 position);
+void setPointLightColor(PointLight* light, glm::vec3 color);
+void setPointLightStrengths(PointLight* light, float ambientStrength, float diffuseStrength);
+void setPointLightAttenuation(PointLight* light, float c, float l, float q);
+void updatePointLightRadius(PointLight* light);
 
 #endif
\ No newline at end of file
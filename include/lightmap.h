@@ -0,0 +1,90 @@
+// baked lightmaps
+
+#ifndef VMR_LIGHTMAP_H
+#define VMR_LIGHTMAP_H
+
+// includes //
+#include <graphics.h>
+#include <lighting.h>
+#include <world.h>
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <vector>
+
+// macros //
+
+// default width and height of the atlas, and world space texels per unit objects start out packed at
+// the density is lowered until every object fits
+#define LIGHTMAP_ATLAS_SIZE 2048
+#define LIGHTMAP_TEXELS_PER_UNIT 16.f
+
+// empty texels left between charts and between objects, so bilinear filtering doesn't blend unrelated surfaces
+#define LIGHTMAP_PADDING 2
+
+// smallest size (in texels) an object gets in the atlas, its charts are padded for this size so smaller would let them bleed
+#define LIGHTMAP_MIN_OBJECT_SIZE 32
+
+// triangles whose normals are within this (cosine) of a chart's normal join it when unwrapping
+#define LIGHTMAP_CHART_ANGLE 0.9f
+
+// shadow rays start this far off of the surface, so they don't hit the triangle they start on
+#define LIGHTMAP_SHADOW_BIAS 0.01f
+
+// triangles per bvh leaf
+#define LIGHTMAP_BVH_LEAF_SIZE 4
+
+// rows of an object baked at a time, objects are split into bands of rows so one huge object doesn't end up on a single thread
+#define LIGHTMAP_BAKE_ROWS 16
+
+// structs //
+
+// a world space triangle the baker traces against, stored as a corner and two edges
+struct LightmapTriangle {
+	glm::vec3 v0;
+	glm::vec3 e1; // v1 - v0
+	glm::vec3 e2; // v2 - v0
+};
+
+// node of the bounding volume hierarchy over every static triangle
+// inner nodes have count 0 and their children at first and first + 1, leaves hold count triangles starting at first
+struct LightmapBvhNode {
+	glm::vec3 lower;
+	glm::vec3 upper;
+	
+	uint32_t first;
+	uint32_t count;
+};
+
+// the world space position and normal a lightmap texel is lit at, found by rasterizing each object into the atlas
+struct LightmapSample {
+	glm::vec3 position;
+	glm::vec3 normal;
+	
+	bool valid; // false if no triangle covers the texel
+};
+
+// direct lighting of a scene's static objects, baked into a single atlas
+// each object's vertex data is unwrapped into the 0-1 range (lightmapCoordinates), and every object gets its own square of the atlas (lightmapRect)
+// only diffuse light from point lights is baked, ambient light is still added by the shader
+struct Lightmap {
+	uint32_t size; // width and height in texels
+	float texelsPerUnit; // world space density the objects ended up packed at
+	
+	std::vector<glm::vec3>* texels; // size * size, rows start at the bottom (v = 0), black until baked or read
+	
+	GLuint texture; // 0 until uploaded
+};
+
+// methods //
+float unwrapLightmapCoordinates(VertexData* data);
+Lightmap* createSceneLightmap(Scene* scene, uint32_t size);
+void bakeSceneLightmap(Scene* scene, Lightmap* lightmap, uint32_t threadCount);
+bool writeLightmap(Lightmap* lightmap, const char* path);
+bool readLightmap(Lightmap* lightmap, const char* path);
+bool uploadLightmap(Lightmap* lightmap);
+void bindLightmap(Lightmap* lightmap);
+
+#endif
\ No newline at end of file
@@ -0,0 +1,43 @@
+// material table
+
+#ifndef VMR_MATERIAL_H
+#define VMR_MATERIAL_H
+
+// includes //
+#include <shader.h>
+#include <texture.h>
+#include <world.h>
+
+#include <glm/glm.hpp>
+
+#include <vector>
+
+// structs //
+
+// how a surface looks, objects with the same texture and color share one
+// the shaders add the texture sample and color, so color is usually black for textured materials and the texture NULL for colored ones
+struct Material {
+	TextureData* texture;
+	glm::vec3 color;
+};
+
+// every material of a scene, objects refer to theirs by index (see TexturedRenderableObject::material)
+// the gpu copy is a texture buffer with one texel per material, (color, texture array layer), read by the vertex shaders
+// since the color and layer come from the table, objects that only differ in those can share draws
+struct MaterialTable {
+	std::vector<Material>* materials;
+	
+	TextureBuffer* buffer; // created on first upload
+	bool dirty; // materials were added, or their textures were packed, since the last upload
+};
+
+// methods //
+MaterialTable* createMaterialTable();
+uint32_t addMaterial(MaterialTable* table, TextureData* texture, glm::vec3 color);
+void invalidateMaterialTable(MaterialTable* table);
+bool uploadMaterialTable(MaterialTable* table);
+void bindMaterialTable(MaterialTable* table);
+
+void assignSceneMaterials(Scene* scene);
+
+#endif
\ No newline at end of file
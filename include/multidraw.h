@@ -0,0 +1,52 @@
+// multi-draw indirect submission
+
+#ifndef VMR_MULTIDRAW_H
+#define VMR_MULTIDRAW_H
+
+// includes //
+#include <graphics.h>
+#include <streambuffer.h>
+#include <texture.h>
+
+#include <glad/glad.h>
+
+#include <cstdint>
+#include <vector>
+
+// macros //
+
+// GL_ARB_draw_indirect isn't part of the 3.3 core loader
+#ifndef GL_DRAW_INDIRECT_BUFFER
+#define GL_DRAW_INDIRECT_BUFFER 0x8F3F
+#endif
+
+// structs //
+
+// one draw of a multi-draw, laid out the way glMultiDrawElementsIndirect reads it
+// baseInstance offsets the instance attributes, so each command draws its own range of an instance buffer
+struct DrawElementsIndirectCommand {
+	uint32_t count; // index count
+	uint32_t instanceCount;
+	uint32_t firstIndex;
+	int32_t baseVertex;
+	uint32_t baseInstance;
+};
+
+// a run of draw commands that share a vao and texture binding, submitted with a single multi-draw
+struct MultiDrawBucket {
+	VertexData* vertexData; // vertex data of the first command, every other command shares its vao
+	TextureData* texture; // texture of the first command, every other command shares its binding
+	
+	uint32_t firstCommand;
+	uint32_t commandCount;
+};
+
+// methods //
+void initMultiDraw(GLADloadproc load);
+void setMultiDrawIndirect(bool enabled);
+bool isMultiDrawIndirectSupported();
+
+DrawElementsIndirectCommand createDrawElementsIndirectCommand(VertexData* data, uint32_t firstInstance, uint32_t instanceCount);
+uint32_t multiDrawElementsIndirect(GLuint commandBuffer, std::vector<DrawElementsIndirectCommand>& commands, MultiDrawBucket& bucket, InstanceBuffer* instanceBuffer);
+
+#endif
\ No newline at end of file
@@ -0,0 +1,54 @@
+// shader permutations
+
+#ifndef VMR_PERMUTATION_H
+#define VMR_PERMUTATION_H
+
+// includes //
+#include <shader.h>
+#include <texture.h>
+
+#include <cstdint>
+#include <map>
+#include <string>
+
+// enums //
+
+// features a program is built with for its whole life, picked when it's created
+// each one is #defined in both shaders of the variants that have it
+typedef enum {
+	SHADER_FEATURE_INSTANCED = 1 << 0, // per-instance attributes instead of per-object uniforms (INSTANCED)
+	SHADER_FEATURE_LIGHTMAPPED = 1 << 1 // light from the lightmap instead of the scene's lights (LIGHTMAPPED)
+} ShaderFeature;
+
+// how a variant gets its base color, picked per draw from the material's texture (see getShaderTextureMode)
+typedef enum {
+	SHADER_UNTEXTURED, // material color only, nothing is sampled
+	SHADER_TEXTURED, // texture1 + material color (TEXTURED)
+	SHADER_TEXTURE_ARRAY, // textureArray at the material's layer + material color (TEXTURE_ARRAY)
+	
+	SHADER_TEXTURE_MODE_COUNT
+} ShaderTextureMode;
+
+// structs //
+
+// every variant of a vertex and fragment shader pair, compiled from the same sources with different #defines
+// variants share attribute locations, uniform names and uniform blocks, so anything set up for one works the same for the others
+struct ShaderPermutations {
+	const char* vertexPath;
+	const char* fragmentPath;
+	
+	// variants compiled so far by key (see getShaderPermutationKey), NULL for ones that failed to compile
+	std::map<uint32_t, ShaderProgramEx*>* programs;
+};
+
+// methods //
+ShaderPermutations* createShaderPermutations(const char* vertexPath, const char* fragmentPath);
+std::string getShaderPermutationDefines(uint32_t features, ShaderTextureMode textureMode);
+ShaderProgramEx* getShaderPermutation(ShaderPermutations* permutations, uint32_t features, ShaderTextureMode textureMode);
+bool precompileShaderPermutations(ShaderPermutations* permutations, uint32_t features);
+
+ShaderTextureMode getShaderTextureMode(TextureData* textureData, bool useTextureArrays);
+ShaderProgramEx* getProgramExVariant(ShaderProgramEx* programEx, ShaderTextureMode textureMode);
+ShaderProgramEx* useProgramExObjectTexture(ShaderProgramEx* programEx, TextureData* textureData);
+
+#endif
\ No newline at end of file
@@ -0,0 +1,61 @@
+// shader program binary cache
+
+#ifndef VMR_PROGRAMCACHE_H
+#define VMR_PROGRAMCACHE_H
+
+// includes //
+#include <glad/glad.h>
+
+#include <cstdint>
+#include <map>
+#include <vector>
+
+// macros //
+
+// GL_ARB_get_program_binary isn't part of the 3.3 core loader
+#ifndef GL_PROGRAM_BINARY_RETRIEVABLE_HINT
+#define GL_PROGRAM_BINARY_RETRIEVABLE_HINT 0x8257
+#endif
+
+#ifndef GL_PROGRAM_BINARY_LENGTH
+#define GL_PROGRAM_BINARY_LENGTH 0x8741
+#endif
+
+#ifndef GL_NUM_PROGRAM_BINARY_FORMATS
+#define GL_NUM_PROGRAM_BINARY_FORMATS 0x87FE
+#endif
+
+// where the cache is kept unless another path is given (relative to the working directory, like the shaders themselves)
+#define DEFAULT_PROGRAM_CACHE_PATH "./res/shader/programs.cache"
+
+// structs //
+
+// a linked program as the driver hands it out, only valid for the driver that made it
+struct ProgramBinary {
+	GLenum format;
+	std::vector<uint8_t> data;
+};
+
+// how programs were created since the cache was opened
+struct ProgramCacheStats {
+	uint32_t hits; // loaded from a cached binary
+	uint32_t misses; // compiled from source, no binary was cached for them
+	uint32_t rejected; // had a cached binary the driver wouldn't load, compiled from source instead
+	
+	double time; // seconds spent creating programs, cached or not
+};
+
+// methods //
+void initProgramCache(GLADloadproc load);
+bool isProgramCacheSupported();
+void openProgramCache(const char* path);
+void closeProgramCache();
+
+ProgramCacheStats* getProgramCacheStats();
+
+void hintProgramBinaryRetrievable(GLuint program);
+uint64_t getProgramCacheKey(const char* vertexSource, const char* fragmentSource);
+GLuint loadCachedProgram(uint64_t key);
+void storeCachedProgram(uint64_t key, GLuint program);
+
+#endif
\ No newline at end of file
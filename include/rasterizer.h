@@ -0,0 +1,161 @@
+// software rasterizer
+
+#ifndef VMR_RASTERIZER_H
+#define VMR_RASTERIZER_H
+
+// includes //
+#include <renderthread.h>
+#include <textureloader.h>
+
+#include <glm/glm.hpp>
+
+#include <atomic>
+#include <condition_variable>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// macros //
+
+// width and height of the screen tiles triangles are binned into, each tile is rasterized by one thread at a time
+// a multiple of 4, so the groups of 4 pixels rasterizeTriangle works on never cross into another tile
+#define RASTERIZER_TILE_SIZE 64
+
+// fractional bits of the fixed point screen coordinates triangles are snapped to
+#define RASTERIZER_SUBPIXEL_BITS 4
+
+// triangles are only clipped against the sides of the screen past this many screen widths/heights, the rest is rejected per tile
+#define RASTERIZER_GUARD_BAND 2.0f
+
+// structs //
+
+// a texture decoded into memory, rgba with the bottom row first (the same way gl stores it)
+struct RasterizerTexture {
+	int32_t width;
+	int32_t height;
+	
+	std::vector<uint32_t>* texels;
+};
+
+// a vertex after the vertex stage, the same outputs as lighting/vertex.glsl
+struct RasterizerVertex {
+	glm::vec4 clip; // pv * world position
+	glm::vec3 position; // world space
+	glm::vec3 normal; // world space, normalized
+	glm::vec2 textureCoordinates;
+};
+
+// a triangle set up for rasterizing, in screen space
+// attributes are interpolated with barycentric coordinates weighted by 1/w, so they come out perspective correct
+struct RasterizerTriangle {
+	// fixed point positions (RASTERIZER_SUBPIXEL_BITS), counter clockwise
+	int32_t x[3];
+	int32_t y[3];
+	
+	float z[3]; // depth (normalized device z)
+	float inverseW[3];
+	
+	double area; // twice the area, in fixed point units
+	
+	glm::vec3 position[3]; // world space
+	glm::vec3 normal[3];
+	glm::vec2 textureCoordinates[3];
+	
+	// covered pixels, inclusive
+	int32_t minX;
+	int32_t minY;
+	int32_t maxX;
+	int32_t maxY;
+	
+	glm::vec3 color; // material color
+	RasterizerTexture* texture; // NULL if the material has no texture
+	
+	// range of the frame's light indices that reach the triangle's object
+	uint32_t firstLight;
+	uint32_t lightCount;
+};
+
+// what one thread set up during the geometry stage
+// bins hold indices into triangles, one bin per tile, in the order the triangles were submitted
+struct RasterizerThreadData {
+	std::vector<RasterizerVertex>* vertices; // vertex stage output of the instance being set up
+	std::vector<RasterizerTriangle>* triangles;
+	std::vector<std::vector<uint32_t>>* bins;
+	
+	// instances of the frame this thread sets up
+	uint32_t firstInstance;
+	uint32_t instanceCount;
+};
+
+// draws frame packets on the cpu, for machines without a usable gpu
+// 1. geometry: the packet's instances are split between the threads, which transform, cull, clip and set up their triangles and bin them by tile
+// 2. raster: threads take tiles one at a time and rasterize every triangle binned to them (from every thread, in submission order), 4 pixels at once
+//    shading is the same as lighting/fragment.glsl: texture + material color, lit by ambient light plus the point lights that reach the object
+// the frame ends up in colorBuffer, which can be written to an image, nothing is drawn or presented with gl
+struct SoftwareRasterizer {
+	Scene* scene;
+	
+	uint32_t width;
+	uint32_t height;
+	
+	uint32_t stride; // pixels per row of the color and depth buffers, width rounded up to a multiple of 4
+	
+	uint32_t tilesX;
+	uint32_t tilesY;
+	
+	// bottom row first, like the gl framebuffer
+	std::vector<uint32_t>* colorBuffer; // rgba8
+	std::vector<float>* depthBuffer;
+	
+	// every texture drawn so far, converted from its decoded image (see getTextureImage) the first time it's drawn
+	std::map<TextureData*, RasterizerTexture*>* textures;
+	
+	// object space bounds of every vertex data drawn so far, to find the lights that reach each instance
+	std::map<VertexData*, std::pair<glm::vec3, glm::vec3>>* bounds;
+	
+	// the frame being drawn, shared with the worker threads
+	FramePacket* packet;
+	std::vector<VertexData*>* instanceVertexData; // vertex data of each of the packet's instances
+	std::vector<RasterizerTexture*>* materialTextures; // texture of each of the scene's materials
+	std::vector<glm::vec4>* lights; // (position, radius), (color * diffuseStrength, c), (l, q, unused, unused) like the light data buffer
+	std::vector<uint32_t>* lightIndices;
+	std::vector<uint32_t>* instanceLights; // first light index of each instance, followed by the count
+	glm::vec3 ambientLight;
+	
+	// worker threads, the thread drawing the frame takes part in every stage as thread 0
+	uint32_t threadCount;
+	std::vector<RasterizerThreadData>* threads;
+	std::vector<std::thread*>* workers;
+	
+	std::mutex* mutex;
+	std::condition_variable* condition; // signalled when a stage starts or a worker finishes one
+	uint32_t stage; // see runRasterizerStage
+	uint32_t generation; // bumped every time a stage starts
+	uint32_t busyWorkers;
+	bool quit;
+	
+	std::atomic<uint32_t>* nextTile;
+	
+	const char* imagePath; // if set, every frame is written here (see writeSoftwareRasterizerImage)
+	
+	bool printStats;
+	
+	// stats, printed once a second
+	uint32_t statsFrames;
+	double statsStart;
+	double statsGeometryTime;
+	double statsRasterTime;
+	double statsWriteTime;
+	double statsTriangles; // triangles set up (after culling and clipping)
+	double statsBinnedTriangles; // triangle/tile pairs
+};
+
+// methods //
+SoftwareRasterizer* createSoftwareRasterizer(Scene* scene, uint32_t width, uint32_t height, uint32_t threadCount);
+void destroySoftwareRasterizer(SoftwareRasterizer* rasterizer);
+
+void renderSoftwareRasterizerFrame(SoftwareRasterizer* rasterizer, FramePacket* packet);
+bool writeSoftwareRasterizerImage(SoftwareRasterizer* rasterizer, const char* path);
+
+#endif
\ No newline at end of file
@@ -0,0 +1,40 @@
+// renderer backends
+
+#ifndef VMR_RENDERER_H
+#define VMR_RENDERER_H
+
+// includes //
+#include <rasterizer.h>
+#include <renderthread.h>
+
+// enums //
+
+// what turns frame packets into frames
+typedef enum {
+	RENDERER_OPENGL, // FrameRenderer, the scene drawn with gl (see renderFramePacket)
+	RENDERER_SOFTWARE // SoftwareRasterizer, the scene drawn on the cpu (see renderSoftwareRasterizerFrame)
+} RendererBackend;
+
+// structs //
+
+// draws frame packets with one of the backends, picked when it's created
+// the simulation side (building packets, the render thread's hand-off) is the same for every backend, the backend only sees the packets
+// plus scene data that doesn't change after loading, so it can keep its own copies of meshes and textures in whatever form it needs
+struct Renderer {
+	RendererBackend backend;
+	
+	FrameRenderer* frameRenderer; // RENDERER_OPENGL
+	SoftwareRasterizer* softwareRasterizer; // RENDERER_SOFTWARE
+};
+
+// methods //
+Renderer* createOpenGlRenderer(FrameRenderer* frameRenderer);
+Renderer* createSoftwareRenderer(SoftwareRasterizer* softwareRasterizer);
+const char* getRendererBackendName(RendererBackend backend);
+
+void renderFrame(Renderer* renderer, FramePacket* packet);
+
+void attachRendererThread(Renderer* renderer);
+void detachRendererThread(Renderer* renderer);
+
+#endif
\ No newline at end of file
@@ -0,0 +1,127 @@
+// render thread
+
+#ifndef VMR_RENDERTHREAD_H
+#define VMR_RENDERTHREAD_H
+
+// includes //
+#include <dynamicresolution.h>
+#include <engine.h>
+
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// enums //
+
+// where a frame packet is between the simulation and render threads
+typedef enum {
+	FRAME_PACKET_FREE, // can be written
+	FRAME_PACKET_WRITING, // being built by the simulation thread
+	FRAME_PACKET_PENDING, // submitted, waiting to be drawn
+	FRAME_PACKET_RENDERING // being drawn by the render thread
+} FramePacketState;
+
+// structs //
+
+struct Renderer;
+
+// everything needed to draw a frame, built by the simulation thread and never changed once it's submitted
+// besides this the render thread only reads scene data that doesn't change after loading (vertex data, textures, batches), so the simulation can move on while the frame is drawn
+struct FramePacket {
+	uint32_t frame;
+	
+	PerspectiveCamera camera; // copy of the player's camera, matrices up to date
+	
+	// visible static objects (see collectSceneInstances), sorted for the render mode
+	std::vector<InstanceData>* instances;
+	std::vector<InstanceGroup>* instanceGroups;
+	
+	// copy of every light in the scene, and the light each one was copied from (only compared, never read by the render thread)
+	std::vector<PointLight>* lights;
+	std::vector<PointLight*>* lightSources;
+	
+	// simulation thread timings, for stats
+	double simulationTime; // seconds spent updating the world and building the packet
+	double simulationWaitTime; // seconds spent waiting for a free packet before that
+	
+	double renderWaitTime; // seconds the render thread spent waiting for this packet, 0 without one
+};
+
+// draws frame packets, on the main thread or on a render thread (see startRenderThread)
+struct FrameRenderer {
+	Window* window;
+	Scene* scene;
+	
+	uint32_t width;
+	uint32_t height;
+	
+	SceneRenderMode mode;
+	ShaderProgramEx* program; // per-object and batched rendering
+	ShaderProgramEx* instancedProgram; // instanced and multi-draw rendering
+	
+	DepthPrepass* depthPrepass; // NULL unless laying down depth first
+	DeferredRenderer* deferredRenderer; // NULL unless deferred shading
+	DynamicResolution* dynamicResolution; // NULL unless scaling the resolution to hold a gpu frame time
+	bool showOverdraw;
+	
+	bool printStats;
+	
+	double startTime; // when the program started, time to first frame is reported once that frame is drawn (0 to not report it)
+	
+	// the lights the scene's buffers are built from, copied out of each packet
+	// slots are only marked dirty when their light changed, so updateSceneLightBuffer still only uploads what changed
+	std::vector<PointLight*>* lights;
+	std::vector<PointLight*>* lightSources;
+	
+	// gpu timer for the scene's draw calls, read back a frame later so we don't wait on the gpu
+	GLuint gpuTimer;
+	bool gpuTimerPending;
+	
+	// samples that pass the depth test in the main pass (each one runs the fragment shader), read back like the gpu timer
+	GLuint samplesQuery;
+	bool samplesQueryPending;
+	
+	// stats, printed once a second
+	uint32_t statsFrames;
+	double statsStart;
+	double statsRenderTime; // submitting the scene
+	double statsGpuTime;
+	double statsShadedSamples;
+	double statsPixels; // pixels rendered, fewer than width * height per frame under dynamic resolution
+	double statsResolutionScale;
+	double statsSimulationTime;
+	double statsSimulationWaitTime;
+	double statsFrameTime; // everything the render thread did for its frames, including swapping buffers
+	double statsRenderWaitTime; // render thread waiting for packets
+};
+
+// runs a renderer on its own thread, which it's attached to (owning the gl context, for gl) from startRenderThread until stopRenderThread
+// the simulation thread builds one packet while the render thread draws the other, and waits before getting more than one frame ahead
+// window events still have to be polled from the main thread
+struct RenderThread {
+	Renderer* renderer;
+	
+	FramePacket* packets[2];
+	FramePacketState states[2];
+	
+	bool quit;
+	
+	std::thread* thread;
+	std::mutex* mutex;
+	std::condition_variable* condition; // signalled whenever a packet changes state
+};
+
+// methods //
+FramePacket* createFramePacket();
+void buildFramePacket(FramePacket* packet, Scene* scene, PerspectiveCamera* camera, SceneRenderMode mode);
+
+FrameRenderer* createFrameRenderer(Window* window, Scene* scene, uint32_t width, uint32_t height, SceneRenderMode mode, ShaderProgramEx* program, ShaderProgramEx* instancedProgram);
+void renderFramePacket(FrameRenderer* renderer, FramePacket* packet);
+
+RenderThread* startRenderThread(Renderer* renderer);
+FramePacket* beginFramePacket(RenderThread* renderThread);
+void submitFramePacket(RenderThread* renderThread, FramePacket* packet);
+void stopRenderThread(RenderThread* renderThread);
+
+#endif
\ No newline at end of file
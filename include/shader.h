@@ -5,8 +5,12 @@
 
 // includes //
 #include <glad/glad.h>
+#include <glstate.h>
 #include <texture.h>
 #include <lighting.h>
+#include <streambuffer.h>
+
+#include <glm/glm.hpp>
 
 #include <map>
 #include <string>
@@ -15,8 +19,107 @@
 #define NULL_SHADER 0
 #define NULL_SHADER_PROGRAM 0
 
+// size of the pointLights uniform array used by addProgramExPointLight
+// the lighting shaders don't have this limit, they read lights from texture buffers (see lightclusters.h)
+#define MAX_POINT_LIGHTS 48
+
+// uniform block binding points, every program gets its blocks bound to these when created
+#define LIGHTS_BLOCK_BINDING 0
+#define CAMERA_BLOCK_BINDING 1
+
+// texture units reserved for the material table, lightmap atlas, texture arrays and the shared light texture buffers, setProgramExUniformTexture only uses the units below these
+#define MATERIAL_DATA_TEXTURE_UNIT 10
+#define LIGHTMAP_TEXTURE_UNIT 11
+#define TEXTURE_ARRAY_TEXTURE_UNIT 12
+#define LIGHT_DATA_TEXTURE_UNIT 13
+#define CLUSTER_DATA_TEXTURE_UNIT 14
+#define CLUSTER_LIGHT_INDICES_TEXTURE_UNIT 15
+#define FIRST_RESERVED_TEXTURE_UNIT MATERIAL_DATA_TEXTURE_UNIT
+
+// enums //
+
+// well known uniforms, resolved into a table when a ShaderProgramEx is created (see getProgramExUniform)
+typedef enum {
+	UNIFORM_PVM,
+	UNIFORM_MODEL,
+	UNIFORM_NORMAL_MATRIX,
+	UNIFORM_COLOR,
+	UNIFORM_TEXTURE1,
+	UNIFORM_NUM_POINT_LIGHTS,
+	UNIFORM_LIGHT_DATA,
+	UNIFORM_CLUSTER_DATA,
+	UNIFORM_CLUSTER_LIGHT_INDICES,
+	UNIFORM_TEXTURE_ARRAY,
+	UNIFORM_LIGHTMAP,
+	UNIFORM_LIGHTMAP_RECT,
+	UNIFORM_MATERIAL_DATA,
+	
+	UNIFORM_COUNT
+} ProgramUniform;
+
+// fields of each element of the pointLights uniform array
+typedef enum {
+	POINT_LIGHT_POSITION,
+	POINT_LIGHT_COLOR,
+	POINT_LIGHT_AMBIENT_STRENGTH,
+	POINT_LIGHT_DIFFUSE_STRENGTH,
+	POINT_LIGHT_C,
+	POINT_LIGHT_L,
+	POINT_LIGHT_Q,
+	
+	POINT_LIGHT_FIELD_COUNT
+} PointLightField;
+
 // structs //
 
+struct ShaderPermutations;
+
+// std140 mirror of the Lights uniform block
+struct LightsBlock {
+	glm::vec3 ambientLight; // sum of every light's color * ambientStrength, ambient light isn't attenuated so it doesn't need clustering
+	int32_t numPointLights;
+	
+	// cluster grid (see LightClusterGrid)
+	int32_t clusterGridSize[3];
+	float clusterDepthScale; // z slice = log(view depth) * scale + bias
+	float clusterDepthBias;
+	float padding[3]; // std140 rounds the block up to a multiple of 16 bytes
+};
+
+// std140 mirror of the Camera uniform block
+struct CameraBlock {
+	glm::mat4 view;
+	glm::mat4 projection;
+	glm::mat4 pv;
+	glm::vec3 position;
+	float padding;
+	glm::mat4 inversePv; // for reconstructing world positions from depth
+};
+
+// uniform buffer object bound to a uniform block binding point
+// every update rewrites the whole block into the next region of a stream buffer, so updates never wait on draws still using the old values
+struct UniformBuffer {
+	GLuint ubo; // region of stream holding the current contents, bound to binding
+	GLuint binding;
+	
+	uint32_t size; // size in bytes
+	
+	StreamBuffer* stream;
+	uint8_t* data; // cpu copy of the block's contents
+};
+
+// buffer object read by shaders through a buffer texture (samplerBuffer), used for data too large for a uniform block
+// uploads go to the next region of a stream buffer and the texture is pointed at it
+struct TextureBuffer {
+	GLuint buffer; // region of stream holding the current contents
+	GLuint texture;
+	
+	GLenum format; // internal format of each texel
+	uint32_t size; // size of the buffer's storage in bytes
+	
+	StreamBuffer* stream;
+};
+
 // shader program with extended uniform and texture management
 struct ShaderProgramEx {
 	GLuint program;
@@ -24,6 +127,14 @@ struct ShaderProgramEx {
 	// uniform management
 	std::map<std::string, GLint>* uniforms;
 	
+	// locations of well known uniforms and pointLights elements (-1 if the program doesn't use them)
+	GLint uniformTable[UNIFORM_COUNT];
+	GLint pointLightTable[MAX_POINT_LIGHTS][POINT_LIGHT_FIELD_COUNT];
+	
+	// last values written to the well known uniforms (as floats, ints are stored bit for bit), writes that wouldn't change them are skipped
+	float uniformValues[UNIFORM_COUNT][16];
+	bool uniformValuesSet[UNIFORM_COUNT]; // false until the uniform is first written
+	
 	// texture management
 	uint32_t textureUnits; // number of currently bound texure units
 	int32_t maxTextureUnits; // maximum supported texture units (implementation dependent)
@@ -31,22 +142,55 @@ struct ShaderProgramEx {
 	// point light management
 	uint32_t numPointLights;
 	uint32_t maxPointLights;
+	
+	// permutations the program is a variant of, and the ShaderFeature bits and ShaderTextureMode it was compiled with (see permutation.h)
+	// NULL for programs that aren't part of any
+	ShaderPermutations* permutations;
+	uint32_t permutationFeatures;
+	uint32_t permutationTextureMode;
 };
 
 // method definitions //
 GLuint createShader(GLenum shaderType, const char* source);
+GLuint createShaderFromSource(GLenum shaderType, const char* source);
 GLchar* getShaderInfoLog(GLuint shader);
 
 GLuint createShaderProgram(GLuint vertexShader, GLuint fragmentShader, bool deleteShaders);
 GLchar* getShaderProgramInfoLog(GLuint shaderProgram);
 
 ShaderProgramEx* createShaderProgramEx(GLuint vertexShader, GLuint fragmentShader, bool deleteShaders);
+ShaderProgramEx* loadShaderProgramEx(const char* vertexPath, const char* fragmentPath);
+ShaderProgramEx* loadShaderProgramEx(const char* vertexPath, const char* fragmentPath, const char* defines);
+ShaderProgramEx* createShaderProgramExFromProgram(GLuint program);
 void loadShaderProgramExUniformLocations(ShaderProgramEx* programEx);
+void loadShaderProgramExUniformTable(ShaderProgramEx* programEx);
+void bindShaderProgramExUniformBlocks(ShaderProgramEx* programEx);
+void bindShaderProgramExReservedTextures(ShaderProgramEx* programEx);
 void useProgramEx(ShaderProgramEx* programEx);
+void deleteShaderProgramEx(ShaderProgramEx* programEx);
 GLint getProgramExUniformLocation(ShaderProgramEx* programEx, std::string name);
+GLint getProgramExUniform(ShaderProgramEx* programEx, ProgramUniform uniform);
+void setProgramExUniformInt(ShaderProgramEx* programEx, ProgramUniform uniform, GLint value);
+void setProgramExUniformVec3(ShaderProgramEx* programEx, ProgramUniform uniform, glm::vec3 value);
+void setProgramExUniformVec4(ShaderProgramEx* programEx, ProgramUniform uniform, glm::vec4 value);
+void setProgramExUniformMat3(ShaderProgramEx* programEx, ProgramUniform uniform, glm::mat3 value);
+void setProgramExUniformMat4(ShaderProgramEx* programEx, ProgramUniform uniform, glm::mat4 value);
 void setProgramExUniformTexture(ShaderProgramEx* programEx, const char* location, TextureData* textureData);
+void setProgramExUniformTexture(ShaderProgramEx* programEx, ProgramUniform uniform, TextureData* textureData);
+void setProgramExTextureArray(ShaderProgramEx* programEx, TextureArray* array);
+void setProgramExObjectTexture(ShaderProgramEx* programEx, TextureData* textureData);
 void resetProgramExUniformTextures(ShaderProgramEx* programEx);
 void addProgramExPointLight(ShaderProgramEx* programEx, const char* location, PointLight* light);
+void addProgramExPointLight(ShaderProgramEx* programEx, PointLight* light);
 void resetProgramExPointLights(ShaderProgramEx* programEx);
 
+UniformBuffer* createUniformBuffer(uint32_t size, GLuint binding);
+void updateUniformBuffer(UniformBuffer* buffer, uint32_t offset, uint32_t size, const void* data);
+
+TextureBuffer* createTextureBuffer(GLenum format, uint32_t size);
+void uploadTextureBuffer(TextureBuffer* buffer, uint32_t size, const void* data);
+void updateTextureBuffer(TextureBuffer* buffer, uint32_t offset, uint32_t size, const void* data);
+void bindTextureBuffer(TextureBuffer* buffer, GLuint unit);
+void deleteTextureBuffer(TextureBuffer* buffer);
+
 #endif
\ No newline at end of file
@@ -0,0 +1,61 @@
+// streaming buffers for data rewritten every frame
+
+#ifndef VMR_STREAMBUFFER_H
+#define VMR_STREAMBUFFER_H
+
+// includes //
+#include <glad/glad.h>
+
+#include <cstdint>
+
+// macros //
+
+// number of regions each stream buffer cycles through, so the cpu can fill one while the gpu is still reading the last two
+#define STREAM_BUFFER_REGIONS 3
+
+// number of frame fences kept around, frames older than this are assumed to be done (after waiting on their fence once)
+#define STREAM_BUFFER_FRAME_FENCES 8
+
+// structs //
+
+// ring of buffer regions for data that is completely rewritten every upload (instances, light clusters, uniform blocks)
+// every write goes to the next region, after waiting for the gpu to finish the frame that region was last written in
+// frames are fenced by endStreamBufferFrame, so with one write per frame a write only waits if the gpu is more than STREAM_BUFFER_REGIONS frames behind
+// each region is its own buffer object, since gl 3.3 can't point a buffer texture at part of a buffer
+struct StreamBuffer {
+	GLenum target; // what the buffer is bound to while writing (GL_ARRAY_BUFFER, GL_TEXTURE_BUFFER, ...)
+	
+	GLuint buffers[STREAM_BUFFER_REGIONS];
+	uint32_t capacities[STREAM_BUFFER_REGIONS]; // size of each region's storage in bytes
+	void* mapped[STREAM_BUFFER_REGIONS]; // persistent mapping of each region, NULL if persistent mapping isn't supported
+	uint32_t frames[STREAM_BUFFER_REGIONS]; // frame each region was last written in (see endStreamBufferFrame), 0 if never
+	
+	uint32_t region; // region holding the most recent write
+	bool persistent; // if regions use immutable persistently mapped storage (GL_ARB_buffer_storage)
+};
+
+// stream buffer activity since the last resetStreamBufferStats
+struct StreamBufferStats {
+	uint32_t writes;
+	uint32_t bytesWritten;
+	
+	uint32_t fenceWaits; // writes that had to wait for the gpu to finish with a region
+	double fenceWaitTime; // seconds spent waiting
+};
+
+// methods //
+void initStreamBuffers(GLADloadproc load);
+void setStreamBufferPersistentMapping(bool enabled);
+bool isStreamBufferPersistentMappingSupported();
+
+StreamBufferStats* getStreamBufferStats();
+void resetStreamBufferStats();
+
+void endStreamBufferFrame();
+
+StreamBuffer* createStreamBuffer(GLenum target, uint32_t capacity);
+GLuint writeStreamBuffer(StreamBuffer* buffer, uint32_t size, const void* data);
+GLuint getStreamBufferBuffer(StreamBuffer* buffer);
+void deleteStreamBuffer(StreamBuffer* buffer);
+
+#endif
\ No newline at end of file
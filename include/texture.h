@@ -3,11 +3,30 @@
 
 // includes
 #include <cstdint>
+#include <vector>
 
 #include <assimp/Importer.hpp>      // C++ importer interface
 #include <assimp/scene.h>           // Output data structure
 #include <assimp/postprocess.h>     // Post processing flags
 
+// layers of texture arrays are never bigger than this, bigger textures are shrunk to fit
+#define MAX_TEXTURE_ARRAY_SIZE 1024
+
+// size classes with more textures than this are split over several arrays (GL 3.3 only guarantees 256 layers)
+#define MAX_TEXTURE_ARRAY_LAYERS 256
+
+/**
+	*	@brief Struct representing a texture array
+	*
+	*	Textures of the same size class packed into the layers of a single GL_TEXTURE_2D_ARRAY, so objects using any of them can be drawn without rebinding (see packTextureArrays)
+*/
+struct TextureArray {
+	uint32_t texture; /**< @brief OpenGL texture name of the array */
+	
+	int32_t size; /**< @brief width and height of every layer */
+	uint32_t layers;
+};
+
 /**
 	*	@brief Struct representing texture data
 	*
@@ -19,6 +38,9 @@ struct TextureData {
 	int32_t channels;
 	
 	uint32_t texture; /**< @brief OpenGL texture name used in rendering */
+	
+	TextureArray* array; /**< @brief array this texture was packed into, or NULL if it hasn't been packed */
+	uint32_t layer; /**< @brief layer of array holding this texture */
 };
 
 /**
@@ -36,4 +58,11 @@ TextureData* createTextureData(const char* texturePath);
 // create texture data from raw compressed image
 TextureData* createTextureDataRawCompressed(unsigned char* buffer, uint32_t length);
 
+void setTextureDataImage(TextureData* textureData, const void* pixels);
+
+// texture arrays
+int32_t getTextureSizeClass(int32_t width, int32_t height);
+void packTextureArrays(std::vector<TextureData*>& textures, std::vector<TextureArray*>& arrays);
+uint32_t getTextureBinding(TextureData* textureData);
+
 #endif
\ No newline at end of file
@@ -0,0 +1,94 @@
+// asynchronous texture loading
+
+#ifndef VMR_TEXTURELOADER_H
+#define VMR_TEXTURELOADER_H
+
+// includes //
+#include <texture.h>
+
+#include <glad/glad.h>
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// macros //
+
+// bytes of decoded images uploaded per updateTextureLoads call by the renderer, at least one image is always uploaded
+#define TEXTURE_UPLOAD_BUDGET (8 * 1024 * 1024)
+
+// color of the placeholder a texture shows until its image is uploaded (rgba)
+#define TEXTURE_PLACEHOLDER_COLOR {128, 128, 128, 255}
+
+// color a texture shows if its image has a readable header but couldn't be decoded (rgba)
+#define TEXTURE_MISSING_COLOR {255, 0, 255, 255}
+
+// typedefs //
+
+// called on the gl thread once a texture's image is uploaded (loaded), or it turned out it couldn't be decoded (it shows TEXTURE_MISSING_COLOR)
+// textureData is NULL if the image couldn't be opened or read at all, in which case NULL was also returned when it was requested
+typedef void (*TextureLoadCallback)(TextureData* textureData, bool loaded, void* data);
+
+// structs //
+
+// a texture waiting to be decoded or uploaded
+struct TextureLoad {
+	TextureData* textureData;
+	
+	std::string* path; // file to decode, or what to call the texture in timings when it's decoded from memory
+	std::vector<uint8_t>* compressed; // copy of the image to decode from memory, NULL to decode path
+	
+	// decoded image, pixels is NULL if it couldn't be decoded
+	uint8_t* pixels;
+	int32_t width;
+	int32_t height;
+	int32_t channels;
+	
+	TextureLoadCallback callback;
+	void* callbackData;
+	
+	double requestTime;
+	double decodeTime; // seconds the worker spent decoding
+};
+
+// a decoded image kept after it's uploaded, for drawing without gl (see setTextureImageRetention)
+struct TextureImage {
+	uint8_t* pixels; // width x height x channels, bottom row first (the same way gl stores it)
+	int32_t width;
+	int32_t height;
+	int32_t channels;
+};
+
+// how long a texture took to load
+struct TextureLoadTiming {
+	std::string path;
+	
+	int32_t width;
+	int32_t height;
+	
+	double decodeTime; // seconds spent decoding on a worker thread
+	double uploadTime; // seconds spent on the gl thread (copying into the pixel buffer, glTexImage2D and mipmaps)
+	double latency; // seconds from the request until the image was uploaded
+	
+	bool loaded;
+};
+
+// methods //
+void startTextureLoader(uint32_t threadCount);
+void stopTextureLoader();
+bool isTextureLoaderRunning();
+
+TextureData* createTextureDataAsync(const char* texturePath, TextureLoadCallback callback, void* callbackData);
+TextureData* createTextureDataRawCompressedAsync(unsigned char* buffer, uint32_t length, TextureLoadCallback callback, void* callbackData);
+
+uint32_t updateTextureLoads(uint32_t uploadBudget);
+void finishTextureLoads();
+uint32_t getPendingTextureLoadCount();
+
+void setTextureImageRetention(bool enabled);
+TextureImage* getTextureImage(TextureData* textureData);
+
+std::vector<TextureLoadTiming>* getTextureLoadTimings();
+void printTextureLoadTimings();
+
+#endif
\ No newline at end of file
@@ -0,0 +1,44 @@
+// transform hierarchy
+
+#ifndef VMR_TRANSFORM_H
+#define VMR_TRANSFORM_H
+
+// includes //
+#include <glm/glm.hpp>
+
+#include <vector>
+
+// structs //
+
+// a node in a transform hierarchy
+// world and normal matrices are cached and only recomputed after the node or one of its ancestors changes
+struct Transform {
+	glm::mat4 localMatrix; // relative to parent (or the world if there is no parent)
+	
+	// cached, use getTransformWorldMatrix/getTransformNormalMatrix instead of reading these directly
+	glm::mat4 worldMatrix;
+	glm::mat3 normalMatrix; // transpose(inverse(worldMatrix)), for transforming normals
+	
+	// if the cached matrices are out of date
+	bool dirty;
+	
+	Transform* parent;
+	std::vector<Transform*>* children;
+};
+
+// methods //
+glm::mat4 composeTransformMatrix(glm::vec3 position, glm::vec3 rotation, glm::vec3 scale);
+
+Transform* createTransform(glm::vec3 position, glm::vec3 rotation, glm::vec3 scale);
+Transform* createTransform(glm::mat4 localMatrix);
+void setTransform(Transform* transform, glm::vec3 position, glm::vec3 rotation, glm::vec3 scale);
+void setTransformLocalMatrix(Transform* transform, glm::mat4 localMatrix);
+void setTransformParent(Transform* transform, Transform* parent);
+void markTransformDirty(Transform* transform);
+
+glm::mat4& getTransformWorldMatrix(Transform* transform);
+glm::mat3& getTransformNormalMatrix(Transform* transform);
+glm::vec3 getTransformWorldPosition(Transform* transform);
+glm::vec3 getTransformWorldScale(Transform* transform);
+
+#endif
\ No newline at end of file
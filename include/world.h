@@ -7,6 +7,7 @@
 #include <graphics.h>
 #include <texture.h>
 #include <lighting.h>
+#include <multidraw.h>
 
 #include <string>
 #include <vector>
@@ -17,6 +18,21 @@
 struct Scene;
 struct TriggerInfo;
 
+// see batch.h
+struct StaticBatch;
+
+// see lightclusters.h
+struct LightClusterGrid;
+
+// see lightmap.h
+struct Lightmap;
+
+// see drawlist.h
+struct StaticDrawList;
+
+// see material.h
+struct MaterialTable;
+
 // event checker function
 typedef bool (*EventCheckFunction)(Scene*, TriggerInfo*, bool);
 
@@ -72,8 +88,14 @@ struct TexturedRenderableObject {
 	TextureData* textureData;
 	glm::vec3 color; // color if texture data is null
 	
+	uint32_t material; // index of the texture/color pair in the scene's material table (see assignSceneMaterials)
+	
 	RenderableObject* renderableObject;
 	
+	glm::vec4 lightmapRect; // scale (xy) and offset (zw) from the vertex data's lightmap coordinates to the scene's lightmap atlas, zero if it wasn't packed
+	
+	uint32_t world; // index of the world it was loaded from in the scene's worlds
+	
 	bool visible; // used by scene to only render "visible" objects, usually for debugging
 };
 
@@ -105,21 +127,64 @@ struct Scene {
 	// player
 	Player* player;
 	
+	// path of every world parsed into the scene, in order
+	std::vector<std::string>* worlds;
+	
 	// loaded vertex data
 	std::map<std::string, VertexData*>* vertexData;
 	
 	// loaded textures
 	std::map<std::string, TextureData*>* textures;
 	
+	// texture arrays the scene's textures were packed into (see packSceneTextureArrays), empty unless the scene has been packed
+	std::vector<TextureArray*>* textureArrays;
+	
 	// models
 	std::map<std::string, Model*>* models;
 	
 	// objects
 	std::map<VertexData*, std::vector<TexturedRenderableObject*>*>* staticObjects;
 	
+	// every texture/color pair the static objects use
+	MaterialTable* materials;
+	
+	// draw calls of the static objects, compiled on first use (see updateSceneStaticDrawList)
+	StaticDrawList* staticDrawList;
+	
+	// static batches (see buildSceneStaticBatches), empty unless the scene has been batched
+	std::vector<StaticBatch*>* staticBatches;
+	
+	// instanced rendering (see renderSceneInstanced), rebuilt every frame from the visible records of the static draw list
+	InstanceBuffer* instanceBuffer; // created on first use
+	std::vector<InstanceData>* instances;
+	std::vector<InstanceGroup>* instanceGroups;
+	
+	// multi-draw rendering (see renderSceneMultiDraw), rebuilt every frame from the instance groups
+	StreamBuffer* drawCommandBuffer; // created on first use
+	std::vector<DrawElementsIndirectCommand>* drawCommands;
+	std::vector<MultiDrawBucket>* drawBuckets;
+	
 	// lights
 	std::vector<PointLight*>* pointLights;
 	
+	// shared uniform buffers (see updateSceneUniformBuffers), created on first use
+	UniformBuffer* lightBuffer;
+	UniformBuffer* cameraBuffer;
+	
+	// every light's data, 3 texels per light (see updateSceneLightBuffer), created on first use
+	TextureBuffer* lightDataBuffer;
+	
+	// what's currently in the light and uniform buffers, used to skip uploads when nothing changed
+	std::vector<PointLight*>* uploadedLights; // light in each slot of the light data buffer
+	LightsBlock uploadedLightsBlock;
+	CameraBlock uploadedCamera;
+	
+	// lights touching each view space cluster (see updateSceneLightClusters), created on first use
+	LightClusterGrid* lightClusters;
+	
+	// baked direct lighting of the static objects (see lightmap.h), NULL unless the scene uses a lightmap
+	Lightmap* lightmap;
+	
 	// walkmap
 	std::vector<BoundingBox*>* walkmap;
 	
@@ -233,6 +298,7 @@ BoundingBox* checkBbox(BoundingBox* bbox, glm::vec3 oldPosition, glm::vec3 posit
 void updatePlayerPosition(Player* player, Scene* scene, Window* window, double delta);
 
 Scene* createScene(Window* window, Player* player);
+void packSceneTextureArrays(Scene* scene);
 void parseWorldIntoScene(Scene* scene, const char* file);
 Scene* parseWorld(const char* file, Window* window, Player* player);
 bool hasWalkmap(Scene* scene);
@@ -0,0 +1,244 @@
+// static geometry batching
+
+#include <batch.h>
+#include <utils.h>
+
+#include <glm/glm.hpp>
+#include <glm/ext.hpp>
+
+#include <algorithm>
+#include <cmath>
+
+// object + the cluster cell it belongs to, used for sorting objects into batches and clusters
+struct BatchEntry {
+	TexturedRenderableObject* object;
+	glm::ivec3 cell;
+};
+
+// get the cluster cell of an object
+glm::ivec3 getClusterCell(TexturedRenderableObject* object, float clusterSize){
+	return glm::ivec3(glm::floor(getTransformWorldPosition(object->renderableObject->transform) / clusterSize));
+}
+
+// lexicographic compare for vectors
+template <typename T>
+bool compareVectors(T a, T b){
+	for(uint32_t i = 0; i < (uint32_t)a.length(); i++){
+		if(a[i] != b[i]) return a[i] < b[i];
+	}
+	
+	return false;
+}
+
+// true if two objects can go in the same batch
+// color and layer come from each vertex's material, so only the texture binding has to match
+bool sameBatchBinding(TexturedRenderableObject* a, TexturedRenderableObject* b){
+	return getTextureBinding(a->textureData) == getTextureBinding(b->textureData);
+}
+
+// sorts by texture binding, then cell
+bool compareBatchEntries(const BatchEntry& a, const BatchEntry& b){
+	uint32_t bindingA = getTextureBinding(a.object->textureData);
+	uint32_t bindingB = getTextureBinding(b.object->textureData);
+	
+	if(bindingA != bindingB) return bindingA < bindingB;
+	
+	return compareVectors(a.cell, b.cell);
+}
+
+// batch a list of objects
+// every object should have the same texture binding, clusterSize is the size of the grid cells used to split the batch into clusters
+// objects in boxFaces are batched as their optimized faces instead of their vertex data (boxFaces can be NULL)
+// returns NULL if there is nothing to batch
+StaticBatch* createStaticBatch(std::vector<TexturedRenderableObject*>& objects, float clusterSize, BoxFaceSet* boxFaces){
+	if(objects.size() == 0) return NULL;
+	
+	// sort objects into cells
+	std::vector<BatchEntry> entries;
+	
+	for(uint32_t i = 0; i < objects.size(); i++){
+		entries.push_back( (BatchEntry){objects[i], getClusterCell(objects[i], clusterSize)} );
+	}
+	
+	std::sort(entries.begin(), entries.end(), compareBatchEntries);
+	
+	// merged vertices and indices
+	std::vector<Vertex> vertices;
+	std::vector<uint32_t> indices;
+	std::vector<uint32_t> materials;
+	
+	std::vector<StaticBatchCluster>* clusters = new std::vector<StaticBatchCluster>();
+	
+	// cluster bounds
+	glm::vec3 lower;
+	glm::vec3 upper;
+	
+	for(uint32_t i = 0; i < entries.size(); i++){
+		// start a new cluster when the cell changes
+		if(i == 0 || entries[i].cell != entries[i-1].cell){
+			StaticBatchCluster cluster;
+			
+			cluster.firstIndex = indices.size();
+			cluster.indexCount = 0;
+			
+			clusters->push_back(cluster);
+			
+			lower = glm::vec3(HUGE_VALF);
+			upper = glm::vec3(-HUGE_VALF);
+		}
+		
+		RenderableObject* object = entries[i].object->renderableObject;
+		VertexData* vertexData = object->vertexData;
+		
+		// transform vertices into world space
+		glm::mat4& modelMatrix = getTransformWorldMatrix(object->transform);
+		glm::mat3& normalMatrix = getTransformNormalMatrix(object->transform);
+		
+		uint32_t baseVertex = vertices.size();
+		
+		uint32_t material = entries[i].object->material;
+		
+		glm::vec4& lightmapRect = entries[i].object->lightmapRect;
+		
+		// optimized boxes are already in world space, their faces replace the vertex data
+		std::vector<BoxFace>* faces = NULL;
+		
+		if(boxFaces){
+			std::map<TexturedRenderableObject*, std::vector<BoxFace>*>::iterator it = boxFaces->faces->find(entries[i].object);
+			
+			if(it != boxFaces->faces->end()) faces = it->second;
+		}
+		
+		if(faces){
+			for(uint32_t j = 0; j < faces->size(); j++){
+				getBoxFaceGeometry(faces->at(j), vertices, indices);
+				
+				// merged faces keep their own material
+				materials.resize(vertices.size(), faces->at(j).material);
+			}
+			
+			for(uint32_t j = baseVertex; j < vertices.size(); j++){
+				lower = glm::min(lower, vertices[j].position);
+				upper = glm::max(upper, vertices[j].position);
+			}
+		} else {
+			for(uint32_t j = 0; j < vertexData->vertices->size(); j++){
+				Vertex vertex = vertexData->vertices->at(j);
+				
+				vertex.position = glm::vec3(modelMatrix * glm::vec4(vertex.position, 1.f));
+				vertex.normal = glm::normalize(normalMatrix * vertex.normal);
+				vertex.lightmapCoordinates = vertex.lightmapCoordinates * glm::vec2(lightmapRect) + glm::vec2(lightmapRect.z, lightmapRect.w);
+				
+				lower = glm::min(lower, vertex.position);
+				upper = glm::max(upper, vertex.position);
+				
+				vertices.push_back(vertex);
+				materials.push_back(material);
+			}
+			
+			// copy indices (or make them if the vertex data doesn't have any)
+			if(vertexData->indices->size() > 0){
+				for(uint32_t j = 0; j < vertexData->indices->size(); j++){
+					indices.push_back(baseVertex + vertexData->indices->at(j));
+				}
+			} else {
+				for(uint32_t j = 0; j < vertexData->vertices->size(); j++){
+					indices.push_back(baseVertex + j);
+				}
+			}
+		}
+		
+		// update cluster
+		StaticBatchCluster& cluster = clusters->back();
+		
+		cluster.indexCount = indices.size() - cluster.firstIndex;
+		cluster.center = (lower + upper) / 2.f;
+		cluster.radius = glm::length(upper - lower) / 2.f;
+	}
+	
+	// clusters whose boxes were completely hidden
+	for(uint32_t i = clusters->size(); i-- > 0;){
+		if(clusters->at(i).indexCount == 0) clusters->erase(clusters->begin() + i);
+	}
+	
+	if(indices.size() == 0){
+		delete clusters;
+		
+		return NULL;
+	}
+	
+	// create batch (with its own vao, since the materials get attached to it)
+	VertexData* vertexData = createStandaloneVertexData(vertices, indices);
+	
+	if(!vertexData){
+		delete clusters;
+		
+		return NULL;
+	}
+	
+	StaticBatch* batch = allocateMemoryForType<StaticBatch>();
+	
+	batch->vertexData = vertexData;
+	batch->materialVbo = 0;
+	batch->texture = entries[0].object->textureData;
+	batch->clusters = clusters;
+	
+	// attach materials to the batch's vao
+	glGenBuffers(1, &batch->materialVbo);
+	
+	bindVertexData(vertexData);
+	
+	glBindBuffer(GL_ARRAY_BUFFER, batch->materialVbo);
+	glBufferData(GL_ARRAY_BUFFER, materials.size() * sizeof(uint32_t), &materials[0], GL_STATIC_DRAW);
+	
+	glVertexAttribIPointer(11, 1, GL_UNSIGNED_INT, sizeof(uint32_t), (void*)0);
+	glEnableVertexAttribArray(11);
+	
+	bindGlVertexArray(0);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+	
+	return batch;
+}
+
+// batch every visible static object of a scene into scene->staticBatches, one batch per texture binding
+// pack the scene's textures first (packSceneTextureArrays) to let objects with different textures share batches
+// faces of static boxes hidden by other boxes are left out and coplanar ones merged, unless that's been turned off (see setBoxFaceOptimization)
+// should be called once the scene is done loading
+void buildSceneStaticBatches(Scene* scene, float clusterSize){
+	// collect every object
+	std::vector<BatchEntry> entries;
+	
+	for (std::map<VertexData*, std::vector<TexturedRenderableObject*>*>::iterator it = scene->staticObjects->begin(); it != scene->staticObjects->end(); it++){
+		if(!it->second) continue;
+		
+		for(uint32_t i = 0; i < it->second->size(); i++){
+			TexturedRenderableObject* object = it->second->at(i);
+			
+			if(!object || !object->visible) continue;
+			
+			entries.push_back( (BatchEntry){object, glm::ivec3(0)} );
+		}
+	}
+	
+	// sort by texture binding so each batch is one contiguous run
+	std::sort(entries.begin(), entries.end(), compareBatchEntries);
+	
+	BoxFaceSet* boxFaces = isBoxFaceOptimizationEnabled() ? optimizeSceneBoxFaces(scene) : NULL;
+	
+	std::vector<TexturedRenderableObject*> run;
+	
+	for(uint32_t i = 0; i < entries.size(); i++){
+		run.push_back(entries[i].object);
+		
+		// flush at the end of each run
+		if(i == entries.size()-1 || !sameBatchBinding(entries[i].object, entries[i+1].object)){
+			StaticBatch* batch = createStaticBatch(run, clusterSize, boxFaces);
+			
+			if(batch) scene->staticBatches->push_back(batch);
+			
+			run.clear();
+		}
+	}
+	
+	if(boxFaces) destroyBoxFaceSet(boxFaces);
+}
\ No newline at end of file
@@ -0,0 +1,655 @@
+// hidden face removal and face merging for static boxes
+
+#include <boxfaces.h>
+#include <utils.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+
+// worlds are mostly built out of abutting boxes, so the batcher optimizes their faces unless this is turned off
+bool boxFaceOptimization = true;
+
+// boxes spanning more occluder grid cells than this are checked against every face instead of being put in the grid
+#define BOX_FACE_GRID_MAX_CELLS 64
+
+// faces cut into more pieces than this by the boxes crossing them (like a floor with things standing on it) are given up on and kept whole
+#define BOX_FACE_MAX_PIECES 64
+
+// an axis aligned static box, as seen by the optimizer
+struct OptimizedBox {
+	TexturedRenderableObject* object;
+	
+	// world space bounds
+	glm::vec3 lower;
+	glm::vec3 upper;
+};
+
+// a face in the middle of being optimized, with the box it came from
+struct BoxFaceEntry {
+	BoxFace face;
+	uint32_t box;
+	bool merged; // merged into another entry, so it's gone
+};
+
+// turn hidden face removal and face merging on or off for batches built from now on
+void setBoxFaceOptimization(bool enabled){
+	boxFaceOptimization = enabled;
+}
+
+bool isBoxFaceOptimizationEnabled(){
+	return boxFaceOptimization;
+}
+
+// index of the vertex making up corner j of triangle i
+uint32_t getBoxTriangleVertex(VertexData* vertexData, uint32_t i, uint32_t j){
+	return vertexData->indices->size() > 0 ? vertexData->indices->at(i*3 + j) : i*3 + j;
+}
+
+uint32_t getBoxTriangleCount(VertexData* vertexData){
+	return (vertexData->indices->size() > 0 ? vertexData->indices->size() : vertexData->vertices->size()) / 3;
+}
+
+// get which of the 6 faces of its bounds a triangle lies on (axis * 2, + 1 if it faces +axis)
+// returns -1 if it isn't on one, or faces the wrong way
+int32_t getBoxTriangleFace(VertexData* vertexData, uint32_t triangle, glm::vec3 lower, glm::vec3 upper){
+	glm::vec3 p0 = vertexData->vertices->at(getBoxTriangleVertex(vertexData, triangle, 0)).position;
+	glm::vec3 p1 = vertexData->vertices->at(getBoxTriangleVertex(vertexData, triangle, 1)).position;
+	glm::vec3 p2 = vertexData->vertices->at(getBoxTriangleVertex(vertexData, triangle, 2)).position;
+	
+	glm::vec3 normal = glm::cross(p1 - p0, p2 - p0);
+	
+	for(uint32_t axis = 0; axis < 3; axis++){
+		// every other component has to be zero
+		if(normal[(axis + 1) % 3] != 0.0f || normal[(axis + 2) % 3] != 0.0f || normal[axis] == 0.0f) continue;
+		
+		float plane = normal[axis] > 0.0f ? upper[axis] : lower[axis];
+		
+		if(p0[axis] != plane || p1[axis] != plane || p2[axis] != plane) return -1;
+		
+		return axis * 2 + (normal[axis] > 0.0f ? 1 : 0);
+	}
+	
+	return -1;
+}
+
+// true if vertex data is a box: every triangle lies on one of the faces of its bounds, facing out, and the faces are completely covered
+// like the cube shape, whatever its texture coordinates are
+bool isBoxVertexData(VertexData* vertexData){
+	if(!vertexData || vertexData->vertices->size() == 0) return false;
+	
+	glm::vec3 lower = glm::vec3(HUGE_VALF);
+	glm::vec3 upper = glm::vec3(-HUGE_VALF);
+	
+	for(uint32_t i = 0; i < vertexData->vertices->size(); i++){
+		lower = glm::min(lower, vertexData->vertices->at(i).position);
+		upper = glm::max(upper, vertexData->vertices->at(i).position);
+	}
+	
+	glm::vec3 size = upper - lower;
+	
+	if(size.x <= 0.0f || size.y <= 0.0f || size.z <= 0.0f) return false;
+	
+	float areas[6] = {0, 0, 0, 0, 0, 0};
+	
+	for(uint32_t i = 0; i < getBoxTriangleCount(vertexData); i++){
+		int32_t face = getBoxTriangleFace(vertexData, i, lower, upper);
+		
+		if(face < 0) return false;
+		
+		glm::vec3 p0 = vertexData->vertices->at(getBoxTriangleVertex(vertexData, i, 0)).position;
+		glm::vec3 p1 = vertexData->vertices->at(getBoxTriangleVertex(vertexData, i, 1)).position;
+		glm::vec3 p2 = vertexData->vertices->at(getBoxTriangleVertex(vertexData, i, 2)).position;
+		
+		areas[face] += glm::length(glm::cross(p1 - p0, p2 - p0)) / 2.0f;
+	}
+	
+	for(uint32_t face = 0; face < 6; face++){
+		uint32_t axis = face / 2;
+		float area = size[(axis + 1) % 3] * size[(axis + 2) % 3];
+		
+		if(fabsf(areas[face] - area) > area * 0.001f) return false;
+	}
+	
+	return true;
+}
+
+// texture coordinates and lightmap atlas coordinates of a vertex of an object
+glm::vec4 getBoxVertexAttributes(TexturedRenderableObject* object, Vertex& vertex){
+	glm::vec4& lightmapRect = object->lightmapRect;
+	
+	return glm::vec4(vertex.textureCoordinates, vertex.lightmapCoordinates * glm::vec2(lightmapRect) + glm::vec2(lightmapRect.z, lightmapRect.w));
+}
+
+// set up the 6 faces of a box object in world space
+// returns false if the object can't be optimized: its transform isn't a rotation by multiples of 90 degrees (plus scale), or its attributes aren't affine across a face
+bool getBoxObjectFaces(TexturedRenderableObject* object, OptimizedBox& box, std::vector<BoxFace>& faces){
+	VertexData* vertexData = object->renderableObject->vertexData;
+	glm::mat4& modelMatrix = getTransformWorldMatrix(object->renderableObject->transform);
+	
+	// every object axis has to end up along exactly one world axis
+	for(uint32_t column = 0; column < 3; column++){
+		glm::vec3 axis = glm::vec3(modelMatrix[column]);
+		float length = glm::length(axis);
+		
+		uint32_t nonZero = 0;
+		
+		for(uint32_t i = 0; i < 3; i++){
+			if(fabsf(axis[i]) > length * 0.00001f) nonZero++;
+		}
+		
+		if(length == 0.0f || nonZero != 1) return false;
+	}
+	
+	// mirrored objects are drawn inside out, leave them alone
+	if(glm::determinant(glm::mat3(modelMatrix)) <= 0.0f) return false;
+	
+	// world space bounds
+	glm::vec3 objectLower = glm::vec3(HUGE_VALF);
+	glm::vec3 objectUpper = glm::vec3(-HUGE_VALF);
+	
+	for(uint32_t i = 0; i < vertexData->vertices->size(); i++){
+		objectLower = glm::min(objectLower, vertexData->vertices->at(i).position);
+		objectUpper = glm::max(objectUpper, vertexData->vertices->at(i).position);
+	}
+	
+	box.object = object;
+	box.lower = glm::vec3(HUGE_VALF);
+	box.upper = glm::vec3(-HUGE_VALF);
+	
+	for(uint32_t corner = 0; corner < 8; corner++){
+		glm::vec3 point = glm::vec3(corner & 1 ? objectUpper.x : objectLower.x, corner & 2 ? objectUpper.y : objectLower.y, corner & 4 ? objectUpper.z : objectLower.z);
+		glm::vec3 world = glm::vec3(modelMatrix * glm::vec4(point, 1));
+		
+		box.lower = glm::min(box.lower, world);
+		box.upper = glm::max(box.upper, world);
+	}
+	
+	// find each face's attribute gradients from one of its triangles, then make sure its other triangles agree
+	bool found[6] = {false, false, false, false, false, false};
+	
+	faces.resize(6);
+	
+	for(uint32_t i = 0; i < getBoxTriangleCount(vertexData); i++){
+		int32_t objectFace = getBoxTriangleFace(vertexData, i, objectLower, objectUpper);
+		
+		glm::vec3 positions[3];
+		glm::vec4 attributes[3];
+		
+		for(uint32_t j = 0; j < 3; j++){
+			Vertex& vertex = vertexData->vertices->at(getBoxTriangleVertex(vertexData, i, j));
+			
+			positions[j] = glm::vec3(modelMatrix * glm::vec4(vertex.position, 1));
+			attributes[j] = getBoxVertexAttributes(object, vertex);
+		}
+		
+		// world axis and direction of the face
+		glm::vec3 normal = glm::cross(positions[1] - positions[0], positions[2] - positions[0]);
+		
+		uint32_t axis = 0;
+		
+		for(uint32_t j = 1; j < 3; j++){
+			if(fabsf(normal[j]) > fabsf(normal[axis])) axis = j;
+		}
+		
+		uint32_t u = (axis + 1) % 3;
+		uint32_t v = (axis + 2) % 3;
+		
+		BoxFace& face = faces[objectFace];
+		
+		if(!found[objectFace]){
+			glm::vec2 d1 = glm::vec2(positions[1][u] - positions[0][u], positions[1][v] - positions[0][v]);
+			glm::vec2 d2 = glm::vec2(positions[2][u] - positions[0][u], positions[2][v] - positions[0][v]);
+			
+			float det = d1.x * d2.y - d2.x * d1.y;
+			
+			face.axis = axis;
+			face.direction = normal[axis] > 0.0f ? 1.0f : -1.0f;
+			face.plane = face.direction > 0.0f ? box.upper[axis] : box.lower[axis];
+			face.lower = glm::vec2(box.lower[u], box.lower[v]);
+			face.upper = glm::vec2(box.upper[u], box.upper[v]);
+			face.attributesU = ((attributes[1] - attributes[0]) * d2.y - (attributes[2] - attributes[0]) * d1.y) / det;
+			face.attributesV = ((attributes[2] - attributes[0]) * d1.x - (attributes[1] - attributes[0]) * d2.x) / det;
+			face.attributes = attributes[0] + face.attributesU * (face.lower.x - positions[0][u]) + face.attributesV * (face.lower.y - positions[0][v]);
+			face.material = object->material;
+			
+			found[objectFace] = true;
+		}
+		
+		for(uint32_t j = 0; j < 3; j++){
+			glm::vec4 expected = face.attributes + face.attributesU * (positions[j][u] - face.lower.x) + face.attributesV * (positions[j][v] - face.lower.y);
+			glm::vec4 difference = glm::abs(expected - attributes[j]);
+			
+			if(glm::max(glm::max(difference.x, difference.y), glm::max(difference.z, difference.w)) > 0.001f) return false;
+		}
+	}
+	
+	return true;
+}
+
+// move the corner a face's attributes are stored at
+void setBoxFaceLower(BoxFace& face, glm::vec2 lower){
+	face.attributes += face.attributesU * (lower.x - face.lower.x) + face.attributesV * (lower.y - face.lower.y);
+	face.lower = lower;
+}
+
+// cut a rectangle out of a face, adding what's left (up to 4 faces) to pieces
+void subtractBoxFaceRect(BoxFace& face, glm::vec2 lower, glm::vec2 upper, std::vector<BoxFace>& pieces){
+	// doesn't overlap
+	if(lower.x >= face.upper.x || upper.x <= face.lower.x || lower.y >= face.upper.y || upper.y <= face.lower.y){
+		pieces.push_back(face);
+		
+		return;
+	}
+	
+	lower = glm::max(lower, face.lower);
+	upper = glm::min(upper, face.upper);
+	
+	// strips left and right of the rectangle (full height), then below and above it (between the strips)
+	glm::vec2 lowers[4] = {face.lower, glm::vec2(upper.x, face.lower.y), glm::vec2(lower.x, face.lower.y), glm::vec2(lower.x, upper.y)};
+	glm::vec2 uppers[4] = {glm::vec2(lower.x, face.upper.y), face.upper, glm::vec2(upper.x, lower.y), glm::vec2(upper.x, face.upper.y)};
+	
+	for(uint32_t i = 0; i < 4; i++){
+		// drop slivers
+		if(uppers[i].x - lowers[i].x < BOX_FACE_EPSILON || uppers[i].y - lowers[i].y < BOX_FACE_EPSILON) continue;
+		
+		BoxFace piece = face;
+		
+		setBoxFaceLower(piece, lowers[i]);
+		piece.upper = uppers[i];
+		
+		pieces.push_back(piece);
+	}
+}
+
+// true if a box hides a face: the face is on or inside the box, and the box continues past it on the side the face looks at
+bool isBoxFaceCoveredBy(BoxFace& face, OptimizedBox& box){
+	float lower = box.lower[face.axis];
+	float upper = box.upper[face.axis];
+	
+	if(face.direction > 0.0f){
+		return lower <= face.plane + BOX_FACE_EPSILON && upper > face.plane + BOX_FACE_EPSILON;
+	} else {
+		return upper >= face.plane - BOX_FACE_EPSILON && lower < face.plane - BOX_FACE_EPSILON;
+	}
+}
+
+// occluder grid cell coordinate
+int64_t getBoxFaceGridCell(float x, float cellSize){
+	return (int64_t)floorf(x / cellSize);
+}
+
+// key of an occluder grid cell
+int64_t getBoxFaceGridKey(int64_t x, int64_t y, int64_t z){
+	return ((x & 0x1fffff) << 42) | ((y & 0x1fffff) << 21) | (z & 0x1fffff);
+}
+
+// quantize a coordinate, so values within about BOX_FACE_EPSILON of each other sort the same way
+int64_t quantizeBoxFaceCoordinate(float x){
+	return (int64_t)llroundf(x / BOX_FACE_EPSILON);
+}
+
+// true if two affine attribute maps are the same
+bool sameBoxFaceAttributes(BoxFace& a, BoxFace& b){
+	glm::vec4 atB = a.attributes + a.attributesU * (b.lower.x - a.lower.x) + a.attributesV * (b.lower.y - a.lower.y);
+	
+	glm::vec4 difference = glm::max(glm::abs(atB - b.attributes), glm::max(glm::abs(a.attributesU - b.attributesU), glm::abs(a.attributesV - b.attributesV)));
+	
+	return glm::max(glm::max(difference.x, difference.y), glm::max(difference.z, difference.w)) <= 0.0001f;
+}
+
+// orders faces so the ones that can be merged along u (alongV false) or v (true) end up next to each other
+// plane and material, then the extent along the other axis, then the position along the merged axis
+struct BoxFaceMergeOrder {
+	bool alongV;
+	
+	bool operator()(const BoxFaceEntry& a, const BoxFaceEntry& b) const {
+		uint32_t same = alongV ? 0 : 1;
+		uint32_t merged = alongV ? 1 : 0;
+		
+		int64_t keysA[6] = {a.face.axis, (int64_t)a.face.direction, quantizeBoxFaceCoordinate(a.face.plane), a.face.material, quantizeBoxFaceCoordinate(a.face.lower[same]), quantizeBoxFaceCoordinate(a.face.upper[same])};
+		int64_t keysB[6] = {b.face.axis, (int64_t)b.face.direction, quantizeBoxFaceCoordinate(b.face.plane), b.face.material, quantizeBoxFaceCoordinate(b.face.lower[same]), quantizeBoxFaceCoordinate(b.face.upper[same])};
+		
+		for(uint32_t i = 0; i < 6; i++){
+			if(keysA[i] != keysB[i]) return keysA[i] < keysB[i];
+		}
+		
+		return a.face.lower[merged] < b.face.lower[merged];
+	}
+};
+
+// merge faces that share a whole edge, lie in the same plane, have the same material and line up texture and lightmap coordinates exactly
+// along u (alongV false) or v (true), returns the number of merges
+uint32_t mergeBoxFaces(std::vector<BoxFaceEntry>& entries, bool alongV){
+	BoxFaceMergeOrder order = {alongV};
+	
+	std::sort(entries.begin(), entries.end(), order);
+	
+	uint32_t same = alongV ? 0 : 1;
+	uint32_t merged = alongV ? 1 : 0;
+	
+	uint32_t merges = 0;
+	uint32_t last = 0;
+	
+	for(uint32_t i = 1; i < entries.size(); i++){
+		BoxFace& a = entries[last].face;
+		BoxFace& b = entries[i].face;
+		
+		bool mergeable = a.axis == b.axis && a.direction == b.direction && fabsf(a.plane - b.plane) <= BOX_FACE_EPSILON && a.material == b.material;
+		
+		mergeable = mergeable && fabsf(a.lower[same] - b.lower[same]) <= BOX_FACE_EPSILON && fabsf(a.upper[same] - b.upper[same]) <= BOX_FACE_EPSILON;
+		mergeable = mergeable && fabsf(a.upper[merged] - b.lower[merged]) <= BOX_FACE_EPSILON && sameBoxFaceAttributes(a, b);
+		
+		if(mergeable){
+			a.upper[merged] = b.upper[merged];
+			
+			entries[i].merged = true;
+			merges++;
+		} else {
+			last = i;
+		}
+	}
+	
+	// drop merged faces
+	uint32_t count = 0;
+	
+	for(uint32_t i = 0; i < entries.size(); i++){
+		if(!entries[i].merged) entries[count++] = entries[i];
+	}
+	
+	entries.resize(count);
+	
+	return merges;
+}
+
+// optimize the faces of every axis aligned box in objects, using the other boxes in objects as occluders
+// objects should be visible static objects of one world, anything that isn't a box is counted but left alone
+BoxFaceSet* optimizeBoxFaces(std::vector<TexturedRenderableObject*>& objects){
+	BoxFaceSet* set = allocateMemoryForType<BoxFaceSet>();
+	
+	set->faces = new std::map<TexturedRenderableObject*, std::vector<BoxFace>*>();
+	set->trianglesBefore = 0;
+	set->trianglesAfter = 0;
+	
+	// find the boxes
+	std::map<VertexData*, bool> boxVertexData;
+	
+	std::vector<OptimizedBox> boxes;
+	std::vector<BoxFace> boxFaces; // 6 per box
+	std::vector<BoxFace> faces;
+	
+	for(uint32_t i = 0; i < objects.size(); i++){
+		TexturedRenderableObject* object = objects[i];
+		VertexData* vertexData = object->renderableObject->vertexData;
+		
+		uint32_t triangles = getBoxTriangleCount(vertexData);
+		
+		set->trianglesBefore += triangles;
+		
+		std::map<VertexData*, bool>::iterator it = boxVertexData.find(vertexData);
+		
+		if(it == boxVertexData.end()) it = boxVertexData.insert(std::make_pair(vertexData, isBoxVertexData(vertexData))).first;
+		
+		OptimizedBox box;
+		
+		if(!it->second || !getBoxObjectFaces(object, box, faces)){
+			set->trianglesAfter += triangles;
+			
+			continue;
+		}
+		
+		boxes.push_back(box);
+		boxFaces.insert(boxFaces.end(), faces.begin(), faces.end());
+	}
+	
+	// grid of the boxes, cells about the size of a typical box
+	std::vector<float> sizes;
+	
+	for(uint32_t i = 0; i < boxes.size(); i++){
+		glm::vec3 size = boxes[i].upper - boxes[i].lower;
+		
+		sizes.push_back(std::max(size.x, std::max(size.y, size.z)));
+	}
+	
+	float cellSize = 1.0f;
+	
+	if(sizes.size() > 0){
+		std::nth_element(sizes.begin(), sizes.begin() + sizes.size() / 2, sizes.end());
+		
+		cellSize = std::max(sizes[sizes.size() / 2], 0.5f);
+	}
+	
+	std::map<int64_t, std::vector<uint32_t>> grid;
+	std::vector<uint32_t> largeBoxes;
+	
+	for(uint32_t i = 0; i < boxes.size(); i++){
+		glm::vec3 lower = boxes[i].lower - BOX_FACE_EPSILON;
+		glm::vec3 upper = boxes[i].upper + BOX_FACE_EPSILON;
+		
+		int64_t x0 = getBoxFaceGridCell(lower.x, cellSize), x1 = getBoxFaceGridCell(upper.x, cellSize);
+		int64_t y0 = getBoxFaceGridCell(lower.y, cellSize), y1 = getBoxFaceGridCell(upper.y, cellSize);
+		int64_t z0 = getBoxFaceGridCell(lower.z, cellSize), z1 = getBoxFaceGridCell(upper.z, cellSize);
+		
+		if((x1 - x0 + 1) * (y1 - y0 + 1) * (z1 - z0 + 1) > BOX_FACE_GRID_MAX_CELLS){
+			largeBoxes.push_back(i);
+			
+			continue;
+		}
+		
+		for(int64_t x = x0; x <= x1; x++){
+			for(int64_t y = y0; y <= y1; y++){
+				for(int64_t z = z0; z <= z1; z++){
+					grid[getBoxFaceGridKey(x, y, z)].push_back(i);
+				}
+			}
+		}
+	}
+	
+	// remove the parts of each face covered by other boxes
+	std::vector<BoxFaceEntry> entries;
+	
+	std::vector<uint32_t> candidates;
+	std::vector<uint32_t> checked(boxes.size(), 0xffffffff); // face that last checked each box, so boxes in several cells are only checked once
+	
+	std::vector<BoxFace> pieces;
+	std::vector<BoxFace> remaining;
+	std::vector<BoxFaceEntry> pieceEntries;
+	
+	for(uint32_t i = 0; i < boxFaces.size(); i++){
+		BoxFace& face = boxFaces[i];
+		uint32_t box = i / 6;
+		
+		uint32_t u = (face.axis + 1) % 3;
+		uint32_t v = (face.axis + 2) % 3;
+		
+		// boxes near the face
+		glm::vec3 lower;
+		glm::vec3 upper;
+		
+		lower[face.axis] = face.plane - BOX_FACE_EPSILON;
+		upper[face.axis] = face.plane + BOX_FACE_EPSILON;
+		lower[u] = face.lower.x - BOX_FACE_EPSILON;
+		upper[u] = face.upper.x + BOX_FACE_EPSILON;
+		lower[v] = face.lower.y - BOX_FACE_EPSILON;
+		upper[v] = face.upper.y + BOX_FACE_EPSILON;
+		
+		candidates = largeBoxes;
+		
+		int64_t x0 = getBoxFaceGridCell(lower.x, cellSize), x1 = getBoxFaceGridCell(upper.x, cellSize);
+		int64_t y0 = getBoxFaceGridCell(lower.y, cellSize), y1 = getBoxFaceGridCell(upper.y, cellSize);
+		int64_t z0 = getBoxFaceGridCell(lower.z, cellSize), z1 = getBoxFaceGridCell(upper.z, cellSize);
+		
+		// huge faces (floors) are checked against every box instead of going through thousands of cells
+		if((x1 - x0 + 1) * (y1 - y0 + 1) * (z1 - z0 + 1) > (int64_t)grid.size()){
+			candidates.clear();
+			
+			for(uint32_t j = 0; j < boxes.size(); j++){
+				candidates.push_back(j);
+			}
+		} else {
+			for(int64_t x = x0; x <= x1; x++){
+				for(int64_t y = y0; y <= y1; y++){
+					for(int64_t z = z0; z <= z1; z++){
+						std::map<int64_t, std::vector<uint32_t>>::iterator it = grid.find(getBoxFaceGridKey(x, y, z));
+						
+						if(it != grid.end()) candidates.insert(candidates.end(), it->second.begin(), it->second.end());
+					}
+				}
+			}
+		}
+		
+		remaining.assign(1, face);
+		
+		for(uint32_t j = 0; j < candidates.size() && remaining.size() > 0 && remaining.size() <= BOX_FACE_MAX_PIECES; j++){
+			uint32_t other = candidates[j];
+			
+			if(other == box || checked[other] == i) continue;
+			
+			checked[other] = i;
+			
+			OptimizedBox& occluder = boxes[other];
+			
+			if(!isBoxFaceCoveredBy(face, occluder)) continue;
+			
+			// grown a little, so faces that line up with the box's edges don't leave slivers
+			glm::vec2 coverLower = glm::vec2(occluder.lower[u], occluder.lower[v]) - BOX_FACE_EPSILON;
+			glm::vec2 coverUpper = glm::vec2(occluder.upper[u], occluder.upper[v]) + BOX_FACE_EPSILON;
+			
+			pieces.clear();
+			
+			for(uint32_t k = 0; k < remaining.size(); k++){
+				subtractBoxFaceRect(remaining[k], coverLower, coverUpper, pieces);
+			}
+			
+			remaining.swap(pieces);
+		}
+		
+		// put the pieces back together where they line up
+		pieceEntries.clear();
+		
+		for(uint32_t k = 0; k < remaining.size(); k++){
+			pieceEntries.push_back( (BoxFaceEntry){remaining[k], box, false} );
+		}
+		
+		while(mergeBoxFaces(pieceEntries, false) + mergeBoxFaces(pieceEntries, true) > 0);
+		
+		// a face that's only partly covered by boxes crossing it would take more triangles as pieces than it does whole, so it's kept whole
+		if(pieceEntries.size() > 1){
+			entries.push_back( (BoxFaceEntry){face, box, false} );
+		} else {
+			entries.insert(entries.end(), pieceEntries.begin(), pieceEntries.end());
+		}
+	}
+	
+	// merge what's left, alternating directions until nothing changes
+	while(true){
+		uint32_t merges = mergeBoxFaces(entries, false);
+		
+		merges += mergeBoxFaces(entries, true);
+		
+		if(merges == 0) break;
+	}
+	
+	// hand faces back to the boxes they (or the first face they were merged into) came from
+	for(uint32_t i = 0; i < boxes.size(); i++){
+		(*set->faces)[boxes[i].object] = new std::vector<BoxFace>();
+	}
+	
+	for(uint32_t i = 0; i < entries.size(); i++){
+		(*set->faces)[boxes[entries[i].box].object]->push_back(entries[i].face);
+	}
+	
+	set->trianglesAfter += entries.size() * 2;
+	
+	return set;
+}
+
+// optimize the boxes of every world loaded into a scene, each world on its own (one world's boxes don't hide another's)
+// prints the triangle counts of each world
+BoxFaceSet* optimizeSceneBoxFaces(Scene* scene){
+	std::vector<std::vector<TexturedRenderableObject*>> worldObjects(scene->worlds->size());
+	
+	for (std::map<VertexData*, std::vector<TexturedRenderableObject*>*>::iterator it = scene->staticObjects->begin(); it != scene->staticObjects->end(); it++){
+		if(!it->second) continue;
+		
+		for(uint32_t i = 0; i < it->second->size(); i++){
+			TexturedRenderableObject* object = it->second->at(i);
+			
+			if(!object || !object->visible || object->world >= worldObjects.size()) continue;
+			
+			worldObjects[object->world].push_back(object);
+		}
+	}
+	
+	BoxFaceSet* set = allocateMemoryForType<BoxFaceSet>();
+	
+	set->faces = new std::map<TexturedRenderableObject*, std::vector<BoxFace>*>();
+	set->trianglesBefore = 0;
+	set->trianglesAfter = 0;
+	
+	for(uint32_t i = 0; i < worldObjects.size(); i++){
+		if(worldObjects[i].size() == 0) continue;
+		
+		BoxFaceSet* worldSet = optimizeBoxFaces(worldObjects[i]);
+		
+		printf("\n%s: %d triangles, %d after removing hidden box faces...", scene->worlds->at(i).c_str(), worldSet->trianglesBefore, worldSet->trianglesAfter);
+		
+		set->faces->insert(worldSet->faces->begin(), worldSet->faces->end());
+		set->trianglesBefore += worldSet->trianglesBefore;
+		set->trianglesAfter += worldSet->trianglesAfter;
+		
+		// the faces moved to set
+		worldSet->faces->clear();
+		
+		destroyBoxFaceSet(worldSet);
+	}
+	
+	return set;
+}
+
+void destroyBoxFaceSet(BoxFaceSet* set){
+	for(std::map<TexturedRenderableObject*, std::vector<BoxFace>*>::iterator it = set->faces->begin(); it != set->faces->end(); it++){
+		delete it->second;
+	}
+	
+	delete set->faces;
+	
+	free(set);
+}
+
+// append a face as a quad (2 triangles, counter clockwise seen from the side it faces) in world space
+void getBoxFaceGeometry(BoxFace& face, std::vector<Vertex>& vertices, std::vector<uint32_t>& indices){
+	uint32_t u = (face.axis + 1) % 3;
+	uint32_t v = (face.axis + 2) % 3;
+	
+	// u x v is +axis, so going around u then v is counter clockwise seen from +axis
+	glm::vec2 corners[4] = {face.lower, glm::vec2(face.upper.x, face.lower.y), face.upper, glm::vec2(face.lower.x, face.upper.y)};
+	
+	if(face.direction < 0.0f) std::swap(corners[1], corners[3]);
+	
+	uint32_t baseVertex = vertices.size();
+	
+	for(uint32_t i = 0; i < 4; i++){
+		Vertex vertex;
+		
+		vertex.position[face.axis] = face.plane;
+		vertex.position[u] = corners[i].x;
+		vertex.position[v] = corners[i].y;
+		
+		vertex.normal = glm::vec3(0);
+		vertex.normal[face.axis] = face.direction;
+		
+		glm::vec4 attributes = face.attributes + face.attributesU * (corners[i].x - face.lower.x) + face.attributesV * (corners[i].y - face.lower.y);
+		
+		vertex.textureCoordinates = glm::vec2(attributes.x, attributes.y);
+		vertex.lightmapCoordinates = glm::vec2(attributes.z, attributes.w);
+		
+		vertices.push_back(vertex);
+	}
+	
+	uint32_t quad[6] = {0, 1, 2, 2, 3, 0};
+	
+	for(uint32_t i = 0; i < 6; i++){
+		indices.push_back(baseVertex + quad[i]);
+	}
+}
\ No newline at end of file
@@ -29,6 +29,9 @@ void updateCameraProjectionMatrix(PerspectiveCamera *camera, float fov, float sc
 	
 	// update projection matrix
 	camera->projection = glm::perspective(fov, screenWidth/screenHeight, near, far);
+	
+	// pv is recomputed lazily
+	camera->dirty = true;
 }
 
 // completely updates perspective camera's view matrix with new position and rotation values.
@@ -43,6 +46,8 @@ void updateCameraViewMatrix(PerspectiveCamera *camera){
 	camera->view = glm::lookAt(camera->position, camera->position+camera->forward, camera->up);
 	
 	camera->pv = camera->projection * camera->view;
+	
+	camera->dirty = false;
 }
 
 // completely updates perspective camera's view matrix with new position and rotation values.
@@ -53,18 +58,27 @@ void updateCameraViewMatrix(PerspectiveCamera *camera, glm::vec3 position, glm::
 	updateCameraViewMatrix(camera);
 }
 
+// updates forward, view and pv if the camera has moved, rotated or changed projection since they were last calculated
+// the functions below only mark the camera dirty, so several changes in a frame only cost one update
+void updateCameraMatrices(PerspectiveCamera *camera){
+	if(camera->dirty) updateCameraViewMatrix(camera);
+}
+
+void setCameraPosition(PerspectiveCamera *camera, glm::vec3 position){
+	camera->position = position;
+	camera->dirty = true;
+}
+
 // adds some translation to camera
 void translateCamera(PerspectiveCamera *camera, glm::vec3 translation){
 	camera->position += translation;
-	
-	updateCameraViewMatrix(camera);
+	camera->dirty = true;
 }
 
 // adds some rotation to camera
 void rotateCamera(PerspectiveCamera *camera, glm::vec3 rotation){
 	camera->rotation += rotation;
-	
-	updateCameraViewMatrix(camera);
+	camera->dirty = true;
 }
 
 void constrainCameraRotation(PerspectiveCamera *camera, glm::vec3 lowerBounds, glm::vec3 upperBounds){
@@ -75,5 +89,5 @@ void constrainCameraRotation(PerspectiveCamera *camera, glm::vec3 lowerBounds, g
 		camera->rotation[i] = std::clamp(camera->rotation[i], lowerBound, upperBound);
 	}
 	
-	updateCameraViewMatrix(camera);
+	camera->dirty = true;
 }
\ No newline at end of file
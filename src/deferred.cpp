@@ -0,0 +1,187 @@
+// deferred shading
+
+#include <deferred.h>
+#include <engine.h>
+#include <utils.h>
+
+#include <glm/glm.hpp>
+#include <glm/ext.hpp>
+
+#include <cstdio>
+#include <vector>
+
+// create a texture to render into
+GLuint createRenderTexture(GLint internalFormat, GLenum format, GLenum type, uint32_t width, uint32_t height){
+	GLuint texture = 0;
+	
+	glGenTextures(1, &texture);
+	bindGlTexture(0, GL_TEXTURE_2D, texture);
+	glTexImage2D(GL_TEXTURE_2D, 0, internalFormat, width, height, 0, format, type, NULL);
+	
+	// read with texelFetch, but set filtering anyways so the texture is complete
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	
+	bindGlTexture(0, GL_TEXTURE_2D, 0);
+	
+	return texture;
+}
+
+// create a shader program from a vertex and fragment shader path
+ShaderProgramEx* createDeferredProgram(const char* vertexPath, const char* fragmentPath){
+	return loadShaderProgramEx(vertexPath, fragmentPath);
+}
+
+// point a program's sampler uniform at a texture unit, if the program has it
+void setDeferredSampler(ShaderProgramEx* programEx, const char* name, GLint unit){
+	GLint location = glGetUniformLocation(programEx->program, name);
+	
+	if(location == -1) return;
+	
+	useGlProgram(programEx->program);
+	glUniform1i(location, unit);
+	useGlProgram(0);
+}
+
+// creates a deferred renderer with a width x height g-buffer
+// returns NULL if its shaders or framebuffers couldn't be created
+DeferredRenderer* createDeferredRenderer(uint32_t width, uint32_t height){
+	DeferredRenderer* renderer = allocateMemoryForType<DeferredRenderer>();
+	
+	renderer->width = width;
+	renderer->height = height;
+	renderer->outputFramebuffer = 0;
+	
+	renderer->viewport[0] = 0;
+	renderer->viewport[1] = 0;
+	renderer->viewport[2] = width;
+	renderer->viewport[3] = height;
+	
+	// load shaders, every texture mode of the geometry programs is compiled now so the geometry pass never waits on one
+	renderer->geometryPrograms = createShaderPermutations("./res/shader/lighting/vertex.glsl", "./res/shader/deferred/geometryFragment.glsl");
+	
+	precompileShaderPermutations(renderer->geometryPrograms, 0);
+	precompileShaderPermutations(renderer->geometryPrograms, SHADER_FEATURE_INSTANCED);
+	
+	renderer->geometryProgram = getShaderPermutation(renderer->geometryPrograms, 0, SHADER_TEXTURED);
+	renderer->instancedGeometryProgram = getShaderPermutation(renderer->geometryPrograms, SHADER_FEATURE_INSTANCED, SHADER_TEXTURED);
+	renderer->lightProgram = createDeferredProgram("./res/shader/deferred/vertex.glsl", "./res/shader/deferred/lightFragment.glsl");
+	renderer->compositeProgram = createDeferredProgram("./res/shader/deferred/vertex.glsl", "./res/shader/deferred/compositeFragment.glsl");
+	
+	if(!renderer->geometryProgram || !renderer->instancedGeometryProgram || !renderer->lightProgram || !renderer->compositeProgram){
+		printf("Couldn't load deferred shading shaders\n");
+		
+		free(renderer);
+		
+		return NULL;
+	}
+	
+	// g-buffer and light textures are always read from these units
+	setDeferredSampler(renderer->lightProgram, "normalTexture", 1);
+	setDeferredSampler(renderer->lightProgram, "depthTexture", 2);
+	
+	setDeferredSampler(renderer->compositeProgram, "albedoTexture", 0);
+	setDeferredSampler(renderer->compositeProgram, "depthTexture", 2);
+	setDeferredSampler(renderer->compositeProgram, "lightTexture", 3);
+	
+	renderer->viewportSizeLocation = glGetUniformLocation(renderer->lightProgram->program, "viewportSize");
+	
+	// create g-buffer
+	renderer->albedoTexture = createRenderTexture(GL_RGBA8, GL_RGBA, GL_UNSIGNED_BYTE, width, height);
+	renderer->normalTexture = createRenderTexture(GL_RGBA16F, GL_RGBA, GL_FLOAT, width, height);
+	renderer->depthTexture = createRenderTexture(GL_DEPTH_COMPONENT24, GL_DEPTH_COMPONENT, GL_FLOAT, width, height);
+	
+	glGenFramebuffers(1, &renderer->geometryFramebuffer);
+	glBindFramebuffer(GL_FRAMEBUFFER, renderer->geometryFramebuffer);
+	
+	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, renderer->albedoTexture, 0);
+	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT1, GL_TEXTURE_2D, renderer->normalTexture, 0);
+	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, renderer->depthTexture, 0);
+	
+	GLenum drawBuffers[] = {GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1};
+	glDrawBuffers(2, drawBuffers);
+	
+	bool geometryComplete = glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE;
+	
+	// create light accumulation buffer
+	renderer->lightTexture = createRenderTexture(GL_RGBA16F, GL_RGBA, GL_FLOAT, width, height);
+	
+	glGenFramebuffers(1, &renderer->lightFramebuffer);
+	glBindFramebuffer(GL_FRAMEBUFFER, renderer->lightFramebuffer);
+	
+	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, renderer->lightTexture, 0);
+	
+	bool lightComplete = glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE;
+	
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+	
+	if(!geometryComplete || !lightComplete){
+		printf("Couldn't create deferred shading framebuffers\n");
+		
+		free(renderer);
+		
+		return NULL;
+	}
+	
+	glGenVertexArrays(1, &renderer->emptyVao);
+	
+	return renderer;
+}
+
+// start drawing the scene into the g-buffer
+// after this, render the scene as usual with geometryProgram (or instancedGeometryProgram), then call renderDeferredLighting
+// the current viewport is kept, it has to fit in the g-buffer
+void beginDeferredGeometryPass(DeferredRenderer* renderer){
+	// remember where the final image goes
+	glGetIntegerv(GL_FRAMEBUFFER_BINDING, &renderer->outputFramebuffer);
+	glGetIntegerv(GL_VIEWPORT, renderer->viewport);
+	
+	glBindFramebuffer(GL_FRAMEBUFFER, renderer->geometryFramebuffer);
+	
+	glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
+	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+}
+
+// light the g-buffer and composite the result into the output framebuffer
+// expects the scene's shared buffers to be up to date (the geometry pass updates them)
+void renderDeferredLighting(DeferredRenderer* renderer, Scene* scene){
+	RenderStats* stats = getRenderStats();
+	
+	// bind g-buffer
+	bindGlTexture(0, GL_TEXTURE_2D, renderer->albedoTexture);
+	bindGlTexture(1, GL_TEXTURE_2D, renderer->normalTexture);
+	bindGlTexture(2, GL_TEXTURE_2D, renderer->depthTexture);
+	bindGlTexture(3, GL_TEXTURE_2D, renderer->lightTexture);
+	
+	// light pass
+	glBindFramebuffer(GL_FRAMEBUFFER, renderer->lightFramebuffer);
+	glDisable(GL_DEPTH_TEST);
+	
+	bindGlVertexArray(renderer->emptyVao);
+	
+	if(scene->uploadedLights->size() > 0){
+		useProgramEx(renderer->lightProgram);
+		
+		if(renderer->viewportSizeLocation != -1) glUniform2f(renderer->viewportSizeLocation, renderer->viewport[2], renderer->viewport[3]);
+		
+		glDrawArrays(GL_TRIANGLES, 0, 3);
+		
+		stats->drawCalls++;
+	} else {
+		glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
+		glClear(GL_COLOR_BUFFER_BIT);
+	}
+	
+	// composite
+	glBindFramebuffer(GL_FRAMEBUFFER, renderer->outputFramebuffer);
+	
+	useProgramEx(renderer->compositeProgram);
+	
+	glDrawArrays(GL_TRIANGLES, 0, 3);
+	
+	glEnable(GL_DEPTH_TEST);
+	
+	stats->drawCalls++;
+}
\ No newline at end of file
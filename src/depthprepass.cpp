@@ -0,0 +1,61 @@
+// depth pre-pass
+
+#include <depthprepass.h>
+#include <utils.h>
+
+#include <cstdio>
+
+// creates the pre-pass programs
+// returns NULL if they couldn't be created
+DepthPrepass* createDepthPrepass(){
+	ShaderProgramEx* program = loadShaderProgramEx("./res/shader/depth/vertex.glsl", "./res/shader/depth/fragment.glsl");
+	ShaderProgramEx* instancedProgram = loadShaderProgramEx("./res/shader/depth/instancedVertex.glsl", "./res/shader/depth/fragment.glsl");
+	
+	if(!program || !instancedProgram){
+		printf("Couldn't create depth pre-pass programs\n");
+		
+		if(program) deleteShaderProgramEx(program);
+		if(instancedProgram) deleteShaderProgramEx(instancedProgram);
+		
+		return NULL;
+	}
+	
+	DepthPrepass* prepass = allocateMemoryForType<DepthPrepass>();
+	
+	prepass->program = program;
+	prepass->instancedProgram = instancedProgram;
+	
+	// gl defaults until the first pre-pass
+	prepass->depthFunc = GL_LESS;
+	prepass->depthMask = GL_TRUE;
+	
+	return prepass;
+}
+
+// start the pre-pass, after this render the scene with program (or instancedProgram), then call beginDepthPrepassMainPass
+// the pre-pass keeps whatever depth func is set, so it lays down the same depth the scene would get without it
+void beginDepthPrepass(DepthPrepass* prepass){
+	glGetIntegerv(GL_DEPTH_FUNC, &prepass->depthFunc);
+	glGetIntegerv(GL_DEPTH_WRITEMASK, &prepass->depthMask);
+	
+	glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+	glDepthMask(GL_TRUE);
+}
+
+// start the main pass, after this render the scene as usual, then call endDepthPrepass
+// depth is already final, so only the surface the pre-pass kept in each pixel passes (strict funcs let equal depths through too)
+void beginDepthPrepassMainPass(DepthPrepass* prepass){
+	glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+	glDepthMask(GL_FALSE);
+	
+	switch(prepass->depthFunc){
+		case GL_LESS: glDepthFunc(GL_LEQUAL); break;
+		case GL_GREATER: glDepthFunc(GL_GEQUAL); break;
+	}
+}
+
+// put the depth state from before the pre-pass back
+void endDepthPrepass(DepthPrepass* prepass){
+	glDepthMask(prepass->depthMask);
+	glDepthFunc(prepass->depthFunc);
+}
\ No newline at end of file
@@ -0,0 +1,166 @@
+// static draw lists
+
+#include <drawlist.h>
+#include <engine.h>
+
+#include <algorithm>
+
+// create an empty draw list, compiled on first use (see updateSceneStaticDrawList)
+StaticDrawList* createStaticDrawList(){
+	StaticDrawList* list = allocateMemoryForType<StaticDrawList>();
+	
+	list->records = new std::vector<StaticDrawRecord>();
+	list->instances = new std::vector<InstanceData>();
+	list->runs = new std::vector<StaticDrawRun>();
+	list->visibility = new std::vector<uint64_t>();
+	list->visibleCount = 0;
+	list->compiled = false;
+	list->vertexDataGeneration = 0;
+	
+	return list;
+}
+
+// have the list compiled again next time it's used, call after adding, removing or changing static objects
+void invalidateStaticDrawList(StaticDrawList* list){
+	list->compiled = false;
+}
+
+// used to sort objects of the same vertex data so that objects with the same texture binding end up next to each other
+bool compareDrawListTextureBindings(TexturedRenderableObject* a, TexturedRenderableObject* b){
+	return getTextureBinding(a->textureData) < getTextureBinding(b->textureData);
+}
+
+// build a draw record and instance for every visible static object of a scene
+// doesn't touch gl, so it's safe on the simulation thread
+void compileStaticDrawList(StaticDrawList* list, Scene* scene){
+	list->records->clear();
+	list->instances->clear();
+	list->runs->clear();
+	
+	std::vector<TexturedRenderableObject*> objects;
+	
+	for (std::map<VertexData*, std::vector<TexturedRenderableObject*>*>::iterator it = scene->staticObjects->begin(); it != scene->staticObjects->end(); it++){
+		if(!it->second) continue;
+		
+		VertexData* vertexData = it->first;
+		
+		objects.clear();
+		
+		for(uint32_t i = 0; i < it->second->size(); i++){
+			TexturedRenderableObject* object = it->second->at(i);
+			
+			if(!object || !object->visible) continue;
+			
+			objects.push_back(object);
+		}
+		
+		std::stable_sort(objects.begin(), objects.end(), compareDrawListTextureBindings);
+		
+		for(uint32_t i = 0; i < objects.size(); i++){
+			TexturedRenderableObject* object = objects[i];
+			Transform* transform = object->renderableObject->transform;
+			
+			StaticDrawRecord record;
+			
+			record.vertexData = vertexData;
+			record.vao = vertexData->vao;
+			record.indexed = vertexData->indexCount > 0;
+			record.first = record.indexed ? vertexData->firstIndex : vertexData->baseVertex;
+			record.count = record.indexed ? vertexData->indexCount : vertexData->vertexCount;
+			record.baseVertex = vertexData->baseVertex;
+			record.texture = object->textureData;
+			record.textureBinding = getTextureBinding(object->textureData);
+			record.center = getTransformWorldPosition(transform);
+			record.radius = glm::length(getTransformWorldScale(transform));
+			
+			// start a new run every time the texture binding changes
+			if(i == 0 || record.textureBinding != list->records->back().textureBinding){
+				list->runs->push_back( (StaticDrawRun){(uint32_t)list->records->size(), 0} );
+			}
+			
+			InstanceData instance;
+			
+			instance.model = getTransformWorldMatrix(transform);
+			instance.normalMatrix = getTransformNormalMatrix(transform);
+			instance.material = object->material;
+			instance.lightmapRect = object->lightmapRect;
+			
+			list->records->push_back(record);
+			list->instances->push_back(instance);
+			list->runs->back().recordCount++;
+		}
+	}
+	
+	list->visibility->assign((list->records->size() + 63) / 64, 0);
+	list->visibleCount = 0;
+	
+	list->compiled = true;
+	list->vertexDataGeneration = getVertexDataGeneration();
+}
+
+// get a scene's static draw list, compiling it first if it was invalidated or any vertex data moved since it was compiled
+StaticDrawList* updateSceneStaticDrawList(Scene* scene){
+	StaticDrawList* list = scene->staticDrawList;
+	
+	if(!list->compiled || list->vertexDataGeneration != getVertexDataGeneration()) compileStaticDrawList(list, scene);
+	
+	return list;
+}
+
+// set the visibility bit of every record whose bounding sphere isn't culled by camera
+// returns the number of visible records
+uint32_t cullStaticDrawList(StaticDrawList* list, PerspectiveCamera* camera){
+	std::vector<uint64_t>& visibility = *list->visibility;
+	std::vector<StaticDrawRecord>& records = *list->records;
+	
+	uint32_t visibleCount = 0;
+	
+	for(uint32_t word = 0; word < visibility.size(); word++){
+		uint64_t bits = 0;
+		uint32_t end = std::min((word + 1) * 64, (uint32_t)records.size());
+		
+		for(uint32_t i = word * 64; i < end; i++){
+			if(isSphereCulled(records[i].center, records[i].radius, camera)) continue;
+			
+			bits |= (uint64_t)1 << (i % 64);
+			visibleCount++;
+		}
+		
+		visibility[word] = bits;
+	}
+	
+	list->visibleCount = visibleCount;
+	
+	return visibleCount;
+}
+
+bool isStaticDrawRecordVisible(StaticDrawList* list, uint32_t record){
+	return (list->visibility->at(record / 64) >> (record % 64)) & 1;
+}
+
+// write the index of every visible record into visible, in record order
+void getStaticDrawListVisible(StaticDrawList* list, std::vector<uint32_t>& visible){
+	std::vector<uint64_t>& visibility = *list->visibility;
+	
+	visible.clear();
+	
+	for(uint32_t word = 0; word < visibility.size(); word++){
+		uint64_t bits = visibility[word];
+		
+		// pop set bits lowest first
+		while(bits){
+			visible.push_back(word * 64 + __builtin_ctzll(bits));
+			
+			bits &= bits - 1;
+		}
+	}
+}
+
+// issue a record's draw call, expects its vao to be bound
+void drawStaticDrawRecord(StaticDrawRecord& record){
+	if(record.indexed){
+		glDrawElementsBaseVertex(GL_TRIANGLES, record.count, GL_UNSIGNED_INT, (void*)(uintptr_t)(record.first * sizeof(uint32_t)), record.baseVertex);
+	} else {
+		glDrawArrays(GL_TRIANGLES, record.first, record.count);
+	}
+}
\ No newline at end of file
@@ -0,0 +1,135 @@
+// dynamic resolution
+
+#include <dynamicresolution.h>
+#include <glstate.h>
+#include <utils.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+
+// lowest scale the renderer drops to, below this the upscaled image gets too blurry to be worth the time saved
+#define DYNAMIC_RESOLUTION_MIN_SCALE 0.5f
+
+// fraction of the way to the wanted scale moved each frame
+// gpu times are read back a frame late and are noisy, so jumping straight to the wanted scale would overshoot and oscillate
+#define DYNAMIC_RESOLUTION_RESPONSE 0.25f
+
+// gpu time within this fraction of the target counts as on target, so the scale doesn't wander when it's already close
+#define DYNAMIC_RESOLUTION_TOLERANCE 0.05
+
+// creates dynamic resolution buffers for a width x height output, aiming for targetFrameTime seconds of gpu time per frame
+// starts out at full resolution, returns NULL if the framebuffer couldn't be created
+DynamicResolution* createDynamicResolution(uint32_t width, uint32_t height, double targetFrameTime){
+	DynamicResolution* resolution = allocateMemoryForType<DynamicResolution>();
+	
+	resolution->width = width;
+	resolution->height = height;
+	resolution->minScale = DYNAMIC_RESOLUTION_MIN_SCALE;
+	resolution->maxScale = 1.0f;
+	resolution->targetFrameTime = targetFrameTime;
+	resolution->outputFramebuffer = 0;
+	
+	setDynamicResolutionScale(resolution, 1.0f);
+	
+	// color is only ever blitted, so it can be filtered linearly when upscaling
+	glGenTextures(1, &resolution->colorTexture);
+	bindGlTexture(0, GL_TEXTURE_2D, resolution->colorTexture);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+	
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	
+	bindGlTexture(0, GL_TEXTURE_2D, 0);
+	
+	// depth is never read, so a renderbuffer is enough
+	glGenRenderbuffers(1, &resolution->depthRenderbuffer);
+	glBindRenderbuffer(GL_RENDERBUFFER, resolution->depthRenderbuffer);
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, width, height);
+	glBindRenderbuffer(GL_RENDERBUFFER, 0);
+	
+	glGenFramebuffers(1, &resolution->framebuffer);
+	glBindFramebuffer(GL_FRAMEBUFFER, resolution->framebuffer);
+	
+	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, resolution->colorTexture, 0);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, resolution->depthRenderbuffer);
+	
+	bool complete = glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE;
+	
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+	
+	if(!complete){
+		printf("Couldn't create dynamic resolution framebuffer\n");
+		
+		glDeleteFramebuffers(1, &resolution->framebuffer);
+		glDeleteRenderbuffers(1, &resolution->depthRenderbuffer);
+		glDeleteTextures(1, &resolution->colorTexture);
+		
+		free(resolution);
+		
+		return NULL;
+	}
+	
+	return resolution;
+}
+
+// set the scale directly, clamped to the resolution's range
+void setDynamicResolutionScale(DynamicResolution* resolution, float scale){
+	resolution->scale = std::min(std::max(scale, resolution->minScale), resolution->maxScale);
+	
+	resolution->renderWidth = std::max((uint32_t)std::lround(resolution->width * resolution->scale), (uint32_t)1);
+	resolution->renderHeight = std::max((uint32_t)std::lround(resolution->height * resolution->scale), (uint32_t)1);
+}
+
+// adjust the scale for the next frame from the gpu time of a frame rendered at the current scale
+// gpu time is taken to grow with the number of pixels rendered, which goes with the square of the scale
+void updateDynamicResolution(DynamicResolution* resolution, double gpuTime){
+	if(gpuTime <= 0.0) return;
+	
+	double ratio = resolution->targetFrameTime / gpuTime;
+	
+	if(std::abs(ratio - 1.0) < DYNAMIC_RESOLUTION_TOLERANCE) return;
+	
+	float wantedScale = resolution->scale * (float)std::sqrt(ratio);
+	
+	setDynamicResolutionScale(resolution, resolution->scale + (wantedScale - resolution->scale) * DYNAMIC_RESOLUTION_RESPONSE);
+}
+
+// start drawing into the offscreen buffers at the current scale
+// after this render the frame as usual (clears included), then call endDynamicResolution
+void beginDynamicResolution(DynamicResolution* resolution){
+	// remember where the final image goes
+	glGetIntegerv(GL_FRAMEBUFFER_BINDING, &resolution->outputFramebuffer);
+	
+	glBindFramebuffer(GL_FRAMEBUFFER, resolution->framebuffer);
+	glViewport(0, 0, resolution->renderWidth, resolution->renderHeight);
+}
+
+// upscale what was drawn into the output framebuffer with bilinear filtering, and bind the output again at full size
+void endDynamicResolution(DynamicResolution* resolution){
+	uint32_t renderWidth = resolution->renderWidth;
+	uint32_t renderHeight = resolution->renderHeight;
+	
+	// the filter reads up to half a texel past the right and top edges of the drawn part
+	// copy the last column and row out one texel so the edges don't pick up whatever was cleared there
+	glBindFramebuffer(GL_FRAMEBUFFER, resolution->framebuffer);
+	
+	if(renderWidth < resolution->width){
+		glBlitFramebuffer(renderWidth - 1, 0, renderWidth, renderHeight, renderWidth, 0, renderWidth + 1, renderHeight, GL_COLOR_BUFFER_BIT, GL_NEAREST);
+		
+		renderWidth++;
+	}
+	
+	if(renderHeight < resolution->height){
+		glBlitFramebuffer(0, renderHeight - 1, renderWidth, renderHeight, 0, renderHeight, renderWidth, renderHeight + 1, GL_COLOR_BUFFER_BIT, GL_NEAREST);
+	}
+	
+	glBindFramebuffer(GL_DRAW_FRAMEBUFFER, resolution->outputFramebuffer);
+	
+	glBlitFramebuffer(0, 0, resolution->renderWidth, resolution->renderHeight, 0, 0, resolution->width, resolution->height, GL_COLOR_BUFFER_BIT, GL_LINEAR);
+	
+	glBindFramebuffer(GL_FRAMEBUFFER, resolution->outputFramebuffer);
+	glViewport(0, 0, resolution->width, resolution->height);
+}
\ No newline at end of file
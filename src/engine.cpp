@@ -6,6 +6,270 @@
 #include <glm/ext.hpp>
 #include <glm/gtx/norm.hpp>
 
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+
+// number of texels each light takes up in the light data buffer (see packPointLightData)
+#define LIGHT_DATA_TEXELS 3
+
+// render statistics
+RenderStats renderStats = {0, 0, 0, 0};
+
+// get the render statistics accumulated since the last reset
+RenderStats* getRenderStats(){
+	return &renderStats;
+}
+
+void resetRenderStats(){
+	renderStats.drawCalls = 0;
+	renderStats.objectsRendered = 0;
+	renderStats.lightUploads = 0;
+	renderStats.vertexArrayBinds = 0;
+}
+
+// if opaque objects are drawn front to back (see setFrontToBackSorting)
+bool frontToBack = false;
+
+// draw objects nearest to the camera first, so the depth test can reject the fragments behind them before they're shaded
+// costs a sort per frame, and per-object rendering ends up switching textures more often
+void setFrontToBackSorting(bool enabled){
+	frontToBack = enabled;
+}
+
+// uniform buffers //
+
+// pack a light into its texels in the light data buffer
+// (position, radius), (color * diffuseStrength, c), (l, q, unused, unused)
+void packPointLightData(PointLight* light, glm::vec4* texels){
+	texels[0] = glm::vec4(light->position, light->radius);
+	texels[1] = glm::vec4(light->color * light->diffuseStrength, light->c);
+	texels[2] = glm::vec4(light->l, light->q, 0, 0);
+}
+
+// upload any lights that changed since the last call to the light data buffer
+// lights are only written when they're new to their slot or marked dirty (see the setters in lighting.h)
+// returns true if anything changed
+bool updateSceneLightBuffer(Scene* scene){
+	return updateSceneLightBuffer(scene, *scene->pointLights);
+}
+
+// same as above, but uploads lights instead of the scene's lights
+// used by the render thread, which draws copies of the lights from a frame packet (see renderthread.h)
+bool updateSceneLightBuffer(Scene* scene, std::vector<PointLight*>& lights){
+	// create buffer on first use
+	if(!scene->lightDataBuffer){
+		scene->lightDataBuffer = createTextureBuffer(GL_RGBA32F, 0);
+		
+		if(!scene->lightDataBuffer) return false;
+	}
+	
+	uint32_t lightCount = 0;
+	
+	for(uint32_t i = 0; i < lights.size(); i++){
+		if(lights.at(i) != NULL) lightCount++;
+	}
+	
+	uint32_t lightSize = LIGHT_DATA_TEXELS * sizeof(glm::vec4);
+	
+	// if the buffer has to grow, upload every light at once
+	if(lightCount * lightSize > scene->lightDataBuffer->size){
+		std::vector<glm::vec4> texels(lightCount * LIGHT_DATA_TEXELS);
+		
+		scene->uploadedLights->clear();
+		
+		for(uint32_t i = 0; i < lights.size(); i++){
+			PointLight* light = lights.at(i);
+			
+			if(light == NULL) continue;
+			
+			packPointLightData(light, &texels[scene->uploadedLights->size() * LIGHT_DATA_TEXELS]);
+			
+			scene->uploadedLights->push_back(light);
+			
+			light->dirty = false;
+			
+			renderStats.lightUploads++;
+		}
+		
+		uploadTextureBuffer(scene->lightDataBuffer, lightCount * lightSize, &texels[0]);
+		
+		return true;
+	}
+	
+	// otherwise only upload the slots that changed
+	uint32_t uploadedCount = scene->uploadedLights->size();
+	uint32_t slot = 0;
+	bool changed = false;
+	
+	for(uint32_t i = 0; i < lights.size(); i++){
+		PointLight* light = lights.at(i);
+		
+		if(light == NULL) continue;
+		
+		// check if the slot is already up to date
+		bool sameLight = slot < scene->uploadedLights->size() && scene->uploadedLights->at(slot) == light;
+		
+		if(!sameLight || light->dirty){
+			glm::vec4 texels[LIGHT_DATA_TEXELS];
+			
+			packPointLightData(light, texels);
+			
+			updateTextureBuffer(scene->lightDataBuffer, slot * lightSize, lightSize, texels);
+			
+			if(slot < scene->uploadedLights->size()){
+				scene->uploadedLights->at(slot) = light;
+			} else {
+				scene->uploadedLights->push_back(light);
+			}
+			
+			light->dirty = false;
+			changed = true;
+			
+			renderStats.lightUploads++;
+		}
+		
+		slot++;
+	}
+	
+	// lights were removed
+	if(slot != uploadedCount){
+		scene->uploadedLights->resize(slot);
+		
+		changed = true;
+	}
+	
+	return changed;
+}
+
+// reassign the scene's lights to the clusters of the camera's view and upload the result, along with the Lights block
+void updateSceneLightClusters(Scene* scene, PerspectiveCamera* camera){
+	// create buffer and grid on first use
+	if(!scene->lightBuffer){
+		scene->lightBuffer = createUniformBuffer(sizeof(LightsBlock), LIGHTS_BLOCK_BINDING);
+		
+		if(!scene->lightBuffer) return;
+	}
+	
+	if(!scene->lightClusters){
+		scene->lightClusters = createLightClusterGrid(LIGHT_CLUSTERS_X, LIGHT_CLUSTERS_Y, LIGHT_CLUSTERS_Z);
+		
+		if(!scene->lightClusters) return;
+	}
+	
+	LightClusterGrid* grid = scene->lightClusters;
+	
+	assignLightClusters(grid, *scene->uploadedLights, camera);
+	uploadLightClusters(grid);
+	
+	// update the Lights block if it changed
+	LightsBlock block;
+	
+	block.ambientLight = glm::vec3(0);
+	
+	for(uint32_t i = 0; i < scene->uploadedLights->size(); i++){
+		PointLight* light = scene->uploadedLights->at(i);
+		
+		block.ambientLight += light->color * light->ambientStrength;
+	}
+	
+	block.numPointLights = scene->uploadedLights->size();
+	block.clusterGridSize[0] = grid->sizeX;
+	block.clusterGridSize[1] = grid->sizeY;
+	block.clusterGridSize[2] = grid->sizeZ;
+	block.clusterDepthScale = getLightClusterDepthScale(grid);
+	block.clusterDepthBias = getLightClusterDepthBias(grid);
+	block.padding[0] = block.padding[1] = block.padding[2] = 0;
+	
+	if(memcmp(&block, &scene->uploadedLightsBlock, sizeof(LightsBlock)) == 0) return;
+	
+	updateUniformBuffer(scene->lightBuffer, 0, sizeof(LightsBlock), &block);
+	
+	scene->uploadedLightsBlock = block;
+}
+
+// upload camera matrices to the shared camera buffer if the camera changed since the last call
+// returns true if the camera changed
+bool updateSceneCameraBuffer(Scene* scene, PerspectiveCamera* camera){
+	// create buffer on first use
+	if(!scene->cameraBuffer){
+		scene->cameraBuffer = createUniformBuffer(sizeof(CameraBlock), CAMERA_BLOCK_BINDING);
+		
+		if(!scene->cameraBuffer) return false;
+	}
+	
+	CameraBlock block;
+	
+	block.view = camera->view;
+	block.projection = camera->projection;
+	block.pv = camera->pv;
+	block.position = camera->position;
+	block.padding = 0;
+	block.inversePv = glm::inverse(camera->pv);
+	
+	if(memcmp(&block, &scene->uploadedCamera, sizeof(CameraBlock)) == 0) return false;
+	
+	updateUniformBuffer(scene->cameraBuffer, 0, sizeof(CameraBlock), &block);
+	
+	scene->uploadedCamera = block;
+	
+	return true;
+}
+
+// update every buffer shared by the scene's programs and bind the light texture buffers
+// safe to call multiple times a frame, nothing is uploaded unless it changed
+void updateSceneUniformBuffers(Scene* scene, PerspectiveCamera* camera){
+	updateSceneUniformBuffers(scene, camera, *scene->pointLights);
+}
+
+// same as above, but with lights in place of the scene's lights (see updateSceneLightBuffer)
+void updateSceneUniformBuffers(Scene* scene, PerspectiveCamera* camera, std::vector<PointLight*>& lights){
+	updateCameraMatrices(camera);
+	
+	bool lightsChanged = updateSceneLightBuffer(scene, lights);
+	bool cameraChanged = updateSceneCameraBuffer(scene, camera);
+	
+	// clusters are in view space, so they have to be reassigned whenever the camera or any light moves
+	if(lightsChanged || cameraChanged || !scene->lightClusters) updateSceneLightClusters(scene, camera);
+	
+	// materials only change while loading, so this rarely uploads anything
+	uploadMaterialTable(scene->materials);
+	
+	if(scene->lightDataBuffer) bindTextureBuffer(scene->lightDataBuffer, LIGHT_DATA_TEXTURE_UNIT);
+	bindMaterialTable(scene->materials);
+	if(scene->lightClusters) bindLightClusters(scene->lightClusters);
+	if(scene->lightmap) bindLightmap(scene->lightmap);
+}
+
+// scatter count small, randomly colored lights through the bounds of the scene's static objects
+// for benchmarking scenes with lots of lights (see --lights in main.cpp)
+void addRandomPointLights(Scene* scene, uint32_t count){
+	// get bounds
+	glm::vec3 lower = glm::vec3(HUGE_VALF);
+	glm::vec3 upper = glm::vec3(-HUGE_VALF);
+	
+	for(auto it = scene->staticObjects->begin(); it != scene->staticObjects->end(); it++){
+		std::vector<TexturedRenderableObject*>* objects = it->second;
+		
+		for(uint32_t i = 0; i < objects->size(); i++){
+			glm::vec3 position = getTransformWorldPosition(objects->at(i)->renderableObject->transform);
+			
+			lower = glm::min(lower, position);
+			upper = glm::max(upper, position);
+		}
+	}
+	
+	// no objects
+	if(lower.x > upper.x) return;
+	
+	for(uint32_t i = 0; i < count; i++){
+		glm::vec3 position = lower + (upper - lower) * glm::vec3(rand(), rand(), rand()) / (float)RAND_MAX;
+		glm::vec3 color = glm::vec3(0.25f) + 0.75f * glm::vec3(rand(), rand(), rand()) / (float)RAND_MAX;
+		
+		scene->pointLights->push_back(createPointLight(position, color, 0.0f, 1.0f, 1.0f, 0.7f, 1.8f));
+	}
+}
+
 // assumes a texture uniform "texture1" exists in the shader
 void renderTexturedRenderableObject(TexturedRenderableObject* texturedRenderableObject, PerspectiveCamera* camera, ShaderProgramEx* programEx){
 	// null checks
@@ -14,11 +278,11 @@ void renderTexturedRenderableObject(TexturedRenderableObject* texturedRenderable
 	// bind texture
 	TextureData* textureData = texturedRenderableObject->textureData;
 	
-	// set color
-	glUniform3fv(getProgramExUniformLocation(programEx, "color"), 1, glm::value_ptr(texturedRenderableObject->color));
+	// set material (constant attribute, see MaterialTable)
+	glVertexAttribI1ui(11, texturedRenderableObject->material);
 	
 	// set texture
-	setProgramExUniformTexture(programEx, "texture1", textureData);
+	setProgramExUniformTexture(programEx, UNIFORM_TEXTURE1, textureData);
 	
 	// render
 	RenderableObject* object = texturedRenderableObject->renderableObject;
@@ -36,11 +300,11 @@ void renderTexturedRenderableObjectNoBind(TexturedRenderableObject* texturedRend
 	// bind texture
 	TextureData* textureData = texturedRenderableObject->textureData;
 	
-	// set color
-	glUniform3fv(getProgramExUniformLocation(programEx, "color"), 1, glm::value_ptr(texturedRenderableObject->color));
+	// set material (constant attribute, see MaterialTable)
+	glVertexAttribI1ui(11, texturedRenderableObject->material);
 	
 	// set texture
-	setProgramExUniformTexture(programEx, "texture1", textureData);
+	setProgramExUniformTexture(programEx, UNIFORM_TEXTURE1, textureData);
 	
 	// render
 	RenderableObject* object = texturedRenderableObject->renderableObject;
@@ -51,73 +315,493 @@ void renderTexturedRenderableObjectNoBind(TexturedRenderableObject* texturedRend
 	resetProgramExUniformTextures(programEx);
 }
 
+// check if a bounding sphere can be skipped when rendering from camera
+bool isSphereCulled(glm::vec3 center, float radius, PerspectiveCamera* camera){
+	float maxDistance2 = camera->far * camera->far;
+	
+	// compute distance from camera
+	glm::vec3 difVector = center - camera->position;
+	float distance2 = glm::length2( difVector );
+	
+	distance2 -= radius*radius;
+	
+	// if distance is greater than view distance, cull
+	if(distance2 > maxDistance2) return true;
+	
+	// determine if sphere is absolutely behind viewer
+	glm::vec3 furthestPossiblePoint = center + camera->forward*radius;
+	
+	float angle = glm::dot(camera->forward, glm::normalize(furthestPossiblePoint - camera->position) );
+	
+	return angle < 0;
+}
+
+// check if an object can be skipped when rendering from camera
+// not perfect but good enough, basically creates a bounding sphere which can be ineffective for long thin objects
+bool isObjectCulled(TexturedRenderableObject* object, PerspectiveCamera* camera){
+	Transform* transform = object->renderableObject->transform;
+	
+	float longestEdge = glm::length(getTransformWorldScale(transform));
+	
+	return isSphereCulled(getTransformWorldPosition(transform), longestEdge, camera);
+}
+
+// a visible draw list record and its squared distance from the camera (0 unless sorting front to back)
+struct SortedRecord {
+	uint32_t record;
+	float distance;
+};
+
+// get the distance a draw list record should be sorted by
+float getSortDistance(StaticDrawRecord& record, PerspectiveCamera* camera){
+	if(!frontToBack) return 0;
+	
+	return glm::distance2(record.center, camera->position);
+}
+
+// used to sort records front to back
+bool compareSortedRecordDistances(const SortedRecord& a, const SortedRecord& b){
+	return a.distance < b.distance;
+}
+
 // render an entire scene
-// assumes uniforms named pointLights, numPointLights, and normalMatrix exist
+// replays the visible records of the scene's static draw list, which come sorted by vertex data and texture (front to back if sorting)
+// assumes the program uses the Lights and Camera uniform blocks and light texture buffers, and uniforms named model and normalMatrix exist
+// each record is drawn with the variant of programEx for its texture (see permutation.h)
 void renderScene(Scene* scene, PerspectiveCamera* camera, ShaderProgramEx* programEx){
-	float maxDistance2 = camera->far * camera->far;
+	// update lights and camera
+	updateSceneUniformBuffers(scene, camera);
+	
+	StaticDrawList* list = updateSceneStaticDrawList(scene);
+	
+	cullStaticDrawList(list, camera);
+	
+	std::vector<uint32_t> visible;
 	
-	// add lights to shader
-	for(uint32_t i = 0; i < scene->pointLights->size(); i++){
-		PointLight* light = scene->pointLights->at(i);
+	getStaticDrawListVisible(list, visible);
+	
+	if(frontToBack){
+		std::vector<SortedRecord> sorted;
+		
+		for(uint32_t i = 0; i < visible.size(); i++){
+			sorted.push_back( (SortedRecord){visible[i], getSortDistance(list->records->at(visible[i]), camera)} );
+		}
+		
+		std::sort(sorted.begin(), sorted.end(), compareSortedRecordDistances);
 		
-		if(light != NULL) addProgramExPointLight(programEx, "pointLights", light);
+		for(uint32_t i = 0; i < sorted.size(); i++){
+			visible[i] = sorted[i].record;
+		}
 	}
 	
-	uint32_t renderCalls = 0;
+	// vao currently bound
+	uint32_t boundVao = 0;
 	
-	// loop through vertex data
-	for (std::map<VertexData*, std::vector<TexturedRenderableObject*>*>::iterator it = scene->staticObjects->begin(); it != scene->staticObjects->end(); it++){
-    // bind vertex data
-		bindVertexData(it->first);
+	// render each record
+	for(uint32_t i = 0; i < visible.size(); i++){
+		StaticDrawRecord& record = list->records->at(visible[i]);
+		InstanceData& instance = list->instances->at(visible[i]);
 		
-		if(!it->second) continue;
+		// objects are drawn one at a time, so there's nothing to gain from texture arrays
+		ShaderProgramEx* variant = getProgramExVariant(programEx, getShaderTextureMode(record.texture, false));
 		
-		// render each object
-		for(uint32_t i = 0; i < it->second->size(); i++){
-			TexturedRenderableObject* object = it->second->at(i);
-			
-			if(!object || !object->visible) continue;
+		useProgramEx(variant);
+		
+		// bind vertex data, unless it shares a mesh pool page with the last one
+		if(record.vao != boundVao){
+			bindGlVertexArray(record.vao);
 			
-			// compute distance from camera
+			boundVao = record.vao;
+			renderStats.vertexArrayBinds++;
+		}
+		
+		// model and normal matrix are necessary for lighting, lightmap rect is only used by the lightmap shader
+		setProgramExUniformMat4(variant, UNIFORM_MODEL, instance.model);
+		setProgramExUniformMat3(variant, UNIFORM_NORMAL_MATRIX, instance.normalMatrix);
+		setProgramExUniformVec4(variant, UNIFORM_LIGHTMAP_RECT, instance.lightmapRect);
+		setProgramExUniformTexture(variant, UNIFORM_TEXTURE1, record.texture);
+		
+		// color (and layer) come from the material table, the material is a constant attribute since it's only an int
+		glVertexAttribI1ui(11, instance.material);
+		
+		if(getProgramExUniform(variant, UNIFORM_PVM) != -1) setProgramExUniformMat4(variant, UNIFORM_PVM, camera->pv * instance.model);
+		
+		drawStaticDrawRecord(record);
+		
+		resetProgramExUniformTextures(variant);
+	}
+	
+	renderStats.drawCalls += visible.size();
+	renderStats.objectsRendered += visible.size();
+}
+
+// used to sort instance groups front to back, by their nearest instance
+bool compareInstanceGroupDistances(const InstanceGroup& a, const InstanceGroup& b){
+	return a.distance < b.distance;
+}
+
+// used to sort instance groups into multi-draw buckets, groups that share a vao and texture binding end up next to each other
+bool compareInstanceGroupBuckets(const InstanceGroup& a, const InstanceGroup& b){
+	if(a.vertexData->vao != b.vertexData->vao) return a.vertexData->vao < b.vertexData->vao;
+	
+	return getTextureBinding(a.texture) < getTextureBinding(b.texture);
+}
+
+// cull a scene's static draw list and write the visible records' instances into instances, in groups of vertex data and texture binding
+// doesn't touch gl, so the simulation thread can build a frame's instances while the render thread draws the last one
+void collectSceneInstances(Scene* scene, PerspectiveCamera* camera, std::vector<InstanceData>& instances, std::vector<InstanceGroup>& groups){
+	instances.clear();
+	groups.clear();
+	
+	StaticDrawList* list = updateSceneStaticDrawList(scene);
+	
+	cullStaticDrawList(list, camera);
+	
+	std::vector<SortedRecord> visible;
+	
+	// every run becomes a group, unless none of it is visible
+	for(uint32_t i = 0; i < list->runs->size(); i++){
+		StaticDrawRun& run = list->runs->at(i);
+		
+		visible.clear();
+		
+		for(uint32_t j = run.firstRecord; j < run.firstRecord + run.recordCount; j++){
+			if(!isStaticDrawRecordVisible(list, j)) continue;
 			
-			// not perfect but good enough, basically creates a bounding sphere which can be ineffective for long thin objects
-			float longestEdge2 = glm::length2(object->renderableObject->scale);
+			visible.push_back( (SortedRecord){j, getSortDistance(list->records->at(j), camera)} );
+		}
+		
+		if(visible.size() == 0) continue;
+		
+		if(frontToBack) std::sort(visible.begin(), visible.end(), compareSortedRecordDistances);
+		
+		InstanceGroup group;
+		
+		group.vertexData = list->records->at(run.firstRecord).vertexData;
+		group.texture = list->records->at(visible[0].record).texture;
+		group.firstInstance = instances.size();
+		group.instanceCount = visible.size();
+		group.distance = visible[0].distance; // nearest, since the group is sorted front to back
+		
+		groups.push_back(group);
+		
+		for(uint32_t j = 0; j < visible.size(); j++){
+			instances.push_back(list->instances->at(visible[j].record));
+		}
+	}
+}
+
+// put instance groups in the order a render mode draws them
+// instances are found through firstInstance, so groups can be drawn in any order
+void sortSceneInstanceGroups(std::vector<InstanceGroup>& groups, SceneRenderMode mode){
+	if(mode == RENDER_MULTI_DRAW){
+		// buckets are drawn in one call each, so front to back only applies to the commands inside of a bucket
+		if(frontToBack){
+			std::sort(groups.begin(), groups.end(), compareInstanceGroupDistances);
+			std::stable_sort(groups.begin(), groups.end(), compareInstanceGroupBuckets);
+		} else {
+			std::sort(groups.begin(), groups.end(), compareInstanceGroupBuckets);
+		}
+	} else if(frontToBack){
+		std::sort(groups.begin(), groups.end(), compareInstanceGroupDistances);
+	}
+}
+
+// upload instances to scene->instanceBuffer, which is created on first use
+// returns false if the instance buffer couldn't be created
+bool uploadSceneInstances(Scene* scene, std::vector<InstanceData>& instances){
+	// create instance buffer on first use
+	if(!scene->instanceBuffer){
+		scene->instanceBuffer = createInstanceBuffer(256);
+		
+		if(!scene->instanceBuffer) return false;
+	}
+	
+	// upload every instance at once
+	uploadInstanceBuffer(scene->instanceBuffer, instances);
+	
+	return true;
+}
+
+// cull a scene's static objects and write the visible ones into scene->instances, sorted into groups of vertex data and texture binding (scene->instanceGroups)
+// the instances are uploaded to scene->instanceBuffer, which is created on first use
+// returns false if the instance buffer couldn't be created
+bool buildSceneInstances(Scene* scene, PerspectiveCamera* camera){
+	collectSceneInstances(scene, camera, *scene->instances, *scene->instanceGroups);
+	
+	return uploadSceneInstances(scene, *scene->instances);
+}
+
+// draw instances one at a time with per-object uniforms, for programs without instance attributes (like renderScene)
+// groups only share a texture binding, so objects end up sorted by texture instead of strictly front to back
+void drawSceneInstancesPerObject(Scene* scene, std::vector<InstanceData>& instances, std::vector<InstanceGroup>& groups, PerspectiveCamera* camera, ShaderProgramEx* programEx){
+	// vao currently bound
+	uint32_t boundVao = 0;
+	
+	for(uint32_t i = 0; i < groups.size(); i++){
+		InstanceGroup& group = groups[i];
+		
+		if(group.vertexData->vao != boundVao){
+			bindVertexData(group.vertexData);
 			
-			glm::vec3 difVector = object->renderableObject->position - camera->position;
-			float distance2 = glm::length2( difVector );
+			boundVao = group.vertexData->vao;
+			renderStats.vertexArrayBinds++;
+		}
+		
+		// objects in a group can have different textures of the same array, each one's material (which has its layer) is set as a constant attribute below
+		ShaderProgramEx* variant = useProgramExObjectTexture(programEx, group.texture);
+		
+		GLint pvmLocation = getProgramExUniform(variant, UNIFORM_PVM);
+		
+		for(uint32_t j = group.firstInstance; j < group.firstInstance + group.instanceCount; j++){
+			InstanceData& instance = instances[j];
 			
-			distance2 -= longestEdge2;
+			setProgramExUniformMat4(variant, UNIFORM_MODEL, instance.model);
+			setProgramExUniformMat3(variant, UNIFORM_NORMAL_MATRIX, instance.normalMatrix);
+			setProgramExUniformVec4(variant, UNIFORM_LIGHTMAP_RECT, instance.lightmapRect);
+			glVertexAttribI1ui(11, instance.material);
 			
-			// if distance is greater than view distance, cull
-			if(distance2 > maxDistance2) continue;
+			if(pvmLocation != -1){
+				glm::mat4 pvm = camera->pv * instance.model;
+				
+				setProgramExUniformMat4(variant, UNIFORM_PVM, pvm);
+			}
 			
-			// determine if object is absolutely behind viewer
-			float longestEdge = sqrt(longestEdge2);
+			renderVertexDataNoBind(group.vertexData);
 			
-			glm::vec3 furthestPossiblePoint = object->renderableObject->position + camera->forward*longestEdge;
+			renderStats.drawCalls++;
+			renderStats.objectsRendered++;
+		}
+		
+		resetProgramExUniformTextures(variant);
+	}
+}
+
+// render an entire scene using instancing, one draw call per vertex data/texture binding pair (textures packed into the same array share a binding)
+// assumes programEx was made with INSTANCED defined (instance attributes instead of model and normalMatrix uniforms, see permutation.h)
+void renderSceneInstanced(Scene* scene, PerspectiveCamera* camera, ShaderProgramEx* programEx){
+	// update lights and camera
+	updateSceneUniformBuffers(scene, camera);
+	
+	if(!buildSceneInstances(scene, camera)) return;
+	
+	sortSceneInstanceGroups(*scene->instanceGroups, RENDER_INSTANCED);
+	
+	drawSceneInstanced(scene, *scene->instanceGroups, programEx);
+}
+
+// draw instance groups whose instances are already in scene->instanceBuffer (see uploadSceneInstances), one draw call per group
+void drawSceneInstanced(Scene* scene, std::vector<InstanceGroup>& groups, ShaderProgramEx* programEx){
+	// vao currently bound
+	uint32_t boundVao = 0;
+	
+	// draw each group
+	for(uint32_t i = 0; i < groups.size(); i++){
+		InstanceGroup& group = groups[i];
+		
+		// groups in the same mesh pool page share a vao, only the instance attributes need moving
+		if(group.vertexData->vao != boundVao){
+			bindVertexData(group.vertexData);
 			
-			float angle = glm::dot(camera->forward, glm::normalize(furthestPossiblePoint - camera->position) );
+			boundVao = group.vertexData->vao;
+			renderStats.vertexArrayBinds++;
+		}
+		
+		bindVertexDataInstances(group.vertexData, scene->instanceBuffer, group.firstInstance);
+		
+		ShaderProgramEx* variant = useProgramExObjectTexture(programEx, group.texture);
+		
+		renderVertexDataInstancedNoBind(group.vertexData, group.instanceCount);
+		
+		resetProgramExUniformTextures(variant);
+		
+		renderStats.drawCalls++;
+		renderStats.objectsRendered += group.instanceCount;
+	}
+}
+
+// render an entire scene using multi-draw indirect, one draw call per vao/texture binding pair
+// every instance group becomes a draw command, and commands that share a vao (mesh pool page) and texture binding are drawn together
+// falls back to a draw call per command if multi-draw indirect isn't supported (see multiDrawElementsIndirect)
+// uses the same shader as renderSceneInstanced
+void renderSceneMultiDraw(Scene* scene, PerspectiveCamera* camera, ShaderProgramEx* programEx){
+	// update lights and camera
+	updateSceneUniformBuffers(scene, camera);
+	
+	if(!buildSceneInstances(scene, camera)) return;
+	
+	sortSceneInstanceGroups(*scene->instanceGroups, RENDER_MULTI_DRAW);
+	
+	drawSceneMultiDraw(scene, *scene->instanceGroups, programEx);
+}
+
+// draw instance groups whose instances are already in scene->instanceBuffer, one draw call per bucket
+// expects groups to be sorted into buckets (see sortSceneInstanceGroups)
+void drawSceneMultiDraw(Scene* scene, std::vector<InstanceGroup>& groups, ShaderProgramEx* programEx){
+	// create command buffer on first use
+	if(!scene->drawCommandBuffer){
+		scene->drawCommandBuffer = createStreamBuffer(GL_DRAW_INDIRECT_BUFFER, 64 * sizeof(DrawElementsIndirectCommand));
+		
+		if(!scene->drawCommandBuffer) return;
+	}
+	
+	// write commands, starting a new bucket every time the vao or texture binding changes
+	scene->drawCommands->clear();
+	scene->drawBuckets->clear();
+	
+	uint32_t instancesRendered = 0;
+	
+	for(uint32_t i = 0; i < groups.size(); i++){
+		InstanceGroup& group = groups[i];
+		
+		instancesRendered += group.instanceCount;
+		
+		if(i == 0 || compareInstanceGroupBuckets(groups[i-1], group)){
+			MultiDrawBucket bucket;
 			
-			if(angle < 0) continue;
+			bucket.vertexData = group.vertexData;
+			bucket.texture = group.texture;
+			bucket.firstCommand = scene->drawCommands->size();
+			bucket.commandCount = 0;
 			
-			// set model matrix (necessary for lighting)
-			glUniformMatrix4fv(getProgramExUniformLocation(programEx, "model"), 1, GL_FALSE, glm::value_ptr(object->renderableObject->modelMatrix));
+			scene->drawBuckets->push_back(bucket);
+		}
+		
+		scene->drawCommands->push_back(createDrawElementsIndirectCommand(group.vertexData, group.firstInstance, group.instanceCount));
+		scene->drawBuckets->back().commandCount++;
+	}
+	
+	// upload every command at once
+	GLuint commandBuffer = writeStreamBuffer(scene->drawCommandBuffer, scene->drawCommands->size() * sizeof(DrawElementsIndirectCommand), scene->drawCommands->empty() ? NULL : &scene->drawCommands->at(0));
+	
+	uint32_t renderCalls = 0;
+	
+	// vao currently bound
+	uint32_t boundVao = 0;
+	
+	// draw each bucket
+	for(uint32_t i = 0; i < scene->drawBuckets->size(); i++){
+		MultiDrawBucket& bucket = scene->drawBuckets->at(i);
+		
+		if(bucket.vertexData->vao != boundVao){
+			bindVertexData(bucket.vertexData);
 			
-			// set normal matrix (necessary for lighting)
-			glm::mat3 normalMatrix = glm::mat3(glm::transpose(glm::inverse(object->renderableObject->modelMatrix)));
-			glUniformMatrix3fv(getProgramExUniformLocation(programEx, "normalMatrix"), 1, GL_FALSE, glm::value_ptr(normalMatrix));
+			boundVao = bucket.vertexData->vao;
+			renderStats.vertexArrayBinds++;
+		}
+		
+		ShaderProgramEx* variant = useProgramExObjectTexture(programEx, bucket.texture);
+		
+		renderCalls += multiDrawElementsIndirect(commandBuffer, *scene->drawCommands, bucket, scene->instanceBuffer);
+		
+		resetProgramExUniformTextures(variant);
+	}
+	
+	renderStats.drawCalls += renderCalls;
+	renderStats.objectsRendered += instancesRendered;
+}
+
+// render the static batches of a scene (see buildSceneStaticBatches), one draw call per run of visible clusters
+// uses the same shader as renderScene
+void renderSceneBatched(Scene* scene, PerspectiveCamera* camera, ShaderProgramEx* programEx){
+	// update lights and camera
+	updateSceneUniformBuffers(scene, camera);
+	
+	drawSceneBatched(scene, camera, programEx);
+}
+
+// draw the static batches' clusters that are visible from camera
+// batches never change after they're built, so this is safe to call from the render thread
+void drawSceneBatched(Scene* scene, PerspectiveCamera* camera, ShaderProgramEx* programEx){
+	// batches are already in world space (and lightmap space), so model is identity
+	glm::mat4 model = glm::mat4(1.0f);
+	glm::mat3 normalMatrix = glm::mat3(1.0f);
+	glm::vec4 lightmapRect = glm::vec4(1, 1, 0, 0);
+	
+	uint32_t renderCalls = 0;
+	uint32_t clustersRendered = 0;
+	
+	for(uint32_t i = 0; i < scene->staticBatches->size(); i++){
+		StaticBatch* batch = scene->staticBatches->at(i);
+		
+		// these only get written to each variant once, after that the uniform cache skips them
+		ShaderProgramEx* variant = useProgramExObjectTexture(programEx, batch->texture);
+		
+		setProgramExUniformMat4(variant, UNIFORM_MODEL, model);
+		setProgramExUniformMat3(variant, UNIFORM_NORMAL_MATRIX, normalMatrix);
+		setProgramExUniformVec4(variant, UNIFORM_LIGHTMAP_RECT, lightmapRect);
+		
+		bindVertexData(batch->vertexData);
+		
+		renderStats.vertexArrayBinds++;
+		
+		// visible clusters next to each other in the element buffer get drawn together
+		uint32_t runStart = 0;
+		uint32_t runCount = 0;
+		
+		for(uint32_t j = 0; j <= batch->clusters->size(); j++){
+			bool visible = false;
 			
-			renderTexturedRenderableObjectNoBind(object, camera, programEx);
+			if(j < batch->clusters->size()){
+				StaticBatchCluster& cluster = batch->clusters->at(j);
+				
+				visible = !isSphereCulled(cluster.center, cluster.radius, camera);
+				
+				if(visible){
+					if(runCount == 0) runStart = cluster.firstIndex;
+					
+					runCount += cluster.indexCount;
+					clustersRendered++;
+				}
+			}
 			
-			renderCalls++;
+			// flush run
+			if(!visible && runCount > 0){
+				glDrawElements(GL_TRIANGLES, runCount, GL_UNSIGNED_INT, (void*)(runStart * sizeof(uint32_t)));
+				
+				runCount = 0;
+				renderCalls++;
+			}
 		}
 		
-		// unbind vao
-		glBindVertexArray(0);
+		resetProgramExUniformTextures(variant);
 	}
 	
-	// reset lights
-	resetProgramExPointLights(programEx);
-	
-	//printf("render calls: %d\n", renderCalls);
+	renderStats.drawCalls += renderCalls;
+	renderStats.objectsRendered += clustersRendered;
+}
+
+// bind the right program for a render mode and render the scene with it
+// program is used for per-object and batched rendering, instancedProgram for instanced and multi-draw rendering
+void renderSceneMode(Scene* scene, PerspectiveCamera* camera, SceneRenderMode mode, ShaderProgramEx* program, ShaderProgramEx* instancedProgram){
+	switch(mode){
+		case RENDER_PER_OBJECT: {
+			useProgramEx(program);
+			
+			renderScene(scene, camera, program);
+			
+			break;
+		}
+		case RENDER_INSTANCED: {
+			useProgramEx(instancedProgram);
+			
+			renderSceneInstanced(scene, camera, instancedProgram);
+			
+			break;
+		}
+		case RENDER_MULTI_DRAW: {
+			useProgramEx(instancedProgram);
+			
+			renderSceneMultiDraw(scene, camera, instancedProgram);
+			
+			break;
+		}
+		case RENDER_BATCHED: {
+			useProgramEx(program);
+			
+			renderSceneBatched(scene, camera, program);
+			
+			break;
+		}
+	}
 }
\ No newline at end of file
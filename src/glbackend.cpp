@@ -0,0 +1,666 @@
+// swappable gl backends
+// glad calls every gl method through a function pointer (glad_glDrawArrays and so on), so a backend is just a table of pointers written over glad's
+
+#include <glbackend.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <map>
+#include <set>
+#include <sstream>
+
+// extension methods the engine loads by hand when the driver has them (see initStreamBuffers, initMultiDraw and initProgramCache)
+typedef void (APIENTRYP PFNGLMULTIDRAWELEMENTSINDIRECTPROC)(GLenum mode, GLenum type, const void* indirect, GLsizei drawcount, GLsizei stride);
+typedef void (APIENTRYP PFNGLBUFFERSTORAGEPROC)(GLenum target, GLsizeiptr size, const void* data, GLbitfield flags);
+typedef void (APIENTRYP PFNGLGETPROGRAMBINARYPROC)(GLuint program, GLsizei bufSize, GLsizei* length, GLenum* binaryFormat, void* binary);
+typedef void (APIENTRYP PFNGLPROGRAMBINARYPROC)(GLuint program, GLenum binaryFormat, const void* binary, GLsizei length);
+typedef void (APIENTRYP PFNGLPROGRAMPARAMETERIPROC)(GLuint program, GLenum pname, GLint value);
+
+// every gl method the engine calls through glad
+// one that isn't in here always goes to the driver, so calling it without a context crashes
+#define GL_BACKEND_FUNCTIONS \
+	GL_BACKEND_FUNCTION(glActiveTexture) \
+	GL_BACKEND_FUNCTION(glAttachShader) \
+	GL_BACKEND_FUNCTION(glBeginQuery) \
+	GL_BACKEND_FUNCTION(glBindBuffer) \
+	GL_BACKEND_FUNCTION(glBindBufferBase) \
+	GL_BACKEND_FUNCTION(glBindFramebuffer) \
+	GL_BACKEND_FUNCTION(glBindRenderbuffer) \
+	GL_BACKEND_FUNCTION(glBindTexture) \
+	GL_BACKEND_FUNCTION(glBindVertexArray) \
+	GL_BACKEND_FUNCTION(glBlendFunc) \
+	GL_BACKEND_FUNCTION(glBlitFramebuffer) \
+	GL_BACKEND_FUNCTION(glBufferData) \
+	GL_BACKEND_FUNCTION(glBufferSubData) \
+	GL_BACKEND_FUNCTION(glCheckFramebufferStatus) \
+	GL_BACKEND_FUNCTION(glClear) \
+	GL_BACKEND_FUNCTION(glClearColor) \
+	GL_BACKEND_FUNCTION(glClientWaitSync) \
+	GL_BACKEND_FUNCTION(glColorMask) \
+	GL_BACKEND_FUNCTION(glCompileShader) \
+	GL_BACKEND_FUNCTION(glCreateProgram) \
+	GL_BACKEND_FUNCTION(glCreateShader) \
+	GL_BACKEND_FUNCTION(glCullFace) \
+	GL_BACKEND_FUNCTION(glDeleteBuffers) \
+	GL_BACKEND_FUNCTION(glDeleteFramebuffers) \
+	GL_BACKEND_FUNCTION(glDeleteProgram) \
+	GL_BACKEND_FUNCTION(glDeleteRenderbuffers) \
+	GL_BACKEND_FUNCTION(glDeleteShader) \
+	GL_BACKEND_FUNCTION(glDeleteSync) \
+	GL_BACKEND_FUNCTION(glDeleteTextures) \
+	GL_BACKEND_FUNCTION(glDeleteVertexArrays) \
+	GL_BACKEND_FUNCTION(glDepthFunc) \
+	GL_BACKEND_FUNCTION(glDepthMask) \
+	GL_BACKEND_FUNCTION(glDisable) \
+	GL_BACKEND_FUNCTION(glDrawArrays) \
+	GL_BACKEND_FUNCTION(glDrawArraysInstanced) \
+	GL_BACKEND_FUNCTION(glDrawBuffers) \
+	GL_BACKEND_FUNCTION(glDrawElements) \
+	GL_BACKEND_FUNCTION(glDrawElementsBaseVertex) \
+	GL_BACKEND_FUNCTION(glDrawElementsInstancedBaseVertex) \
+	GL_BACKEND_FUNCTION(glEnable) \
+	GL_BACKEND_FUNCTION(glEnableVertexAttribArray) \
+	GL_BACKEND_FUNCTION(glEndQuery) \
+	GL_BACKEND_FUNCTION(glFenceSync) \
+	GL_BACKEND_FUNCTION(glFinish) \
+	GL_BACKEND_FUNCTION(glFramebufferRenderbuffer) \
+	GL_BACKEND_FUNCTION(glFramebufferTexture2D) \
+	GL_BACKEND_FUNCTION(glGenBuffers) \
+	GL_BACKEND_FUNCTION(glGenFramebuffers) \
+	GL_BACKEND_FUNCTION(glGenQueries) \
+	GL_BACKEND_FUNCTION(glGenRenderbuffers) \
+	GL_BACKEND_FUNCTION(glGenTextures) \
+	GL_BACKEND_FUNCTION(glGenVertexArrays) \
+	GL_BACKEND_FUNCTION(glGenerateMipmap) \
+	GL_BACKEND_FUNCTION(glGetActiveUniformName) \
+	GL_BACKEND_FUNCTION(glGetIntegerv) \
+	GL_BACKEND_FUNCTION(glGetProgramInfoLog) \
+	GL_BACKEND_FUNCTION(glGetProgramiv) \
+	GL_BACKEND_FUNCTION(glGetQueryObjectui64v) \
+	GL_BACKEND_FUNCTION(glGetQueryObjectuiv) \
+	GL_BACKEND_FUNCTION(glGetShaderInfoLog) \
+	GL_BACKEND_FUNCTION(glGetShaderiv) \
+	GL_BACKEND_FUNCTION(glGetString) \
+	GL_BACKEND_FUNCTION(glGetStringi) \
+	GL_BACKEND_FUNCTION(glGetTexImage) \
+	GL_BACKEND_FUNCTION(glGetUniformBlockIndex) \
+	GL_BACKEND_FUNCTION(glGetUniformLocation) \
+	GL_BACKEND_FUNCTION(glLinkProgram) \
+	GL_BACKEND_FUNCTION(glMapBufferRange) \
+	GL_BACKEND_FUNCTION(glPixelStorei) \
+	GL_BACKEND_FUNCTION(glRenderbufferStorage) \
+	GL_BACKEND_FUNCTION(glShaderSource) \
+	GL_BACKEND_FUNCTION(glTexBuffer) \
+	GL_BACKEND_FUNCTION(glTexImage2D) \
+	GL_BACKEND_FUNCTION(glTexImage3D) \
+	GL_BACKEND_FUNCTION(glTexParameteri) \
+	GL_BACKEND_FUNCTION(glTexSubImage2D) \
+	GL_BACKEND_FUNCTION(glTexSubImage3D) \
+	GL_BACKEND_FUNCTION(glUniform1f) \
+	GL_BACKEND_FUNCTION(glUniform1i) \
+	GL_BACKEND_FUNCTION(glUniform2f) \
+	GL_BACKEND_FUNCTION(glUniform3fv) \
+	GL_BACKEND_FUNCTION(glUniform4fv) \
+	GL_BACKEND_FUNCTION(glUniformBlockBinding) \
+	GL_BACKEND_FUNCTION(glUniformMatrix3fv) \
+	GL_BACKEND_FUNCTION(glUniformMatrix4fv) \
+	GL_BACKEND_FUNCTION(glUnmapBuffer) \
+	GL_BACKEND_FUNCTION(glUseProgram) \
+	GL_BACKEND_FUNCTION(glVertexAttribDivisor) \
+	GL_BACKEND_FUNCTION(glVertexAttribI1ui) \
+	GL_BACKEND_FUNCTION(glVertexAttribIPointer) \
+	GL_BACKEND_FUNCTION(glVertexAttribPointer) \
+	GL_BACKEND_FUNCTION(glViewport)
+
+// extension methods, handed to the engine through loadGlBackendProc instead of glad
+#define GL_BACKEND_EXTENSION_FUNCTIONS \
+	GL_BACKEND_EXTENSION_FUNCTION(glMultiDrawElementsIndirect, PFNGLMULTIDRAWELEMENTSINDIRECTPROC) \
+	GL_BACKEND_EXTENSION_FUNCTION(glBufferStorage, PFNGLBUFFERSTORAGEPROC) \
+	GL_BACKEND_EXTENSION_FUNCTION(glGetProgramBinary, PFNGLGETPROGRAMBINARYPROC) \
+	GL_BACKEND_EXTENSION_FUNCTION(glProgramBinary, PFNGLPROGRAMBINARYPROC) \
+	GL_BACKEND_EXTENSION_FUNCTION(glProgramParameteri, PFNGLPROGRAMPARAMETERIPROC)
+
+// index of every method in the tables
+enum {
+	#define GL_BACKEND_FUNCTION(name) GL_FUNCTION_##name,
+	#define GL_BACKEND_EXTENSION_FUNCTION(name, type) GL_FUNCTION_##name,
+	GL_BACKEND_FUNCTIONS
+	GL_BACKEND_EXTENSION_FUNCTIONS
+	#undef GL_BACKEND_FUNCTION
+	#undef GL_BACKEND_EXTENSION_FUNCTION
+	
+	GL_FUNCTION_COUNT
+};
+
+const char* g_glFunctionNames[GL_FUNCTION_COUNT] = {
+	#define GL_BACKEND_FUNCTION(name) #name,
+	#define GL_BACKEND_EXTENSION_FUNCTION(name, type) #name,
+	GL_BACKEND_FUNCTIONS
+	GL_BACKEND_EXTENSION_FUNCTIONS
+	#undef GL_BACKEND_FUNCTION
+	#undef GL_BACKEND_EXTENSION_FUNCTION
+};
+
+// any gl method, cast back to its own type before it's called
+typedef void (APIENTRYP GlProc)();
+
+// each backend's methods
+GlProc g_glRealFunctions[GL_FUNCTION_COUNT] = {NULL}; // what the driver loaded, NULL without a context (or if it doesn't have an extension)
+GlProc g_glNullFunctions[GL_FUNCTION_COUNT] = {NULL};
+GlProc g_glRecordingFunctions[GL_FUNCTION_COUNT] = {NULL};
+
+GlBackend g_glBackend = GL_BACKEND_REAL;
+bool g_glBackendInitialized = false;
+
+// the loader initGlBackend was given, NULL without a context
+GLADloadproc g_glBackendLoad = NULL;
+
+// recording backend //
+
+// calls are recorded from whichever thread the engine makes gl calls on, and read back once it's done
+GlRecording glRecording = {new std::vector<GlRecordedCall>(), new std::vector<uint64_t>(GL_FUNCTION_COUNT, 0), 0, false};
+
+template<typename T> void appendGlArgument(std::ostringstream& stream, T argument){
+	stream << argument;
+}
+
+// pointers (buffers, arrays, out parameters) as addresses
+template<typename T> void appendGlArgument(std::ostringstream& stream, T* argument){
+	stream << (const void*)argument;
+}
+
+// strings passed in (uniform and block names) as themselves
+void appendGlArgument(std::ostringstream& stream, const GLchar* argument){
+	if(argument){
+		stream << '"' << argument << '"';
+	} else {
+		stream << "NULL";
+	}
+}
+
+// GLboolean is an unsigned char, keep it from printing as a character
+void appendGlArgument(std::ostringstream& stream, GLboolean argument){
+	stream << (uint32_t)argument;
+}
+
+template<typename... Arguments> void recordGlCall(uint32_t function, Arguments... arguments){
+	glRecording.counts->at(function)++;
+	glRecording.totalCalls++;
+	
+	if(!glRecording.log) return;
+	
+	std::ostringstream stream;
+	uint32_t index = 0;
+	
+	// expands to one append per argument, in order
+	int expand[] = {0, (stream << (index++ ? ", " : ""), appendGlArgument(stream, arguments), 0)...};
+	(void)expand;
+	
+	GlRecordedCall call;
+	
+	call.function = function;
+	call.arguments = stream.str();
+	
+	glRecording.calls->push_back(call);
+}
+
+// what each backend does for a method of type Proc, for the ones that don't need anything more specific
+template<uint32_t function, typename Proc> struct GlBackendFunction;
+
+template<uint32_t function, typename R, typename... Arguments> struct GlBackendFunction<function, R (APIENTRYP)(Arguments...)> {
+	typedef R (APIENTRYP Proc)(Arguments...);
+	
+	// null backend, does nothing and returns 0
+	static R APIENTRY discard(Arguments...){
+		return R();
+	}
+	
+	// recording backend, counted/logged and passed to the driver, or the null backend without one
+	static R APIENTRY record(Arguments... arguments){
+		recordGlCall(function, arguments...);
+		
+		return ((Proc)(g_glRealFunctions[function] ? g_glRealFunctions[function] : g_glNullFunctions[function]))(arguments...);
+	}
+	
+	// extension methods are only loaded once, so instead of being swapped they check the backend on every call
+	static R APIENTRY dispatch(Arguments... arguments){
+		if(g_glBackend == GL_BACKEND_RECORDING) return record(arguments...);
+		
+		return ((Proc)(g_glBackend == GL_BACKEND_NULL ? g_glNullFunctions[function] : g_glRealFunctions[function]))(arguments...);
+	}
+};
+
+// null backend //
+// enough of gl's behaviour for the engine to load and draw: objects get names, shaders compile, framebuffers are complete,
+// programs have the uniforms their shaders declare, fences are signalled straight away and mapped buffers point at memory that's thrown away
+
+// object names handed out, shared between every kind of object
+GLuint g_nullNextName = 1;
+
+// buffer bound to each target and the memory standing in for each mapped buffer
+std::map<GLenum, GLuint>* g_nullBoundBuffers = new std::map<GLenum, GLuint>();
+std::map<GLuint, std::vector<uint8_t>*>* g_nullBufferMemory = new std::map<GLuint, std::vector<uint8_t>*>();
+
+GLint g_nullViewport[4] = {0, 0, 0, 0};
+
+// uniforms and uniform blocks declared by the shaders attached to each program, found by scanning their sources
+// there's no compiler to optimize unused ones out, so everything declared is active (even in #ifdef'd out code)
+struct NullProgram {
+	std::set<std::string> uniforms;
+	std::vector<std::string> blocks; // index = block index
+	
+	std::map<std::string, GLint> locations; // handed out the first time each name is looked up
+};
+
+std::map<GLuint, std::string>* g_nullShaderSources = new std::map<GLuint, std::string>();
+std::map<GLuint, NullProgram>* g_nullPrograms = new std::map<GLuint, NullProgram>();
+
+void APIENTRY nullGenNames(GLsizei n, GLuint* names){
+	for(GLsizei i = 0; i < n; i++) names[i] = g_nullNextName++;
+}
+
+GLuint APIENTRY nullCreateProgram(){
+	return g_nullNextName++;
+}
+
+GLuint APIENTRY nullCreateShader(GLenum type){
+	return g_nullNextName++;
+}
+
+void APIENTRY nullShaderSource(GLuint shader, GLsizei count, const GLchar* const* string, const GLint* length){
+	std::string& source = (*g_nullShaderSources)[shader];
+	
+	source.clear();
+	
+	for(GLsizei i = 0; i < count; i++){
+		if(length && length[i] >= 0){
+			source.append(string[i], length[i]);
+		} else {
+			source.append(string[i]);
+		}
+	}
+}
+
+// add the uniforms and blocks a shader declares to the program
+// declarations are one per line: "uniform type name;" for uniforms, "uniform Name {" (or just "uniform Name") for blocks
+void APIENTRY nullAttachShader(GLuint program, GLuint shader){
+	NullProgram& nullProgram = (*g_nullPrograms)[program];
+	
+	std::istringstream source((*g_nullShaderSources)[shader]);
+	std::string line;
+	
+	while(std::getline(source, line)){
+		line = line.substr(0, line.find("//"));
+		
+		std::istringstream words(line);
+		std::string word;
+		
+		while(words >> word && word != "uniform");
+		
+		if(word != "uniform") continue;
+		
+		std::string first;
+		std::string second;
+		
+		words >> first >> second;
+		
+		if(second.empty() || second[0] == '{'){
+			first = first.substr(0, first.find('{'));
+			
+			if(std::find(nullProgram.blocks.begin(), nullProgram.blocks.end(), first) == nullProgram.blocks.end()) nullProgram.blocks.push_back(first);
+		} else {
+			nullProgram.uniforms.insert(second.substr(0, second.find_first_of("[;")));
+		}
+	}
+}
+
+void APIENTRY nullDeleteShader(GLuint shader){
+	g_nullShaderSources->erase(shader);
+}
+
+void APIENTRY nullDeleteProgram(GLuint program){
+	g_nullPrograms->erase(program);
+}
+
+// glGetShaderiv/glGetProgramiv, everything compiles and links, with no log and no active uniforms
+void APIENTRY nullGetObjectiv(GLuint object, GLenum pname, GLint* params){
+	*params = (pname == GL_COMPILE_STATUS || pname == GL_LINK_STATUS) ? GL_TRUE : 0;
+}
+
+void APIENTRY nullGetInfoLog(GLuint object, GLsizei bufSize, GLsizei* length, GLchar* infoLog){
+	if(length) *length = 0;
+	if(infoLog && bufSize > 0) infoLog[0] = '\0';
+}
+
+// limits are the minimums gl 3.3 guarantees, so anything sized from them works on a real context too
+void APIENTRY nullGetIntegerv(GLenum pname, GLint* data){
+	switch(pname){
+		case GL_VIEWPORT:
+			memcpy(data, g_nullViewport, sizeof(g_nullViewport));
+			return;
+		case GL_MAX_COMBINED_TEXTURE_IMAGE_UNITS:
+			*data = 48;
+			return;
+		case GL_MAX_TEXTURE_SIZE:
+			*data = 1024;
+			return;
+		case GL_MAX_ARRAY_TEXTURE_LAYERS:
+			*data = 256;
+			return;
+		case GL_MAX_UNIFORM_BLOCK_SIZE:
+			*data = 16384;
+			return;
+		case GL_MAX_TEXTURE_BUFFER_SIZE:
+			*data = 65536;
+			return;
+		case GL_DEPTH_FUNC:
+			*data = GL_LESS;
+			return;
+		case GL_DEPTH_WRITEMASK:
+			*data = GL_TRUE;
+			return;
+		case GL_PACK_ALIGNMENT:
+		case GL_UNPACK_ALIGNMENT:
+			*data = 4;
+			return;
+	}
+	
+	// no extensions, nothing bound
+	*data = 0;
+}
+
+const GLubyte* APIENTRY nullGetString(GLenum name){
+	return (const GLubyte*)"null";
+}
+
+// uniforms the program's shaders don't declare get -1 and blocks they don't declare GL_INVALID_INDEX, like ones the compiler optimized out
+// elements and fields of declared arrays and structs (pointLights[0].position) get locations of their own
+GLint APIENTRY nullGetUniformLocation(GLuint program, const GLchar* name){
+	std::map<GLuint, NullProgram>::iterator it = g_nullPrograms->find(program);
+	
+	if(it == g_nullPrograms->end()) return -1;
+	
+	std::string fullName = std::string(name);
+	
+	if(!it->second.uniforms.count(fullName.substr(0, fullName.find_first_of("[.")))) return -1;
+	
+	std::map<std::string, GLint>& locations = it->second.locations;
+	std::map<std::string, GLint>::iterator location = locations.find(fullName);
+	
+	if(location != locations.end()) return location->second;
+	
+	GLint newLocation = locations.size();
+	
+	locations[fullName] = newLocation;
+	
+	return newLocation;
+}
+
+GLuint APIENTRY nullGetUniformBlockIndex(GLuint program, const GLchar* uniformBlockName){
+	std::map<GLuint, NullProgram>::iterator it = g_nullPrograms->find(program);
+	
+	if(it == g_nullPrograms->end()) return GL_INVALID_INDEX;
+	
+	std::vector<std::string>& blocks = it->second.blocks;
+	std::vector<std::string>::iterator block = std::find(blocks.begin(), blocks.end(), std::string(uniformBlockName));
+	
+	return block == blocks.end() ? GL_INVALID_INDEX : block - blocks.begin();
+}
+
+GLenum APIENTRY nullCheckFramebufferStatus(GLenum target){
+	return GL_FRAMEBUFFER_COMPLETE;
+}
+
+GLsync APIENTRY nullFenceSync(GLenum condition, GLbitfield flags){
+	return (GLsync)(uintptr_t)g_nullNextName++;
+}
+
+GLenum APIENTRY nullClientWaitSync(GLsync sync, GLbitfield flags, GLuint64 timeout){
+	return GL_ALREADY_SIGNALED;
+}
+
+// query results are always available, and 0
+void APIENTRY nullGetQueryObjectuiv(GLuint id, GLenum pname, GLuint* params){
+	*params = pname == GL_QUERY_RESULT_AVAILABLE ? GL_TRUE : 0;
+}
+
+void APIENTRY nullGetQueryObjectui64v(GLuint id, GLenum pname, GLuint64* params){
+	*params = pname == GL_QUERY_RESULT_AVAILABLE ? GL_TRUE : 0;
+}
+
+void APIENTRY nullBindBuffer(GLenum target, GLuint buffer){
+	(*g_nullBoundBuffers)[target] = buffer;
+}
+
+void APIENTRY nullBindBufferBase(GLenum target, GLuint index, GLuint buffer){
+	(*g_nullBoundBuffers)[target] = buffer;
+}
+
+void APIENTRY nullDeleteBuffers(GLsizei n, const GLuint* buffers){
+	for(GLsizei i = 0; i < n; i++){
+		std::map<GLuint, std::vector<uint8_t>*>::iterator it = g_nullBufferMemory->find(buffers[i]);
+		
+		if(it == g_nullBufferMemory->end()) continue;
+		
+		delete it->second;
+		g_nullBufferMemory->erase(it);
+	}
+}
+
+// the bound buffer gets memory the size of the furthest range mapped, kept until it's deleted
+void* APIENTRY nullMapBufferRange(GLenum target, GLintptr offset, GLsizeiptr length, GLbitfield access){
+	std::vector<uint8_t>*& memory = (*g_nullBufferMemory)[(*g_nullBoundBuffers)[target]];
+	
+	if(!memory) memory = new std::vector<uint8_t>();
+	if(memory->size() < (size_t)(offset + length)) memory->resize(offset + length);
+	
+	return memory->size() ? &memory->at(offset) : NULL;
+}
+
+GLboolean APIENTRY nullUnmapBuffer(GLenum target){
+	return GL_TRUE;
+}
+
+void APIENTRY nullViewport(GLint x, GLint y, GLsizei width, GLsizei height){
+	g_nullViewport[0] = x;
+	g_nullViewport[1] = y;
+	g_nullViewport[2] = width;
+	g_nullViewport[3] = height;
+}
+
+// backends //
+
+// fill in the null and recording tables
+void createGlBackendTables(){
+	#define GL_BACKEND_FUNCTION(name) \
+		g_glNullFunctions[GL_FUNCTION_##name] = (GlProc)GlBackendFunction<GL_FUNCTION_##name, decltype(glad_##name)>::discard; \
+		g_glRecordingFunctions[GL_FUNCTION_##name] = (GlProc)GlBackendFunction<GL_FUNCTION_##name, decltype(glad_##name)>::record;
+	#define GL_BACKEND_EXTENSION_FUNCTION(name, type) \
+		g_glNullFunctions[GL_FUNCTION_##name] = (GlProc)GlBackendFunction<GL_FUNCTION_##name, type>::discard; \
+		g_glRecordingFunctions[GL_FUNCTION_##name] = (GlProc)GlBackendFunction<GL_FUNCTION_##name, type>::record;
+	GL_BACKEND_FUNCTIONS
+	GL_BACKEND_EXTENSION_FUNCTIONS
+	#undef GL_BACKEND_FUNCTION
+	#undef GL_BACKEND_EXTENSION_FUNCTION
+	
+	// methods whose results the engine depends on
+	g_glNullFunctions[GL_FUNCTION_glGenBuffers] = (GlProc)nullGenNames;
+	g_glNullFunctions[GL_FUNCTION_glGenTextures] = (GlProc)nullGenNames;
+	g_glNullFunctions[GL_FUNCTION_glGenVertexArrays] = (GlProc)nullGenNames;
+	g_glNullFunctions[GL_FUNCTION_glGenFramebuffers] = (GlProc)nullGenNames;
+	g_glNullFunctions[GL_FUNCTION_glGenRenderbuffers] = (GlProc)nullGenNames;
+	g_glNullFunctions[GL_FUNCTION_glGenQueries] = (GlProc)nullGenNames;
+	g_glNullFunctions[GL_FUNCTION_glCreateProgram] = (GlProc)nullCreateProgram;
+	g_glNullFunctions[GL_FUNCTION_glCreateShader] = (GlProc)nullCreateShader;
+	g_glNullFunctions[GL_FUNCTION_glShaderSource] = (GlProc)nullShaderSource;
+	g_glNullFunctions[GL_FUNCTION_glAttachShader] = (GlProc)nullAttachShader;
+	g_glNullFunctions[GL_FUNCTION_glDeleteShader] = (GlProc)nullDeleteShader;
+	g_glNullFunctions[GL_FUNCTION_glDeleteProgram] = (GlProc)nullDeleteProgram;
+	g_glNullFunctions[GL_FUNCTION_glGetShaderiv] = (GlProc)nullGetObjectiv;
+	g_glNullFunctions[GL_FUNCTION_glGetProgramiv] = (GlProc)nullGetObjectiv;
+	g_glNullFunctions[GL_FUNCTION_glGetShaderInfoLog] = (GlProc)nullGetInfoLog;
+	g_glNullFunctions[GL_FUNCTION_glGetProgramInfoLog] = (GlProc)nullGetInfoLog;
+	g_glNullFunctions[GL_FUNCTION_glGetIntegerv] = (GlProc)nullGetIntegerv;
+	g_glNullFunctions[GL_FUNCTION_glGetString] = (GlProc)nullGetString;
+	g_glNullFunctions[GL_FUNCTION_glGetUniformLocation] = (GlProc)nullGetUniformLocation;
+	g_glNullFunctions[GL_FUNCTION_glGetUniformBlockIndex] = (GlProc)nullGetUniformBlockIndex;
+	g_glNullFunctions[GL_FUNCTION_glCheckFramebufferStatus] = (GlProc)nullCheckFramebufferStatus;
+	g_glNullFunctions[GL_FUNCTION_glFenceSync] = (GlProc)nullFenceSync;
+	g_glNullFunctions[GL_FUNCTION_glClientWaitSync] = (GlProc)nullClientWaitSync;
+	g_glNullFunctions[GL_FUNCTION_glGetQueryObjectuiv] = (GlProc)nullGetQueryObjectuiv;
+	g_glNullFunctions[GL_FUNCTION_glGetQueryObjectui64v] = (GlProc)nullGetQueryObjectui64v;
+	g_glNullFunctions[GL_FUNCTION_glBindBuffer] = (GlProc)nullBindBuffer;
+	g_glNullFunctions[GL_FUNCTION_glBindBufferBase] = (GlProc)nullBindBufferBase;
+	g_glNullFunctions[GL_FUNCTION_glDeleteBuffers] = (GlProc)nullDeleteBuffers;
+	g_glNullFunctions[GL_FUNCTION_glMapBufferRange] = (GlProc)nullMapBufferRange;
+	g_glNullFunctions[GL_FUNCTION_glUnmapBuffer] = (GlProc)nullUnmapBuffer;
+	g_glNullFunctions[GL_FUNCTION_glViewport] = (GlProc)nullViewport;
+}
+
+// write the current backend's methods over glad's
+void installGlBackend(){
+	GlProc* functions = g_glRealFunctions;
+	
+	switch(g_glBackend){
+		case GL_BACKEND_REAL:
+			functions = g_glRealFunctions;
+			break;
+		case GL_BACKEND_NULL:
+			functions = g_glNullFunctions;
+			break;
+		case GL_BACKEND_RECORDING:
+			functions = g_glRecordingFunctions;
+			break;
+	}
+	
+	#define GL_BACKEND_FUNCTION(name) glad_##name = (decltype(glad_##name))functions[GL_FUNCTION_##name];
+	GL_BACKEND_FUNCTIONS
+	#undef GL_BACKEND_FUNCTION
+}
+
+// set up the backends and switch to the one picked with setGlBackend
+// load is the loader glad was loaded with, called right after gladLoadGL, or NULL without a context (glad's methods don't have to be loaded then)
+// without a context the real backend isn't available, so it falls back to the null backend
+void initGlBackend(GLADloadproc load){
+	createGlBackendTables();
+	
+	g_glBackendLoad = load;
+	
+	#define GL_BACKEND_FUNCTION(name) g_glRealFunctions[GL_FUNCTION_##name] = load ? (GlProc)glad_##name : NULL;
+	GL_BACKEND_FUNCTIONS
+	#undef GL_BACKEND_FUNCTION
+	
+	if(!load && g_glBackend == GL_BACKEND_REAL) g_glBackend = GL_BACKEND_NULL;
+	
+	g_glBackendInitialized = true;
+	
+	installGlBackend();
+}
+
+// loader to give the methods that load extensions by hand, goes through the backend for the extensions in GL_BACKEND_EXTENSION_FUNCTIONS
+// extensions are found with whatever backend is current when they're looked for (the null backend has none), and stay loaded after switching
+void* loadGlBackendProc(const char* name){
+	#define GL_BACKEND_EXTENSION_FUNCTION(function, type) \
+		if(strcmp(name, #function) == 0){ \
+			g_glRealFunctions[GL_FUNCTION_##function] = g_glBackendLoad ? (GlProc)g_glBackendLoad(name) : NULL; \
+			\
+			return g_glRealFunctions[GL_FUNCTION_##function] ? (void*)GlBackendFunction<GL_FUNCTION_##function, type>::dispatch : NULL; \
+		}
+	GL_BACKEND_EXTENSION_FUNCTIONS
+	#undef GL_BACKEND_EXTENSION_FUNCTION
+	
+	return g_glBackendLoad ? g_glBackendLoad(name) : NULL;
+}
+
+// pick where gl calls go, can be switched at any time from the thread that makes the engine's gl calls
+// returns false (and leaves the backend as it is) if the real backend is picked without a context
+bool setGlBackend(GlBackend backend){
+	if(g_glBackendInitialized && backend == GL_BACKEND_REAL && !hasRealGl()) return false;
+	
+	g_glBackend = backend;
+	
+	if(g_glBackendInitialized) installGlBackend();
+	
+	return true;
+}
+
+GlBackend getGlBackend(){
+	return g_glBackend;
+}
+
+// if the driver's methods are loaded
+bool hasRealGl(){
+	return g_glRealFunctions[GL_FUNCTION_glClear] != NULL;
+}
+
+// the methods calls are counted for, by index
+uint32_t getGlFunctionCount(){
+	return GL_FUNCTION_COUNT;
+}
+
+const char* getGlFunctionName(uint32_t function){
+	return function < GL_FUNCTION_COUNT ? g_glFunctionNames[function] : NULL;
+}
+
+// get what the recording backend saw since the last clear
+GlRecording* getGlRecording(){
+	return &glRecording;
+}
+
+void clearGlRecording(){
+	glRecording.calls->clear();
+	glRecording.counts->assign(GL_FUNCTION_COUNT, 0);
+	glRecording.totalCalls = 0;
+}
+
+// keep every call with its arguments as well as counting them, off by default since formatting the arguments costs far more than the calls
+void setGlRecordingLog(bool enabled){
+	glRecording.log = enabled;
+}
+
+// calls recorded of the method called name (glDrawArrays etc.), 0 if it isn't one the backends know
+uint64_t getGlCallCount(const char* name){
+	for(uint32_t i = 0; i < GL_FUNCTION_COUNT; i++){
+		if(strcmp(g_glFunctionNames[i], name) == 0) return glRecording.counts->at(i);
+	}
+	
+	return 0;
+}
+
+// print every call logged since the last clear, in order (see setGlRecordingLog)
+void printGlRecordingLog(){
+	for(uint32_t i = 0; i < glRecording.calls->size(); i++){
+		GlRecordedCall& call = glRecording.calls->at(i);
+		
+		printf("%s(%s)\n", g_glFunctionNames[call.function], call.arguments.c_str());
+	}
+}
+
+// used to sort methods by how many times they were called, most first
+bool compareGlCallCounts(uint32_t a, uint32_t b){
+	return glRecording.counts->at(a) > glRecording.counts->at(b);
+}
+
+// print how many times each method was called, and per frame if frames isn't 0
+void printGlCallCounts(uint32_t frames){
+	std::vector<uint32_t> functions;
+	
+	for(uint32_t i = 0; i < GL_FUNCTION_COUNT; i++){
+		if(glRecording.counts->at(i) > 0) functions.push_back(i);
+	}
+	
+	std::stable_sort(functions.begin(), functions.end(), compareGlCallCounts);
+	
+	printf("gl calls: %llu", (unsigned long long)glRecording.totalCalls);
+	if(frames > 0) printf(" (%.1f per frame over %u frames)", glRecording.totalCalls / (double)frames, frames);
+	printf("\n");
+	
+	for(uint32_t i = 0; i < functions.size(); i++){
+		uint64_t count = glRecording.counts->at(functions[i]);
+		
+		printf("  %-36s %10llu", g_glFunctionNames[functions[i]], (unsigned long long)count);
+		if(frames > 0) printf(" %12.1f per frame", count / (double)frames);
+		printf("\n");
+	}
+}
\ No newline at end of file
@@ -0,0 +1,137 @@
+// gl state cache
+
+#include <glstate.h>
+
+// texture targets whose bindings are tracked, binds to any other target always go through
+#define GL_STATE_TEXTURE_TARGETS 3
+
+// if calls that wouldn't change anything are skipped (see setGlStateCaching)
+bool g_glStateCaching = true;
+
+// state cache activity
+GlStateStats glStateStats = {{0, 0}, {0, 0}, {0, 0}, {0, 0}, {0, 0}};
+
+// what's currently bound, every bind in the engine goes through here so these always match the context
+// the context starts out with nothing bound and texture unit 0 active
+GLuint g_boundProgram = 0;
+GLuint g_boundVertexArray = 0;
+GLuint g_activeTextureUnit = 0;
+GLuint g_boundTextures[GL_STATE_TEXTURE_UNITS][GL_STATE_TEXTURE_TARGETS] = {{0}};
+
+// skip gl calls that set state to what it already is
+// bindings are still tracked while this is off, so it can be turned back on at any time
+void setGlStateCaching(bool enabled){
+	g_glStateCaching = enabled;
+}
+
+bool isGlStateCachingEnabled(){
+	return g_glStateCaching;
+}
+
+// get the state cache activity since the last reset
+GlStateStats* getGlStateStats(){
+	return &glStateStats;
+}
+
+void resetGlStateStats(){
+	glStateStats.programs = (GlStateCounter){0, 0};
+	glStateStats.vertexArrays = (GlStateCounter){0, 0};
+	glStateStats.textureUnits = (GlStateCounter){0, 0};
+	glStateStats.textures = (GlStateCounter){0, 0};
+	glStateStats.uniforms = (GlStateCounter){0, 0};
+}
+
+// record a call that was either issued or skipped
+void countGlStateCall(GlStateCounter* counter, bool issued){
+	if(issued){
+		counter->issued++;
+	} else {
+		counter->elided++;
+	}
+}
+
+// get the index of a tracked texture target, -1 if it isn't tracked
+int32_t getGlStateTextureTarget(GLenum target){
+	switch(target){
+		case GL_TEXTURE_2D: return 0;
+		case GL_TEXTURE_2D_ARRAY: return 1;
+		case GL_TEXTURE_BUFFER: return 2;
+		default: return -1;
+	}
+}
+
+// glUseProgram, unless program is already in use
+void useGlProgram(GLuint program){
+	bool issue = !g_glStateCaching || program != g_boundProgram;
+	
+	if(issue) glUseProgram(program);
+	
+	g_boundProgram = program;
+	
+	countGlStateCall(&glStateStats.programs, issue);
+}
+
+// glBindVertexArray, unless vao is already bound
+// since the bound vao is always known, vaos can be left bound after drawing instead of unbinding them for neatness
+void bindGlVertexArray(GLuint vao){
+	bool issue = !g_glStateCaching || vao != g_boundVertexArray;
+	
+	if(issue) glBindVertexArray(vao);
+	
+	g_boundVertexArray = vao;
+	
+	countGlStateCall(&glStateStats.vertexArrays, issue);
+}
+
+// glDeleteProgram, deleting the program in use forgets it so a new program that gets its name is still used
+void deleteGlProgram(GLuint program){
+	glDeleteProgram(program);
+	
+	if(program == g_boundProgram) g_boundProgram = 0;
+}
+
+// glDeleteVertexArrays, deleting the bound vao binds 0 in its place
+void deleteGlVertexArray(GLuint vao){
+	glDeleteVertexArrays(1, &vao);
+	
+	if(vao == g_boundVertexArray) g_boundVertexArray = 0;
+}
+
+// glDeleteTextures, deleting a texture binds 0 in its place on every unit it was bound to
+void deleteGlTexture(GLuint texture){
+	glDeleteTextures(1, &texture);
+	
+	for(uint32_t i = 0; i < GL_STATE_TEXTURE_UNITS; i++){
+		for(uint32_t j = 0; j < GL_STATE_TEXTURE_TARGETS; j++){
+			if(g_boundTextures[i][j] == texture) g_boundTextures[i][j] = 0;
+		}
+	}
+}
+
+// bind a texture to a texture unit, only switching the active unit and binding if they aren't already set
+// the active unit is left wherever the last bind put it, anything binding textures (even just to upload them) has to go through here
+void bindGlTexture(GLuint unit, GLenum target, GLuint texture){
+	int32_t targetIndex = getGlStateTextureTarget(target);
+	bool tracked = unit < GL_STATE_TEXTURE_UNITS && targetIndex != -1;
+	
+	// already bound
+	if(g_glStateCaching && tracked && g_boundTextures[unit][targetIndex] == texture){
+		countGlStateCall(&glStateStats.textures, false);
+		
+		return;
+	}
+	
+	bool switchUnit = !g_glStateCaching || unit != g_activeTextureUnit;
+	
+	if(switchUnit) glActiveTexture(GL_TEXTURE0 + unit);
+	
+	g_activeTextureUnit = unit;
+	
+	countGlStateCall(&glStateStats.textureUnits, switchUnit);
+	
+	glBindTexture(target, texture);
+	
+	if(tracked) g_boundTextures[unit][targetIndex] = texture;
+	
+	countGlStateCall(&glStateStats.textures, true);
+}
\ No newline at end of file
@@ -3,9 +3,14 @@
 // includes //
 
 #include <graphics.h>
+#include <glbackend.h>
+#include <multidraw.h>
+#include <programcache.h>
+#include <textureloader.h>
 #include <utils.h>
 
 #include <string>
+#include <algorithm>
 
 // window management //
 
@@ -33,6 +38,18 @@ void terminateGraphics(){
 	glfwTerminate();
 }
 
+// state every context starts out with
+void initGlDefaults(uint32_t width, uint32_t height){
+	// set viewport size
+	glViewport(0, 0, width, height);
+	
+	// default settings
+	glEnable(GL_DEPTH_TEST);
+	
+	glEnable(GL_CULL_FACE);
+	glCullFace(GL_BACK);
+}
+
 // create a new render window
 // returns NULL if an error occurred
 Window* createWindow(int32_t width, int32_t height, const char* title){
@@ -57,20 +74,34 @@ Window* createWindow(int32_t width, int32_t height, const char* title){
 		return NULL;
 	}
 	
-	// set viewport size
-	glViewport(0, 0, width, height);
+	// put the backend picked with setGlBackend in front of them
+	initGlBackend((GLADloadproc)glfwGetProcAddress);
 	
-	// default settings
-	glEnable(GL_DEPTH_TEST);
+	// check for persistent mapping, multi-draw indirect and program binary support
+	initStreamBuffers(loadGlBackendProc);
+	initMultiDraw(loadGlBackendProc);
+	initProgramCache(loadGlBackendProc);
 	
-	glEnable(GL_CULL_FACE);
-	glCullFace(GL_BACK);
+	initGlDefaults(width, height);
 	
 	glfwSwapInterval(1);
 	
 	return window;
 }
 
+// set up the gl methods without a window or context, so the engine can run against the null or recording backend (see glbackend.h)
+// takes the place of createWindow, nothing is ever drawn since the real backend isn't available
+void initHeadlessGraphics(uint32_t width, uint32_t height){
+	initGlBackend(NULL);
+	
+	// the null backend has no extensions, so these just pick their fallbacks
+	initStreamBuffers(loadGlBackendProc);
+	initMultiDraw(loadGlBackendProc);
+	initProgramCache(loadGlBackendProc);
+	
+	initGlDefaults(width, height);
+}
+
 // if the window has received some kind of close event
 bool shouldWindowClose(Window* window){
 	return glfwWindowShouldClose(window->glfwWindow);
@@ -84,6 +115,22 @@ void updateWindow(Window* window){
 	glfwPollEvents();
 }
 
+// show the frame that was just drawn, may be called from whichever thread the context is current on
+void swapWindowBuffers(Window* window){
+	glfwSwapBuffers(window->glfwWindow);
+}
+
+// handle input and window events, has to be called from the main thread
+void pollWindowEvents(){
+	glfwPollEvents();
+}
+
+// make the window's context current on the calling thread, or release the calling thread's context if window is NULL
+// a context can only be current on one thread at a time, so it has to be released before another thread takes it
+void setWindowContextCurrent(Window* window){
+	glfwMakeContextCurrent(window ? window->glfwWindow : NULL);
+}
+
 // clear the window and replace with a color
 // also flushes the depth map
 void clearWindow(float r, float g, float b){
@@ -93,151 +140,416 @@ void clearWindow(float r, float g, float b){
 
 // vertex //
 Vertex createVertex(glm::vec3 position, glm::vec2 textureCoordinates, glm::vec3 normal){
-	return (Vertex){position, textureCoordinates, normal};
+	return (Vertex){position, textureCoordinates, normal, glm::vec2(0)};
 }
 
-// vertex data //
+// point the vertex attributes of the bound vao at the bound array buffer, which holds Vertex structs
+void setVertexAttributes(){
+	// position
+	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 10 * sizeof(float), (void*)(0));
+	glEnableVertexAttribArray(0);
+	
+	// tex coords
+	glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 10 * sizeof(float), (void*)(3*sizeof(float)));
+	glEnableVertexAttribArray(1);
+	
+	// normal
+	glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, 10 * sizeof(float), (void*)(5*sizeof(float)));
+	glEnableVertexAttribArray(2);
+	
+	// lightmap coords (12, since 3-10 are taken by instance attributes and 11 by the material of non-instanced draws)
+	glVertexAttribPointer(12, 2, GL_FLOAT, GL_FALSE, 10 * sizeof(float), (void*)(8*sizeof(float)));
+	glEnableVertexAttribArray(12);
+}
 
-// create vertex data from a set of vertices
-// if vertexCount is not equal to sizeof(vertices)/sizeof(float), there will be problems
-// for component order: 
-// 0 = 3-component vertices
-// 1 = 2-component texture coordinates
-// 2 = 3-component normals
-VertexData* createVertexData(float *vertices, uint32_t vertexCount, uint32_t sizeInBytes, uint32_t *componentOrder, uint32_t numComponents){
-	// allocate space
-	VertexData* data = allocateMemoryForType<VertexData>();
+// mesh pool //
+
+// every page of the mesh pool
+std::vector<MeshPoolPage*> meshPoolPages;
+
+// if createVertexData should suballocate from the mesh pool
+bool meshPoolEnabled = true;
+
+// bumped whenever vertex data might have moved to a different range or buffers (see getVertexDataGeneration)
+uint32_t vertexDataGeneration = 0;
+
+// anything holding on to vertex data ranges (like static draw lists) has to re-resolve them once this changes
+uint32_t getVertexDataGeneration(){
+	return vertexDataGeneration;
+}
+
+// turn the mesh pool on or off for vertex data created from now on
+void setMeshPoolEnabled(bool enabled){
+	meshPoolEnabled = enabled;
+}
+
+// create an empty page with room for vertexCapacity vertices and indexCapacity indices
+// returns NULL if the page couldn't be created
+MeshPoolPage* createMeshPoolPage(uint32_t vertexCapacity, uint32_t indexCapacity){
+	MeshPoolPage* page = allocateMemoryForType<MeshPoolPage>();
 	
-	// set default values in case any methods below fail
-	data->vbo = 0;
-	data->vao = 0;
-	data->ebo = 0;
-	data->indexCount = 0;
-	data->vertexCount = vertexCount;
-	data->sizeInBytes = sizeInBytes;
+	page->vbo = 0;
+	page->vao = 0;
+	page->ebo = 0;
+	page->vertexCapacity = vertexCapacity;
+	page->indexCapacity = indexCapacity;
 	
-	// create vertex buffer object
-	glGenBuffers(1, &data->vbo);
+	glGenBuffers(1, &page->vbo);
+	glGenBuffers(1, &page->ebo);
+	glGenVertexArrays(1, &page->vao);
 	
-	// check for success
 	// FIXME: actual error checking using gl methods
-	if(data->vbo == 0) return NULL;
+	if(page->vbo == 0 || page->ebo == 0 || page->vao == 0){
+		free(page);
+		
+		return NULL;
+	}
 	
-	// bind buffer to array buffer target
-	glBindBuffer(GL_ARRAY_BUFFER, data->vbo);
+	bindGlVertexArray(page->vao);
 	
-	// copy vertex data to buffer
-	glBufferData(GL_ARRAY_BUFFER, data->sizeInBytes, vertices, GL_STATIC_DRAW); // target, size, data, purpose
+	glBindBuffer(GL_ARRAY_BUFFER, page->vbo);
+	glBufferData(GL_ARRAY_BUFFER, vertexCapacity * sizeof(Vertex), NULL, GL_STATIC_DRAW);
 	
-	// generate vertex attribute object
-	glGenVertexArrays(1, &data->vao);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, page->ebo);
+	glBufferData(GL_ELEMENT_ARRAY_BUFFER, indexCapacity * sizeof(uint32_t), NULL, GL_STATIC_DRAW);
 	
-	// check for success
-	if(data->vao == 0) return NULL;
+	setVertexAttributes();
 	
-	// bind vao
-	glBindVertexArray(data->vao);
+	// unbind the vao first so it keeps the element buffer
+	bindGlVertexArray(0);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
 	
-	// total stride for each element
-	uint32_t stride = 0;
+	// everything starts out free
+	page->freeVertices = new std::vector<MeshPoolRange>();
+	page->freeIndices = new std::vector<MeshPoolRange>();
+	page->allocations = new std::vector<VertexData*>();
 	
-	// calculate total size of stride
-	for(uint32_t i = 0; i < numComponents; i++){
-		uint32_t component = componentOrder[i];
-		uint32_t componentSize = 3 - (component % 2); // this will need to be changed should any more components be supported
+	page->freeVertices->push_back( (MeshPoolRange){0, vertexCapacity} );
+	page->freeIndices->push_back( (MeshPoolRange){0, indexCapacity} );
+	
+	return page;
+}
+
+// find the first free range with room for count elements
+// returns the index of the range in freeList, or -1 if none are big enough
+int32_t findMeshPoolRange(std::vector<MeshPoolRange>* freeList, uint32_t count){
+	for(uint32_t i = 0; i < freeList->size(); i++){
+		if(freeList->at(i).count >= count) return i;
+	}
+	
+	return -1;
+}
+
+// take count elements off the front of a free range, returning where they start
+uint32_t takeMeshPoolRange(std::vector<MeshPoolRange>* freeList, int32_t index, uint32_t count){
+	MeshPoolRange& range = freeList->at(index);
+	
+	uint32_t first = range.first;
+	
+	range.first += count;
+	range.count -= count;
+	
+	if(range.count == 0) freeList->erase(freeList->begin() + index);
+	
+	return first;
+}
+
+// put a range back on a free list, merging it with the ranges on either side if they touch
+void releaseMeshPoolRange(std::vector<MeshPoolRange>* freeList, uint32_t first, uint32_t count){
+	if(count == 0) return;
+	
+	// find where the range goes
+	uint32_t index = 0;
+	
+	while(index < freeList->size() && freeList->at(index).first < first){
+		index++;
+	}
+	
+	freeList->insert(freeList->begin() + index, (MeshPoolRange){first, count});
+	
+	// merge with next
+	if(index + 1 < freeList->size() && first + count == freeList->at(index + 1).first){
+		freeList->at(index).count += freeList->at(index + 1).count;
+		freeList->erase(freeList->begin() + index + 1);
+	}
+	
+	// merge with previous
+	if(index > 0 && freeList->at(index - 1).first + freeList->at(index - 1).count == first){
+		freeList->at(index - 1).count += freeList->at(index).count;
+		freeList->erase(freeList->begin() + index);
+	}
+}
+
+// total number of free elements in a free list
+uint32_t getMeshPoolFreeCount(std::vector<MeshPoolRange>* freeList){
+	uint32_t count = 0;
+	
+	for(uint32_t i = 0; i < freeList->size(); i++){
+		count += freeList->at(i).count;
+	}
+	
+	return count;
+}
+
+// used to sort allocations by where they sit in a page
+bool compareMeshPoolVertices(VertexData* a, VertexData* b){
+	return a->baseVertex < b->baseVertex;
+}
+
+bool compareMeshPoolIndices(VertexData* a, VertexData* b){
+	return a->firstIndex < b->firstIndex;
+}
+
+// copy a pooled vertex data's cpu side vertices/indices into its range of the page
+void uploadMeshPool(VertexData* data){
+	MeshPoolPage* page = data->page;
+	
+	// copy targets are used so the element buffer of whatever vao is bound isn't touched
+	if(data->vertexCount > 0){
+		glBindBuffer(GL_COPY_WRITE_BUFFER, page->vbo);
+		glBufferSubData(GL_COPY_WRITE_BUFFER, data->baseVertex * sizeof(Vertex), data->vertexCount * sizeof(Vertex), &data->vertices->at(0));
+	}
+	
+	if(data->indexCount > 0){
+		glBindBuffer(GL_COPY_WRITE_BUFFER, page->ebo);
+		glBufferSubData(GL_COPY_WRITE_BUFFER, data->firstIndex * sizeof(uint32_t), data->indexCount * sizeof(uint32_t), &data->indices->at(0));
+	}
+	
+	glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+}
+
+// slide every allocation of a page down so all of its free space ends up in one range at the end
+// allocations are re-uploaded from their cpu side copies, which is safe in place since nothing moves up
+// indices are relative to baseVertex, so they never need rewriting
+void defragmentMeshPoolPage(MeshPoolPage* page){
+	// nothing to do if the free space is already in one piece at the end
+	bool vertexHoles = page->freeVertices->size() > 1 || (page->freeVertices->size() == 1 && page->freeVertices->at(0).first + page->freeVertices->at(0).count != page->vertexCapacity);
+	bool indexHoles = page->freeIndices->size() > 1 || (page->freeIndices->size() == 1 && page->freeIndices->at(0).first + page->freeIndices->at(0).count != page->indexCapacity);
+	
+	if(!vertexHoles && !indexHoles) return;
+	
+	vertexDataGeneration++;
+	
+	std::vector<VertexData*> allocations = *page->allocations;
+	
+	// vertices
+	std::sort(allocations.begin(), allocations.end(), compareMeshPoolVertices);
+	
+	uint32_t vertexEnd = 0;
+	
+	for(uint32_t i = 0; i < allocations.size(); i++){
+		VertexData* data = allocations[i];
 		
-		stride += componentSize;
+		if(data->baseVertex != vertexEnd && data->vertexCount > 0){
+			data->baseVertex = vertexEnd;
+			
+			glBindBuffer(GL_COPY_WRITE_BUFFER, page->vbo);
+			glBufferSubData(GL_COPY_WRITE_BUFFER, data->baseVertex * sizeof(Vertex), data->vertexCount * sizeof(Vertex), &data->vertices->at(0));
+		}
+		
+		vertexEnd += data->vertexCount;
 	}
 	
-	// offset of the current component
-	uint32_t offset = 0;
+	// indices
+	std::sort(allocations.begin(), allocations.end(), compareMeshPoolIndices);
 	
-	// create vertex attribues
-	for(uint32_t i = 0; i < numComponents; i++){
-		uint32_t component = componentOrder[i];
-		uint32_t componentSize = 3 - (component % 2); // this will need to be changed should any more components be supported
+	uint32_t indexEnd = 0;
+	
+	for(uint32_t i = 0; i < allocations.size(); i++){
+		VertexData* data = allocations[i];
 		
-		glVertexAttribPointer(component, componentSize, GL_FLOAT, GL_FALSE, stride * sizeof(float), (void*)(offset*sizeof(float)));
-		glEnableVertexAttribArray(component);
+		if(data->firstIndex != indexEnd && data->indexCount > 0){
+			data->firstIndex = indexEnd;
+			
+			glBindBuffer(GL_COPY_WRITE_BUFFER, page->ebo);
+			glBufferSubData(GL_COPY_WRITE_BUFFER, data->firstIndex * sizeof(uint32_t), data->indexCount * sizeof(uint32_t), &data->indices->at(0));
+		}
 		
-		offset += componentSize;
+		indexEnd += data->indexCount;
 	}
 	
-	// unbind buffer and array
-	glBindBuffer(GL_ARRAY_BUFFER, 0);
-	glBindVertexArray(0);
+	glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
 	
-	return data;
+	// the rest of the page is one free range
+	page->freeVertices->clear();
+	page->freeIndices->clear();
+	
+	if(vertexEnd < page->vertexCapacity) page->freeVertices->push_back( (MeshPoolRange){vertexEnd, page->vertexCapacity - vertexEnd} );
+	if(indexEnd < page->indexCapacity) page->freeIndices->push_back( (MeshPoolRange){indexEnd, page->indexCapacity - indexEnd} );
 }
 
-VertexData* createVertexData(Vertex *vertices, uint32_t vertexCount, uint32_t sizeInBytes){
-	// allocate space
-	VertexData* data = allocateMemoryForType<VertexData>();
+// compact every page of the mesh pool, best called once after unloading a set of vertex data
+void defragmentMeshPool(){
+	for(uint32_t i = 0; i < meshPoolPages.size(); i++){
+		defragmentMeshPoolPage(meshPoolPages[i]);
+	}
+}
+
+// try to fit a vertex data into a page, defragmenting the page if it has enough room but not in one piece
+bool allocateMeshPoolPage(MeshPoolPage* page, VertexData* data){
+	int32_t vertexRange = data->vertexCount > 0 ? findMeshPoolRange(page->freeVertices, data->vertexCount) : 0;
+	int32_t indexRange = data->indexCount > 0 ? findMeshPoolRange(page->freeIndices, data->indexCount) : 0;
 	
-	// set default values in case any methods below fail
-	data->vbo = 0;
-	data->vao = 0;
-	data->ebo = 0;
-	data->vertexCount = vertexCount;
-	data->indexCount = 0;
-	data->sizeInBytes = sizeInBytes;
+	if(vertexRange < 0 || indexRange < 0){
+		if(getMeshPoolFreeCount(page->freeVertices) < data->vertexCount || getMeshPoolFreeCount(page->freeIndices) < data->indexCount) return false;
+		
+		defragmentMeshPoolPage(page);
+		
+		vertexRange = 0;
+		indexRange = 0;
+	}
 	
-	// create vertex buffer object
-	glGenBuffers(1, &data->vbo);
+	data->baseVertex = data->vertexCount > 0 ? takeMeshPoolRange(page->freeVertices, vertexRange, data->vertexCount) : 0;
+	data->firstIndex = data->indexCount > 0 ? takeMeshPoolRange(page->freeIndices, indexRange, data->indexCount) : 0;
 	
-	// check for success
-	// FIXME: actual error checking using gl methods
-	if(data->vbo == 0) return NULL;
+	data->page = page;
+	data->vbo = page->vbo;
+	data->vao = page->vao;
+	data->ebo = page->ebo;
 	
-	// bind buffer to array buffer target
-	glBindBuffer(GL_ARRAY_BUFFER, data->vbo);
+	page->allocations->push_back(data);
 	
-	// copy vertex data to buffer
-	glBufferData(GL_ARRAY_BUFFER, data->sizeInBytes, vertices, GL_STATIC_DRAW); // target, size, data, purpose
+	return true;
+}
+
+// find a range of the mesh pool for a vertex data, adding a page if none of the existing ones have room
+bool allocateMeshPool(VertexData* data){
+	for(uint32_t i = 0; i < meshPoolPages.size(); i++){
+		if(allocateMeshPoolPage(meshPoolPages[i], data)) return true;
+	}
 	
-	// generate vertex attribute object
-	glGenVertexArrays(1, &data->vao);
+	uint32_t vertexCapacity = data->vertexCount > MESH_POOL_PAGE_VERTICES ? data->vertexCount : MESH_POOL_PAGE_VERTICES;
+	uint32_t indexCapacity = data->indexCount > MESH_POOL_PAGE_INDICES ? data->indexCount : MESH_POOL_PAGE_INDICES;
 	
-	// check for success
-	if(data->vao == 0) return NULL;
+	MeshPoolPage* page = createMeshPoolPage(vertexCapacity, indexCapacity);
 	
-	// bind vao
-	glBindVertexArray(data->vao);
+	if(!page) return false;
 	
-	// position
-	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)(0));
-	glEnableVertexAttribArray(0);
+	meshPoolPages.push_back(page);
 	
-	// tex coords
-	glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)(3*sizeof(float)));
-	glEnableVertexAttribArray(1);
+	return allocateMeshPoolPage(page, data);
+}
+
+// give a pooled vertex data's ranges back to its page
+void freeMeshPool(VertexData* data){
+	MeshPoolPage* page = data->page;
 	
-	// normal
-	glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)(5*sizeof(float)));
-	glEnableVertexAttribArray(2);
+	page->allocations->erase(std::remove(page->allocations->begin(), page->allocations->end(), data), page->allocations->end());
 	
-	// unbind buffer and array
-	glBindBuffer(GL_ARRAY_BUFFER, 0);
-	glBindVertexArray(0);
+	if(data->vertexCount > 0) releaseMeshPoolRange(page->freeVertices, data->baseVertex, data->vertexCount);
+	if(data->indexCount > 0) releaseMeshPoolRange(page->freeIndices, data->firstIndex, data->indexCount);
 	
-	return data;
+	data->page = NULL;
+	data->vbo = 0;
+	data->vao = 0;
+	data->ebo = 0;
+}
+
+// vertex data //
+
+// create vertex data from a set of vertices
+// if vertexCount is not equal to sizeof(vertices)/sizeof(float), there will be problems
+// for component order:
+// 0 = 3-component vertices
+// 1 = 2-component texture coordinates
+// 2 = 3-component normals
+// vertices are converted to the Vertex layout (missing components are zeroed) so they can share a mesh pool page with everything else
+VertexData* createVertexData(float *vertices, uint32_t vertexCount, uint32_t sizeInBytes, uint32_t *componentOrder, uint32_t numComponents){
+	// total stride for each element
+	uint32_t stride = 0;
+	
+	// calculate total size of stride
+	for(uint32_t i = 0; i < numComponents; i++){
+		uint32_t component = componentOrder[i];
+		uint32_t componentSize = 3 - (component % 2); // this will need to be changed should any more components be supported
+		
+		stride += componentSize;
+	}
+	
+	std::vector<Vertex> converted;
+	
+	// convert each component to its spot in Vertex
+	for(uint32_t v = 0; v < vertexCount; v++){
+		Vertex vertex = createVertex(glm::vec3(0), glm::vec2(0), glm::vec3(0));
+		
+		float* element = vertices + v*stride;
+		
+		for(uint32_t i = 0; i < numComponents; i++){
+			uint32_t component = componentOrder[i];
+			uint32_t componentSize = 3 - (component % 2);
+			
+			float* destination = component == 0 ? &vertex.position.x : component == 1 ? &vertex.textureCoordinates.x : &vertex.normal.x;
+			
+			for(uint32_t j = 0; j < componentSize; j++){
+				destination[j] = element[j];
+			}
+			
+			element += componentSize;
+		}
+		
+		converted.push_back(vertex);
+	}
+	
+	return createVertexData(converted, std::vector<uint32_t>());
+}
+
+VertexData* createVertexData(Vertex *vertices, uint32_t vertexCount, uint32_t sizeInBytes){
+	return createVertexData(std::vector<Vertex>(vertices, vertices + vertexCount), std::vector<uint32_t>());
 }
 
 VertexData* createVertexData(std::vector<Vertex> vertices){
 	return createVertexData(vertices, std::vector<uint32_t>());
 }
 
-VertexData* createVertexData(std::vector<Vertex> vertices, std::vector<uint32_t> indices){
-	// allocate space
+// allocate space for vertex data, and set default values in case any methods after fail
+VertexData* allocateVertexData(std::vector<Vertex>& vertices, std::vector<uint32_t>& indices){
 	VertexData* data = allocateMemoryForType<VertexData>();
 	
-	// set default values in case any methods below fail
 	data->vbo = 0;
 	data->vao = 0;
 	data->ebo = 0;
 	data->vertexCount = vertices.size();
 	data->indexCount = indices.size();
 	data->sizeInBytes = data->vertexCount * sizeof(Vertex);
+	data->baseVertex = 0;
+	data->firstIndex = 0;
+	data->page = NULL;
+	data->vertices = new std::vector<Vertex>(vertices);
+	data->indices = new std::vector<uint32_t>(indices);
+	
+	return data;
+}
+
+// create vertex data, suballocated from the mesh pool unless it's been disabled (see setMeshPoolEnabled)
+// vertex data without indices is given 0, 1, 2, ... so every vertex data can be drawn by the same kind of indirect command (see multidraw.h)
+VertexData* createVertexData(std::vector<Vertex> vertices, std::vector<uint32_t> indices){
+	if(indices.size() == 0){
+		for(uint32_t i = 0; i < vertices.size(); i++){
+			indices.push_back(i);
+		}
+	}
+	
+	if(!meshPoolEnabled) return createStandaloneVertexData(vertices, indices);
+	
+	VertexData* data = allocateVertexData(vertices, indices);
+	
+	if(!allocateMeshPool(data)){
+		deleteVertexData(data);
+		
+		return NULL;
+	}
+	
+	uploadMeshPool(data);
+	
+	return data;
+}
+
+// create vertex data with its own buffers and vao
+// for vertex data that needs attributes of its own on its vao (like the layers of a static batch)
+VertexData* createStandaloneVertexData(std::vector<Vertex> vertices, std::vector<uint32_t> indices){
+	// allocate space
+	VertexData* data = allocateVertexData(vertices, indices);
 	
 	// create vertex buffer object
 	glGenBuffers(1, &data->vbo);
@@ -254,12 +566,12 @@ VertexData* createVertexData(std::vector<Vertex> vertices, std::vector<uint32_t>
 	
 	// generate vertex attribute object
 	glGenVertexArrays(1, &data->vao);
-		
+	
 	// check for success
 	if(data->vao == 0) return NULL;
 	
 	// bind vao
-	glBindVertexArray(data->vao);
+	bindGlVertexArray(data->vao);
 	
 	// generate indices if they exist
 	if(indices.size() > 0){
@@ -274,56 +586,192 @@ VertexData* createVertexData(std::vector<Vertex> vertices, std::vector<uint32_t>
 		glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(uint32_t), &indices[0], GL_STATIC_DRAW);
 	}
 	
-	// position
-	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)(0));
-	glEnableVertexAttribArray(0);
-	
-	// tex coords
-	glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)(3*sizeof(float)));
-	glEnableVertexAttribArray(1);
-	
-	// normal
-	glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)(5*sizeof(float)));
-	glEnableVertexAttribArray(2);
+	setVertexAttributes();
 	
 	// unbind buffer(s) and array
-	glBindVertexArray(0);
+	bindGlVertexArray(0);
 	glBindBuffer(GL_ARRAY_BUFFER, 0);
 	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
 	
 	return data;
 }
 
+// replace the vertices and indices of vertex data, moving it to a new range of the mesh pool (or new buffers) if the size changed
+// every object using the vertex data sees the new vertices, returns false if there wasn't room for them
+bool setVertexDataVertices(VertexData* data, std::vector<Vertex>& vertices, std::vector<uint32_t>& indices){
+	if(vertices.size() == 0 || indices.size() == 0) return false;
+	
+	bool resized = vertices.size() != data->vertexCount || indices.size() != data->indexCount;
+	
+	vertexDataGeneration++;
+	
+	*data->vertices = vertices;
+	*data->indices = indices;
+	
+	if(data->page){
+		if(resized){
+			freeMeshPool(data);
+			
+			data->vertexCount = vertices.size();
+			data->indexCount = indices.size();
+			data->sizeInBytes = data->vertexCount * sizeof(Vertex);
+			
+			if(!allocateMeshPool(data)) return false;
+		}
+		
+		uploadMeshPool(data);
+		
+		return true;
+	}
+	
+	data->vertexCount = vertices.size();
+	data->indexCount = indices.size();
+	data->sizeInBytes = data->vertexCount * sizeof(Vertex);
+	
+	// standalone vertex data keeps its buffers, they're just given new storage
+	if(data->ebo == 0) glGenBuffers(1, &data->ebo);
+	
+	bindGlVertexArray(data->vao);
+	
+	glBindBuffer(GL_ARRAY_BUFFER, data->vbo);
+	glBufferData(GL_ARRAY_BUFFER, data->sizeInBytes, &vertices[0], GL_STATIC_DRAW);
+	
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, data->ebo);
+	glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(uint32_t), &indices[0], GL_STATIC_DRAW);
+	
+	bindGlVertexArray(0);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+	
+	return true;
+}
+
+// delete vertex data, giving its range back to the mesh pool if it was pooled
+// the page isn't compacted until it runs out of room or defragmentMeshPool is called, so unloading many vertex data only moves the rest once
+void deleteVertexData(VertexData* data){
+	vertexDataGeneration++;
+	
+	if(data->page){
+		freeMeshPool(data);
+	} else {
+		if(data->vbo != 0) glDeleteBuffers(1, &data->vbo);
+		if(data->ebo != 0) glDeleteBuffers(1, &data->ebo);
+		if(data->vao != 0) deleteGlVertexArray(data->vao);
+	}
+	
+	delete data->vertices;
+	delete data->indices;
+	
+	free(data);
+}
 
 // bind vertex data vao
 void bindVertexData(VertexData* data){
-	glBindVertexArray(data->vao);
+	bindGlVertexArray(data->vao);
 }
 
 // bind vertex data and call draw arrays
+// the vao is left bound, so drawing the same vertex data again doesn't bind it again
 void renderVertexData(VertexData* data){
 	// bind vao
 	bindVertexData(data);
 	
 	// call draw arrays
 	renderVertexDataNoBind(data);
-	
-	// unbind vertex array for neatness
-	glBindVertexArray(0);
 }
 
 // call draw arrays with no bind
 void renderVertexDataNoBind(VertexData* data){
 	// call draw arrays or elements
-	if(data->ebo == 0){
-		glDrawArrays(GL_TRIANGLES, 0, data->vertexCount);
+	if(data->indexCount == 0){
+		glDrawArrays(GL_TRIANGLES, data->baseVertex, data->vertexCount);
 	} else {
-		//printf("drawing elements... %d\n", data->indexCount);
-		glDrawElements(GL_TRIANGLES, data->indexCount, GL_UNSIGNED_INT, 0);
-		//printf("done.\n");
+		glDrawElementsBaseVertex(GL_TRIANGLES, data->indexCount, GL_UNSIGNED_INT, (void*)(uintptr_t)(data->firstIndex * sizeof(uint32_t)), data->baseVertex);
 	}
 }
 
+// call draw arrays/elements instanced with no bind
+// expects instance attributes to already be pointed at the right instances with bindVertexDataInstances
+void renderVertexDataInstancedNoBind(VertexData* data, uint32_t instanceCount){
+	if(data->indexCount == 0){
+		glDrawArraysInstanced(GL_TRIANGLES, data->baseVertex, data->vertexCount, instanceCount);
+	} else {
+		glDrawElementsInstancedBaseVertex(GL_TRIANGLES, data->indexCount, GL_UNSIGNED_INT, (void*)(uintptr_t)(data->firstIndex * sizeof(uint32_t)), instanceCount, data->baseVertex);
+	}
+}
+
+// instance buffer //
+
+// create an instance buffer with space for capacity instances
+// returns NULL if the buffer couldn't be created
+InstanceBuffer* createInstanceBuffer(uint32_t capacity){
+	InstanceBuffer* buffer = allocateMemoryForType<InstanceBuffer>();
+	
+	buffer->stream = createStreamBuffer(GL_ARRAY_BUFFER, capacity * sizeof(InstanceData));
+	
+	if(!buffer->stream){
+		free(buffer);
+		
+		return NULL;
+	}
+	
+	buffer->vbo = getStreamBufferBuffer(buffer->stream);
+	
+	return buffer;
+}
+
+// copy instances into an instance buffer, growing it if necessary
+// every upload goes to the next region of the stream buffer so the driver doesn't have to wait on last frame's draws
+void uploadInstanceBuffer(InstanceBuffer* buffer, std::vector<InstanceData>& instances){
+	if(instances.size() == 0) return;
+	
+	buffer->vbo = writeStreamBuffer(buffer->stream, instances.size() * sizeof(InstanceData), &instances[0]);
+}
+
+// point the instance attributes of a vertex data's vao at an instance buffer, starting at firstInstance
+// assumes that the vao of data is already bound (see bindVertexData)
+// instance attributes:
+// 3-6 = 4x4 model matrix
+// 7-9 = 3x3 normal matrix
+// 10 = material index (see MaterialTable)
+// 13 = lightmap rect
+void bindVertexDataInstances(VertexData* data, InstanceBuffer* buffer, uint32_t firstInstance){
+	glBindBuffer(GL_ARRAY_BUFFER, buffer->vbo);
+	
+	// byte offset of the first instance
+	uintptr_t base = firstInstance * sizeof(InstanceData);
+	
+	// model matrix (one attribute per column)
+	for(uint32_t i = 0; i < 4; i++){
+		uintptr_t offset = base + offsetof(InstanceData, model) + i * sizeof(glm::vec4);
+		
+		glVertexAttribPointer(3 + i, 4, GL_FLOAT, GL_FALSE, sizeof(InstanceData), (void*)offset);
+		glEnableVertexAttribArray(3 + i);
+		glVertexAttribDivisor(3 + i, 1);
+	}
+	
+	// normal matrix (one attribute per column)
+	for(uint32_t i = 0; i < 3; i++){
+		uintptr_t offset = base + offsetof(InstanceData, normalMatrix) + i * sizeof(glm::vec3);
+		
+		glVertexAttribPointer(7 + i, 3, GL_FLOAT, GL_FALSE, sizeof(InstanceData), (void*)offset);
+		glEnableVertexAttribArray(7 + i);
+		glVertexAttribDivisor(7 + i, 1);
+	}
+	
+	// material
+	glVertexAttribIPointer(10, 1, GL_UNSIGNED_INT, sizeof(InstanceData), (void*)(base + offsetof(InstanceData, material)));
+	glEnableVertexAttribArray(10);
+	glVertexAttribDivisor(10, 1);
+	
+	// lightmap rect
+	glVertexAttribPointer(13, 4, GL_FLOAT, GL_FALSE, sizeof(InstanceData), (void*)(base + offsetof(InstanceData, lightmapRect)));
+	glEnableVertexAttribArray(13);
+	glVertexAttribDivisor(13, 1);
+	
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
 // create a renderable object (vertex data w/ model matrix)
 RenderableObject* createRenderableObject(VertexData* vertexData, glm::vec3 position, glm::vec3 rotation, glm::vec3 scale){
 	// allocate memory
@@ -333,40 +781,24 @@ RenderableObject* createRenderableObject(VertexData* vertexData, glm::vec3 posit
 	object->vertexData = vertexData;
 	
 	// assign transform
-	setRenderableObjectTransform(object, position, rotation, scale);
+	object->transform = createTransform(position, rotation, scale);
 	
 	return object;
 }
 
 // assign translation, rotation, and scale values to an object's transform
 void setRenderableObjectTransform(RenderableObject* object, glm::vec3 position, glm::vec3 rotation, glm::vec3 scale){
-	// store values
-	object->position = position;
-	object->rotation = rotation;
-	object->scale = scale;
-	
-	// translate
-	object->modelMatrix = glm::mat4(1.0f);
-	
-	object->modelMatrix = glm::translate(object->modelMatrix, position);
-	
-	// rotate around each axis
-	object->modelMatrix = glm::rotate(object->modelMatrix, object->rotation.z, glm::vec3(0.f, 0.f, 1.f));
-	object->modelMatrix = glm::rotate(object->modelMatrix, object->rotation.y, glm::vec3(0.f, 1.f, 0.f));
-	object->modelMatrix = glm::rotate(object->modelMatrix, object->rotation.x, glm::vec3(1.f, 0.f, 0.f));
-	
-	// scale
-	object->modelMatrix = glm::scale(object->modelMatrix, object->scale);
+	setTransform(object->transform, position, rotation, scale);
 }
 
 // render a renderable object with respect to a perspective camera's transform
 // this method assumes that the shader has a pvm uniform, and has already been bound (this method will not call glUseProgram)
 void renderRenderableObject(RenderableObject* object, PerspectiveCamera* camera, ShaderProgramEx* programEx){
 	// create pvm
-	glm::mat4 pvm = camera->pv * object->modelMatrix;
+	glm::mat4 pvm = camera->pv * getTransformWorldMatrix(object->transform);
 	
 	// assign uniforms
-	glUniformMatrix4fv(getProgramExUniformLocation(programEx, "pvm"), 1, GL_FALSE, glm::value_ptr(pvm));
+	setProgramExUniformMat4(programEx, UNIFORM_PVM, pvm);
 	
 	// render vertex data
 	renderVertexData(object->vertexData);
@@ -376,11 +808,15 @@ void renderRenderableObject(RenderableObject* object, PerspectiveCamera* camera,
 // this method assumes that the shader has a pvm uniform, and has already been bound (this method will not call glUseProgram)
 // calls renderVertexDataNoBind
 void renderRenderableObjectNoBind(RenderableObject* object, PerspectiveCamera* camera, ShaderProgramEx* programEx){
-	// create pvm
-	glm::mat4 pvm = camera->pv * object->modelMatrix;
+	// create pvm (unless the shader multiplies it out itself, like with the Camera uniform block)
+	GLint pvmLocation = getProgramExUniform(programEx, UNIFORM_PVM);
 	
-	// assign uniforms
-	glUniformMatrix4fv(getProgramExUniformLocation(programEx, "pvm"), 1, GL_FALSE, glm::value_ptr(pvm));
+	if(pvmLocation != -1){
+		glm::mat4 pvm = camera->pv * getTransformWorldMatrix(object->transform);
+		
+		// assign uniforms
+		setProgramExUniformMat4(programEx, UNIFORM_PVM, pvm);
+	}
 	
 	// render vertex data
 	renderVertexDataNoBind(object->vertexData);
@@ -393,6 +829,7 @@ Mesh* createMesh(VertexData* vertexData, TextureData* texture, glm::vec3 color){
 	mesh->vertexData = vertexData;
 	mesh->texture = texture;
 	mesh->color = color;
+	mesh->transform = glm::mat4(1.0f);
 	
 	return mesh;
 }
@@ -488,7 +925,7 @@ void processMesh(aiMesh* aiMesh, const aiScene* scene, Model* model){
 					// check if we need to run through stbi
 					if(embeddedTexture->mHeight == 0){
 						// get texture data from stbi
-						texture = createTextureDataRawCompressed((unsigned char*)embeddedTexture->pcData, embeddedTexture->mWidth);
+						texture = createTextureDataRawCompressedAsync((unsigned char*)embeddedTexture->pcData, embeddedTexture->mWidth, NULL, NULL);
 					} else {
 						// FIXME: code
 						printf("Error: I wish this supported raw embedded texture data, but it doesn't\n");
@@ -496,7 +933,7 @@ void processMesh(aiMesh* aiMesh, const aiScene* scene, Model* model){
 					}
 				} else {
 					// not embedded
-					texture = createTextureData( (*model->path + relativePath).c_str() );
+					texture = createTextureDataAsync( (*model->path + relativePath).c_str(), NULL, NULL );
 				}
 				
 				(*model->textures)[relativePath] = texture;
@@ -515,21 +952,29 @@ void processMesh(aiMesh* aiMesh, const aiScene* scene, Model* model){
 }
 
 // process node into meshes, etc.
-void processNode(aiNode* node, const aiScene* scene, Model* model){
+// parentTransform is the accumulated transformation of the node's parents
+void processNode(aiNode* node, const aiScene* scene, Model* model, glm::mat4 parentTransform){
+	// assimp matrices are row major
+	glm::mat4 transform = parentTransform * glm::transpose(glm::make_mat4(&node->mTransformation.a1));
+	
 	// load meshes
 	for(uint32_t i = 0; i < node->mNumMeshes; i++){
 		uint32_t meshIndex = node->mMeshes[i];
 		
 		aiMesh* mesh = scene->mMeshes[meshIndex];
 		
+		uint32_t meshCount = model->meshes->size();
+		
 		processMesh(mesh, scene, model);
+		
+		if(model->meshes->size() > meshCount) model->meshes->back()->transform = transform;
 	}
 	
 	// process children
 	for(uint32_t i = 0; i < node->mNumChildren; i++){
 		aiNode* child = node->mChildren[i];
 		
-		processNode(child, scene, model);
+		processNode(child, scene, model, transform);
 	}
 }
 
@@ -563,7 +1008,7 @@ Model* loadModel(Assimp::Importer& importer, const std::string& path){
 	model->path = new std::string(path);
 	
 	// process the root node (also recursively processess everything else)
-	processNode(scene->mRootNode, scene, model);
+	processNode(scene->mRootNode, scene, model, glm::mat4(1.0f));
 	
 	return model;
 }
@@ -0,0 +1,306 @@
+// clustered light assignment
+
+#include <lightclusters.h>
+#include <utils.h>
+
+#include <glm/glm.hpp>
+#include <glm/ext.hpp>
+
+#include <algorithm>
+#include <cmath>
+
+// lights are capped to this radius while being assigned so lights that never fade out don't turn into infinities and nans
+#define MAX_ASSIGNED_LIGHT_RADIUS 1.0e6f
+
+void runLightClusterWorker(LightClusterGrid* grid, uint32_t index);
+
+// creates a cluster grid of sizeX * sizeY * sizeZ clusters
+// returns NULL if the cluster buffers couldn't be created
+LightClusterGrid* createLightClusterGrid(uint32_t sizeX, uint32_t sizeY, uint32_t sizeZ){
+	LightClusterGrid* grid = allocateMemoryForType<LightClusterGrid>();
+	
+	uint32_t clusterCount = sizeX * sizeY * sizeZ;
+	
+	grid->sizeX = sizeX;
+	grid->sizeY = sizeY;
+	grid->sizeZ = sizeZ;
+	
+	// placeholder depth range until the first assignment
+	grid->near = 0.1f;
+	grid->far = 100.0f;
+	
+	// create gpu buffers
+	grid->clusterBuffer = createTextureBuffer(GL_RG32UI, clusterCount * 2 * sizeof(uint32_t));
+	grid->indexBuffer = createTextureBuffer(GL_R32UI, 0);
+	
+	if(!grid->clusterBuffer || !grid->indexBuffer){
+		if(grid->clusterBuffer) deleteTextureBuffer(grid->clusterBuffer);
+		if(grid->indexBuffer) deleteTextureBuffer(grid->indexBuffer);
+		
+		free(grid);
+		
+		return NULL;
+	}
+	
+	// create cpu lists (remember to delete)
+	grid->clusterLights = new std::vector<std::vector<uint32_t>>(clusterCount);
+	grid->viewLights = new std::vector<glm::vec4>();
+	grid->clusterRanges = new std::vector<uint32_t>(clusterCount * 2, 0);
+	grid->lightIndices = new std::vector<uint32_t>();
+	
+	// leave a core for the calling thread, which does its share of the work too
+	uint32_t cores = std::thread::hardware_concurrency();
+	
+	grid->workerCount = cores > 1 ? std::min(cores - 1, 7u) : 0;
+	
+	grid->mutex = new std::mutex();
+	grid->condition = new std::condition_variable();
+	grid->generation = 0;
+	grid->busyWorkers = 0;
+	grid->quit = false;
+	
+	grid->projection = glm::mat4(1.0f);
+	grid->threadCount = 1;
+	
+	grid->workers = new std::vector<std::thread*>();
+	
+	for(uint32_t i = 1; i <= grid->workerCount; i++){
+		grid->workers->push_back(new std::thread(runLightClusterWorker, grid, i));
+	}
+	
+	return grid;
+}
+
+// stop the worker threads and free everything the grid made
+void destroyLightClusterGrid(LightClusterGrid* grid){
+	{
+		std::lock_guard<std::mutex> lock(*grid->mutex);
+		
+		grid->quit = true;
+	}
+	
+	grid->condition->notify_all();
+	
+	for(uint32_t i = 0; i < grid->workers->size(); i++){
+		grid->workers->at(i)->join();
+		
+		delete grid->workers->at(i);
+	}
+	
+	deleteTextureBuffer(grid->clusterBuffer);
+	deleteTextureBuffer(grid->indexBuffer);
+	
+	delete grid->clusterLights;
+	delete grid->viewLights;
+	delete grid->clusterRanges;
+	delete grid->lightIndices;
+	delete grid->workers;
+	delete grid->mutex;
+	delete grid->condition;
+	
+	free(grid);
+}
+
+// get the view depth at the near side of a z slice
+float getLightClusterSliceDepth(LightClusterGrid* grid, uint32_t slice){
+	return grid->near * powf(grid->far / grid->near, (float)slice / (float)grid->sizeZ);
+}
+
+// get the z slice containing a view depth
+uint32_t getLightClusterSlice(LightClusterGrid* grid, float depth){
+	float slice = logf(depth) * getLightClusterDepthScale(grid) + getLightClusterDepthBias(grid);
+	
+	return (uint32_t)glm::clamp(slice, 0.0f, (float)grid->sizeZ - 1);
+}
+
+// get the column (or row) of clusters containing a normalized device coordinate
+uint32_t getLightClusterTile(float ndc, uint32_t size){
+	float tile = (glm::clamp(ndc, -1.0f, 1.0f) * 0.5f + 0.5f) * size;
+	
+	return std::min((uint32_t)tile, size - 1);
+}
+
+// assign every light to the clusters in z slices [firstSlice, lastSlice)
+// threads can work on separate slices at the same time since they never touch the same clusters
+void assignLightClusterSlices(LightClusterGrid* grid, glm::mat4 projection, uint32_t firstSlice, uint32_t lastSlice){
+	uint32_t sliceSize = grid->sizeX * grid->sizeY;
+	
+	// clear old assignments (keeps the lists' memory around)
+	for(uint32_t i = firstSlice * sliceSize; i < lastSlice * sliceSize; i++){
+		grid->clusterLights->at(i).clear();
+	}
+	
+	// view space to normalized device coordinates is x * scale / depth
+	float scaleX = projection[0][0];
+	float scaleY = projection[1][1];
+	
+	for(uint32_t i = 0; i < grid->viewLights->size(); i++){
+		glm::vec4 light = grid->viewLights->at(i);
+		
+		float depth = -light.z;
+		float radius = light.w;
+		
+		if(radius <= 0) continue;
+		
+		// depth range of the light inside the grid
+		float minDepth = std::max(depth - radius, grid->near);
+		float maxDepth = std::min(depth + radius, grid->far);
+		
+		if(minDepth > maxDepth) continue;
+		
+		uint32_t startSlice = std::max(getLightClusterSlice(grid, minDepth), firstSlice);
+		uint32_t endSlice = std::min(getLightClusterSlice(grid, maxDepth) + 1, lastSlice);
+		
+		for(uint32_t z = startSlice; z < endSlice; z++){
+			// depth range of the light inside this slice
+			float sliceNear = std::max(getLightClusterSliceDepth(grid, z), minDepth);
+			float sliceFar = std::min(getLightClusterSliceDepth(grid, z + 1), maxDepth);
+			
+			// widest cross section of the sphere inside this slice
+			float offset = 0;
+			
+			if(depth < sliceNear) offset = sliceNear - depth;
+			else if(depth > sliceFar) offset = depth - sliceFar;
+			
+			float crossRadius = sqrtf(std::max(radius*radius - offset*offset, 0.0f));
+			
+			// project the box around the cross section, x / depth is always most extreme at the nearest or farthest depth
+			float left = light.x - crossRadius;
+			float right = light.x + crossRadius;
+			float bottom = light.y - crossRadius;
+			float top = light.y + crossRadius;
+			
+			float minX = std::min(left / sliceNear, left / sliceFar) * scaleX;
+			float maxX = std::max(right / sliceNear, right / sliceFar) * scaleX;
+			float minY = std::min(bottom / sliceNear, bottom / sliceFar) * scaleY;
+			float maxY = std::max(top / sliceNear, top / sliceFar) * scaleY;
+			
+			// add light to every cluster the box covers
+			uint32_t startX = getLightClusterTile(minX, grid->sizeX);
+			uint32_t endX = getLightClusterTile(maxX, grid->sizeX);
+			uint32_t startY = getLightClusterTile(minY, grid->sizeY);
+			uint32_t endY = getLightClusterTile(maxY, grid->sizeY);
+			
+			for(uint32_t y = startY; y <= endY; y++){
+				for(uint32_t x = startX; x <= endX; x++){
+					grid->clusterLights->at(x + y*grid->sizeX + z*sliceSize).push_back(i);
+				}
+			}
+		}
+	}
+}
+
+// assign the z slices of one thread's share of the current assignment
+void assignLightClusterThreadSlices(LightClusterGrid* grid, uint32_t index){
+	if(index >= grid->threadCount) return;
+	
+	assignLightClusterSlices(grid, grid->projection, grid->sizeZ * index / grid->threadCount, grid->sizeZ * (index + 1) / grid->threadCount);
+}
+
+// body of each worker thread, does its share of every assignment until the grid is destroyed
+void runLightClusterWorker(LightClusterGrid* grid, uint32_t index){
+	uint32_t generation = 0;
+	
+	while(true){
+		{
+			std::unique_lock<std::mutex> lock(*grid->mutex);
+			
+			while(grid->generation == generation && !grid->quit){
+				grid->condition->wait(lock);
+			}
+			
+			if(grid->quit) return;
+			
+			generation = grid->generation;
+		}
+		
+		assignLightClusterThreadSlices(grid, index);
+		
+		{
+			std::lock_guard<std::mutex> lock(*grid->mutex);
+			
+			grid->busyWorkers--;
+		}
+		
+		grid->condition->notify_all();
+	}
+}
+
+// rebuild the light lists of every cluster for the camera's current view
+// light indexes refer to positions in lights
+void assignLightClusters(LightClusterGrid* grid, std::vector<PointLight*>& lights, PerspectiveCamera* camera){
+	grid->near = camera->near;
+	grid->far = camera->far;
+	
+	// move lights into view space
+	grid->viewLights->clear();
+	
+	for(uint32_t i = 0; i < lights.size(); i++){
+		glm::vec3 position = glm::vec3(camera->view * glm::vec4(lights[i]->position, 1.0f));
+		
+		grid->viewLights->push_back(glm::vec4(position, std::min(lights[i]->radius, MAX_ASSIGNED_LIGHT_RADIUS)));
+	}
+	
+	// split slices between threads
+	uint32_t threadCount = lights.size() >= LIGHT_CLUSTER_THREAD_THRESHOLD ? grid->workerCount + 1 : 1;
+	
+	threadCount = std::min(threadCount, grid->sizeZ);
+	
+	grid->projection = camera->projection;
+	grid->threadCount = threadCount;
+	
+	if(threadCount > 1){
+		// wake the workers, the ones past threadCount go straight back to waiting
+		{
+			std::lock_guard<std::mutex> lock(*grid->mutex);
+			
+			grid->generation++;
+			grid->busyWorkers = grid->workers->size();
+		}
+		
+		grid->condition->notify_all();
+		
+		assignLightClusterThreadSlices(grid, 0);
+		
+		std::unique_lock<std::mutex> lock(*grid->mutex);
+		
+		while(grid->busyWorkers > 0){
+			grid->condition->wait(lock);
+		}
+	} else {
+		assignLightClusterThreadSlices(grid, 0);
+	}
+	
+	// flatten lists
+	grid->lightIndices->clear();
+	
+	for(uint32_t i = 0; i < grid->clusterLights->size(); i++){
+		std::vector<uint32_t>& clusterLights = grid->clusterLights->at(i);
+		
+		grid->clusterRanges->at(i*2) = grid->lightIndices->size();
+		grid->clusterRanges->at(i*2 + 1) = clusterLights.size();
+		
+		grid->lightIndices->insert(grid->lightIndices->end(), clusterLights.begin(), clusterLights.end());
+	}
+}
+
+// copy the cluster lists to the gpu
+void uploadLightClusters(LightClusterGrid* grid){
+	uploadTextureBuffer(grid->clusterBuffer, grid->clusterRanges->size() * sizeof(uint32_t), &grid->clusterRanges->at(0));
+	uploadTextureBuffer(grid->indexBuffer, grid->lightIndices->size() * sizeof(uint32_t), grid->lightIndices->data());
+}
+
+// bind the cluster buffers to their reserved texture units
+void bindLightClusters(LightClusterGrid* grid){
+	bindTextureBuffer(grid->clusterBuffer, CLUSTER_DATA_TEXTURE_UNIT);
+	bindTextureBuffer(grid->indexBuffer, CLUSTER_LIGHT_INDICES_TEXTURE_UNIT);
+}
+
+// the shader finds a fragment's z slice as log(view depth) * scale + bias
+float getLightClusterDepthScale(LightClusterGrid* grid){
+	return grid->sizeZ / logf(grid->far / grid->near);
+}
+
+float getLightClusterDepthBias(LightClusterGrid* grid){
+	return -(grid->sizeZ * logf(grid->near)) / logf(grid->far / grid->near);
+}
\ No newline at end of file
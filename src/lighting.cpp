@@ -16,5 +16,66 @@ PointLight* createPointLight(glm::vec3 position, glm::vec3 color, float ambientS
 	light->l = l;
 	light->q = q;
 	
+	light->dirty = true;
+	
+	updatePointLightRadius(light);
+	
 	return light;
+}
+
+// setters
+// these mark the light dirty so it gets uploaded again, so use them instead of writing to the light directly
+
+void setPointLightPosition(PointLight* light, glm::vec3 position){
+	light->position = position;
+	light->dirty = true;
+}
+
+void setPointLightColor(PointLight* light, glm::vec3 color){
+	light->color = color;
+	light->dirty = true;
+	
+	updatePointLightRadius(light);
+}
+
+void setPointLightStrengths(PointLight* light, float ambientStrength, float diffuseStrength){
+	light->ambientStrength = ambientStrength;
+	light->diffuseStrength = diffuseStrength;
+	light->dirty = true;
+	
+	updatePointLightRadius(light);
+}
+
+void setPointLightAttenuation(PointLight* light, float c, float l, float q){
+	light->c = c;
+	light->l = l;
+	light->q = q;
+	light->dirty = true;
+	
+	updatePointLightRadius(light);
+}
+
+// recalculate the light's radius of influence
+// solves diffuseStrength * brightest color channel / (c + l*d + q*d^2) = LIGHT_INFLUENCE_CUTOFF for d
+void updatePointLightRadius(PointLight* light){
+	float intensity = light->diffuseStrength * glm::max(light->color.x, glm::max(light->color.y, light->color.z));
+	
+	// attenuation the light has to reach before it's invisible
+	float target = intensity / LIGHT_INFLUENCE_CUTOFF;
+	
+	if(target <= light->c){
+		// never visible
+		light->radius = 0;
+	} else if(light->q > 0){
+		// q*d^2 + l*d + (c - target) = 0, positive root
+		float b = light->l;
+		float c = light->c - target;
+		
+		light->radius = (-b + sqrtf(b*b - 4*light->q*c)) / (2*light->q);
+	} else if(light->l > 0){
+		light->radius = (target - light->c) / light->l;
+	} else {
+		// no attenuation
+		light->radius = HUGE_VALF;
+	}
 }
\ No newline at end of file
@@ -0,0 +1,995 @@
+// baked lightmaps
+
+#include <lightmap.h>
+#include <drawlist.h>
+#include <utils.h>
+
+#include <glm/glm.hpp>
+#include <glm/ext.hpp>
+
+#include <stb/stb_image.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdio>
+#include <map>
+#include <thread>
+#include <tuple>
+
+// unwrapping //
+
+// a group of connected triangles facing roughly the same way, flattened onto its plane
+struct LightmapChart {
+	std::vector<uint32_t> triangles;
+	
+	glm::vec3 normal; // normal of the triangle the chart started from
+	glm::vec3 tangent; // x axis of the chart's plane
+	glm::vec3 bitangent; // y axis of the chart's plane
+	
+	// bounds in the chart's plane
+	glm::vec2 lower;
+	glm::vec2 upper;
+	
+	glm::vec2 position; // where lower was packed to
+};
+
+// used to pack the tallest charts first
+bool compareLightmapChartHeights(const LightmapChart* a, const LightmapChart* b){
+	return a->upper.y - a->lower.y > b->upper.y - b->lower.y;
+}
+
+// pack charts into rows with padding between them and around the edges
+// returns the width and height of the square every chart fits in
+float packLightmapCharts(std::vector<LightmapChart*>& charts, float padding){
+	// aim for a square
+	float area = 0;
+	float widest = 0;
+	
+	for(uint32_t i = 0; i < charts.size(); i++){
+		glm::vec2 size = charts[i]->upper - charts[i]->lower;
+		
+		area += (size.x + padding) * (size.y + padding);
+		widest = std::max(widest, size.x);
+	}
+	
+	float rowWidth = std::max(sqrtf(area), widest + 2*padding);
+	
+	// place charts left to right, starting a new row when one runs out of room
+	float x = padding;
+	float y = padding;
+	float rowHeight = 0;
+	float right = 0;
+	
+	for(uint32_t i = 0; i < charts.size(); i++){
+		glm::vec2 size = charts[i]->upper - charts[i]->lower;
+		
+		if(x + size.x + padding > rowWidth && x > padding){
+			x = padding;
+			y += rowHeight + padding;
+			rowHeight = 0;
+		}
+		
+		charts[i]->position = glm::vec2(x, y);
+		
+		x += size.x + padding;
+		rowHeight = std::max(rowHeight, size.y);
+		right = std::max(right, x);
+	}
+	
+	return std::max(right, y + rowHeight + padding);
+}
+
+// generate lightmap coordinates for vertex data, so every triangle gets its own part of the 0-1 range
+// triangles are split into charts of connected triangles facing roughly the same way, each chart is projected onto its plane and the charts are packed into a square
+// vertices shared by more than one chart are split, so the vertex data is replaced with the unwrapped vertices (see setVertexDataVertices)
+// charts are scaled uniformly, so texel density is the same across the whole mesh
+// returns the size of the 0-1 range in the vertex data's own units, or 0 if it couldn't be unwrapped
+float unwrapLightmapCoordinates(VertexData* data){
+	std::vector<Vertex>& vertices = *data->vertices;
+	std::vector<uint32_t> indices = *data->indices;
+	
+	if(indices.size() == 0){
+		for(uint32_t i = 0; i < vertices.size(); i++){
+			indices.push_back(i);
+		}
+	}
+	
+	uint32_t triangleCount = indices.size() / 3;
+	
+	if(triangleCount == 0) return 0;
+	
+	// weld vertices by position, so triangles with their own copies of a corner are still connected
+	std::map<std::tuple<float, float, float>, uint32_t> weldedPositions;
+	std::vector<uint32_t> welded(vertices.size());
+	
+	for(uint32_t i = 0; i < vertices.size(); i++){
+		glm::vec3& position = vertices[i].position;
+		
+		std::tuple<float, float, float> key = std::make_tuple(position.x, position.y, position.z);
+		
+		if(weldedPositions.count(key) == 0){
+			uint32_t index = weldedPositions.size();
+			
+			weldedPositions[key] = index;
+		}
+		
+		welded[i] = weldedPositions[key];
+	}
+	
+	// face normals and the triangles on each edge
+	std::vector<glm::vec3> normals(triangleCount);
+	std::map<std::pair<uint32_t, uint32_t>, std::vector<uint32_t>> edges;
+	
+	for(uint32_t i = 0; i < triangleCount; i++){
+		glm::vec3 p0 = vertices[indices[i*3]].position;
+		glm::vec3 p1 = vertices[indices[i*3 + 1]].position;
+		glm::vec3 p2 = vertices[indices[i*3 + 2]].position;
+		
+		glm::vec3 normal = glm::cross(p1 - p0, p2 - p0);
+		float length = glm::length(normal);
+		
+		normals[i] = length > 0 ? normal / length : glm::vec3(0, 1, 0);
+		
+		for(uint32_t j = 0; j < 3; j++){
+			uint32_t a = welded[indices[i*3 + j]];
+			uint32_t b = welded[indices[i*3 + (j + 1) % 3]];
+			
+			edges[std::make_pair(std::min(a, b), std::max(a, b))].push_back(i);
+		}
+	}
+	
+	// grow charts out from each triangle that isn't in one yet
+	std::vector<int32_t> triangleCharts(triangleCount, -1);
+	std::vector<LightmapChart*> charts;
+	std::vector<uint32_t> stack;
+	
+	for(uint32_t i = 0; i < triangleCount; i++){
+		if(triangleCharts[i] >= 0) continue;
+		
+		LightmapChart* chart = new LightmapChart();
+		
+		chart->normal = normals[i];
+		
+		triangleCharts[i] = charts.size();
+		stack.push_back(i);
+		
+		while(!stack.empty()){
+			uint32_t triangle = stack.back();
+			
+			stack.pop_back();
+			chart->triangles.push_back(triangle);
+			
+			for(uint32_t j = 0; j < 3; j++){
+				uint32_t a = welded[indices[triangle*3 + j]];
+				uint32_t b = welded[indices[triangle*3 + (j + 1) % 3]];
+				
+				std::vector<uint32_t>& neighbours = edges[std::make_pair(std::min(a, b), std::max(a, b))];
+				
+				for(uint32_t k = 0; k < neighbours.size(); k++){
+					uint32_t neighbour = neighbours[k];
+					
+					if(triangleCharts[neighbour] >= 0 || glm::dot(normals[neighbour], chart->normal) < LIGHTMAP_CHART_ANGLE) continue;
+					
+					triangleCharts[neighbour] = charts.size();
+					stack.push_back(neighbour);
+				}
+			}
+		}
+		
+		charts.push_back(chart);
+	}
+	
+	// project each chart onto its plane, giving every chart its own copy of its vertices
+	std::vector<Vertex> unwrappedVertices;
+	std::vector<uint32_t> unwrappedIndices(indices.size());
+	std::vector<uint32_t> vertexCharts; // chart of each unwrapped vertex
+	
+	for(uint32_t i = 0; i < charts.size(); i++){
+		LightmapChart* chart = charts[i];
+		
+		glm::vec3 axis = fabsf(chart->normal.y) < 0.99f ? glm::vec3(0, 1, 0) : glm::vec3(1, 0, 0);
+		
+		chart->tangent = glm::normalize(glm::cross(axis, chart->normal));
+		chart->bitangent = glm::cross(chart->normal, chart->tangent);
+		chart->lower = glm::vec2(HUGE_VALF);
+		chart->upper = glm::vec2(-HUGE_VALF);
+		
+		// original vertex -> unwrapped vertex
+		std::map<uint32_t, uint32_t> chartVertices;
+		
+		for(uint32_t j = 0; j < chart->triangles.size(); j++){
+			uint32_t triangle = chart->triangles[j];
+			
+			for(uint32_t k = 0; k < 3; k++){
+				uint32_t index = indices[triangle*3 + k];
+				
+				if(chartVertices.count(index) == 0){
+					Vertex vertex = vertices[index];
+					
+					vertex.lightmapCoordinates = glm::vec2(glm::dot(vertex.position, chart->tangent), glm::dot(vertex.position, chart->bitangent));
+					
+					chart->lower = glm::min(chart->lower, vertex.lightmapCoordinates);
+					chart->upper = glm::max(chart->upper, vertex.lightmapCoordinates);
+					
+					chartVertices[index] = unwrappedVertices.size();
+					unwrappedVertices.push_back(vertex);
+					vertexCharts.push_back(i);
+				}
+				
+				unwrappedIndices[triangle*3 + k] = chartVertices[index];
+			}
+		}
+	}
+	
+	// pack charts, tallest first
+	std::vector<LightmapChart*> packed = charts;
+	
+	std::sort(packed.begin(), packed.end(), compareLightmapChartHeights);
+	
+	float area = 0;
+	
+	for(uint32_t i = 0; i < charts.size(); i++){
+		glm::vec2 size = charts[i]->upper - charts[i]->lower;
+		
+		area += size.x * size.y;
+	}
+	
+	// padding has to be LIGHTMAP_PADDING texels of the smallest square an object gets, but the square depends on the padding
+	// so keep packing until the padding is big enough (meshes with a huge number of charts may never get there, they'll just bleed a little)
+	float minimumPadding = (float)LIGHTMAP_PADDING / LIGHTMAP_MIN_OBJECT_SIZE;
+	float padding = sqrtf(area) * minimumPadding;
+	float extent = 0;
+	
+	for(uint32_t i = 0; i < 8; i++){
+		extent = packLightmapCharts(packed, padding);
+		
+		if(extent <= 0 || padding >= extent * minimumPadding) break;
+		
+		padding = extent * minimumPadding * 1.05f;
+	}
+	
+	// move every vertex to its chart's spot in the 0-1 range
+	if(extent > 0){
+		for(uint32_t i = 0; i < unwrappedVertices.size(); i++){
+			LightmapChart* chart = charts[vertexCharts[i]];
+			
+			unwrappedVertices[i].lightmapCoordinates = (unwrappedVertices[i].lightmapCoordinates - chart->lower + chart->position) / extent;
+		}
+	}
+	
+	for(uint32_t i = 0; i < charts.size(); i++){
+		delete charts[i];
+	}
+	
+	if(extent <= 0 || !setVertexDataVertices(data, unwrappedVertices, unwrappedIndices)) return 0;
+	
+	return extent;
+}
+
+// atlas packing //
+
+// an object's square of the atlas, in texels
+struct LightmapObject {
+	TexturedRenderableObject* object;
+	
+	glm::vec3 position; // world position, used to keep the packing order the same between runs
+	uint32_t size;
+	
+	uint32_t x;
+	uint32_t y;
+};
+
+// biggest first, ties broken by position so the same scene always packs the same way
+bool compareLightmapObjects(const LightmapObject& a, const LightmapObject& b){
+	if(a.size != b.size) return a.size > b.size;
+	if(a.position.x != b.position.x) return a.position.x < b.position.x;
+	if(a.position.y != b.position.y) return a.position.y < b.position.y;
+	
+	return a.position.z < b.position.z;
+}
+
+// pack objects into rows of an atlas with padding between them
+// returns false if they don't all fit
+bool packLightmapObjects(std::vector<LightmapObject>& objects, uint32_t atlasSize){
+	uint32_t x = LIGHTMAP_PADDING;
+	uint32_t y = LIGHTMAP_PADDING;
+	uint32_t rowHeight = 0;
+	
+	for(uint32_t i = 0; i < objects.size(); i++){
+		LightmapObject& object = objects[i];
+		
+		if(x + object.size + LIGHTMAP_PADDING > atlasSize){
+			x = LIGHTMAP_PADDING;
+			y += rowHeight + LIGHTMAP_PADDING;
+			rowHeight = 0;
+		}
+		
+		if(x + object.size + LIGHTMAP_PADDING > atlasSize || y + object.size + LIGHTMAP_PADDING > atlasSize) return false;
+		
+		object.x = x;
+		object.y = y;
+		
+		x += object.size + LIGHTMAP_PADDING;
+		rowHeight = std::max(rowHeight, object.size);
+	}
+	
+	return true;
+}
+
+// unwrap the vertex data of a scene's static objects and give each object a square of a size * size atlas (see TexturedRenderableObject::lightmapRect)
+// objects get LIGHTMAP_TEXELS_PER_UNIT if they fit, otherwise the density is lowered until they do
+// the layout only depends on the scene, so a lightmap baked for a scene can be read back into a lightmap created for the same scene later
+// returns NULL if the objects don't fit even at the smallest size
+Lightmap* createSceneLightmap(Scene* scene, uint32_t size){
+	// every object's lightmap rect changes
+	invalidateStaticDrawList(scene->staticDrawList);
+	
+	// unwrap every vertex data used by a visible object
+	std::vector<LightmapObject> objects;
+	std::vector<float> extents; // size of each object's vertex data's 0-1 range, in its own units
+	
+	for (std::map<VertexData*, std::vector<TexturedRenderableObject*>*>::iterator it = scene->staticObjects->begin(); it != scene->staticObjects->end(); it++){
+		if(!it->second) continue;
+		
+		float extent = -1;
+		
+		for(uint32_t i = 0; i < it->second->size(); i++){
+			TexturedRenderableObject* object = it->second->at(i);
+			
+			if(!object || !object->visible) continue;
+			
+			object->lightmapRect = glm::vec4(0);
+			
+			// unwrap on first use
+			if(extent < 0) extent = unwrapLightmapCoordinates(it->first);
+			
+			if(extent <= 0) break;
+			
+			Transform* transform = object->renderableObject->transform;
+			glm::vec3 scale = glm::abs(getTransformWorldScale(transform));
+			
+			LightmapObject lightmapObject;
+			
+			lightmapObject.object = object;
+			lightmapObject.position = getTransformWorldPosition(transform);
+			lightmapObject.size = 0;
+			lightmapObject.x = 0;
+			lightmapObject.y = 0;
+			
+			objects.push_back(lightmapObject);
+			extents.push_back(extent * std::max(scale.x, std::max(scale.y, scale.z)));
+		}
+	}
+	
+	// pack, lowering the density until everything fits
+	float texelsPerUnit = LIGHTMAP_TEXELS_PER_UNIT;
+	uint32_t maxObjectSize = size - 2*LIGHTMAP_PADDING;
+	bool fits = false;
+	
+	while(!fits){
+		bool smallest = true;
+		
+		for(uint32_t i = 0; i < objects.size(); i++){
+			float objectSize = ceilf(extents[i] * texelsPerUnit);
+			
+			objects[i].size = (uint32_t)glm::clamp(objectSize, (float)LIGHTMAP_MIN_OBJECT_SIZE, (float)maxObjectSize);
+			
+			if(objects[i].size > LIGHTMAP_MIN_OBJECT_SIZE) smallest = false;
+		}
+		
+		std::vector<LightmapObject> sorted = objects;
+		
+		std::sort(sorted.begin(), sorted.end(), compareLightmapObjects);
+		
+		fits = packLightmapObjects(sorted, size);
+		
+		if(fits){
+			objects = sorted;
+		} else if(smallest){
+			printf("Couldn't fit %d objects into a %dx%d lightmap\n", (int32_t)objects.size(), size, size);
+			
+			return NULL;
+		} else {
+			texelsPerUnit *= 0.8f;
+		}
+	}
+	
+	// point each object at its square
+	for(uint32_t i = 0; i < objects.size(); i++){
+		LightmapObject& object = objects[i];
+		
+		object.object->lightmapRect = glm::vec4(glm::vec2((float)object.size / size), glm::vec2(object.x, object.y) / (float)size);
+	}
+	
+	Lightmap* lightmap = allocateMemoryForType<Lightmap>();
+	
+	lightmap->size = size;
+	lightmap->texelsPerUnit = texelsPerUnit;
+	lightmap->texels = new std::vector<glm::vec3>(size * size, glm::vec3(0));
+	lightmap->texture = 0;
+	
+	return lightmap;
+}
+
+// ray tracing //
+
+// triangle index and the centroid coordinate it's split by while building the bvh
+struct LightmapBvhEntry {
+	uint32_t triangle;
+	glm::vec3 centroid;
+	float key;
+};
+
+bool compareLightmapBvhEntries(const LightmapBvhEntry& a, const LightmapBvhEntry& b){
+	return a.key < b.key;
+}
+
+// fill in a bvh node for entries [first, first + count), splitting it at the median centroid of its longest axis until the leaves are small enough
+void buildLightmapBvhNode(std::vector<LightmapBvhNode>& nodes, std::vector<LightmapTriangle>& triangles, std::vector<LightmapBvhEntry>& entries, uint32_t node, uint32_t first, uint32_t count){
+	glm::vec3 lower = glm::vec3(HUGE_VALF);
+	glm::vec3 upper = glm::vec3(-HUGE_VALF);
+	glm::vec3 centroidLower = glm::vec3(HUGE_VALF);
+	glm::vec3 centroidUpper = glm::vec3(-HUGE_VALF);
+	
+	for(uint32_t i = first; i < first + count; i++){
+		LightmapTriangle& triangle = triangles[entries[i].triangle];
+		
+		lower = glm::min(lower, glm::min(triangle.v0, glm::min(triangle.v0 + triangle.e1, triangle.v0 + triangle.e2)));
+		upper = glm::max(upper, glm::max(triangle.v0, glm::max(triangle.v0 + triangle.e1, triangle.v0 + triangle.e2)));
+		
+		centroidLower = glm::min(centroidLower, entries[i].centroid);
+		centroidUpper = glm::max(centroidUpper, entries[i].centroid);
+	}
+	
+	nodes[node].lower = lower;
+	nodes[node].upper = upper;
+	
+	// split along the longest axis, unless the node is small enough or every centroid is in the same spot
+	glm::vec3 extent = centroidUpper - centroidLower;
+	uint32_t axis = extent.x > extent.y ? (extent.x > extent.z ? 0 : 2) : (extent.y > extent.z ? 1 : 2);
+	
+	if(count <= LIGHTMAP_BVH_LEAF_SIZE || extent[axis] <= 0){
+		nodes[node].first = first;
+		nodes[node].count = count;
+		
+		return;
+	}
+	
+	for(uint32_t i = first; i < first + count; i++){
+		entries[i].key = entries[i].centroid[axis];
+	}
+	
+	uint32_t half = count / 2;
+	
+	std::nth_element(entries.begin() + first, entries.begin() + first + half, entries.begin() + first + count, compareLightmapBvhEntries);
+	
+	// children are next to each other
+	uint32_t children = nodes.size();
+	
+	nodes[node].first = children;
+	nodes[node].count = 0;
+	
+	nodes.resize(nodes.size() + 2);
+	
+	buildLightmapBvhNode(nodes, triangles, entries, children, first, half);
+	buildLightmapBvhNode(nodes, triangles, entries, children + 1, first + half, count - half);
+}
+
+// build a bvh over triangles, reordering them so each leaf's triangles are next to each other
+void buildLightmapBvh(std::vector<LightmapBvhNode>& nodes, std::vector<LightmapTriangle>& triangles){
+	nodes.clear();
+	
+	if(triangles.size() == 0) return;
+	
+	std::vector<LightmapBvhEntry> entries(triangles.size());
+	
+	for(uint32_t i = 0; i < triangles.size(); i++){
+		LightmapTriangle& triangle = triangles[i];
+		
+		entries[i].triangle = i;
+		entries[i].centroid = triangle.v0 + (triangle.e1 + triangle.e2) / 3.0f;
+		entries[i].key = 0;
+	}
+	
+	nodes.resize(1);
+	
+	buildLightmapBvhNode(nodes, triangles, entries, 0, 0, triangles.size());
+	
+	std::vector<LightmapTriangle> ordered(triangles.size());
+	
+	for(uint32_t i = 0; i < entries.size(); i++){
+		ordered[i] = triangles[entries[i].triangle];
+	}
+	
+	triangles = ordered;
+}
+
+// check if a ray (with precomputed 1 / direction) enters a box before maxDistance
+bool isLightmapRayHittingBox(glm::vec3& origin, glm::vec3& inverseDirection, float maxDistance, glm::vec3& lower, glm::vec3& upper){
+	float near = 0;
+	float far = maxDistance;
+	
+	for(uint32_t i = 0; i < 3; i++){
+		float t0 = (lower[i] - origin[i]) * inverseDirection[i];
+		float t1 = (upper[i] - origin[i]) * inverseDirection[i];
+		
+		if(t0 > t1) std::swap(t0, t1);
+		
+		// comparisons written so nans (0 * inf) leave the range alone
+		if(t0 > near) near = t0;
+		if(t1 < far) far = t1;
+		
+		if(near > far) return false;
+	}
+	
+	return true;
+}
+
+// check if a ray hits a triangle (from either side) before maxDistance (moller-trumbore)
+bool isLightmapRayHittingTriangle(glm::vec3& origin, glm::vec3& direction, float maxDistance, LightmapTriangle& triangle){
+	glm::vec3 p = glm::cross(direction, triangle.e2);
+	float determinant = glm::dot(triangle.e1, p);
+	
+	// parallel
+	if(fabsf(determinant) < 1.0e-12f) return false;
+	
+	float inverseDeterminant = 1.0f / determinant;
+	
+	glm::vec3 t = origin - triangle.v0;
+	float u = glm::dot(t, p) * inverseDeterminant;
+	
+	if(u < 0 || u > 1) return false;
+	
+	glm::vec3 q = glm::cross(t, triangle.e1);
+	float v = glm::dot(direction, q) * inverseDeterminant;
+	
+	if(v < 0 || u + v > 1) return false;
+	
+	float distance = glm::dot(triangle.e2, q) * inverseDeterminant;
+	
+	return distance > 0 && distance < maxDistance;
+}
+
+// check if anything is between origin and origin + direction * maxDistance
+bool isLightmapRayOccluded(std::vector<LightmapBvhNode>& nodes, std::vector<LightmapTriangle>& triangles, glm::vec3 origin, glm::vec3 direction, float maxDistance){
+	if(nodes.size() == 0) return false;
+	
+	glm::vec3 inverseDirection = 1.0f / direction;
+	
+	uint32_t stack[64];
+	uint32_t stackSize = 0;
+	
+	stack[stackSize++] = 0;
+	
+	while(stackSize > 0){
+		LightmapBvhNode& node = nodes[stack[--stackSize]];
+		
+		if(!isLightmapRayHittingBox(origin, inverseDirection, maxDistance, node.lower, node.upper)) continue;
+		
+		if(node.count > 0){
+			for(uint32_t i = node.first; i < node.first + node.count; i++){
+				if(isLightmapRayHittingTriangle(origin, direction, maxDistance, triangles[i])) return true;
+			}
+		} else {
+			stack[stackSize++] = node.first;
+			stack[stackSize++] = node.first + 1;
+		}
+	}
+	
+	return false;
+}
+
+// baking //
+
+// an object to bake, with everything the worker threads need so they never touch the scene
+struct LightmapBakeObject {
+	VertexData* vertexData;
+	
+	glm::mat4 model;
+	glm::mat3 normalMatrix;
+	
+	// square of the atlas, in texels
+	uint32_t x;
+	uint32_t y;
+	uint32_t size;
+	
+	// world space bounds, to find the lights that reach it
+	glm::vec3 lower;
+	glm::vec3 upper;
+};
+
+// a band of rows of an object
+struct LightmapBakeTask {
+	uint32_t object;
+	uint32_t firstRow;
+	uint32_t rowCount;
+};
+
+// everything shared by the threads of a bake
+// tasks are handed out one at a time, and since tasks don't share texels the threads never write to the same place
+struct LightmapBake {
+	Lightmap* lightmap;
+	
+	std::vector<LightmapBakeObject> objects;
+	std::vector<LightmapBakeTask> tasks;
+	std::vector<LightmapTriangle> triangles;
+	std::vector<LightmapBvhNode> nodes;
+	std::vector<PointLight*> lights;
+	
+	std::vector<uint8_t> covered; // if each texel of the atlas was covered by a triangle
+	
+	std::atomic<uint32_t> nextTask;
+};
+
+// find the surface under each texel of a band of an object's square by rasterizing its triangles in lightmap space
+void rasterizeLightmapObject(LightmapBakeObject& object, uint32_t firstRow, uint32_t rowCount, std::vector<LightmapSample>& samples){
+	samples.assign(object.size * rowCount, (LightmapSample){glm::vec3(0), glm::vec3(0), false});
+	
+	std::vector<Vertex>& vertices = *object.vertexData->vertices;
+	std::vector<uint32_t>& indices = *object.vertexData->indices;
+	
+	for(uint32_t i = 0; i + 2 < indices.size(); i += 3){
+		glm::vec2 texel[3];
+		glm::vec3 position[3];
+		glm::vec3 normal[3];
+		
+		for(uint32_t j = 0; j < 3; j++){
+			Vertex& vertex = vertices[indices[i + j]];
+			
+			// texel centers land on whole numbers
+			texel[j] = vertex.lightmapCoordinates * (float)object.size - 0.5f;
+			position[j] = glm::vec3(object.model * glm::vec4(vertex.position, 1));
+			normal[j] = object.normalMatrix * vertex.normal;
+		}
+		
+		float area = (texel[1].x - texel[0].x) * (texel[2].y - texel[0].y) - (texel[2].x - texel[0].x) * (texel[1].y - texel[0].y);
+		
+		if(fabsf(area) < 1.0e-12f) continue;
+		
+		glm::vec2 lower = glm::max(glm::floor(glm::min(texel[0], glm::min(texel[1], texel[2]))), glm::vec2(0, firstRow));
+		glm::vec2 upper = glm::min(glm::ceil(glm::max(texel[0], glm::max(texel[1], texel[2]))), glm::vec2(object.size - 1, firstRow + rowCount - 1));
+		
+		for(int32_t y = (int32_t)lower.y; y <= (int32_t)upper.y; y++){
+			for(int32_t x = (int32_t)lower.x; x <= (int32_t)upper.x; x++){
+				glm::vec2 point = glm::vec2(x, y);
+				
+				// barycentric coordinates
+				float w0 = ((texel[1].x - point.x) * (texel[2].y - point.y) - (texel[2].x - point.x) * (texel[1].y - point.y)) / area;
+				float w1 = ((texel[2].x - point.x) * (texel[0].y - point.y) - (texel[0].x - point.x) * (texel[2].y - point.y)) / area;
+				float w2 = 1.0f - w0 - w1;
+				
+				if(w0 < -1.0e-4f || w1 < -1.0e-4f || w2 < -1.0e-4f) continue;
+				
+				LightmapSample& sample = samples[(y - firstRow) * object.size + x];
+				
+				sample.position = w0 * position[0] + w1 * position[1] + w2 * position[2];
+				sample.normal = glm::normalize(w0 * normal[0] + w1 * normal[1] + w2 * normal[2]);
+				sample.valid = true;
+			}
+		}
+	}
+}
+
+// diffuse light reaching a surface from lights, with shadows
+// the same as calculatePointLightContribution in lighting/fragment.glsl, so baked and dynamic lighting match (apart from the shadows)
+glm::vec3 calculateLightmapSample(LightmapBake* bake, std::vector<PointLight*>& lights, LightmapSample& sample){
+	glm::vec3 light = glm::vec3(0);
+	
+	glm::vec3 origin = sample.position + sample.normal * LIGHTMAP_SHADOW_BIAS;
+	
+	for(uint32_t i = 0; i < lights.size(); i++){
+		PointLight* pointLight = lights[i];
+		
+		glm::vec3 lightRay = pointLight->position - sample.position;
+		float distance = glm::length(lightRay);
+		
+		if(distance > pointLight->radius || distance <= 0) continue;
+		
+		float diffuse = std::max(glm::dot(sample.normal, lightRay / distance), 0.0f);
+		
+		if(diffuse <= 0) continue;
+		
+		// shadow
+		glm::vec3 shadowRay = pointLight->position - origin;
+		float shadowDistance = glm::length(shadowRay);
+		
+		if(isLightmapRayOccluded(bake->nodes, bake->triangles, origin, shadowRay / shadowDistance, shadowDistance)) continue;
+		
+		float attenuation = 1 / (pointLight->c + pointLight->l * distance + pointLight->q * distance * distance);
+		
+		light += pointLight->color * pointLight->diffuseStrength * diffuse * attenuation;
+	}
+	
+	return light;
+}
+
+// bake tasks until there are none left, run by every thread of a bake
+void bakeLightmapTasks(LightmapBake* bake){
+	Lightmap* lightmap = bake->lightmap;
+	
+	std::vector<LightmapSample> samples;
+	std::vector<PointLight*> lights;
+	
+	while(true){
+		uint32_t index = bake->nextTask++;
+		
+		if(index >= bake->tasks.size()) return;
+		
+		LightmapBakeTask& task = bake->tasks[index];
+		LightmapBakeObject& object = bake->objects[task.object];
+		
+		// only the lights that reach the object's bounds
+		lights.clear();
+		
+		for(uint32_t i = 0; i < bake->lights.size(); i++){
+			PointLight* light = bake->lights[i];
+			
+			glm::vec3 closest = glm::clamp(light->position, object.lower, object.upper);
+			
+			if(glm::distance(closest, light->position) <= light->radius) lights.push_back(light);
+		}
+		
+		rasterizeLightmapObject(object, task.firstRow, task.rowCount, samples);
+		
+		for(uint32_t y = 0; y < task.rowCount; y++){
+			for(uint32_t x = 0; x < object.size; x++){
+				LightmapSample& sample = samples[y * object.size + x];
+				
+				if(!sample.valid) continue;
+				
+				uint32_t texel = (object.y + task.firstRow + y) * lightmap->size + object.x + x;
+				
+				lightmap->texels->at(texel) = calculateLightmapSample(bake, lights, sample);
+				bake->covered[texel] = 1;
+			}
+		}
+	}
+}
+
+// spread covered texels into the empty texels around them, so bilinear filtering at the edge of a chart doesn't blend in black
+void dilateLightmap(Lightmap* lightmap, std::vector<uint8_t>& covered, uint32_t passes){
+	int32_t size = lightmap->size;
+	std::vector<glm::vec3>& texels = *lightmap->texels;
+	
+	std::vector<uint8_t> nextCovered;
+	
+	for(uint32_t pass = 0; pass < passes; pass++){
+		nextCovered = covered;
+		
+		for(int32_t y = 0; y < size; y++){
+			for(int32_t x = 0; x < size; x++){
+				if(covered[y * size + x]) continue;
+				
+				glm::vec3 sum = glm::vec3(0);
+				uint32_t count = 0;
+				
+				int32_t offsets[4][2] = {{-1, 0}, {1, 0}, {0, -1}, {0, 1}};
+				
+				for(uint32_t i = 0; i < 4; i++){
+					int32_t nx = x + offsets[i][0];
+					int32_t ny = y + offsets[i][1];
+					
+					if(nx < 0 || ny < 0 || nx >= size || ny >= size || !covered[ny * size + nx]) continue;
+					
+					sum += texels[ny * size + nx];
+					count++;
+				}
+				
+				if(count == 0) continue;
+				
+				texels[y * size + x] = sum / (float)count;
+				nextCovered[y * size + x] = 1;
+			}
+		}
+		
+		covered.swap(nextCovered);
+	}
+}
+
+// trace the direct lighting of every packed object of a scene into its lightmap (see createSceneLightmap)
+// bands of objects are split between threadCount threads (0 for every core), each object's texels are found by rasterizing it into the atlas
+// and lit by every light that reaches it, with a shadow ray through a bvh of the whole scene
+void bakeSceneLightmap(Scene* scene, Lightmap* lightmap, uint32_t threadCount){
+	LightmapBake* bake = new LightmapBake();
+	
+	bake->lightmap = lightmap;
+	bake->covered.assign(lightmap->size * lightmap->size, 0);
+	bake->nextTask = 0;
+	
+	// copy out everything the threads need, and put every triangle in world space
+	for (std::map<VertexData*, std::vector<TexturedRenderableObject*>*>::iterator it = scene->staticObjects->begin(); it != scene->staticObjects->end(); it++){
+		if(!it->second) continue;
+		
+		for(uint32_t i = 0; i < it->second->size(); i++){
+			TexturedRenderableObject* object = it->second->at(i);
+			
+			if(!object || !object->visible || object->lightmapRect.x <= 0) continue;
+			
+			LightmapBakeObject bakeObject;
+			
+			bakeObject.vertexData = it->first;
+			bakeObject.model = getTransformWorldMatrix(object->renderableObject->transform);
+			bakeObject.normalMatrix = getTransformNormalMatrix(object->renderableObject->transform);
+			bakeObject.x = (uint32_t)roundf(object->lightmapRect.z * lightmap->size);
+			bakeObject.y = (uint32_t)roundf(object->lightmapRect.w * lightmap->size);
+			bakeObject.size = (uint32_t)roundf(object->lightmapRect.x * lightmap->size);
+			bakeObject.lower = glm::vec3(HUGE_VALF);
+			bakeObject.upper = glm::vec3(-HUGE_VALF);
+			
+			std::vector<Vertex>& vertices = *it->first->vertices;
+			std::vector<uint32_t>& indices = *it->first->indices;
+			
+			for(uint32_t j = 0; j + 2 < indices.size(); j += 3){
+				glm::vec3 v0 = glm::vec3(bakeObject.model * glm::vec4(vertices[indices[j]].position, 1));
+				glm::vec3 v1 = glm::vec3(bakeObject.model * glm::vec4(vertices[indices[j + 1]].position, 1));
+				glm::vec3 v2 = glm::vec3(bakeObject.model * glm::vec4(vertices[indices[j + 2]].position, 1));
+				
+				bakeObject.lower = glm::min(bakeObject.lower, glm::min(v0, glm::min(v1, v2)));
+				bakeObject.upper = glm::max(bakeObject.upper, glm::max(v0, glm::max(v1, v2)));
+				
+				bake->triangles.push_back( (LightmapTriangle){v0, v1 - v0, v2 - v0} );
+			}
+			
+			// split the object into bands
+			for(uint32_t row = 0; row < bakeObject.size; row += LIGHTMAP_BAKE_ROWS){
+				bake->tasks.push_back( (LightmapBakeTask){(uint32_t)bake->objects.size(), row, std::min(bakeObject.size - row, (uint32_t)LIGHTMAP_BAKE_ROWS)} );
+			}
+			
+			bake->objects.push_back(bakeObject);
+		}
+	}
+	
+	for(uint32_t i = 0; i < scene->pointLights->size(); i++){
+		if(scene->pointLights->at(i) != NULL) bake->lights.push_back(scene->pointLights->at(i));
+	}
+	
+	buildLightmapBvh(bake->nodes, bake->triangles);
+	
+	// the calling thread does its share of the work too
+	if(threadCount == 0) threadCount = std::max(std::thread::hardware_concurrency(), 1u);
+	
+	std::fill(lightmap->texels->begin(), lightmap->texels->end(), glm::vec3(0));
+	
+	std::vector<std::thread> workers;
+	
+	for(uint32_t i = 1; i < threadCount; i++){
+		workers.push_back(std::thread(bakeLightmapTasks, bake));
+	}
+	
+	bakeLightmapTasks(bake);
+	
+	for(uint32_t i = 0; i < workers.size(); i++){
+		workers[i].join();
+	}
+	
+	dilateLightmap(lightmap, bake->covered, LIGHTMAP_PADDING);
+	
+	printf("Baked %d objects (%d triangles, %d lights) into a %dx%d lightmap with %d threads\n", (int32_t)bake->objects.size(), (int32_t)bake->triangles.size(), (int32_t)bake->lights.size(), lightmap->size, lightmap->size, threadCount);
+	
+	delete bake;
+}
+
+// files //
+
+// write a lightmap as a radiance .hdr file
+// scanlines use the run length encoded format, with every run written as literals
+bool writeLightmap(Lightmap* lightmap, const char* path){
+	FILE* file = fopen(path, "wb");
+	
+	if(!file){
+		printf("Couldn't open %s for writing\n", path);
+		
+		return false;
+	}
+	
+	uint32_t size = lightmap->size;
+	
+	fprintf(file, "#?RADIANCE\nFORMAT=32-bit_rle_rgbe\n\n-Y %d +X %d\n", size, size);
+	
+	std::vector<uint8_t> channels(size * 4);
+	
+	// first row of the file is the top of the image
+	for(uint32_t row = 0; row < size; row++){
+		uint32_t y = size - 1 - row;
+		
+		// shared exponent
+		for(uint32_t x = 0; x < size; x++){
+			glm::vec3& texel = lightmap->texels->at(y * size + x);
+			
+			float largest = std::max(texel.r, std::max(texel.g, texel.b));
+			
+			if(largest < 1.0e-32f){
+				channels[x] = channels[size + x] = channels[2*size + x] = channels[3*size + x] = 0;
+				
+				continue;
+			}
+			
+			int32_t exponent = 0;
+			float scale = frexpf(largest, &exponent) * 256.0f / largest;
+			
+			channels[x] = (uint8_t)(std::max(texel.r, 0.0f) * scale);
+			channels[size + x] = (uint8_t)(std::max(texel.g, 0.0f) * scale);
+			channels[2*size + x] = (uint8_t)(std::max(texel.b, 0.0f) * scale);
+			channels[3*size + x] = (uint8_t)(exponent + 128);
+		}
+		
+		uint8_t header[4] = {2, 2, (uint8_t)(size >> 8), (uint8_t)(size & 0xFF)};
+		
+		fwrite(header, 1, 4, file);
+		
+		// each channel in runs of up to 128 literals
+		for(uint32_t channel = 0; channel < 4; channel++){
+			for(uint32_t x = 0; x < size; x += 128){
+				uint8_t count = (uint8_t)std::min(size - x, 128u);
+				
+				fwrite(&count, 1, 1, file);
+				fwrite(&channels[channel*size + x], 1, count, file);
+			}
+		}
+	}
+	
+	fclose(file);
+	
+	return true;
+}
+
+// read a lightmap written by writeLightmap
+// the file has to be the same size as the lightmap, otherwise it was baked for a different layout
+bool readLightmap(Lightmap* lightmap, const char* path){
+	int32_t width = 0;
+	int32_t height = 0;
+	int32_t channels = 0;
+	
+	stbi_set_flip_vertically_on_load(true); // rows start at the bottom, like the lightmap's
+	
+	float* data = stbi_loadf(path, &width, &height, &channels, 3);
+	
+	if(!data){
+		printf("Couldn't read lightmap %s\n", path);
+		
+		return false;
+	}
+	
+	if(width != (int32_t)lightmap->size || height != (int32_t)lightmap->size){
+		printf("Lightmap %s is %dx%d, expected %dx%d (was it baked for a different scene?)\n", path, width, height, lightmap->size, lightmap->size);
+		
+		stbi_image_free(data);
+		
+		return false;
+	}
+	
+	for(uint32_t i = 0; i < lightmap->size * lightmap->size; i++){
+		lightmap->texels->at(i) = glm::vec3(data[i*3], data[i*3 + 1], data[i*3 + 2]);
+	}
+	
+	stbi_image_free(data);
+	
+	return true;
+}
+
+// copy a lightmap's texels into its texture, creating it on first use
+bool uploadLightmap(Lightmap* lightmap){
+	if(lightmap->texture == 0){
+		glGenTextures(1, &lightmap->texture);
+		
+		if(lightmap->texture == 0) return false;
+	}
+	
+	bindGlTexture(LIGHTMAP_TEXTURE_UNIT, GL_TEXTURE_2D, lightmap->texture);
+	
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB16F, lightmap->size, lightmap->size, 0, GL_RGB, GL_FLOAT, &lightmap->texels->at(0));
+	
+	// no mipmaps, lower levels would blend charts together
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	
+	return true;
+}
+
+// bind a lightmap to its reserved texture unit
+void bindLightmap(Lightmap* lightmap){
+	bindGlTexture(LIGHTMAP_TEXTURE_UNIT, GL_TEXTURE_2D, lightmap->texture);
+}
\ No newline at end of file
@@ -1,6 +1,11 @@
 // remaster of the virtual museum I made for history about a year ago
 
 #include <engine.h>
+#include <glbackend.h>
+#include <programcache.h>
+#include <renderer.h>
+#include <renderthread.h>
+#include <textureloader.h>
 #include <world.h>
 
 #include <cstdio>
@@ -26,6 +31,9 @@ int main(int argc, char** argv){
 		exit(EXIT_FAILURE);
 	}
 	
+	// for time to first frame
+	double startTime = glfwGetTime();
+	
 	// create render window
 	printf("Creating window...");
 	
@@ -39,15 +47,77 @@ int main(int argc, char** argv){
 	float xSensitivity = 0.5f;
 	float ySensitivity = 0.5f;
 	
-	Window* window = createWindow(screenWidth, screenHeight, "Virtual Museum Remastered");
+	// run without a window or gpu (--headless), with the camera left where the world puts it
+	// gl calls go to the recording backend (or the null backend with --gl-backend null), and the run fails unless every frame was cleared and drawn
+	bool headless = false;
 	
-	// make sure it exists
-	if(window == NULL){
-		printf("\nThere was an error creating the render window\n");
-		exit(EXIT_FAILURE);
+	// frames to run before exiting (--frames), 0 to run until the window is closed
+	uint32_t frameLimit = 0;
+	
+	// keep every gl call the recording backend sees with its arguments, and print them on exit (--gl-log)
+	bool logGlCalls = false;
+	
+	// draw frames on the cpu instead of with gl (--software), which doesn't need a window or gpu either
+	// frames are never presented, only written to softwareImagePath if it's set (--software-image)
+	bool useSoftwareRenderer = false;
+	
+	// send gl calls to the null or recording backend instead of the driver (--gl-backend null/recording), has to be picked before the window loads gl
+	// nothing is drawn with the null backend, so the frame rate is what the cpu side costs, the recording backend prints the calls per frame on exit
+	for(uint32_t i = 1; i < argc; i++){
+		std::string argument = std::string(argv[i]);
+		
+		if(argument == "--headless") headless = true;
+		if(argument == "--gl-log") logGlCalls = true;
+		if(argument == "--software") useSoftwareRenderer = true;
+		if(argument == "--frames" && i + 1 < argc) frameLimit = atoi(argv[i + 1]);
+		
+		if(argument != "--gl-backend" || i + 1 >= argc) continue;
+		
+		if(std::string(argv[i + 1]) == "null") setGlBackend(GL_BACKEND_NULL);
+		if(std::string(argv[i + 1]) == "recording") setGlBackend(GL_BACKEND_RECORDING);
 	}
 	
-	initMouseManager(window, xSensitivity, ySensitivity);
+	Window* window = NULL;
+	
+	if(headless || useSoftwareRenderer){
+		// the calls have to be counted to check the frames, the software rasterizer makes none so they're just dropped
+		if(getGlBackend() == GL_BACKEND_REAL) setGlBackend(useSoftwareRenderer ? GL_BACKEND_NULL : GL_BACKEND_RECORDING);
+		
+		initHeadlessGraphics(screenWidth, screenHeight);
+		
+		// nothing else would stop it
+		if(frameLimit == 0) frameLimit = 100;
+	} else {
+		window = createWindow(screenWidth, screenHeight, "Virtual Museum Remastered");
+		
+		// make sure it exists
+		if(window == NULL){
+			printf("\nThere was an error creating the render window\n");
+			exit(EXIT_FAILURE);
+		}
+		
+		initMouseManager(window, xSensitivity, ySensitivity);
+	}
+	
+	// load linked programs from the program cache instead of compiling them (unless --no-program-cache is passed)
+	// looked for ahead of the other options, since shaders are loaded before those are read
+	bool useProgramCache = true;
+	
+	// decode textures on worker threads while the rest of the scene loads, uploading them once frames are being drawn (unless --no-async-textures is passed)
+	// also looked for ahead of the other options, since textures are requested while worlds are read
+	bool asyncTextures = true;
+	
+	for(uint32_t i = 1; i < argc; i++){
+		if(std::string(argv[i]) == "--no-program-cache") useProgramCache = false;
+		if(std::string(argv[i]) == "--no-async-textures") asyncTextures = false;
+	}
+	
+	if(useProgramCache) openProgramCache(DEFAULT_PROGRAM_CACHE_PATH);
+	
+	// the software rasterizer draws from the decoded images, since there's no gl to read the textures back from
+	if(useSoftwareRenderer) setTextureImageRetention(true);
+	
+	if(asyncTextures) startTextureLoader(0);
 	
 	printf("Done\nLoading shaders...");
 	
@@ -72,11 +142,17 @@ int main(int argc, char** argv){
 	
 	//ShaderProgramEx* textureTestShader = createShaderProgramEx(textureTestVs, textureTestFs, true);
 	
-	// lighting shader
-	uint32_t lightingVs = createShader(GL_VERTEX_SHADER, "./res/shader/lighting/vertex.glsl");
-	uint32_t lightingFs = createShader(GL_FRAGMENT_SHADER, "./res/shader/lighting/fragment.glsl");
+	// lighting shaders, every variant the scene can draw with is compiled now (see permutation.h)
+	ShaderPermutations* lightingShaders = createShaderPermutations("./res/shader/lighting/vertex.glsl", "./res/shader/lighting/fragment.glsl");
+	
+	precompileShaderPermutations(lightingShaders, 0);
+	precompileShaderPermutations(lightingShaders, SHADER_FEATURE_INSTANCED);
+	
+	// the draw functions switch to the texture mode each material needs
+	ShaderProgramEx* lightingShader = getShaderPermutation(lightingShaders, 0, SHADER_TEXTURED);
 	
-	ShaderProgramEx* lightingShader = createShaderProgramEx(lightingVs, lightingFs, true);
+	// instanced lighting shader (instance attributes in place of per-object uniforms)
+	ShaderProgramEx* instancedLightingShader = getShaderPermutation(lightingShaders, SHADER_FEATURE_INSTANCED, SHADER_TEXTURED);
 	
 	// load sounds
 	printf("Done\nLoading sounds...");
@@ -102,42 +178,322 @@ int main(int argc, char** argv){
 	// parse world
 	Scene* scene = createScene(window, player);
 	
+	// render mode (instanced unless the instanced shader failed to load)
+	SceneRenderMode renderMode = instancedLightingShader ? RENDER_INSTANCED : RENDER_PER_OBJECT;
+	
+	// deferred shading (forward unless --deferred is passed)
+	bool deferredShading = false;
+	
+	// lay down depth before shading (off unless --depth-prepass is passed)
+	bool useDepthPrepass = false;
+	
+	// show how many times each pixel gets shaded instead of the lit scene (off unless --overdraw is passed)
+	bool showOverdraw = false;
+	
+	// pack textures into texture arrays so objects with different textures can share draw calls (unless --no-texture-arrays is passed)
+	bool useTextureArrays = true;
+	
+	// if render stats should be printed to the console (once a second)
+	bool printStats = false;
+	
+	// draw frames on their own thread while the next one is simulated (unless --no-render-thread is passed)
+	bool useRenderThread = true;
+	
+	// extra random lights to add to the scene, for benchmarking
+	uint32_t extraLights = 0;
+	
+	// lightmap to bake the scene's lights into and exit (--bake-lightmap), or to light the scene with instead of its lights (--lightmap)
+	const char* bakeLightmapPath = NULL;
+	const char* lightmapPath = NULL;
+	
+	// threads to bake with, 0 for every core
+	uint32_t bakeThreads = 0;
+	
+	// gpu ms per frame to scale the resolution down to hold (--target-frame-ms), 0 to always render at full resolution
+	float targetFrameMs = 0.0f;
+	
+	// threads the software rasterizer draws with (0 for every core), and where it writes its frames
+	uint32_t softwareThreads = 0;
+	const char* softwareImagePath = NULL;
+	
 	// load any world/walkmap files from arguments
+	// arguments starting with -- are options instead
 	for(uint32_t i = 1; i < argc; i++){
-		parseWorldIntoScene(scene, argv[i]);
+		std::string argument = std::string(argv[i]);
+		
+		if(argument == "--per-object"){
+			renderMode = RENDER_PER_OBJECT;
+		} else if(argument == "--instanced" && instancedLightingShader){
+			renderMode = RENDER_INSTANCED;
+		} else if(argument == "--multi-draw" && instancedLightingShader){
+			renderMode = RENDER_MULTI_DRAW;
+		} else if(argument == "--no-multi-draw-indirect"){
+			setMultiDrawIndirect(false);
+		} else if(argument == "--batched"){
+			renderMode = RENDER_BATCHED;
+		} else if(argument == "--deferred"){
+			deferredShading = true;
+		} else if(argument == "--depth-prepass"){
+			useDepthPrepass = true;
+		} else if(argument == "--front-to-back"){
+			setFrontToBackSorting(true);
+		} else if(argument == "--overdraw"){
+			showOverdraw = true;
+		} else if(argument == "--no-texture-arrays"){
+			useTextureArrays = false;
+		} else if(argument == "--no-mesh-pool"){
+			// only affects worlds listed after it
+			setMeshPoolEnabled(false);
+		} else if(argument == "--no-box-faces"){
+			setBoxFaceOptimization(false);
+		} else if(argument == "--no-persistent-mapping"){
+			setStreamBufferPersistentMapping(false);
+		} else if(argument == "--stats"){
+			printStats = true;
+		} else if(argument == "--no-render-thread"){
+			useRenderThread = false;
+		} else if(argument == "--no-program-cache"){
+			// already handled before loading shaders
+		} else if(argument == "--no-async-textures"){
+			// already handled before loading shaders
+		} else if(argument == "--gl-backend" && i + 1 < argc){
+			// already handled before creating the window
+			i++;
+		} else if(argument == "--headless" || argument == "--gl-log"){
+			// already handled before creating the window
+		} else if(argument == "--frames" && i + 1 < argc){
+			// already handled before creating the window
+			i++;
+		} else if(argument == "--no-state-cache"){
+			setGlStateCaching(false);
+		} else if(argument == "--lights" && i + 1 < argc){
+			extraLights = atoi(argv[++i]);
+		} else if(argument == "--bake-lightmap" && i + 1 < argc){
+			bakeLightmapPath = argv[++i];
+		} else if(argument == "--lightmap" && i + 1 < argc){
+			lightmapPath = argv[++i];
+		} else if(argument == "--bake-threads" && i + 1 < argc){
+			bakeThreads = atoi(argv[++i]);
+		} else if(argument == "--target-frame-ms" && i + 1 < argc){
+			targetFrameMs = atof(argv[++i]);
+		} else if(argument == "--software"){
+			// already handled before creating the window
+		} else if(argument == "--software-threads" && i + 1 < argc){
+			softwareThreads = atoi(argv[++i]);
+		} else if(argument == "--software-image" && i + 1 < argc){
+			softwareImagePath = argv[++i];
+		} else {
+			parseWorldIntoScene(scene, argv[i]);
+		}
 	}
 	
 	/*for(uint32_t i = 0; i < scene->pointLights->size(); i++){
 		printf("%f, %f, %f\n", scene->pointLights->at(i)->color.x, scene->pointLights->at(i)->color.y, scene->pointLights->at(i)->color.z);
 	}*/
 	
+	if(extraLights > 0) addRandomPointLights(scene, extraLights);
+	
+	// the software rasterizer draws the packet's instances, with every texture's own image
+	if(useSoftwareRenderer){
+		renderMode = RENDER_INSTANCED;
+		useTextureArrays = false;
+	}
+	
+	// lightmaps have to be laid out before anything copies the scene's vertices (batching)
+	if(bakeLightmapPath || lightmapPath){
+		printf("Done\nUnwrapping lightmap...");
+		
+		Lightmap* lightmap = createSceneLightmap(scene, LIGHTMAP_ATLAS_SIZE);
+		
+		// baking is done offline, the lightmap is written and the program exits
+		if(lightmap && bakeLightmapPath){
+			printf("Done\nBaking lightmap...\n");
+			
+			double bakeStart = glfwGetTime();
+			
+			bakeSceneLightmap(scene, lightmap, bakeThreads);
+			
+			printf("Baked in %.2f s (%.2f texels per unit)\n", glfwGetTime() - bakeStart, lightmap->texelsPerUnit);
+			
+			bool written = writeLightmap(lightmap, bakeLightmapPath);
+			
+			// join the decode threads before glfw goes away
+			stopTextureLoader();
+			
+			terminateGraphics();
+			
+			free(window);
+			
+			return written ? EXIT_SUCCESS : EXIT_FAILURE;
+		}
+		
+		if(lightmap && lightmapPath && readLightmap(lightmap, lightmapPath) && uploadLightmap(lightmap)){
+			scene->lightmap = lightmap;
+		} else {
+			printf("\nLighting the scene with its lights instead...");
+		}
+	}
+	
+	// pack textures (per-object rendering binds every object's texture anyway, so it doesn't benefit)
+	if(useTextureArrays && renderMode != RENDER_PER_OBJECT){
+		printf("Done\nPacking textures...");
+		
+		packSceneTextureArrays(scene);
+	}
+	
+	// merge static objects into batches (only needed for batched rendering)
+	if(renderMode == RENDER_BATCHED){
+		printf("Done\nBatching scene...");
+		
+		buildSceneStaticBatches(scene, 8.f);
+	}
+	
+	// programs used to draw the scene's objects
+	ShaderProgramEx* sceneShader = lightingShader;
+	ShaderProgramEx* instancedSceneShader = instancedLightingShader;
+	
+	DeferredRenderer* deferredRenderer = NULL;
+	DepthPrepass* depthPrepass = NULL;
+	
+	if(scene->lightmap){
+		printf("Done\nLoading lightmap shaders...");
+		
+		// same shaders with LIGHTMAPPED, the fragment shader reads the lightmap instead of going through the lights
+		precompileShaderPermutations(lightingShaders, SHADER_FEATURE_LIGHTMAPPED);
+		precompileShaderPermutations(lightingShaders, SHADER_FEATURE_LIGHTMAPPED | SHADER_FEATURE_INSTANCED);
+		
+		ShaderProgramEx* lightmapShader = getShaderPermutation(lightingShaders, SHADER_FEATURE_LIGHTMAPPED, SHADER_TEXTURED);
+		ShaderProgramEx* instancedLightmapShader = getShaderPermutation(lightingShaders, SHADER_FEATURE_LIGHTMAPPED | SHADER_FEATURE_INSTANCED, SHADER_TEXTURED);
+		
+		if(lightmapShader && instancedLightmapShader){
+			sceneShader = lightmapShader;
+			instancedSceneShader = instancedLightmapShader;
+		}
+		
+		// the deferred light pass goes through the lights itself
+		if(deferredShading) printf("\nLightmap isn't used with deferred shading...");
+	}
+	
+	if(showOverdraw){
+		printf("Done\nLoading overdraw shaders...");
+		
+		// same vertex shaders, every shaded fragment adds to the pixel (the lit scene, forward or deferred, isn't drawn at all)
+		ShaderProgramEx* overdrawShader = loadShaderProgramEx("./res/shader/lighting/vertex.glsl", "./res/shader/overdraw/fragment.glsl");
+		ShaderProgramEx* instancedOverdrawShader = loadShaderProgramEx("./res/shader/lighting/vertex.glsl", "./res/shader/overdraw/fragment.glsl", getShaderPermutationDefines(SHADER_FEATURE_INSTANCED, SHADER_UNTEXTURED).c_str());
+		
+		if(overdrawShader && instancedOverdrawShader){
+			sceneShader = overdrawShader;
+			instancedSceneShader = instancedOverdrawShader;
+		} else {
+			showOverdraw = false;
+		}
+	}
+	
+	if(useDepthPrepass){
+		printf("Done\nLoading depth pre-pass shaders...");
+		
+		depthPrepass = createDepthPrepass();
+	}
+	
+	if(deferredShading && !showOverdraw){
+		printf("Done\nCreating deferred renderer...");
+		
+		deferredRenderer = createDeferredRenderer(screenWidth, screenHeight);
+		
+		// objects are drawn into the g-buffer instead
+		if(deferredRenderer){
+			sceneShader = deferredRenderer->geometryProgram;
+			instancedSceneShader = deferredRenderer->instancedGeometryProgram;
+		}
+	}
+	
+	DynamicResolution* dynamicResolution = NULL;
+	
+	if(targetFrameMs > 0.0f){
+		printf("Done\nCreating dynamic resolution buffers...");
+		
+		dynamicResolution = createDynamicResolution(screenWidth, screenHeight, targetFrameMs / 1000.0);
+	}
+	
+	// draws the frames the loop below simulates
+	Renderer* renderer = NULL;
+	
+	if(useSoftwareRenderer){
+		printf("Done\nStarting software rasterizer...");
+		
+		// it converts each texture's decoded image the first time it draws it, so they have to be done loading
+		finishTextureLoads();
+		
+		SoftwareRasterizer* softwareRasterizer = createSoftwareRasterizer(scene, screenWidth, screenHeight, softwareThreads);
+		
+		softwareRasterizer->imagePath = softwareImagePath;
+		softwareRasterizer->printStats = printStats;
+		
+		renderer = createSoftwareRenderer(softwareRasterizer);
+	} else {
+		FrameRenderer* frameRenderer = createFrameRenderer(window, scene, screenWidth, screenHeight, renderMode, sceneShader, instancedSceneShader);
+		
+		frameRenderer->depthPrepass = depthPrepass;
+		frameRenderer->deferredRenderer = deferredRenderer;
+		frameRenderer->dynamicResolution = dynamicResolution;
+		frameRenderer->showOverdraw = showOverdraw;
+		frameRenderer->printStats = printStats;
+		frameRenderer->startTime = startTime;
+		
+		renderer = createOpenGlRenderer(frameRenderer);
+	}
+	
+	// only count (and log) the render loop's calls
+	clearGlRecording();
+	setGlRecordingLog(logGlCalls);
+	
+	// the render thread takes the context from here on, otherwise frames are drawn right after they're simulated
+	RenderThread* renderThread = NULL;
+	FramePacket* framePacket = NULL;
+	
+	if(useRenderThread){
+		renderThread = startRenderThread(renderer);
+	} else {
+		framePacket = createFramePacket();
+	}
+	
 	printf("Done\nRender Loop Starting\n");
 	
 	// render loop //
+	uint32_t frame = 0;
 	double delta = 0.0;
 	double lastFrame = glfwGetTime();
-	while(!shouldWindowClose(window)){
+	while((frameLimit == 0 || frame < frameLimit) && !(window && shouldWindowClose(window))){
+		// get a packet to build this frame into (waits if the render thread is a frame behind)
+		FramePacket* packet = renderThread ? beginFramePacket(renderThread) : framePacket;
+		
 		// update delta
 		double time = glfwGetTime();
 		delta = time-lastFrame;
 		lastFrame = time;
 		
-		// update camera
-		glm::vec3 rotationVector = calculateRotationVector();
-		//glm::vec3 movementVector = calculateMovementVector(window, camera);
-		
-		// update player position (works regardless of walkmap presence)
-		updatePlayerPosition(player, scene, window, delta);
+		// input (a headless run has none, so the camera stays put)
+		if(window){
+			// update camera
+			glm::vec3 rotationVector = calculateRotationVector();
+			//glm::vec3 movementVector = calculateMovementVector(window, camera);
+			
+			// update player position (works regardless of walkmap presence)
+			updatePlayerPosition(player, scene, window, delta);
+			
+			rotateCamera(camera, rotationVector);
+			constrainCameraRotation(camera, glm::vec3(glm::radians(-89.f), NO_LB, NO_LB), glm::vec3(glm::radians(89.f), NO_UB, NO_UB));
+			//translateCamera(camera, movementVector);
+		}
 		
-		rotateCamera(camera, rotationVector);
-		constrainCameraRotation(camera, glm::vec3(glm::radians(-89.f), NO_LB, NO_LB), glm::vec3(glm::radians(89.f), NO_UB, NO_UB));
-		//translateCamera(camera, movementVector);
+		// recompute view and pv once for every change made this frame
+		updateCameraMatrices(camera);
 		
 		// update sound listener position
 		updateListener(player->camera->position, player->camera->forward);
 		
-		// check triggers
-		checkTriggers(scene);
+		// check triggers (key triggers read the window)
+		if(window) checkTriggers(scene);
 		
 		//printf("fr: %f\n", 1.0/delta);
 		//printf("camera: %f, %f, %f, %f, %f, %f\n", camera->position.x, camera->position.y, camera->position.z, camera->rotation.x, camera->rotation.y, camera->rotation.z);
@@ -148,17 +504,54 @@ int main(int argc, char** argv){
 		// sounds //
 		updateSounds();
 		
+		// cull and copy everything the frame needs
+		buildFramePacket(packet, scene, camera, renderMode);
+		
+		packet->frame = frame++;
+		packet->simulationTime = glfwGetTime() - time;
+		
 		// render calls //
-		clearWindow(0.3f, 0.0f, 0.0f);
+		if(renderThread){
+			submitFramePacket(renderThread, packet);
+		} else {
+			packet->simulationWaitTime = 0.0;
+			
+			renderFrame(renderer, packet);
+		}
+		
+		// poll for events
+		if(window) pollWindowEvents();
+	}
+	
+	// finish the last frame and take the renderer back
+	if(renderThread) stopRenderThread(renderThread);
+	
+	if(renderer->backend == RENDERER_SOFTWARE) destroySoftwareRasterizer(renderer->softwareRasterizer);
+	
+	stopTextureLoader();
 	
-		// bind shader
-		useProgramEx(lightingShader);
+	if(getGlBackend() == GL_BACKEND_RECORDING){
+		if(logGlCalls) printGlRecordingLog();
+		
+		printGlCallCounts(frame);
+	}
+	
+	// a headless run fails if any frame went by without the scene being cleared and drawn
+	bool passed = true;
+	
+	if(headless && !useSoftwareRenderer && getGlBackend() == GL_BACKEND_RECORDING){
+		const char* drawFunctions[] = {"glDrawArrays", "glDrawArraysInstanced", "glDrawElements", "glDrawElementsBaseVertex", "glDrawElementsInstancedBaseVertex", "glMultiDrawElementsIndirect"};
+		
+		uint64_t clears = getGlCallCount("glClear");
+		uint64_t draws = 0;
+		
+		for(uint32_t i = 0; i < sizeof(drawFunctions)/sizeof(const char*); i++){
+			draws += getGlCallCount(drawFunctions[i]);
+		}
 		
-		// render
-		renderScene(scene, camera, lightingShader);
+		passed = clears >= frame && draws >= frame;
 		
-		// swap buffers
-		updateWindow(window);
+		printf("Headless run %s: %d frames, %llu clears, %llu draw calls\n", passed ? "passed" : "failed", frame, (unsigned long long)clears, (unsigned long long)draws);
 	}
 	
 	// kill graphics
@@ -166,7 +559,7 @@ int main(int argc, char** argv){
 	
 	free(window);
 	
-	return EXIT_SUCCESS;
+	return passed ? EXIT_SUCCESS : EXIT_FAILURE;
 }
 
 glm::vec3 calculateMovementVector(Window* window, PerspectiveCamera* camera){
@@ -0,0 +1,87 @@
+// material table
+
+#include <material.h>
+#include <utils.h>
+
+// create an empty material table
+MaterialTable* createMaterialTable(){
+	MaterialTable* table = allocateMemoryForType<MaterialTable>();
+	
+	table->materials = new std::vector<Material>();
+	table->buffer = NULL;
+	table->dirty = true;
+	
+	return table;
+}
+
+// get the index of the material with texture and color, adding it if the table doesn't have one yet
+// tables only hold a few distinct materials even for big scenes, so a linear search is fine
+uint32_t addMaterial(MaterialTable* table, TextureData* texture, glm::vec3 color){
+	for(uint32_t i = 0; i < table->materials->size(); i++){
+		Material& material = table->materials->at(i);
+		
+		if(material.texture == texture && material.color == color) return i;
+	}
+	
+	table->materials->push_back( (Material){texture, color} );
+	table->dirty = true;
+	
+	return table->materials->size() - 1;
+}
+
+// have the table uploaded again, call after something the materials point to changes (like packing their textures)
+void invalidateMaterialTable(MaterialTable* table){
+	table->dirty = true;
+}
+
+// upload the table to its texture buffer if it changed since the last upload, creating the buffer on first use
+// returns false if the buffer couldn't be created
+bool uploadMaterialTable(MaterialTable* table){
+	if(!table->dirty) return true;
+	
+	// always at least one texel, so the buffer can be created before any materials are added
+	std::vector<glm::vec4> texels;
+	
+	for(uint32_t i = 0; i < table->materials->size(); i++){
+		Material& material = table->materials->at(i);
+		
+		texels.push_back(glm::vec4(material.color, material.texture ? material.texture->layer : 0));
+	}
+	
+	if(texels.size() == 0) texels.push_back(glm::vec4(0));
+	
+	uint32_t size = texels.size() * sizeof(glm::vec4);
+	
+	if(!table->buffer){
+		table->buffer = createTextureBuffer(GL_RGBA32F, size);
+		
+		if(!table->buffer) return false;
+	}
+	
+	uploadTextureBuffer(table->buffer, size, &texels[0]);
+	
+	table->dirty = false;
+	
+	return true;
+}
+
+// bind the table to the reserved material data unit
+void bindMaterialTable(MaterialTable* table){
+	if(table->buffer) bindTextureBuffer(table->buffer, MATERIAL_DATA_TEXTURE_UNIT);
+}
+
+// give every static object of a scene the index of its material, adding materials to scene->materials as needed
+// objects that already have one just find the same material again, so this can be called after every world is loaded
+void assignSceneMaterials(Scene* scene){
+	for (std::map<VertexData*, std::vector<TexturedRenderableObject*>*>::iterator it = scene->staticObjects->begin(); it != scene->staticObjects->end(); it++){
+		if(!it->second) continue;
+		
+		for(uint32_t i = 0; i < it->second->size(); i++){
+			TexturedRenderableObject* object = it->second->at(i);
+			
+			if(!object) continue;
+			
+			object->material = addMaterial(scene->materials, object->textureData, object->color);
+		}
+	}
+}
\ No newline at end of file
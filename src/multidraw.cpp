@@ -0,0 +1,94 @@
+// multi-draw indirect submission
+
+#include <multidraw.h>
+#include <utils.h>
+
+#include <cstring>
+
+// glMultiDrawElementsIndirect (GL_ARB_multi_draw_indirect) is loaded by hand when the driver has it
+typedef void (APIENTRYP PFNGLMULTIDRAWELEMENTSINDIRECTPROC)(GLenum mode, GLenum type, const void* indirect, GLsizei drawcount, GLsizei stride);
+
+PFNGLMULTIDRAWELEMENTSINDIRECTPROC g_glMultiDrawElementsIndirect = NULL;
+
+// if buckets are drawn with glMultiDrawElementsIndirect, otherwise they fall back to one draw per command
+bool g_multiDrawIndirect = false;
+
+// look for the extensions multi-draw indirect needs, must be called after the gl methods are loaded (load should be the same loader given to glad)
+// base instance is needed too, since that's how each command finds its instances
+void initMultiDraw(GLADloadproc load){
+	bool drawIndirect = false;
+	bool multiDrawIndirect = false;
+	bool baseInstance = false;
+	
+	GLint extensionCount = 0;
+	
+	glGetIntegerv(GL_NUM_EXTENSIONS, &extensionCount);
+	
+	for(GLint i = 0; i < extensionCount; i++){
+		const char* extension = (const char*)glGetStringi(GL_EXTENSIONS, i);
+		
+		if(!extension) continue;
+		
+		if(strcmp(extension, "GL_ARB_draw_indirect") == 0) drawIndirect = true;
+		if(strcmp(extension, "GL_ARB_multi_draw_indirect") == 0) multiDrawIndirect = true;
+		if(strcmp(extension, "GL_ARB_base_instance") == 0) baseInstance = true;
+	}
+	
+	if(drawIndirect && multiDrawIndirect && baseInstance){
+		g_glMultiDrawElementsIndirect = (PFNGLMULTIDRAWELEMENTSINDIRECTPROC)load("glMultiDrawElementsIndirect");
+	}
+	
+	g_multiDrawIndirect = g_glMultiDrawElementsIndirect != NULL;
+}
+
+// turn multi-draw indirect on or off (it stays off if it isn't supported)
+void setMultiDrawIndirect(bool enabled){
+	g_multiDrawIndirect = enabled && g_glMultiDrawElementsIndirect != NULL;
+}
+
+bool isMultiDrawIndirectSupported(){
+	return g_glMultiDrawElementsIndirect != NULL;
+}
+
+// create a command that draws instanceCount instances of data, starting at firstInstance of the instance buffer
+// data has to have indices (vertex data made with createVertexData always does)
+DrawElementsIndirectCommand createDrawElementsIndirectCommand(VertexData* data, uint32_t firstInstance, uint32_t instanceCount){
+	DrawElementsIndirectCommand command;
+	
+	command.count = data->indexCount;
+	command.instanceCount = instanceCount;
+	command.firstIndex = data->firstIndex;
+	command.baseVertex = data->baseVertex;
+	command.baseInstance = firstInstance;
+	
+	return command;
+}
+
+// draw a bucket of commands, commandBuffer holding a copy of commands (see writeStreamBuffer)
+// with multi-draw indirect it's one call, otherwise it's a loop of instanced draws with the instance attributes moved to each command's instances
+// assumes that the bucket's vao is already bound (see bindVertexData)
+// returns the number of draw calls made
+uint32_t multiDrawElementsIndirect(GLuint commandBuffer, std::vector<DrawElementsIndirectCommand>& commands, MultiDrawBucket& bucket, InstanceBuffer* instanceBuffer){
+	if(bucket.commandCount == 0) return 0;
+	
+	if(g_multiDrawIndirect){
+		// base instance takes care of the offset
+		bindVertexDataInstances(bucket.vertexData, instanceBuffer, 0);
+		
+		glBindBuffer(GL_DRAW_INDIRECT_BUFFER, commandBuffer);
+		g_glMultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT, (void*)(uintptr_t)(bucket.firstCommand * sizeof(DrawElementsIndirectCommand)), bucket.commandCount, sizeof(DrawElementsIndirectCommand));
+		glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+		
+		return 1;
+	}
+	
+	for(uint32_t i = 0; i < bucket.commandCount; i++){
+		DrawElementsIndirectCommand& command = commands[bucket.firstCommand + i];
+		
+		bindVertexDataInstances(bucket.vertexData, instanceBuffer, command.baseInstance);
+		
+		glDrawElementsInstancedBaseVertex(GL_TRIANGLES, command.count, GL_UNSIGNED_INT, (void*)(uintptr_t)(command.firstIndex * sizeof(uint32_t)), command.instanceCount, command.baseVertex);
+	}
+	
+	return bucket.commandCount;
+}
\ No newline at end of file
@@ -0,0 +1,115 @@
+// shader permutations
+
+#include <permutation.h>
+#include <utils.h>
+
+#include <cstdio>
+
+// names the features and texture modes are #defined as, in the same order as their bits/values
+const char* g_shaderFeatureNames[] = {
+	"INSTANCED",
+	"LIGHTMAPPED"
+};
+
+const char* g_shaderTextureModeNames[SHADER_TEXTURE_MODE_COUNT] = {
+	NULL,
+	"TEXTURED",
+	"TEXTURE_ARRAY"
+};
+
+// create an empty set of permutations, variants are compiled the first time they're asked for (or by precompileShaderPermutations)
+ShaderPermutations* createShaderPermutations(const char* vertexPath, const char* fragmentPath){
+	ShaderPermutations* permutations = allocateMemoryForType<ShaderPermutations>();
+	
+	permutations->vertexPath = vertexPath;
+	permutations->fragmentPath = fragmentPath;
+	permutations->programs = new std::map<uint32_t, ShaderProgramEx*>();
+	
+	return permutations;
+}
+
+// get the key a variant is stored under
+uint32_t getShaderPermutationKey(uint32_t features, ShaderTextureMode textureMode){
+	return features * SHADER_TEXTURE_MODE_COUNT + textureMode;
+}
+
+// get the #define lines a variant is compiled with
+std::string getShaderPermutationDefines(uint32_t features, ShaderTextureMode textureMode){
+	std::string defines;
+	
+	for(uint32_t i = 0; i < sizeof(g_shaderFeatureNames) / sizeof(g_shaderFeatureNames[0]); i++){
+		if(features & (1 << i)) defines += std::string("#define ") + g_shaderFeatureNames[i] + "\n";
+	}
+	
+	if(g_shaderTextureModeNames[textureMode]) defines += std::string("#define ") + g_shaderTextureModeNames[textureMode] + "\n";
+	
+	return defines;
+}
+
+// get the variant with features and textureMode, compiling it if it hasn't been yet
+// returns NULL if it doesn't compile (a failed variant isn't tried again)
+ShaderProgramEx* getShaderPermutation(ShaderPermutations* permutations, uint32_t features, ShaderTextureMode textureMode){
+	uint32_t key = getShaderPermutationKey(features, textureMode);
+	
+	std::map<uint32_t, ShaderProgramEx*>::iterator it = permutations->programs->find(key);
+	
+	if(it != permutations->programs->end()) return it->second;
+	
+	ShaderProgramEx* programEx = loadShaderProgramEx(permutations->vertexPath, permutations->fragmentPath, getShaderPermutationDefines(features, textureMode).c_str());
+	
+	if(programEx){
+		programEx->permutations = permutations;
+		programEx->permutationFeatures = features;
+		programEx->permutationTextureMode = textureMode;
+	} else {
+		printf("Couldn't compile %s + %s with:\n%s", permutations->vertexPath, permutations->fragmentPath, getShaderPermutationDefines(features, textureMode).c_str());
+	}
+	
+	(*permutations->programs)[key] = programEx;
+	
+	return programEx;
+}
+
+// compile every texture mode of the variants with features up front, so drawing a new material never stalls on a compile
+// returns false if any of them didn't compile
+bool precompileShaderPermutations(ShaderPermutations* permutations, uint32_t features){
+	bool compiled = true;
+	
+	for(uint32_t i = 0; i < SHADER_TEXTURE_MODE_COUNT; i++){
+		if(!getShaderPermutation(permutations, features, (ShaderTextureMode)i)) compiled = false;
+	}
+	
+	return compiled;
+}
+
+// get the texture mode that draws textureData, packed textures are sampled from their array unless useTextureArrays is false
+ShaderTextureMode getShaderTextureMode(TextureData* textureData, bool useTextureArrays){
+	if(!textureData) return SHADER_UNTEXTURED;
+	
+	if(textureData->array && useTextureArrays) return SHADER_TEXTURE_ARRAY;
+	
+	return SHADER_TEXTURED;
+}
+
+// get the variant of programEx's permutations with the same features but textureMode
+// programs that aren't permutations (and variants that don't compile) fall back to programEx itself
+ShaderProgramEx* getProgramExVariant(ShaderProgramEx* programEx, ShaderTextureMode textureMode){
+	if(!programEx->permutations || programEx->permutationTextureMode == textureMode) return programEx;
+	
+	ShaderProgramEx* variant = getShaderPermutation(programEx->permutations, programEx->permutationFeatures, textureMode);
+	
+	return variant ? variant : programEx;
+}
+
+// use the variant of programEx that draws textureData and bind the texture for it
+// returns the variant, per-draw uniforms have to be set on it instead of programEx
+ShaderProgramEx* useProgramExObjectTexture(ShaderProgramEx* programEx, TextureData* textureData){
+	ShaderProgramEx* variant = getProgramExVariant(programEx, getShaderTextureMode(textureData, true));
+	
+	useProgramEx(variant);
+	
+	// untextured variants don't sample anything
+	if(!variant->permutations || variant->permutationTextureMode != SHADER_UNTEXTURED) setProgramExObjectTexture(variant, textureData);
+	
+	return variant;
+}
\ No newline at end of file
@@ -0,0 +1,268 @@
+// shader program binary cache
+
+#include <programcache.h>
+
+#include <cstdio>
+#include <cstring>
+
+// magic and version at the start of every cache file, files that don't start with these are ignored and overwritten
+#define PROGRAM_CACHE_MAGIC 0x43504D56 // "VMPC"
+#define PROGRAM_CACHE_VERSION 1
+
+// GL_ARB_get_program_binary methods are loaded by hand when the driver has them
+typedef void (APIENTRYP PFNGLGETPROGRAMBINARYPROC)(GLuint program, GLsizei bufSize, GLsizei* length, GLenum* binaryFormat, void* binary);
+typedef void (APIENTRYP PFNGLPROGRAMBINARYPROC)(GLuint program, GLenum binaryFormat, const void* binary, GLsizei length);
+typedef void (APIENTRYP PFNGLPROGRAMPARAMETERIPROC)(GLuint program, GLenum pname, GLint value);
+
+PFNGLGETPROGRAMBINARYPROC g_glGetProgramBinary = NULL;
+PFNGLPROGRAMBINARYPROC g_glProgramBinary = NULL;
+PFNGLPROGRAMPARAMETERIPROC g_glProgramParameteri = NULL;
+
+// file the cache is saved to, NULL if the cache isn't open
+const char* g_programCachePath = NULL;
+
+// hash of the driver's vendor, renderer and version strings, binaries saved under a different one are never loaded
+uint64_t g_driverHash = 0;
+
+// every binary loaded or stored since the cache was opened, by key (see getProgramCacheKey)
+std::map<uint64_t, ProgramBinary>* g_programBinaries = NULL;
+
+ProgramCacheStats programCacheStats = {0, 0, 0, 0.0};
+
+// 64 bit fnv-1a, continuing from hash
+uint64_t hashProgramCacheString(uint64_t hash, const char* string){
+	if(!string) return hash;
+	
+	for(const char* c = string; *c; c++){
+		hash ^= (uint8_t)*c;
+		hash *= 0x100000001B3ull;
+	}
+	
+	// end marker, so moving characters from one string to the next changes the hash
+	hash ^= 0xFF;
+	hash *= 0x100000001B3ull;
+	
+	return hash;
+}
+
+// look for GL_ARB_get_program_binary, must be called after the gl methods are loaded (load should be the same loader given to glad)
+// drivers can have the extension and still not support any binary formats, in which case the cache stays off too
+void initProgramCache(GLADloadproc load){
+	GLint extensionCount = 0;
+	
+	glGetIntegerv(GL_NUM_EXTENSIONS, &extensionCount);
+	
+	for(GLint i = 0; i < extensionCount; i++){
+		const char* extension = (const char*)glGetStringi(GL_EXTENSIONS, i);
+		
+		if(extension && strcmp(extension, "GL_ARB_get_program_binary") == 0){
+			g_glGetProgramBinary = (PFNGLGETPROGRAMBINARYPROC)load("glGetProgramBinary");
+			g_glProgramBinary = (PFNGLPROGRAMBINARYPROC)load("glProgramBinary");
+			g_glProgramParameteri = (PFNGLPROGRAMPARAMETERIPROC)load("glProgramParameteri");
+			
+			break;
+		}
+	}
+	
+	GLint formatCount = 0;
+	
+	if(g_glGetProgramBinary && g_glProgramBinary && g_glProgramParameteri) glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formatCount);
+	
+	if(formatCount == 0){
+		g_glGetProgramBinary = NULL;
+		g_glProgramBinary = NULL;
+		g_glProgramParameteri = NULL;
+	}
+}
+
+bool isProgramCacheSupported(){
+	return g_glGetProgramBinary != NULL;
+}
+
+// read a value from a cache file, returns false if the file ended first
+template <typename T>
+bool readProgramCacheValue(FILE* file, T* value){
+	return fread(value, sizeof(T), 1, file) == 1;
+}
+
+// start caching programs in the file at path, loading the binaries already in it
+// does nothing if the driver can't hand out program binaries
+void openProgramCache(const char* path){
+	if(!isProgramCacheSupported()) return;
+	
+	g_programCachePath = path;
+	
+	g_driverHash = 0xCBF29CE484222325ull;
+	g_driverHash = hashProgramCacheString(g_driverHash, (const char*)glGetString(GL_VENDOR));
+	g_driverHash = hashProgramCacheString(g_driverHash, (const char*)glGetString(GL_RENDERER));
+	g_driverHash = hashProgramCacheString(g_driverHash, (const char*)glGetString(GL_VERSION));
+	g_driverHash = hashProgramCacheString(g_driverHash, (const char*)glGetString(GL_SHADING_LANGUAGE_VERSION));
+	
+	if(!g_programBinaries) g_programBinaries = new std::map<uint64_t, ProgramBinary>();
+	
+	g_programBinaries->clear();
+	
+	FILE* file = fopen(path, "rb");
+	
+	// nothing cached yet
+	if(!file) return;
+	
+	uint32_t magic = 0;
+	uint32_t version = 0;
+	uint64_t driverHash = 0;
+	uint32_t count = 0;
+	
+	bool valid = readProgramCacheValue(file, &magic) && readProgramCacheValue(file, &version) && readProgramCacheValue(file, &driverHash) && readProgramCacheValue(file, &count);
+	
+	// saved by another driver (or another version of the engine), its binaries are no use to this one
+	if(!valid || magic != PROGRAM_CACHE_MAGIC || version != PROGRAM_CACHE_VERSION || driverHash != g_driverHash){
+		fclose(file);
+		
+		return;
+	}
+	
+	for(uint32_t i = 0; i < count; i++){
+		uint64_t key = 0;
+		uint32_t format = 0;
+		uint32_t size = 0;
+		
+		if(!readProgramCacheValue(file, &key) || !readProgramCacheValue(file, &format) || !readProgramCacheValue(file, &size)) break;
+		
+		ProgramBinary& binary = (*g_programBinaries)[key];
+		
+		binary.format = format;
+		binary.data.resize(size);
+		
+		// truncated file, keep what was read before this entry
+		if(size > 0 && fread(&binary.data[0], 1, size, file) != size){
+			g_programBinaries->erase(key);
+			
+			break;
+		}
+	}
+	
+	fclose(file);
+}
+
+// stop caching programs, programs created after this are always compiled
+void closeProgramCache(){
+	g_programCachePath = NULL;
+	
+	if(g_programBinaries) g_programBinaries->clear();
+}
+
+ProgramCacheStats* getProgramCacheStats(){
+	return &programCacheStats;
+}
+
+// write every binary to the cache file, replacing it
+void saveProgramCache(){
+	FILE* file = fopen(g_programCachePath, "wb");
+	
+	if(!file){
+		printf("Couldn't save program cache to %s\n", g_programCachePath);
+		
+		return;
+	}
+	
+	uint32_t magic = PROGRAM_CACHE_MAGIC;
+	uint32_t version = PROGRAM_CACHE_VERSION;
+	uint32_t count = g_programBinaries->size();
+	
+	fwrite(&magic, sizeof(magic), 1, file);
+	fwrite(&version, sizeof(version), 1, file);
+	fwrite(&g_driverHash, sizeof(g_driverHash), 1, file);
+	fwrite(&count, sizeof(count), 1, file);
+	
+	for(std::map<uint64_t, ProgramBinary>::iterator it = g_programBinaries->begin(); it != g_programBinaries->end(); it++){
+		uint32_t format = it->second.format;
+		uint32_t size = it->second.data.size();
+		
+		fwrite(&it->first, sizeof(it->first), 1, file);
+		fwrite(&format, sizeof(format), 1, file);
+		fwrite(&size, sizeof(size), 1, file);
+		
+		if(size > 0) fwrite(&it->second.data[0], 1, size, file);
+	}
+	
+	fclose(file);
+}
+
+// let the driver know the program's binary will be asked for, has to be called before linking
+void hintProgramBinaryRetrievable(GLuint program){
+	if(g_programCachePath) g_glProgramParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+}
+
+// get the key a program built from these sources is cached under
+// anything that changes the compiled program (#defines included) has to be part of the sources, the driver is accounted for by the file itself
+uint64_t getProgramCacheKey(const char* vertexSource, const char* fragmentSource){
+	uint64_t hash = 0xCBF29CE484222325ull;
+	
+	hash = hashProgramCacheString(hash, vertexSource);
+	hash = hashProgramCacheString(hash, fragmentSource);
+	
+	return hash;
+}
+
+// create a program from the binary cached under key
+// returns 0 if there isn't one, or the driver rejected it (the binary is dropped then, so it gets replaced by the next store)
+GLuint loadCachedProgram(uint64_t key){
+	if(!g_programCachePath) return 0;
+	
+	std::map<uint64_t, ProgramBinary>::iterator it = g_programBinaries->find(key);
+	
+	if(it == g_programBinaries->end()){
+		programCacheStats.misses++;
+		
+		return 0;
+	}
+	
+	GLuint program = glCreateProgram();
+	
+	g_glProgramBinary(program, it->second.format, it->second.data.size() ? &it->second.data[0] : NULL, it->second.data.size());
+	
+	GLint linkStatus = 0;
+	glGetProgramiv(program, GL_LINK_STATUS, &linkStatus);
+	
+	if(!linkStatus){
+		glDeleteProgram(program);
+		
+		g_programBinaries->erase(it);
+		
+		programCacheStats.rejected++;
+		
+		return 0;
+	}
+	
+	programCacheStats.hits++;
+	
+	return program;
+}
+
+// cache a freshly linked program's binary under key, and save the cache
+void storeCachedProgram(uint64_t key, GLuint program){
+	if(!g_programCachePath) return;
+	
+	GLint length = 0;
+	glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+	
+	if(length <= 0) return;
+	
+	ProgramBinary& binary = (*g_programBinaries)[key];
+	
+	binary.data.resize(length);
+	
+	GLsizei written = 0;
+	
+	g_glGetProgramBinary(program, length, &written, &binary.format, &binary.data[0]);
+	
+	if(written <= 0){
+		g_programBinaries->erase(key);
+		
+		return;
+	}
+	
+	binary.data.resize(written);
+	
+	saveProgramCache();
+}
\ No newline at end of file
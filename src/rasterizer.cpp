@@ -0,0 +1,906 @@
+// software rasterizer
+
+#include <rasterizer.h>
+#include <utils.h>
+
+#include <emmintrin.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+
+// stages the worker threads run (see runRasterizerStage)
+#define RASTERIZER_STAGE_GEOMETRY 0
+#define RASTERIZER_STAGE_RASTER 1
+
+// same clear colors as renderFramePacket
+#define RASTERIZER_CLEAR_COLOR 0xff00004d
+
+// planes triangles are clipped against, dot(plane, clip position) >= 0 is inside
+// near and far are the same as gl's, the sides are pushed out to the guard band
+const glm::vec4 g_rasterizerClipPlanes[] = {
+	glm::vec4(0, 0, 1, 1),
+	glm::vec4(0, 0, -1, 1),
+	glm::vec4(1, 0, 0, RASTERIZER_GUARD_BAND),
+	glm::vec4(-1, 0, 0, RASTERIZER_GUARD_BAND),
+	glm::vec4(0, 1, 0, RASTERIZER_GUARD_BAND),
+	glm::vec4(0, -1, 0, RASTERIZER_GUARD_BAND)
+};
+
+#define RASTERIZER_CLIP_PLANES 6
+
+void runRasterizerWorker(SoftwareRasterizer* rasterizer, uint32_t index);
+
+// create a software rasterizer drawing width x height frames with threadCount threads (0 for every core)
+// textures are read from the texture loader, so it expects the scene's textures to be loaded with image retention on (see setTextureImageRetention)
+SoftwareRasterizer* createSoftwareRasterizer(Scene* scene, uint32_t width, uint32_t height, uint32_t threadCount){
+	SoftwareRasterizer* rasterizer = allocateMemoryForType<SoftwareRasterizer>();
+	
+	rasterizer->scene = scene;
+	
+	rasterizer->width = width;
+	rasterizer->height = height;
+	
+	rasterizer->tilesX = (width + RASTERIZER_TILE_SIZE - 1) / RASTERIZER_TILE_SIZE;
+	rasterizer->tilesY = (height + RASTERIZER_TILE_SIZE - 1) / RASTERIZER_TILE_SIZE;
+	
+	// rows are padded so the last tile of a row can load 4 pixels at once without reaching into the next row
+	rasterizer->stride = (width + 3) & ~3u;
+	
+	rasterizer->colorBuffer = new std::vector<uint32_t>(rasterizer->stride * height, RASTERIZER_CLEAR_COLOR);
+	rasterizer->depthBuffer = new std::vector<float>(rasterizer->stride * height, 1.0f);
+	
+	rasterizer->textures = new std::map<TextureData*, RasterizerTexture*>();
+	rasterizer->bounds = new std::map<VertexData*, std::pair<glm::vec3, glm::vec3>>();
+	
+	rasterizer->packet = NULL;
+	rasterizer->instanceVertexData = new std::vector<VertexData*>();
+	rasterizer->materialTextures = new std::vector<RasterizerTexture*>();
+	rasterizer->lights = new std::vector<glm::vec4>();
+	rasterizer->lightIndices = new std::vector<uint32_t>();
+	rasterizer->instanceLights = new std::vector<uint32_t>();
+	rasterizer->ambientLight = glm::vec3(0);
+	
+	if(threadCount == 0) threadCount = std::max(std::thread::hardware_concurrency(), 1u);
+	
+	rasterizer->threadCount = threadCount;
+	rasterizer->threads = new std::vector<RasterizerThreadData>(threadCount);
+	
+	for(uint32_t i = 0; i < threadCount; i++){
+		RasterizerThreadData& thread = rasterizer->threads->at(i);
+		
+		thread.vertices = new std::vector<RasterizerVertex>();
+		thread.triangles = new std::vector<RasterizerTriangle>();
+		thread.bins = new std::vector<std::vector<uint32_t>>(rasterizer->tilesX * rasterizer->tilesY);
+		thread.firstInstance = 0;
+		thread.instanceCount = 0;
+	}
+	
+	rasterizer->mutex = new std::mutex();
+	rasterizer->condition = new std::condition_variable();
+	rasterizer->stage = RASTERIZER_STAGE_GEOMETRY;
+	rasterizer->generation = 0;
+	rasterizer->busyWorkers = 0;
+	rasterizer->quit = false;
+	
+	rasterizer->nextTile = new std::atomic<uint32_t>(0);
+	
+	// the thread drawing the frame is thread 0
+	rasterizer->workers = new std::vector<std::thread*>();
+	
+	for(uint32_t i = 1; i < threadCount; i++){
+		rasterizer->workers->push_back(new std::thread(runRasterizerWorker, rasterizer, i));
+	}
+	
+	rasterizer->imagePath = NULL;
+	
+	rasterizer->printStats = false;
+	
+	rasterizer->statsFrames = 0;
+	rasterizer->statsStart = glfwGetTime();
+	rasterizer->statsGeometryTime = 0.0;
+	rasterizer->statsRasterTime = 0.0;
+	rasterizer->statsWriteTime = 0.0;
+	rasterizer->statsTriangles = 0.0;
+	rasterizer->statsBinnedTriangles = 0.0;
+	
+	return rasterizer;
+}
+
+// stop the worker threads and free everything the rasterizer made
+void destroySoftwareRasterizer(SoftwareRasterizer* rasterizer){
+	{
+		std::lock_guard<std::mutex> lock(*rasterizer->mutex);
+		
+		rasterizer->quit = true;
+	}
+	
+	rasterizer->condition->notify_all();
+	
+	for(uint32_t i = 0; i < rasterizer->workers->size(); i++){
+		rasterizer->workers->at(i)->join();
+		
+		delete rasterizer->workers->at(i);
+	}
+	
+	for(uint32_t i = 0; i < rasterizer->threads->size(); i++){
+		RasterizerThreadData& thread = rasterizer->threads->at(i);
+		
+		delete thread.vertices;
+		delete thread.triangles;
+		delete thread.bins;
+	}
+	
+	for(std::map<TextureData*, RasterizerTexture*>::iterator it = rasterizer->textures->begin(); it != rasterizer->textures->end(); it++){
+		if(!it->second) continue;
+		
+		delete it->second->texels;
+		
+		free(it->second);
+	}
+	
+	delete rasterizer->colorBuffer;
+	delete rasterizer->depthBuffer;
+	delete rasterizer->textures;
+	delete rasterizer->bounds;
+	delete rasterizer->instanceVertexData;
+	delete rasterizer->materialTextures;
+	delete rasterizer->lights;
+	delete rasterizer->lightIndices;
+	delete rasterizer->instanceLights;
+	delete rasterizer->threads;
+	delete rasterizer->workers;
+	delete rasterizer->mutex;
+	delete rasterizer->condition;
+	delete rasterizer->nextTile;
+	
+	free(rasterizer);
+}
+
+// frame setup //
+
+// get the rgba copy of a texture, converted from the image the texture loader kept the first time
+// NULL for no texture, or one without an rgb/rgba image (those get no image in gl either, see setTextureDataImage)
+RasterizerTexture* getRasterizerTexture(SoftwareRasterizer* rasterizer, TextureData* textureData){
+	if(!textureData) return NULL;
+	
+	std::map<TextureData*, RasterizerTexture*>::iterator it = rasterizer->textures->find(textureData);
+	
+	if(it != rasterizer->textures->end()) return it->second;
+	
+	TextureImage* image = getTextureImage(textureData);
+	RasterizerTexture* texture = NULL;
+	
+	if(image && (image->channels == 3 || image->channels == 4)){
+		texture = allocateMemoryForType<RasterizerTexture>();
+		
+		texture->width = image->width;
+		texture->height = image->height;
+		texture->texels = new std::vector<uint32_t>(texture->width * texture->height);
+		
+		for(uint32_t i = 0; i < texture->texels->size(); i++){
+			uint8_t* pixel = image->pixels + i * image->channels;
+			uint32_t alpha = image->channels == 4 ? pixel[3] : 0xff;
+			
+			texture->texels->at(i) = pixel[0] | (pixel[1] << 8) | (pixel[2] << 16) | (alpha << 24);
+		}
+	} else {
+		printf("Software rasterizer has no image for texture %d, drawing it untextured\n", textureData->texture);
+	}
+	
+	(*rasterizer->textures)[textureData] = texture;
+	
+	return texture;
+}
+
+// get the object space bounds of vertex data, worked out the first time
+std::pair<glm::vec3, glm::vec3>& getRasterizerBounds(SoftwareRasterizer* rasterizer, VertexData* vertexData){
+	std::map<VertexData*, std::pair<glm::vec3, glm::vec3>>::iterator it = rasterizer->bounds->find(vertexData);
+	
+	if(it != rasterizer->bounds->end()) return it->second;
+	
+	glm::vec3 lower = glm::vec3(HUGE_VALF);
+	glm::vec3 upper = glm::vec3(-HUGE_VALF);
+	
+	for(uint32_t i = 0; i < vertexData->vertices->size(); i++){
+		lower = glm::min(lower, vertexData->vertices->at(i).position);
+		upper = glm::max(upper, vertexData->vertices->at(i).position);
+	}
+	
+	return (*rasterizer->bounds)[vertexData] = std::make_pair(lower, upper);
+}
+
+// get everything the worker threads need for a packet ready, so they never touch gl or the scene's maps
+// finds the lights that reach each instance and splits the instances between the threads by triangle count
+void setupRasterizerFrame(SoftwareRasterizer* rasterizer, FramePacket* packet){
+	Scene* scene = rasterizer->scene;
+	std::vector<InstanceData>& instances = *packet->instances;
+	
+	rasterizer->packet = packet;
+	
+	// vertex data of each instance
+	rasterizer->instanceVertexData->assign(instances.size(), NULL);
+	
+	for(uint32_t i = 0; i < packet->instanceGroups->size(); i++){
+		InstanceGroup& group = packet->instanceGroups->at(i);
+		
+		for(uint32_t j = group.firstInstance; j < group.firstInstance + group.instanceCount; j++){
+			rasterizer->instanceVertexData->at(j) = group.vertexData;
+		}
+	}
+	
+	// decode any new textures
+	std::vector<Material>& materials = *scene->materials->materials;
+	
+	rasterizer->materialTextures->resize(materials.size());
+	
+	for(uint32_t i = 0; i < materials.size(); i++){
+		rasterizer->materialTextures->at(i) = getRasterizerTexture(rasterizer, materials[i].texture);
+	}
+	
+	// lights, packed the same way as the light data buffer
+	rasterizer->lights->clear();
+	rasterizer->ambientLight = glm::vec3(0);
+	
+	for(uint32_t i = 0; i < packet->lights->size(); i++){
+		PointLight& light = packet->lights->at(i);
+		
+		rasterizer->lights->push_back(glm::vec4(light.position, light.radius));
+		rasterizer->lights->push_back(glm::vec4(light.color * light.diffuseStrength, light.c));
+		rasterizer->lights->push_back(glm::vec4(light.l, light.q, 0, 0));
+		
+		rasterizer->ambientLight += light.color * light.ambientStrength;
+	}
+	
+	// lights that reach each instance's world space bounds
+	rasterizer->lightIndices->clear();
+	rasterizer->instanceLights->clear();
+	
+	std::vector<uint32_t> triangleCounts(instances.size());
+	uint32_t totalTriangles = 0;
+	
+	for(uint32_t i = 0; i < instances.size(); i++){
+		VertexData* vertexData = rasterizer->instanceVertexData->at(i);
+		
+		if(!vertexData) continue;
+		
+		std::pair<glm::vec3, glm::vec3>& bounds = getRasterizerBounds(rasterizer, vertexData);
+		
+		glm::vec3 lower = glm::vec3(HUGE_VALF);
+		glm::vec3 upper = glm::vec3(-HUGE_VALF);
+		
+		for(uint32_t corner = 0; corner < 8; corner++){
+			glm::vec3 point = glm::vec3(corner & 1 ? bounds.second.x : bounds.first.x, corner & 2 ? bounds.second.y : bounds.first.y, corner & 4 ? bounds.second.z : bounds.first.z);
+			glm::vec3 world = glm::vec3(instances[i].model * glm::vec4(point, 1));
+			
+			lower = glm::min(lower, world);
+			upper = glm::max(upper, world);
+		}
+		
+		rasterizer->instanceLights->push_back(rasterizer->lightIndices->size());
+		
+		for(uint32_t j = 0; j < packet->lights->size(); j++){
+			PointLight& light = packet->lights->at(j);
+			
+			glm::vec3 closest = glm::clamp(light.position, lower, upper);
+			
+			if(glm::distance(closest, light.position) <= light.radius) rasterizer->lightIndices->push_back(j);
+		}
+		
+		rasterizer->instanceLights->push_back(rasterizer->lightIndices->size() - rasterizer->instanceLights->back());
+		
+		triangleCounts[i] = (vertexData->indexCount > 0 ? vertexData->indexCount : vertexData->vertexCount) / 3;
+		totalTriangles += triangleCounts[i];
+	}
+	
+	// instances without vertex data never made it into instanceLights
+	rasterizer->instanceLights->resize(instances.size() * 2, 0);
+	
+	// contiguous runs of instances with about the same number of triangles each, so bins stay in submission order
+	uint32_t instance = 0;
+	uint32_t triangles = 0;
+	
+	for(uint32_t i = 0; i < rasterizer->threadCount; i++){
+		RasterizerThreadData& thread = rasterizer->threads->at(i);
+		
+		uint32_t target = (uint64_t)totalTriangles * (i + 1) / rasterizer->threadCount;
+		
+		thread.firstInstance = instance;
+		
+		while(instance < instances.size() && (triangles < target || i + 1 == rasterizer->threadCount)){
+			triangles += triangleCounts[instance];
+			instance++;
+		}
+		
+		thread.instanceCount = instance - thread.firstInstance;
+	}
+}
+
+// geometry stage //
+
+// clip a polygon against one plane, writing what's left into clipped
+void clipRasterizerPolygon(std::vector<RasterizerVertex>& polygon, glm::vec4 plane, std::vector<RasterizerVertex>& clipped){
+	clipped.clear();
+	
+	for(uint32_t i = 0; i < polygon.size(); i++){
+		RasterizerVertex& a = polygon[i];
+		RasterizerVertex& b = polygon[(i + 1) % polygon.size()];
+		
+		float da = glm::dot(plane, a.clip);
+		float db = glm::dot(plane, b.clip);
+		
+		if(da >= 0) clipped.push_back(a);
+		
+		// the edge crosses the plane, everything the vertex stage outputs is linear in clip space
+		if((da >= 0) != (db >= 0)){
+			float t = da / (da - db);
+			
+			RasterizerVertex vertex;
+			
+			vertex.clip = glm::mix(a.clip, b.clip, t);
+			vertex.position = glm::mix(a.position, b.position, t);
+			vertex.normal = glm::mix(a.normal, b.normal, t);
+			vertex.textureCoordinates = glm::mix(a.textureCoordinates, b.textureCoordinates, t);
+			
+			clipped.push_back(vertex);
+		}
+	}
+}
+
+// floor(a / b) for b > 0
+int32_t floorDivide(int32_t a, int32_t b){
+	return a >= 0 ? a / b : -((-a + b - 1) / b);
+}
+
+// project a triangle onto the screen and bin it into every tile its bounds touch
+// back facing and zero area triangles (and ones that miss every pixel center) are dropped
+void setupRasterizerTriangle(SoftwareRasterizer* rasterizer, RasterizerThreadData& thread, RasterizerVertex* vertices[3], glm::vec3 color, RasterizerTexture* texture, uint32_t firstLight, uint32_t lightCount){
+	RasterizerTriangle triangle;
+	
+	for(uint32_t i = 0; i < 3; i++){
+		RasterizerVertex& vertex = *vertices[i];
+		
+		float inverseW = 1.0f / vertex.clip.w;
+		
+		// pixel centers are at + 0.5
+		float x = (vertex.clip.x * inverseW * 0.5f + 0.5f) * rasterizer->width;
+		float y = (vertex.clip.y * inverseW * 0.5f + 0.5f) * rasterizer->height;
+		
+		triangle.x[i] = (int32_t)floorf(x * (1 << RASTERIZER_SUBPIXEL_BITS) + 0.5f);
+		triangle.y[i] = (int32_t)floorf(y * (1 << RASTERIZER_SUBPIXEL_BITS) + 0.5f);
+		triangle.z[i] = vertex.clip.z * inverseW;
+		triangle.inverseW[i] = inverseW;
+		
+		triangle.position[i] = vertex.position;
+		triangle.normal[i] = vertex.normal;
+		triangle.textureCoordinates[i] = vertex.textureCoordinates;
+	}
+	
+	// counter clockwise is front facing, same as gl's defaults
+	int64_t area = (int64_t)(triangle.x[1] - triangle.x[0]) * (triangle.y[2] - triangle.y[0]) - (int64_t)(triangle.x[2] - triangle.x[0]) * (triangle.y[1] - triangle.y[0]);
+	
+	if(area <= 0) return;
+	
+	triangle.area = (double)area;
+	
+	// pixels whose centers are inside the bounds
+	int32_t half = 1 << (RASTERIZER_SUBPIXEL_BITS - 1);
+	int32_t one = 1 << RASTERIZER_SUBPIXEL_BITS;
+	
+	triangle.minX = std::max(floorDivide(std::min(triangle.x[0], std::min(triangle.x[1], triangle.x[2])) - half + one - 1, one), 0);
+	triangle.minY = std::max(floorDivide(std::min(triangle.y[0], std::min(triangle.y[1], triangle.y[2])) - half + one - 1, one), 0);
+	triangle.maxX = std::min(floorDivide(std::max(triangle.x[0], std::max(triangle.x[1], triangle.x[2])) - half, one), (int32_t)rasterizer->width - 1);
+	triangle.maxY = std::min(floorDivide(std::max(triangle.y[0], std::max(triangle.y[1], triangle.y[2])) - half, one), (int32_t)rasterizer->height - 1);
+	
+	if(triangle.minX > triangle.maxX || triangle.minY > triangle.maxY) return;
+	
+	triangle.color = color;
+	triangle.texture = texture;
+	triangle.firstLight = firstLight;
+	triangle.lightCount = lightCount;
+	
+	uint32_t index = thread.triangles->size();
+	
+	thread.triangles->push_back(triangle);
+	
+	for(int32_t ty = triangle.minY / RASTERIZER_TILE_SIZE; ty <= triangle.maxY / RASTERIZER_TILE_SIZE; ty++){
+		for(int32_t tx = triangle.minX / RASTERIZER_TILE_SIZE; tx <= triangle.maxX / RASTERIZER_TILE_SIZE; tx++){
+			thread.bins->at(ty * rasterizer->tilesX + tx).push_back(index);
+		}
+	}
+}
+
+// transform, clip and bin the triangles of a thread's instances
+void runRasterizerGeometry(SoftwareRasterizer* rasterizer, RasterizerThreadData& thread){
+	FramePacket* packet = rasterizer->packet;
+	glm::mat4 pv = packet->camera.pv;
+	
+	std::vector<Material>& materials = *rasterizer->scene->materials->materials;
+	std::vector<RasterizerVertex>& transformed = *thread.vertices;
+	
+	thread.triangles->clear();
+	
+	for(uint32_t i = 0; i < thread.bins->size(); i++){
+		thread.bins->at(i).clear();
+	}
+	
+	std::vector<RasterizerVertex> polygon;
+	std::vector<RasterizerVertex> clipped;
+	
+	for(uint32_t i = thread.firstInstance; i < thread.firstInstance + thread.instanceCount; i++){
+		VertexData* vertexData = rasterizer->instanceVertexData->at(i);
+		InstanceData& instance = packet->instances->at(i);
+		
+		if(!vertexData) continue;
+		
+		glm::vec3 color = instance.material < materials.size() ? materials[instance.material].color : glm::vec3(0);
+		RasterizerTexture* texture = instance.material < materials.size() ? rasterizer->materialTextures->at(instance.material) : NULL;
+		uint32_t firstLight = rasterizer->instanceLights->at(i * 2);
+		uint32_t lightCount = rasterizer->instanceLights->at(i * 2 + 1);
+		
+		// vertex stage, same as lighting/vertex.glsl
+		std::vector<Vertex>& vertices = *vertexData->vertices;
+		
+		transformed.resize(vertices.size());
+		
+		for(uint32_t j = 0; j < vertices.size(); j++){
+			glm::vec4 world = instance.model * glm::vec4(vertices[j].position, 1);
+			
+			transformed[j].clip = pv * world;
+			transformed[j].position = glm::vec3(world);
+			transformed[j].normal = glm::normalize(instance.normalMatrix * vertices[j].normal);
+			transformed[j].textureCoordinates = vertices[j].textureCoordinates;
+		}
+		
+		uint32_t count = vertexData->indexCount > 0 ? vertexData->indexCount : vertexData->vertexCount;
+		
+		for(uint32_t j = 0; j + 2 < count; j += 3){
+			RasterizerVertex* corners[3];
+			
+			for(uint32_t k = 0; k < 3; k++){
+				corners[k] = &transformed[vertexData->indexCount > 0 ? vertexData->indices->at(j + k) : j + k];
+			}
+			
+			// find the planes the triangle crosses, and drop it if it's completely outside any of them
+			bool outside = false;
+			uint32_t crossed = 0;
+			
+			for(uint32_t p = 0; p < RASTERIZER_CLIP_PLANES; p++){
+				uint32_t inside = 0;
+				
+				for(uint32_t k = 0; k < 3; k++){
+					if(glm::dot(g_rasterizerClipPlanes[p], corners[k]->clip) >= 0) inside++;
+				}
+				
+				if(inside == 0) outside = true;
+				if(inside != 3) crossed |= 1 << p;
+			}
+			
+			if(outside) continue;
+			
+			if(!crossed){
+				setupRasterizerTriangle(rasterizer, thread, corners, color, texture, firstLight, lightCount);
+				
+				continue;
+			}
+			
+			// clip, then draw what's left as a fan
+			polygon.assign(3, RasterizerVertex());
+			
+			for(uint32_t k = 0; k < 3; k++){
+				polygon[k] = *corners[k];
+			}
+			
+			for(uint32_t p = 0; p < RASTERIZER_CLIP_PLANES && polygon.size() >= 3; p++){
+				if(!(crossed & (1 << p))) continue;
+				
+				clipRasterizerPolygon(polygon, g_rasterizerClipPlanes[p], clipped);
+				
+				polygon.swap(clipped);
+			}
+			
+			for(uint32_t k = 1; k + 1 < polygon.size(); k++){
+				RasterizerVertex* fan[3] = {&polygon[0], &polygon[k], &polygon[k + 1]};
+				
+				setupRasterizerTriangle(rasterizer, thread, fan, color, texture, firstLight, lightCount);
+			}
+		}
+	}
+}
+
+// raster stage //
+
+// nearest texel of a texture, clamped to the edge (the same sampling createTextureData sets up)
+glm::vec3 sampleRasterizerTexture(RasterizerTexture* texture, glm::vec2 textureCoordinates){
+	int32_t x = std::min(std::max((int32_t)floorf(textureCoordinates.x * texture->width), 0), texture->width - 1);
+	int32_t y = std::min(std::max((int32_t)floorf(textureCoordinates.y * texture->height), 0), texture->height - 1);
+	
+	uint32_t texel = texture->texels->at(y * texture->width + x);
+	
+	return glm::vec3(texel & 0xff, (texel >> 8) & 0xff, (texel >> 16) & 0xff) / 255.0f;
+}
+
+// color of a pixel of a triangle, with weights being its barycentric coordinates
+// the same as lighting/fragment.glsl
+uint32_t shadeRasterizerPixel(SoftwareRasterizer* rasterizer, RasterizerTriangle& triangle, float weights[3]){
+	// perspective correct weights
+	float w0 = weights[0] * triangle.inverseW[0];
+	float w1 = weights[1] * triangle.inverseW[1];
+	float w2 = weights[2] * triangle.inverseW[2];
+	float inverseSum = 1.0f / (w0 + w1 + w2);
+	
+	w0 *= inverseSum;
+	w1 *= inverseSum;
+	w2 *= inverseSum;
+	
+	glm::vec3 position = triangle.position[0] * w0 + triangle.position[1] * w1 + triangle.position[2] * w2;
+	glm::vec3 normal = triangle.normal[0] * w0 + triangle.normal[1] * w1 + triangle.normal[2] * w2;
+	
+	glm::vec3 baseColor = triangle.color;
+	
+	if(triangle.texture) baseColor += sampleRasterizerTexture(triangle.texture, triangle.textureCoordinates[0] * w0 + triangle.textureCoordinates[1] * w1 + triangle.textureCoordinates[2] * w2);
+	
+	glm::vec3 final = baseColor * rasterizer->ambientLight;
+	
+	std::vector<glm::vec4>& lights = *rasterizer->lights;
+	
+	for(uint32_t i = triangle.firstLight; i < triangle.firstLight + triangle.lightCount; i++){
+		uint32_t light = rasterizer->lightIndices->at(i);
+		
+		glm::vec4& positionRadius = lights[light*3];
+		glm::vec4& colorC = lights[light*3 + 1];
+		glm::vec4& lq = lights[light*3 + 2];
+		
+		glm::vec3 lightRay = glm::vec3(positionRadius) - position;
+		float distance = glm::length(lightRay);
+		
+		if(distance > positionRadius.w) continue;
+		
+		float diffuse = std::max(glm::dot(normal, lightRay / distance), 0.0f);
+		float attenuation = 1 / (colorC.w + lq.x * distance + lq.y*distance*distance);
+		
+		final += baseColor * glm::vec3(colorC) * (diffuse * attenuation);
+	}
+	
+	final = glm::clamp(final, 0.0f, 1.0f) * 255.0f + 0.5f;
+	
+	return (uint32_t)final.r | ((uint32_t)final.g << 8) | ((uint32_t)final.b << 16) | 0xff000000;
+}
+
+// rasterize the part of a triangle inside a rectangle of a tile, 4 pixels at a time
+// coverage comes from fixed point edge functions (with a top-left fill rule, so shared edges are only drawn once), depth and attributes from float planes
+void rasterizeTriangle(SoftwareRasterizer* rasterizer, RasterizerTriangle& triangle, int32_t x0, int32_t y0, int32_t x1, int32_t y1){
+	int32_t one = 1 << RASTERIZER_SUBPIXEL_BITS;
+	int32_t half = one / 2;
+	
+	// fixed point position of the first pixel center
+	int64_t px = (int64_t)x0 * one + half;
+	int64_t py = (int64_t)y0 * one + half;
+	
+	int32_t edgeStart[3];
+	int32_t edgeStepX[3];
+	int32_t edgeStepY[3];
+	
+	float weightStart[3];
+	float weightStepX[3];
+	float weightStepY[3];
+	
+	for(uint32_t k = 0; k < 3; k++){
+		// edge opposite vertex k, positive on the inside
+		uint32_t a = (k + 1) % 3;
+		uint32_t b = (k + 2) % 3;
+		
+		int64_t dx = triangle.x[b] - triangle.x[a];
+		int64_t dy = triangle.y[b] - triangle.y[a];
+		
+		int64_t start = dx * (py - triangle.y[a]) - dy * (px - triangle.x[a]);
+		int64_t stepX = -dy * one;
+		int64_t stepY = dx * one;
+		
+		// barycentric coordinate of vertex k, from the exact edge value
+		weightStart[k] = (float)(start / triangle.area);
+		weightStepX[k] = (float)(stepX / triangle.area);
+		weightStepY[k] = (float)(stepY / triangle.area);
+		
+		// pixels on a top or left edge are inside, on any other edge they're outside
+		bool topLeft = dy < 0 || (dy == 0 && dx < 0);
+		
+		if(!topLeft) start -= 1;
+		
+		// the edge at the rectangle's corners, to skip edges that every pixel is inside of
+		int64_t width = x1 - x0;
+		int64_t height = y1 - y0;
+		
+		int64_t lowest = start + std::min(stepX * width, (int64_t)0) + std::min(stepY * height, (int64_t)0);
+		int64_t highest = start + std::max(stepX * width, (int64_t)0) + std::max(stepY * height, (int64_t)0);
+		
+		if(highest < 0) return;
+		
+		if(lowest >= 0){
+			edgeStart[k] = 0;
+			edgeStepX[k] = 0;
+			edgeStepY[k] = 0;
+		} else {
+			// crosses the rectangle, so every value inside it fits in 32 bits
+			edgeStart[k] = (int32_t)start;
+			edgeStepX[k] = (int32_t)stepX;
+			edgeStepY[k] = (int32_t)stepY;
+		}
+	}
+	
+	float zStart = weightStart[0] * triangle.z[0] + weightStart[1] * triangle.z[1] + weightStart[2] * triangle.z[2];
+	float zStepX = weightStepX[0] * triangle.z[0] + weightStepX[1] * triangle.z[1] + weightStepX[2] * triangle.z[2];
+	float zStepY = weightStepY[0] * triangle.z[0] + weightStepY[1] * triangle.z[1] + weightStepY[2] * triangle.z[2];
+	
+	// edge values and depth of 4 pixels next to each other, and how much they change every 4 pixels
+	__m128i offsets = _mm_set_epi32(3, 2, 1, 0);
+	
+	__m128i edgeSteps4[3];
+	__m128i edgeRowOffsets[3];
+	
+	for(uint32_t k = 0; k < 3; k++){
+		edgeSteps4[k] = _mm_set1_epi32(edgeStepX[k] * 4);
+		edgeRowOffsets[k] = _mm_set_epi32(edgeStepX[k] * 3, edgeStepX[k] * 2, edgeStepX[k], 0);
+	}
+	
+	__m128 zOffsets = _mm_mul_ps(_mm_cvtepi32_ps(offsets), _mm_set1_ps(zStepX));
+	__m128 zStep4 = _mm_set1_ps(zStepX * 4);
+	
+	std::vector<uint32_t>& colorBuffer = *rasterizer->colorBuffer;
+	std::vector<float>& depthBuffer = *rasterizer->depthBuffer;
+	
+	// groups of 4 pixels start at multiples of 4, like the tile (and the padded rows), so every load stays inside the tile
+	int32_t groupStart = x0 & ~3;
+	int32_t lead = x0 - groupStart;
+	
+	for(int32_t y = y0; y <= y1; y++){
+		int32_t row = y - y0;
+		
+		__m128i edges[3];
+		
+		for(uint32_t k = 0; k < 3; k++){
+			edges[k] = _mm_add_epi32(_mm_set1_epi32(edgeStart[k] + edgeStepY[k] * row - edgeStepX[k] * lead), edgeRowOffsets[k]);
+		}
+		
+		__m128 depth = _mm_add_ps(_mm_set1_ps(zStart + zStepY * row - zStepX * lead), zOffsets);
+		
+		for(int32_t x = groupStart; x <= x1; x += 4){
+			// a pixel is covered if none of its edge values are negative
+			__m128i signs = _mm_or_si128(edges[0], _mm_or_si128(edges[1], edges[2]));
+			
+			int32_t covered = ~_mm_movemask_ps(_mm_castsi128_ps(signs)) & 0xf;
+			
+			// before the start or past the end of the rectangle
+			if(x < x0) covered &= ~((1 << (x0 - x)) - 1);
+			if(x1 - x < 3) covered &= (1 << (x1 - x + 1)) - 1;
+			
+			if(covered){
+				uint32_t pixel = y * rasterizer->stride + x;
+				
+				// depth test, less like gl's default
+				int32_t passed = covered & _mm_movemask_ps(_mm_cmplt_ps(depth, _mm_loadu_ps(&depthBuffer[pixel])));
+				
+				if(passed){
+					float depths[4];
+					
+					_mm_storeu_ps(depths, depth);
+					
+					for(int32_t i = 0; i < 4; i++){
+						if(!(passed & (1 << i))) continue;
+						
+						int32_t column = x - x0 + i;
+						
+						float weights[3];
+						
+						for(uint32_t k = 0; k < 3; k++){
+							weights[k] = weightStart[k] + weightStepX[k] * column + weightStepY[k] * row;
+						}
+						
+						colorBuffer[pixel + i] = shadeRasterizerPixel(rasterizer, triangle, weights);
+						depthBuffer[pixel + i] = depths[i];
+					}
+				}
+			}
+			
+			for(uint32_t k = 0; k < 3; k++){
+				edges[k] = _mm_add_epi32(edges[k], edgeSteps4[k]);
+			}
+			
+			depth = _mm_add_ps(depth, zStep4);
+		}
+	}
+}
+
+// clear tiles and rasterize everything binned to them until there are no tiles left
+void runRasterizerTiles(SoftwareRasterizer* rasterizer){
+	uint32_t tileCount = rasterizer->tilesX * rasterizer->tilesY;
+	
+	while(true){
+		uint32_t tile = (*rasterizer->nextTile)++;
+		
+		if(tile >= tileCount) return;
+		
+		int32_t x0 = (tile % rasterizer->tilesX) * RASTERIZER_TILE_SIZE;
+		int32_t y0 = (tile / rasterizer->tilesX) * RASTERIZER_TILE_SIZE;
+		int32_t x1 = std::min(x0 + RASTERIZER_TILE_SIZE, (int32_t)rasterizer->width) - 1;
+		int32_t y1 = std::min(y0 + RASTERIZER_TILE_SIZE, (int32_t)rasterizer->height) - 1;
+		
+		for(int32_t y = y0; y <= y1; y++){
+			std::fill(rasterizer->colorBuffer->begin() + y * rasterizer->stride + x0, rasterizer->colorBuffer->begin() + y * rasterizer->stride + x1 + 1, RASTERIZER_CLEAR_COLOR);
+			std::fill(rasterizer->depthBuffer->begin() + y * rasterizer->stride + x0, rasterizer->depthBuffer->begin() + y * rasterizer->stride + x1 + 1, 1.0f);
+		}
+		
+		// threads set up consecutive runs of instances, so going through them in order keeps submission order
+		for(uint32_t i = 0; i < rasterizer->threadCount; i++){
+			RasterizerThreadData& thread = rasterizer->threads->at(i);
+			std::vector<uint32_t>& bin = thread.bins->at(tile);
+			
+			for(uint32_t j = 0; j < bin.size(); j++){
+				RasterizerTriangle& triangle = thread.triangles->at(bin[j]);
+				
+				rasterizeTriangle(rasterizer, triangle, std::max(x0, triangle.minX), std::max(y0, triangle.minY), std::min(x1, triangle.maxX), std::min(y1, triangle.maxY));
+			}
+		}
+	}
+}
+
+// threads //
+
+// run a thread's part of a stage
+void runRasterizerStageWork(SoftwareRasterizer* rasterizer, uint32_t stage, uint32_t index){
+	switch(stage){
+		case RASTERIZER_STAGE_GEOMETRY: {
+			runRasterizerGeometry(rasterizer, rasterizer->threads->at(index));
+			
+			break;
+		}
+		case RASTERIZER_STAGE_RASTER: {
+			runRasterizerTiles(rasterizer);
+			
+			break;
+		}
+	}
+}
+
+// body of each worker thread, runs its part of every stage until the rasterizer is destroyed
+void runRasterizerWorker(SoftwareRasterizer* rasterizer, uint32_t index){
+	uint32_t generation = 0;
+	
+	while(true){
+		uint32_t stage = 0;
+		
+		{
+			std::unique_lock<std::mutex> lock(*rasterizer->mutex);
+			
+			while(rasterizer->generation == generation && !rasterizer->quit){
+				rasterizer->condition->wait(lock);
+			}
+			
+			if(rasterizer->quit) return;
+			
+			generation = rasterizer->generation;
+			stage = rasterizer->stage;
+		}
+		
+		runRasterizerStageWork(rasterizer, stage, index);
+		
+		{
+			std::lock_guard<std::mutex> lock(*rasterizer->mutex);
+			
+			rasterizer->busyWorkers--;
+		}
+		
+		rasterizer->condition->notify_all();
+	}
+}
+
+// run a stage on every thread (the calling thread being thread 0) and wait for all of them to finish
+void runRasterizerStage(SoftwareRasterizer* rasterizer, uint32_t stage){
+	{
+		std::lock_guard<std::mutex> lock(*rasterizer->mutex);
+		
+		rasterizer->stage = stage;
+		rasterizer->generation++;
+		rasterizer->busyWorkers = rasterizer->workers->size();
+	}
+	
+	rasterizer->condition->notify_all();
+	
+	runRasterizerStageWork(rasterizer, stage, 0);
+	
+	std::unique_lock<std::mutex> lock(*rasterizer->mutex);
+	
+	while(rasterizer->busyWorkers > 0){
+		rasterizer->condition->wait(lock);
+	}
+}
+
+// frames //
+
+// draw a frame packet into the color buffer, then write it out if there's an image path
+// expects a packet with instances (any render mode but batched)
+void renderSoftwareRasterizerFrame(SoftwareRasterizer* rasterizer, FramePacket* packet){
+	double start = glfwGetTime();
+	
+	setupRasterizerFrame(rasterizer, packet);
+	
+	runRasterizerStage(rasterizer, RASTERIZER_STAGE_GEOMETRY);
+	
+	double geometryEnd = glfwGetTime();
+	
+	*rasterizer->nextTile = 0;
+	
+	runRasterizerStage(rasterizer, RASTERIZER_STAGE_RASTER);
+	
+	double rasterEnd = glfwGetTime();
+	
+	if(rasterizer->imagePath) writeSoftwareRasterizerImage(rasterizer, rasterizer->imagePath);
+	
+	double time = glfwGetTime();
+	
+	// update stats
+	rasterizer->statsGeometryTime += geometryEnd - start;
+	rasterizer->statsRasterTime += rasterEnd - geometryEnd;
+	rasterizer->statsWriteTime += time - rasterEnd;
+	rasterizer->statsFrames++;
+	
+	for(uint32_t i = 0; i < rasterizer->threadCount; i++){
+		RasterizerThreadData& thread = rasterizer->threads->at(i);
+		
+		rasterizer->statsTriangles += thread.triangles->size();
+		
+		for(uint32_t j = 0; j < thread.bins->size(); j++){
+			rasterizer->statsBinnedTriangles += thread.bins->at(j).size();
+		}
+	}
+	
+	if(time - rasterizer->statsStart >= 1.0){
+		uint32_t frames = rasterizer->statsFrames;
+		
+		if(rasterizer->printStats){
+			printf("software fps: %d (%d threads), triangles/frame: %.0f, tiles/triangle: %.2f, geometry ms/frame: %.3f, raster ms/frame: %.3f, write ms/frame: %.3f\n", frames, rasterizer->threadCount, rasterizer->statsTriangles / frames, rasterizer->statsBinnedTriangles / std::max(rasterizer->statsTriangles, 1.0), rasterizer->statsGeometryTime * 1000.0 / frames, rasterizer->statsRasterTime * 1000.0 / frames, rasterizer->statsWriteTime * 1000.0 / frames);
+		}
+		
+		rasterizer->statsFrames = 0;
+		rasterizer->statsGeometryTime = 0.0;
+		rasterizer->statsRasterTime = 0.0;
+		rasterizer->statsWriteTime = 0.0;
+		rasterizer->statsTriangles = 0.0;
+		rasterizer->statsBinnedTriangles = 0.0;
+		rasterizer->statsStart = time;
+	}
+}
+
+// write the last frame as a binary .ppm image
+bool writeSoftwareRasterizerImage(SoftwareRasterizer* rasterizer, const char* path){
+	FILE* file = fopen(path, "wb");
+	
+	if(!file){
+		printf("Couldn't open %s for writing\n", path);
+		
+		return false;
+	}
+	
+	fprintf(file, "P6\n%d %d\n255\n", rasterizer->width, rasterizer->height);
+	
+	std::vector<uint8_t> row(rasterizer->width * 3);
+	
+	// first row of the file is the top of the image
+	for(uint32_t y = 0; y < rasterizer->height; y++){
+		uint32_t* pixels = &rasterizer->colorBuffer->at((rasterizer->height - 1 - y) * rasterizer->stride);
+		
+		for(uint32_t x = 0; x < rasterizer->width; x++){
+			row[x*3] = pixels[x] & 0xff;
+			row[x*3 + 1] = (pixels[x] >> 8) & 0xff;
+			row[x*3 + 2] = (pixels[x] >> 16) & 0xff;
+		}
+		
+		fwrite(&row[0], 1, row.size(), file);
+	}
+	
+	bool written = !ferror(file);
+	
+	fclose(file);
+	
+	return written;
+}
\ No newline at end of file
@@ -0,0 +1,83 @@
+// renderer backends
+
+#include <renderer.h>
+#include <utils.h>
+
+// backend names, for stats and messages
+const char* g_rendererBackendNames[] = {
+	"opengl",
+	"software"
+};
+
+// create a renderer that draws with a frame renderer (and the gl context of its window)
+Renderer* createOpenGlRenderer(FrameRenderer* frameRenderer){
+	Renderer* renderer = allocateMemoryForType<Renderer>();
+	
+	renderer->backend = RENDERER_OPENGL;
+	renderer->frameRenderer = frameRenderer;
+	renderer->softwareRasterizer = NULL;
+	
+	return renderer;
+}
+
+// create a renderer that draws with a software rasterizer (which doesn't use gl at all)
+Renderer* createSoftwareRenderer(SoftwareRasterizer* softwareRasterizer){
+	Renderer* renderer = allocateMemoryForType<Renderer>();
+	
+	renderer->backend = RENDERER_SOFTWARE;
+	renderer->frameRenderer = NULL;
+	renderer->softwareRasterizer = softwareRasterizer;
+	
+	return renderer;
+}
+
+const char* getRendererBackendName(RendererBackend backend){
+	return g_rendererBackendNames[backend];
+}
+
+// draw a frame packet and present it
+// has to be called from the thread the renderer is attached to (see attachRendererThread), or the main thread if there's no render thread
+void renderFrame(Renderer* renderer, FramePacket* packet){
+	switch(renderer->backend){
+		case RENDERER_OPENGL: {
+			renderFramePacket(renderer->frameRenderer, packet);
+			
+			break;
+		}
+		case RENDERER_SOFTWARE: {
+			renderSoftwareRasterizerFrame(renderer->softwareRasterizer, packet);
+			
+			break;
+		}
+	}
+}
+
+// take whatever the backend needs to draw from the calling thread, like the gl context
+// called on the render thread before it draws its first frame, the thread that had it loses it
+void attachRendererThread(Renderer* renderer){
+	switch(renderer->backend){
+		case RENDERER_OPENGL: {
+			if(renderer->frameRenderer->window) setWindowContextCurrent(renderer->frameRenderer->window);
+			
+			break;
+		}
+		case RENDERER_SOFTWARE: {
+			// nothing to take, its worker threads are its own
+			break;
+		}
+	}
+}
+
+// give up what attachRendererThread took, so another thread can attach
+void detachRendererThread(Renderer* renderer){
+	switch(renderer->backend){
+		case RENDERER_OPENGL: {
+			if(renderer->frameRenderer->window) setWindowContextCurrent(NULL);
+			
+			break;
+		}
+		case RENDERER_SOFTWARE: {
+			break;
+		}
+	}
+}
\ No newline at end of file
@@ -0,0 +1,501 @@
+// render thread
+
+#include <renderthread.h>
+#include <programcache.h>
+#include <renderer.h>
+#include <textureloader.h>
+
+#include <algorithm>
+#include <cstdio>
+
+// frame packets //
+
+// create an empty frame packet
+FramePacket* createFramePacket(){
+	FramePacket* packet = allocateMemoryForType<FramePacket>();
+	
+	packet->frame = 0;
+	
+	packet->instances = new std::vector<InstanceData>();
+	packet->instanceGroups = new std::vector<InstanceGroup>();
+	
+	packet->lights = new std::vector<PointLight>();
+	packet->lightSources = new std::vector<PointLight*>();
+	
+	packet->simulationTime = 0.0;
+	packet->simulationWaitTime = 0.0;
+	
+	packet->renderWaitTime = 0.0;
+	
+	return packet;
+}
+
+// fill a packet with everything needed to draw the scene from camera
+// call after the world has been updated for the frame, doesn't touch gl
+void buildFramePacket(FramePacket* packet, Scene* scene, PerspectiveCamera* camera, SceneRenderMode mode){
+	updateCameraMatrices(camera);
+	
+	packet->camera = *camera;
+	
+	// batches are culled by cluster when they're drawn, the clusters never change so the render thread can do it itself
+	if(mode == RENDER_BATCHED){
+		packet->instances->clear();
+		packet->instanceGroups->clear();
+	} else {
+		collectSceneInstances(scene, camera, *packet->instances, *packet->instanceGroups);
+		sortSceneInstanceGroups(*packet->instanceGroups, mode);
+	}
+	
+	// copy lights, the change is carried by the copy so the light itself is clean again
+	packet->lights->clear();
+	packet->lightSources->clear();
+	
+	for(uint32_t i = 0; i < scene->pointLights->size(); i++){
+		PointLight* light = scene->pointLights->at(i);
+		
+		if(light == NULL) continue;
+		
+		packet->lights->push_back(*light);
+		packet->lightSources->push_back(light);
+		
+		light->dirty = false;
+	}
+}
+
+// frame renderer //
+
+// create a frame renderer that draws the scene in mode with program/instancedProgram
+// expects the window's context to be current, pre-pass, deferred shading, dynamic resolution, overdraw and stats are off until set
+// window is NULL when running headless (see initHeadlessGraphics), frames are drawn but never presented
+FrameRenderer* createFrameRenderer(Window* window, Scene* scene, uint32_t width, uint32_t height, SceneRenderMode mode, ShaderProgramEx* program, ShaderProgramEx* instancedProgram){
+	FrameRenderer* renderer = allocateMemoryForType<FrameRenderer>();
+	
+	renderer->window = window;
+	renderer->scene = scene;
+	
+	renderer->width = width;
+	renderer->height = height;
+	
+	renderer->mode = mode;
+	renderer->program = program;
+	renderer->instancedProgram = instancedProgram;
+	
+	renderer->depthPrepass = NULL;
+	renderer->deferredRenderer = NULL;
+	renderer->dynamicResolution = NULL;
+	renderer->showOverdraw = false;
+	
+	renderer->printStats = false;
+	renderer->startTime = 0.0;
+	
+	renderer->lights = new std::vector<PointLight*>();
+	renderer->lightSources = new std::vector<PointLight*>();
+	
+	renderer->gpuTimer = 0;
+	renderer->gpuTimerPending = false;
+	
+	glGenQueries(1, &renderer->gpuTimer);
+	
+	renderer->samplesQuery = 0;
+	renderer->samplesQueryPending = false;
+	
+	glGenQueries(1, &renderer->samplesQuery);
+	
+	renderer->statsFrames = 0;
+	renderer->statsStart = glfwGetTime();
+	renderer->statsRenderTime = 0.0;
+	renderer->statsGpuTime = 0.0;
+	renderer->statsShadedSamples = 0.0;
+	renderer->statsPixels = 0.0;
+	renderer->statsResolutionScale = 0.0;
+	renderer->statsSimulationTime = 0.0;
+	renderer->statsSimulationWaitTime = 0.0;
+	renderer->statsFrameTime = 0.0;
+	renderer->statsRenderWaitTime = 0.0;
+	
+	return renderer;
+}
+
+// copy a packet's lights into the renderer's own lights, marking the ones that changed dirty
+void updateFrameRendererLights(FrameRenderer* renderer, FramePacket* packet){
+	uint32_t lightCount = packet->lights->size();
+	
+	// lights were removed
+	while(renderer->lights->size() > lightCount){
+		free(renderer->lights->back());
+		
+		renderer->lights->pop_back();
+		renderer->lightSources->pop_back();
+	}
+	
+	for(uint32_t i = 0; i < lightCount; i++){
+		PointLight& source = packet->lights->at(i);
+		
+		// new slot
+		if(i >= renderer->lights->size()){
+			renderer->lights->push_back(allocateMemoryForType<PointLight>());
+			renderer->lightSources->push_back(NULL);
+		}
+		
+		// a different light ended up in this slot, or the light itself changed
+		if(renderer->lightSources->at(i) != packet->lightSources->at(i) || source.dirty){
+			PointLight* light = renderer->lights->at(i);
+			
+			*light = source;
+			light->dirty = true;
+			
+			renderer->lightSources->at(i) = packet->lightSources->at(i);
+		}
+	}
+}
+
+// draw a packet's objects with program/instancedProgram
+// the instances are expected to be uploaded already
+void drawFramePacket(FrameRenderer* renderer, FramePacket* packet, ShaderProgramEx* program, ShaderProgramEx* instancedProgram){
+	Scene* scene = renderer->scene;
+	
+	switch(renderer->mode){
+		case RENDER_PER_OBJECT: {
+			useProgramEx(program);
+			
+			drawSceneInstancesPerObject(scene, *packet->instances, *packet->instanceGroups, &packet->camera, program);
+			
+			break;
+		}
+		case RENDER_INSTANCED: {
+			useProgramEx(instancedProgram);
+			
+			drawSceneInstanced(scene, *packet->instanceGroups, instancedProgram);
+			
+			break;
+		}
+		case RENDER_MULTI_DRAW: {
+			useProgramEx(instancedProgram);
+			
+			drawSceneMultiDraw(scene, *packet->instanceGroups, instancedProgram);
+			
+			break;
+		}
+		case RENDER_BATCHED: {
+			useProgramEx(program);
+			
+			drawSceneBatched(scene, &packet->camera, program);
+			
+			break;
+		}
+	}
+}
+
+// draw a frame packet and swap buffers
+// has to be called from whichever thread the window's context is current on
+void renderFramePacket(FrameRenderer* renderer, FramePacket* packet){
+	Scene* scene = renderer->scene;
+	
+	double renderStart = glfwGetTime();
+	
+	// upload textures that finished decoding, and list how long they all took once the last one is in
+	if(updateTextureLoads(TEXTURE_UPLOAD_BUDGET) > 0 && getPendingTextureLoadCount() == 0 && renderer->printStats) printTextureLoadTimings();
+	
+	// read last frame's gpu time
+	if(renderer->gpuTimerPending){
+		GLuint64 gpuTime = 0;
+		
+		glGetQueryObjectui64v(renderer->gpuTimer, GL_QUERY_RESULT, &gpuTime);
+		
+		renderer->statsGpuTime += gpuTime / 1.0e9;
+		renderer->gpuTimerPending = false;
+		
+		// pick this frame's resolution from it
+		if(renderer->dynamicResolution) updateDynamicResolution(renderer->dynamicResolution, gpuTime / 1.0e9);
+	}
+	
+	if(renderer->samplesQueryPending){
+		GLuint samples = 0;
+		
+		glGetQueryObjectuiv(renderer->samplesQuery, GL_QUERY_RESULT, &samples);
+		
+		renderer->statsShadedSamples += samples;
+		renderer->samplesQueryPending = false;
+	}
+	
+	glBeginQuery(GL_TIME_ELAPSED, renderer->gpuTimer);
+	
+	// render calls //
+	if(renderer->dynamicResolution) beginDynamicResolution(renderer->dynamicResolution);
+	
+	if(renderer->showOverdraw){
+		clearWindow(0.0f, 0.0f, 0.0f);
+	} else {
+		clearWindow(0.3f, 0.0f, 0.0f);
+	}
+	
+	// update lights and camera, and upload the visible instances once for every pass
+	updateFrameRendererLights(renderer, packet);
+	updateSceneUniformBuffers(scene, &packet->camera, *renderer->lights);
+	
+	if(renderer->mode == RENDER_INSTANCED || renderer->mode == RENDER_MULTI_DRAW) uploadSceneInstances(scene, *packet->instances);
+	
+	if(renderer->deferredRenderer) beginDeferredGeometryPass(renderer->deferredRenderer);
+	
+	// depth only pass with the same render mode, so the main pass has exactly the same depth to test against
+	if(renderer->depthPrepass){
+		beginDepthPrepass(renderer->depthPrepass);
+		
+		drawFramePacket(renderer, packet, renderer->depthPrepass->program, renderer->depthPrepass->instancedProgram);
+		
+		beginDepthPrepassMainPass(renderer->depthPrepass);
+	}
+	
+	// add up every shaded fragment
+	if(renderer->showOverdraw){
+		glEnable(GL_BLEND);
+		glBlendFunc(GL_ONE, GL_ONE);
+	}
+	
+	glBeginQuery(GL_SAMPLES_PASSED, renderer->samplesQuery);
+	
+	drawFramePacket(renderer, packet, renderer->program, renderer->instancedProgram);
+	
+	glEndQuery(GL_SAMPLES_PASSED);
+	
+	renderer->samplesQueryPending = true;
+	
+	if(renderer->showOverdraw) glDisable(GL_BLEND);
+	
+	if(renderer->depthPrepass) endDepthPrepass(renderer->depthPrepass);
+	
+	// light the g-buffer
+	if(renderer->deferredRenderer) renderDeferredLighting(renderer->deferredRenderer, scene);
+	
+	// upscale into the window, timed along with the rest so the scale accounts for it
+	if(renderer->dynamicResolution) endDynamicResolution(renderer->dynamicResolution);
+	
+	glEndQuery(GL_TIME_ELAPSED);
+	
+	renderer->gpuTimerPending = true;
+	
+	// update stats (cpu time only covers submitting the scene, not waiting on the gpu)
+	double time = glfwGetTime();
+	
+	renderer->statsRenderTime += time - renderStart;
+	renderer->statsSimulationTime += packet->simulationTime;
+	renderer->statsSimulationWaitTime += packet->simulationWaitTime;
+	renderer->statsRenderWaitTime += packet->renderWaitTime;
+	renderer->statsFrameTime += packet->renderWaitTime;
+	renderer->statsFrames++;
+	
+	if(renderer->dynamicResolution){
+		renderer->statsPixels += renderer->dynamicResolution->renderWidth * renderer->dynamicResolution->renderHeight;
+		renderer->statsResolutionScale += renderer->dynamicResolution->scale;
+	} else {
+		renderer->statsPixels += renderer->width * renderer->height;
+		renderer->statsResolutionScale += 1.0;
+	}
+	
+	if(time - renderer->statsStart >= 1.0){
+		RenderStats* stats = getRenderStats();
+		StreamBufferStats* streamStats = getStreamBufferStats();
+		uint32_t frames = renderer->statsFrames;
+		
+		if(renderer->printStats){
+			printf("fps: %d, draw calls/frame: %.1f, objects/frame: %.1f, light uploads: %d, vao binds/frame: %.1f, shaded samples/pixel: %.2f, render cpu ms/frame: %.3f, render gpu ms/frame: %.3f, stream kb/frame: %.1f, fence waits: %d (%.3f ms)\n", frames, (float)stats->drawCalls / frames, (float)stats->objectsRendered / frames, stats->lightUploads, (float)stats->vertexArrayBinds / frames, renderer->statsShadedSamples / renderer->statsPixels, renderer->statsRenderTime * 1000.0 / frames, renderer->statsGpuTime * 1000.0 / frames, streamStats->bytesWritten / 1024.0 / frames, streamStats->fenceWaits, streamStats->fenceWaitTime * 1000.0);
+			
+			// busy time on each thread, when both add up to more than the frame time the threads overlapped
+			double frameTime = (time - renderer->statsStart) / frames;
+			double simulationBusy = renderer->statsSimulationTime / frames;
+			double renderBusy = (renderer->statsFrameTime - renderer->statsRenderWaitTime) / frames;
+			
+			printf("frame ms: %.3f, simulation ms/frame: %.3f (waiting %.3f), render thread ms/frame: %.3f (waiting %.3f), overlap ms/frame: %.3f\n", frameTime * 1000.0, simulationBusy * 1000.0, renderer->statsSimulationWaitTime * 1000.0 / frames, renderBusy * 1000.0, renderer->statsRenderWaitTime * 1000.0 / frames, std::max(simulationBusy + renderBusy - frameTime, 0.0) * 1000.0);
+			
+			// gl calls issued/skipped by the state cache
+			GlStateStats* glStats = getGlStateStats();
+			
+			printf("gl state/frame (issued/elided): programs %.1f/%.1f, vaos %.1f/%.1f, texture units %.1f/%.1f, textures %.1f/%.1f, uniforms %.1f/%.1f\n", (float)glStats->programs.issued / frames, (float)glStats->programs.elided / frames, (float)glStats->vertexArrays.issued / frames, (float)glStats->vertexArrays.elided / frames, (float)glStats->textureUnits.issued / frames, (float)glStats->textureUnits.elided / frames, (float)glStats->textures.issued / frames, (float)glStats->textures.elided / frames, (float)glStats->uniforms.issued / frames, (float)glStats->uniforms.elided / frames);
+			
+			if(renderer->dynamicResolution){
+				DynamicResolution* resolution = renderer->dynamicResolution;
+				
+				printf("resolution scale: %.2f (now %dx%d of %dx%d), target gpu ms/frame: %.3f\n", renderer->statsResolutionScale / frames, resolution->renderWidth, resolution->renderHeight, resolution->width, resolution->height, resolution->targetFrameTime * 1000.0);
+			}
+		}
+		
+		resetRenderStats();
+		resetGlStateStats();
+		resetStreamBufferStats();
+		renderer->statsFrames = 0;
+		renderer->statsRenderTime = 0.0;
+		renderer->statsGpuTime = 0.0;
+		renderer->statsShadedSamples = 0.0;
+		renderer->statsPixels = 0.0;
+		renderer->statsResolutionScale = 0.0;
+		renderer->statsSimulationTime = 0.0;
+		renderer->statsSimulationWaitTime = 0.0;
+		renderer->statsFrameTime = 0.0;
+		renderer->statsRenderWaitTime = 0.0;
+		renderer->statsStart = time;
+	}
+	
+	// fence this frame's stream buffer writes
+	endStreamBufferFrame();
+	
+	// swap buffers (a headless run has no window)
+	if(renderer->window) swapWindowBuffers(renderer->window);
+	
+	renderer->statsFrameTime += glfwGetTime() - renderStart;
+	
+	// startup cost, including how much of it went into making programs (compare runs with and without a warm program cache)
+	if(renderer->startTime > 0.0){
+		ProgramCacheStats* cacheStats = getProgramCacheStats();
+		
+		printf("time to first frame: %.3f s, programs: %d cached, %d compiled, %d rejected (%.3f ms creating them), textures still loading: %d\n", glfwGetTime() - renderer->startTime, cacheStats->hits, cacheStats->misses, cacheStats->rejected, cacheStats->time * 1000.0, getPendingTextureLoadCount());
+		
+		renderer->startTime = 0.0;
+	}
+}
+
+// render thread //
+
+// body of the render thread, draws packets as they're submitted until the thread is stopped
+void runRenderThread(RenderThread* renderThread){
+	Renderer* renderer = renderThread->renderer;
+	
+	attachRendererThread(renderer);
+	
+	while(true){
+		// wait for a packet
+		double waitStart = glfwGetTime();
+		
+		int32_t index = -1;
+		
+		{
+			std::unique_lock<std::mutex> lock(*renderThread->mutex);
+			
+			while(true){
+				for(uint32_t i = 0; i < 2; i++){
+					if(renderThread->states[i] == FRAME_PACKET_PENDING) index = i;
+				}
+				
+				if(index != -1 || renderThread->quit) break;
+				
+				renderThread->condition->wait(lock);
+			}
+			
+			if(index == -1) break;
+			
+			renderThread->states[index] = FRAME_PACKET_RENDERING;
+		}
+		
+		renderThread->condition->notify_all();
+		
+		FramePacket* packet = renderThread->packets[index];
+		
+		packet->renderWaitTime = glfwGetTime() - waitStart;
+		
+		renderFrame(renderer, packet);
+		
+		// hand the packet back
+		{
+			std::lock_guard<std::mutex> lock(*renderThread->mutex);
+			
+			renderThread->states[index] = FRAME_PACKET_FREE;
+		}
+		
+		renderThread->condition->notify_all();
+	}
+	
+	// the main thread takes the renderer back
+	detachRendererThread(renderer);
+}
+
+// start drawing frames on a new thread
+// the calling thread is detached from the renderer (for gl, it can't make gl calls) until stopRenderThread
+RenderThread* startRenderThread(Renderer* renderer){
+	RenderThread* renderThread = allocateMemoryForType<RenderThread>();
+	
+	renderThread->renderer = renderer;
+	
+	for(uint32_t i = 0; i < 2; i++){
+		renderThread->packets[i] = createFramePacket();
+		renderThread->states[i] = FRAME_PACKET_FREE;
+	}
+	
+	renderThread->quit = false;
+	
+	renderThread->mutex = new std::mutex();
+	renderThread->condition = new std::condition_variable();
+	
+	detachRendererThread(renderer);
+	
+	renderThread->thread = new std::thread(runRenderThread, renderThread);
+	
+	return renderThread;
+}
+
+// get a packet to build the next frame into
+// waits until the last submitted packet has been picked up and the one before it has been drawn, so the simulation stays at most one frame ahead
+FramePacket* beginFramePacket(RenderThread* renderThread){
+	double waitStart = glfwGetTime();
+	
+	std::unique_lock<std::mutex> lock(*renderThread->mutex);
+	
+	int32_t index = -1;
+	
+	while(true){
+		bool pending = false;
+		
+		index = -1;
+		
+		for(uint32_t i = 0; i < 2; i++){
+			if(renderThread->states[i] == FRAME_PACKET_PENDING) pending = true;
+			if(renderThread->states[i] == FRAME_PACKET_FREE) index = i;
+		}
+		
+		if(!pending && index != -1) break;
+		
+		renderThread->condition->wait(lock);
+	}
+	
+	renderThread->states[index] = FRAME_PACKET_WRITING;
+	
+	FramePacket* packet = renderThread->packets[index];
+	
+	packet->simulationWaitTime = glfwGetTime() - waitStart;
+	
+	return packet;
+}
+
+// hand a packet built since beginFramePacket to the render thread
+void submitFramePacket(RenderThread* renderThread, FramePacket* packet){
+	{
+		std::lock_guard<std::mutex> lock(*renderThread->mutex);
+		
+		for(uint32_t i = 0; i < 2; i++){
+			if(renderThread->packets[i] == packet) renderThread->states[i] = FRAME_PACKET_PENDING;
+		}
+	}
+	
+	renderThread->condition->notify_all();
+}
+
+// draw whatever was already submitted, then stop the render thread and attach the renderer to the calling thread again
+void stopRenderThread(RenderThread* renderThread){
+	{
+		std::lock_guard<std::mutex> lock(*renderThread->mutex);
+		
+		renderThread->quit = true;
+	}
+	
+	renderThread->condition->notify_all();
+	
+	renderThread->thread->join();
+	
+	attachRendererThread(renderThread->renderer);
+	
+	delete renderThread->thread;
+	delete renderThread->mutex;
+	delete renderThread->condition;
+	
+	renderThread->thread = NULL;
+	renderThread->mutex = NULL;
+	renderThread->condition = NULL;
+}
\ No newline at end of file
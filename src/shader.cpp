@@ -1,8 +1,11 @@
 // shader management
 
 #include <shader.h>
+#include <programcache.h>
 #include <utils.h>
 
+#include <GLFW/glfw3.h>
+
 #include <glm/glm.hpp>
 #include <glm/ext.hpp>
 
@@ -11,6 +14,34 @@
 #include <string>
 #include <cstring>
 
+// names of the uniforms in ProgramUniform, in the same order
+const char* g_programUniformNames[UNIFORM_COUNT] = {
+	"pvm",
+	"model",
+	"normalMatrix",
+	"color",
+	"texture1",
+	"numPointLights",
+	"lightData",
+	"clusterData",
+	"clusterLightIndices",
+	"textureArray",
+	"lightmap",
+	"lightmapRect",
+	"materialData"
+};
+
+// names of the fields in PointLightField, in the same order
+const char* g_pointLightFieldNames[POINT_LIGHT_FIELD_COUNT] = {
+	"position",
+	"color",
+	"ambientStrength",
+	"diffuseStrength",
+	"c",
+	"l",
+	"q"
+};
+
 GLuint createShader(GLenum shaderType, const char* source){
 	// read the contents of the source file
 	char* contents = read_entire_file(source);
@@ -18,18 +49,25 @@ GLuint createShader(GLenum shaderType, const char* source){
 	// check for valid contents
 	if(contents == NULL) return NULL_SHADER;
 	
+	GLuint shader = createShaderFromSource(shaderType, contents);
+	
+	// free contents
+	free(contents);
+	
+	return shader;
+}
+
+// compiles a shader from the glsl in source
+GLuint createShaderFromSource(GLenum shaderType, const char* source){
 	// create shader object
 	GLuint shader = glCreateShader(shaderType);
 	
 	// load shader source
-	glShaderSource(shader, 1, &contents, NULL);
+	glShaderSource(shader, 1, &source, NULL);
 	
 	// compile
 	glCompileShader(shader);
 	
-	// free contents
-	free(contents);
-	
 	// get compile status and log errors
 	GLint shaderCompiled = 0;
 	glGetShaderiv(shader, GL_COMPILE_STATUS, &shaderCompiled);
@@ -76,6 +114,9 @@ GLuint createShaderProgram(GLuint vertexShader, GLuint fragmentShader, bool dele
 	// create program
 	GLuint shaderProgram = glCreateProgram();
 	
+	// so the program cache can save it
+	hintProgramBinaryRetrievable(shaderProgram);
+	
 	// attach shaders
 	glAttachShader(shaderProgram, vertexShader);
 	glAttachShader(shaderProgram, fragmentShader);
@@ -127,33 +168,118 @@ GLchar* getShaderProgramInfoLog(GLuint shaderProgram){
 }
 
 ShaderProgramEx* createShaderProgramEx(GLuint vertexShader, GLuint fragmentShader, bool deleteShaders){
-	// allocate memory
-	ShaderProgramEx* programEx = allocateMemoryForType<ShaderProgramEx>();
+	return createShaderProgramExFromProgram(createShaderProgram(vertexShader, fragmentShader, deleteShaders));
+}
+
+// creates a program from a vertex and fragment shader file, loading it from the program cache when it has the same sources cached (see programcache.h)
+// otherwise the shaders are compiled and linked as usual, and the result is added to the cache
+ShaderProgramEx* loadShaderProgramEx(const char* vertexPath, const char* fragmentPath){
+	return loadShaderProgramEx(vertexPath, fragmentPath, NULL);
+}
+
+// insert lines of glsl (like #defines) into a shader's source, right after its #version line
+// returns a new buffer (free when done), or NULL if source is NULL
+char* insertShaderSourceLines(char* source, const char* lines){
+	if(!source) return NULL;
 	
-	// create gl shader program
-	programEx->program = createShaderProgram(vertexShader, fragmentShader, deleteShaders);
+	std::string contents = std::string(source);
 	
-	// make sure program compiled
-	if(programEx->program == NULL_SHADER_PROGRAM){
-		free(programEx);
+	size_t lineEnd = contents.find('\n');
+	
+	contents.insert(lineEnd == std::string::npos ? contents.size() : lineEnd + 1, lines);
+	
+	char* inserted = (char*)malloc(contents.size() + 1);
+	
+	memcpy(inserted, contents.c_str(), contents.size() + 1);
+	
+	return inserted;
+}
+
+// same as above, with defines (#define lines, see getShaderPermutationDefines) added to both shaders
+// the defines become part of the sources, so each set of them is cached separately
+ShaderProgramEx* loadShaderProgramEx(const char* vertexPath, const char* fragmentPath, const char* defines){
+	double start = glfwGetTime();
+	
+	char* vertexSource = read_entire_file(vertexPath);
+	char* fragmentSource = read_entire_file(fragmentPath);
+	
+	if(defines){
+		char* definedVertexSource = insertShaderSourceLines(vertexSource, defines);
+		char* definedFragmentSource = insertShaderSourceLines(fragmentSource, defines);
 		
-		return NULL;
+		free(vertexSource);
+		free(fragmentSource);
+		
+		vertexSource = definedVertexSource;
+		fragmentSource = definedFragmentSource;
+	}
+	
+	GLuint program = NULL_SHADER_PROGRAM;
+	
+	if(vertexSource && fragmentSource){
+		uint64_t key = getProgramCacheKey(vertexSource, fragmentSource);
+		
+		program = loadCachedProgram(key);
+		
+		if(program == NULL_SHADER_PROGRAM){
+			GLuint vertexShader = createShaderFromSource(GL_VERTEX_SHADER, vertexSource);
+			GLuint fragmentShader = createShaderFromSource(GL_FRAGMENT_SHADER, fragmentSource);
+			
+			if(vertexShader != NULL_SHADER && fragmentShader != NULL_SHADER) program = createShaderProgram(vertexShader, fragmentShader, true);
+			
+			if(program != NULL_SHADER_PROGRAM) storeCachedProgram(key, program);
+		}
 	}
 	
+	free(vertexSource);
+	free(fragmentSource);
+	
+	ShaderProgramEx* programEx = createShaderProgramExFromProgram(program);
+	
+	getProgramCacheStats()->time += glfwGetTime() - start;
+	
+	return programEx;
+}
+
+// wraps a linked program, returns NULL if program is NULL_SHADER_PROGRAM (so it can be given the result of createShaderProgram directly)
+ShaderProgramEx* createShaderProgramExFromProgram(GLuint program){
+	// make sure program compiled
+	if(program == NULL_SHADER_PROGRAM) return NULL;
+	
+	// allocate memory
+	ShaderProgramEx* programEx = allocateMemoryForType<ShaderProgramEx>();
+	
+	programEx->program = program;
+	
 	// create uniform manager (remember to delete)
 	programEx->uniforms = new std::map<std::string, GLint>();
+	
+	// nothing has been written yet
+	for(uint32_t i = 0; i < UNIFORM_COUNT; i++){
+		programEx->uniformValuesSet[i] = false;
+	}
 		
 	// load uniforms
 	loadShaderProgramExUniformLocations(programEx);
+	loadShaderProgramExUniformTable(programEx);
+	bindShaderProgramExUniformBlocks(programEx);
+	bindShaderProgramExReservedTextures(programEx);
 	
 	// get max supported texture units
 	// TODO: only needs to be called once at start of program
 	glGetIntegerv(GL_MAX_COMBINED_TEXTURE_IMAGE_UNITS, &programEx->maxTextureUnits);
 	
+	// leave the reserved units alone
+	if(programEx->maxTextureUnits > FIRST_RESERVED_TEXTURE_UNIT) programEx->maxTextureUnits = FIRST_RESERVED_TEXTURE_UNIT;
+	
 	programEx->textureUnits = 0;
 	
 	programEx->numPointLights = 0;
-	programEx->maxPointLights = 48;
+	programEx->maxPointLights = MAX_POINT_LIGHTS;
+	
+	programEx->permutations = NULL;
+	programEx->permutationFeatures = 0;
+	programEx->permutationTextureMode = 0;
 	
 	return programEx;
 }
@@ -195,8 +321,60 @@ void loadShaderProgramExUniformLocations(ShaderProgramEx* programEx){
 	}
 }
 
+// resolve the well known uniforms and every pointLights element into the uniform table
+// this way nothing needs to build strings or search the uniform manager while drawing
+void loadShaderProgramExUniformTable(ShaderProgramEx* programEx){
+	GLuint program = programEx->program;
+	
+	for(uint32_t i = 0; i < UNIFORM_COUNT; i++){
+		programEx->uniformTable[i] = glGetUniformLocation(program, g_programUniformNames[i]);
+	}
+	
+	for(uint32_t i = 0; i < MAX_POINT_LIGHTS; i++){
+		for(uint32_t j = 0; j < POINT_LIGHT_FIELD_COUNT; j++){
+			std::string name = "pointLights[" + std::to_string(i) + "]." + g_pointLightFieldNames[j];
+			
+			programEx->pointLightTable[i][j] = glGetUniformLocation(program, name.c_str());
+		}
+	}
+}
+
+// bind the program's shared uniform blocks (if it has them) to their binding points
+void bindShaderProgramExUniformBlocks(ShaderProgramEx* programEx){
+	GLuint lightsIndex = glGetUniformBlockIndex(programEx->program, "Lights");
+	GLuint cameraIndex = glGetUniformBlockIndex(programEx->program, "Camera");
+	
+	if(lightsIndex != GL_INVALID_INDEX) glUniformBlockBinding(programEx->program, lightsIndex, LIGHTS_BLOCK_BINDING);
+	if(cameraIndex != GL_INVALID_INDEX) glUniformBlockBinding(programEx->program, cameraIndex, CAMERA_BLOCK_BINDING);
+}
+
+// point the program's lightmap, texture array and light texture buffer samplers (if it has them) at their reserved texture units
+void bindShaderProgramExReservedTextures(ShaderProgramEx* programEx){
+	useGlProgram(programEx->program);
+	
+	setProgramExUniformInt(programEx, UNIFORM_MATERIAL_DATA, MATERIAL_DATA_TEXTURE_UNIT);
+	setProgramExUniformInt(programEx, UNIFORM_LIGHTMAP, LIGHTMAP_TEXTURE_UNIT);
+	setProgramExUniformInt(programEx, UNIFORM_TEXTURE_ARRAY, TEXTURE_ARRAY_TEXTURE_UNIT);
+	
+	setProgramExUniformInt(programEx, UNIFORM_LIGHT_DATA, LIGHT_DATA_TEXTURE_UNIT);
+	setProgramExUniformInt(programEx, UNIFORM_CLUSTER_DATA, CLUSTER_DATA_TEXTURE_UNIT);
+	setProgramExUniformInt(programEx, UNIFORM_CLUSTER_LIGHT_INDICES, CLUSTER_LIGHT_INDICES_TEXTURE_UNIT);
+	
+	useGlProgram(0);
+}
+
+// use the program, unless it's already in use (see useGlProgram)
 void useProgramEx(ShaderProgramEx* programEx){
-	glUseProgram(programEx->program);
+	useGlProgram(programEx->program);
+}
+
+// delete the program and its uniform manager
+void deleteShaderProgramEx(ShaderProgramEx* programEx){
+	deleteGlProgram(programEx->program);
+	
+	delete programEx->uniforms;
+	
+	free(programEx);
 }
 
 // get uniform location
@@ -204,6 +382,66 @@ GLint getProgramExUniformLocation(ShaderProgramEx* programEx, std::string name){
 	return (*programEx->uniforms)[name];
 }
 
+// get the location of a well known uniform from the uniform table (-1 if the program doesn't use it)
+GLint getProgramExUniform(ShaderProgramEx* programEx, ProgramUniform uniform){
+	return programEx->uniformTable[uniform];
+}
+
+// remember the count floats about to be written to a well known uniform
+// returns false if the write can be skipped, because the program doesn't use the uniform or it already holds those values
+bool updateProgramExUniformValues(ShaderProgramEx* programEx, ProgramUniform uniform, const float* values, uint32_t count){
+	GlStateStats* stats = getGlStateStats();
+	
+	if(programEx->uniformTable[uniform] == -1){
+		countGlStateCall(&stats->uniforms, false);
+		
+		return false;
+	}
+	
+	float* cached = programEx->uniformValues[uniform];
+	bool same = programEx->uniformValuesSet[uniform] && memcmp(cached, values, count * sizeof(float)) == 0;
+	
+	if(same && isGlStateCachingEnabled()){
+		countGlStateCall(&stats->uniforms, false);
+		
+		return false;
+	}
+	
+	memcpy(cached, values, count * sizeof(float));
+	programEx->uniformValuesSet[uniform] = true;
+	
+	countGlStateCall(&stats->uniforms, true);
+	
+	return true;
+}
+
+// setters for well known uniforms, the program has to be in use
+// values are cached per program (uniforms belong to the program, not the context), so switching programs doesn't make them write again
+
+void setProgramExUniformInt(ShaderProgramEx* programEx, ProgramUniform uniform, GLint value){
+	float values[1];
+	
+	memcpy(values, &value, sizeof(GLint));
+	
+	if(updateProgramExUniformValues(programEx, uniform, values, 1)) glUniform1i(programEx->uniformTable[uniform], value);
+}
+
+void setProgramExUniformVec3(ShaderProgramEx* programEx, ProgramUniform uniform, glm::vec3 value){
+	if(updateProgramExUniformValues(programEx, uniform, glm::value_ptr(value), 3)) glUniform3fv(programEx->uniformTable[uniform], 1, glm::value_ptr(value));
+}
+
+void setProgramExUniformVec4(ShaderProgramEx* programEx, ProgramUniform uniform, glm::vec4 value){
+	if(updateProgramExUniformValues(programEx, uniform, glm::value_ptr(value), 4)) glUniform4fv(programEx->uniformTable[uniform], 1, glm::value_ptr(value));
+}
+
+void setProgramExUniformMat3(ShaderProgramEx* programEx, ProgramUniform uniform, glm::mat3 value){
+	if(updateProgramExUniformValues(programEx, uniform, glm::value_ptr(value), 9)) glUniformMatrix3fv(programEx->uniformTable[uniform], 1, GL_FALSE, glm::value_ptr(value));
+}
+
+void setProgramExUniformMat4(ShaderProgramEx* programEx, ProgramUniform uniform, glm::mat4 value){
+	if(updateProgramExUniformValues(programEx, uniform, glm::value_ptr(value), 16)) glUniformMatrix4fv(programEx->uniformTable[uniform], 1, GL_FALSE, glm::value_ptr(value));
+}
+
 // bind a texture to a uniform according to the number of textures currently bound
 // note that this will stop working quickly if the amount of bound textures isn't reset after drawing
 void setProgramExUniformTexture(ShaderProgramEx* programEx, const char* location, TextureData* textureData){
@@ -214,21 +452,55 @@ void setProgramExUniformTexture(ShaderProgramEx* programEx, const char* location
 	}
 	
 	// bind texture to active texture
-	glActiveTexture(GL_TEXTURE0 + programEx->textureUnits);
+	bindGlTexture(programEx->textureUnits, GL_TEXTURE_2D, textureData ? textureData->texture : 0);
 	
-	if(textureData){
-		glBindTexture(GL_TEXTURE_2D, textureData->texture);
-	} else {
-		glBindTexture(GL_TEXTURE_2D, 0);
+	// assign active texture to uniform
+	GLint uniformLocation = getProgramExUniformLocation(programEx, std::string(location));
+	
+	glUniform1i(uniformLocation, programEx->textureUnits);
+	
+	// this went around the uniform table, so forget whatever was cached for the same location
+	for(uint32_t i = 0; i < UNIFORM_COUNT; i++){
+		if(programEx->uniformTable[i] == uniformLocation) programEx->uniformValuesSet[i] = false;
+	}
+
+	// increment current textures
+	programEx->textureUnits++;
+}
+
+// same as above, but for a well known uniform
+void setProgramExUniformTexture(ShaderProgramEx* programEx, ProgramUniform uniform, TextureData* textureData){
+	// check if we've exceeded max bound textures
+	if( (int32_t)programEx->textureUnits >= programEx->maxTextureUnits ){
+		printf("Can't bind more textures, reached maximum supported texture units (%d)\n", programEx->maxTextureUnits);
+		return;
 	}
 	
+	// bind texture to active texture
+	bindGlTexture(programEx->textureUnits, GL_TEXTURE_2D, textureData ? textureData->texture : 0);
+	
 	// assign active texture to uniform
-	glUniform1i(getProgramExUniformLocation(programEx, std::string(location)), programEx->textureUnits);
-
+	setProgramExUniformInt(programEx, uniform, programEx->textureUnits);
+	
 	// increment current textures
 	programEx->textureUnits++;
 }
 
+// bind a texture array to the reserved texture array unit, read by programs compiled to sample textureArray (see SHADER_TEXTURE_ARRAY)
+void setProgramExTextureArray(ShaderProgramEx* programEx, TextureArray* array){
+	if(array) bindGlTexture(TEXTURE_ARRAY_TEXTURE_UNIT, GL_TEXTURE_2D_ARRAY, array->texture);
+}
+
+// bind an object's texture, through its texture array if it's been packed into one, otherwise as texture1
+// the program has to be the variant for the texture (see useProgramExObjectTexture)
+void setProgramExObjectTexture(ShaderProgramEx* programEx, TextureData* textureData){
+	if(textureData && textureData->array){
+		setProgramExTextureArray(programEx, textureData->array);
+	} else {
+		setProgramExUniformTexture(programEx, UNIFORM_TEXTURE1, textureData);
+	}
+}
+
 // reset the number of currently bound textureUnits
 // should generally be called every time something is drawn, since generally you'll be binding new textures
 void resetProgramExUniformTextures(ShaderProgramEx* programEx){
@@ -281,9 +553,141 @@ void addProgramExPointLight(ShaderProgramEx* programEx, const char* location, Po
 	// update numPointLights
 	programEx->numPointLights++;
 	
-	glUniform1i(getProgramExUniformLocation(programEx, "numPointLights"), programEx->numPointLights);
+	setProgramExUniformInt(programEx, UNIFORM_NUM_POINT_LIGHTS, programEx->numPointLights);
+}
+
+// add a new light to the pointLights uniform array, using the locations resolved in the uniform table
+void addProgramExPointLight(ShaderProgramEx* programEx, PointLight* light){
+	// check if we've exceeded max lights
+	if( programEx->numPointLights >= programEx->maxPointLights ){
+		printf("Can't bind more point lights, reached maximum supported point lights (%d)\n", programEx->maxPointLights);
+		return;
+	}
+	
+	GLint* locations = programEx->pointLightTable[programEx->numPointLights];
+	
+	// write each value to shader
+	glUniform3fv(locations[POINT_LIGHT_POSITION], 1, glm::value_ptr(light->position));
+	glUniform3fv(locations[POINT_LIGHT_COLOR], 1, glm::value_ptr(light->color));
+	
+	glUniform1f(locations[POINT_LIGHT_AMBIENT_STRENGTH], light->ambientStrength);
+	glUniform1f(locations[POINT_LIGHT_DIFFUSE_STRENGTH], light->diffuseStrength);
+	
+	glUniform1f(locations[POINT_LIGHT_C], light->c);
+	glUniform1f(locations[POINT_LIGHT_L], light->l);
+	glUniform1f(locations[POINT_LIGHT_Q], light->q);
+	
+	// update numPointLights
+	programEx->numPointLights++;
+	
+	setProgramExUniformInt(programEx, UNIFORM_NUM_POINT_LIGHTS, programEx->numPointLights);
 }
 
 void resetProgramExPointLights(ShaderProgramEx* programEx){
 	programEx->numPointLights = 0;
+}
+
+// uniform buffers //
+
+// create a uniform buffer of size bytes and bind it to a uniform block binding point
+// returns NULL if the buffer couldn't be created
+UniformBuffer* createUniformBuffer(uint32_t size, GLuint binding){
+	UniformBuffer* buffer = allocateMemoryForType<UniformBuffer>();
+	
+	buffer->ubo = 0;
+	buffer->binding = binding;
+	buffer->size = size;
+	buffer->stream = createStreamBuffer(GL_UNIFORM_BUFFER, size);
+	
+	if(!buffer->stream){
+		free(buffer);
+		
+		return NULL;
+	}
+	
+	// zeroed, so unused parts of blocks read as 0
+	buffer->data = (uint8_t*)calloc(size, 1);
+	
+	buffer->ubo = writeStreamBuffer(buffer->stream, size, buffer->data);
+	
+	glBindBufferBase(GL_UNIFORM_BUFFER, binding, buffer->ubo);
+	
+	return buffer;
+}
+
+// write size bytes of data to a uniform buffer at offset
+void updateUniformBuffer(UniformBuffer* buffer, uint32_t offset, uint32_t size, const void* data){
+	memcpy(buffer->data + offset, data, size);
+	
+	buffer->ubo = writeStreamBuffer(buffer->stream, buffer->size, buffer->data);
+	
+	glBindBufferBase(GL_UNIFORM_BUFFER, buffer->binding, buffer->ubo);
+}
+
+// texture buffers //
+
+// create a texture buffer with size bytes of (uninitialized) storage, read as texels of format
+// returns NULL if the buffer couldn't be created
+TextureBuffer* createTextureBuffer(GLenum format, uint32_t size){
+	TextureBuffer* buffer = allocateMemoryForType<TextureBuffer>();
+	
+	buffer->buffer = 0;
+	buffer->texture = 0;
+	buffer->format = format;
+	buffer->stream = createStreamBuffer(GL_TEXTURE_BUFFER, size);
+	
+	glGenTextures(1, &buffer->texture);
+	
+	// FIXME: actual error checking using gl methods
+	if(!buffer->stream || buffer->texture == 0){
+		if(buffer->stream) deleteStreamBuffer(buffer->stream);
+		if(buffer->texture != 0) deleteGlTexture(buffer->texture);
+		
+		free(buffer);
+		
+		return NULL;
+	}
+	
+	buffer->buffer = getStreamBufferBuffer(buffer->stream);
+	buffer->size = buffer->stream->capacities[buffer->stream->region];
+	
+	// attach to texture
+	bindGlTexture(0, GL_TEXTURE_BUFFER, buffer->texture);
+	glTexBuffer(GL_TEXTURE_BUFFER, format, buffer->buffer);
+	bindGlTexture(0, GL_TEXTURE_BUFFER, 0);
+	
+	return buffer;
+}
+
+// replace the contents of a texture buffer with size bytes of data, growing it if necessary
+// the data goes to the next region of the stream buffer, so the driver doesn't have to wait on last frame's draws
+void uploadTextureBuffer(TextureBuffer* buffer, uint32_t size, const void* data){
+	buffer->buffer = writeStreamBuffer(buffer->stream, size, data);
+	buffer->size = buffer->stream->capacities[buffer->stream->region];
+	
+	// point the texture at the new region
+	// unit 0 never samples a buffer texture, so the texture is left bound there rather than unbound every upload
+	bindGlTexture(0, GL_TEXTURE_BUFFER, buffer->texture);
+	glTexBuffer(GL_TEXTURE_BUFFER, buffer->format, buffer->buffer);
+}
+
+// write size bytes of data to the current contents of a texture buffer at offset, offset + size must fit in the buffer
+// unlike uploadTextureBuffer this writes in place, so it's meant for small, occasional changes
+void updateTextureBuffer(TextureBuffer* buffer, uint32_t offset, uint32_t size, const void* data){
+	glBindBuffer(GL_TEXTURE_BUFFER, buffer->buffer);
+	glBufferSubData(GL_TEXTURE_BUFFER, offset, size, data);
+	glBindBuffer(GL_TEXTURE_BUFFER, 0);
+}
+
+// bind a texture buffer to a texture unit
+void bindTextureBuffer(TextureBuffer* buffer, GLuint unit){
+	bindGlTexture(unit, GL_TEXTURE_BUFFER, buffer->texture);
+}
+
+// delete a texture buffer along with its texture and stream buffer
+void deleteTextureBuffer(TextureBuffer* buffer){
+	deleteGlTexture(buffer->texture);
+	deleteStreamBuffer(buffer->stream);
+	
+	free(buffer);
 }
\ No newline at end of file
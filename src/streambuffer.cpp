@@ -0,0 +1,254 @@
+// streaming buffers for data rewritten every frame
+
+#include <streambuffer.h>
+#include <utils.h>
+
+#include <GLFW/glfw3.h>
+
+#include <cstring>
+#include <cstdio>
+
+// smallest region that gets allocated, immutable storage can't be empty
+#define STREAM_BUFFER_MIN_CAPACITY 256
+
+// how long a single glClientWaitSync call may block before checking again (nanoseconds)
+#define STREAM_BUFFER_WAIT_TIMEOUT 1000000000
+
+// GL_ARB_buffer_storage isn't part of the 3.3 core loader, so glBufferStorage is loaded by hand when the driver has it
+#ifndef GL_MAP_PERSISTENT_BIT
+#define GL_MAP_PERSISTENT_BIT 0x0040
+#endif
+
+#ifndef GL_MAP_COHERENT_BIT
+#define GL_MAP_COHERENT_BIT 0x0080
+#endif
+
+#ifndef GL_DYNAMIC_STORAGE_BIT
+#define GL_DYNAMIC_STORAGE_BIT 0x0100
+#endif
+
+typedef void (APIENTRYP PFNGLBUFFERSTORAGEPROC)(GLenum target, GLsizeiptr size, const void* data, GLbitfield flags);
+
+PFNGLBUFFERSTORAGEPROC g_glBufferStorage = NULL;
+
+// if new stream buffers should use persistent mapping
+bool g_persistentMapping = false;
+
+StreamBufferStats streamBufferStats = {0, 0, 0, 0.0};
+
+// frame being recorded, and the newest frame the gpu is known to have finished
+uint32_t g_streamFrame = 1;
+uint32_t g_completedFrame = 0;
+
+// fence placed at the end of each frame, frame f is at f % STREAM_BUFFER_FRAME_FENCES
+GLsync g_frameFences[STREAM_BUFFER_FRAME_FENCES] = {NULL};
+
+// look for GL_ARB_buffer_storage, must be called after the gl methods are loaded (load should be the same loader given to glad)
+// without it, stream buffers fall back to unsynchronized glMapBufferRange
+void initStreamBuffers(GLADloadproc load){
+	GLint extensionCount = 0;
+	
+	glGetIntegerv(GL_NUM_EXTENSIONS, &extensionCount);
+	
+	for(GLint i = 0; i < extensionCount; i++){
+		const char* extension = (const char*)glGetStringi(GL_EXTENSIONS, i);
+		
+		if(extension && strcmp(extension, "GL_ARB_buffer_storage") == 0){
+			g_glBufferStorage = (PFNGLBUFFERSTORAGEPROC)load("glBufferStorage");
+			
+			break;
+		}
+	}
+	
+	g_persistentMapping = g_glBufferStorage != NULL;
+}
+
+// turn persistent mapping on or off for stream buffers created from now on (it stays off if it isn't supported)
+void setStreamBufferPersistentMapping(bool enabled){
+	g_persistentMapping = enabled && g_glBufferStorage != NULL;
+}
+
+bool isStreamBufferPersistentMappingSupported(){
+	return g_glBufferStorage != NULL;
+}
+
+StreamBufferStats* getStreamBufferStats(){
+	return &streamBufferStats;
+}
+
+void resetStreamBufferStats(){
+	streamBufferStats.writes = 0;
+	streamBufferStats.bytesWritten = 0;
+	streamBufferStats.fenceWaits = 0;
+	streamBufferStats.fenceWaitTime = 0.0;
+}
+
+// block until the gpu has finished every command issued in frame (and every frame before it)
+void waitStreamBufferFrame(uint32_t frame){
+	if(frame <= g_completedFrame) return;
+	
+	double start = glfwGetTime();
+	
+	if(frame >= g_streamFrame){
+		// the frame hasn't been fenced yet (a buffer was written more than STREAM_BUFFER_REGIONS times this frame, or endStreamBufferFrame is never called)
+		glFinish();
+		
+		g_completedFrame = g_streamFrame - 1;
+	} else {
+		GLsync fence = g_frameFences[frame % STREAM_BUFFER_FRAME_FENCES];
+		
+		// usually already signalled, only count it as a wait if it isn't
+		GLenum result = glClientWaitSync(fence, 0, 0);
+		
+		g_completedFrame = frame;
+		
+		if(result != GL_TIMEOUT_EXPIRED) return;
+		
+		do {
+			result = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, STREAM_BUFFER_WAIT_TIMEOUT);
+		} while(result == GL_TIMEOUT_EXPIRED);
+	}
+	
+	streamBufferStats.fenceWaits++;
+	streamBufferStats.fenceWaitTime += glfwGetTime() - start;
+}
+
+// fence everything issued this frame, should be called once per frame after the frame's last draw call
+void endStreamBufferFrame(){
+	uint32_t slot = g_streamFrame % STREAM_BUFFER_FRAME_FENCES;
+	
+	// make sure the frame that used to be in this slot is done before forgetting its fence
+	if(g_frameFences[slot]){
+		waitStreamBufferFrame(g_streamFrame - STREAM_BUFFER_FRAME_FENCES);
+		
+		glDeleteSync(g_frameFences[slot]);
+	}
+	
+	g_frameFences[slot] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	
+	g_streamFrame++;
+}
+
+// (re)allocate the storage of one region of a stream buffer
+void allocateStreamBufferRegion(StreamBuffer* buffer, uint32_t region, uint32_t capacity){
+	if(buffer->persistent){
+		// immutable storage can't be resized, so the region gets a new buffer (gl frees the old one once the gpu is done with it)
+		if(buffer->buffers[region] != 0) glDeleteBuffers(1, &buffer->buffers[region]);
+		
+		glGenBuffers(1, &buffer->buffers[region]);
+		
+		GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+		
+		// dynamic storage so small in place updates (see updateTextureBuffer) can still use glBufferSubData
+		glBindBuffer(buffer->target, buffer->buffers[region]);
+		g_glBufferStorage(buffer->target, capacity, NULL, flags | GL_DYNAMIC_STORAGE_BIT);
+		buffer->mapped[region] = glMapBufferRange(buffer->target, 0, capacity, flags);
+	} else {
+		glBindBuffer(buffer->target, buffer->buffers[region]);
+		glBufferData(buffer->target, capacity, NULL, GL_STREAM_DRAW);
+	}
+	
+	glBindBuffer(buffer->target, 0);
+	
+	buffer->capacities[region] = capacity;
+}
+
+// create a stream buffer with capacity bytes of storage in each region
+// returns NULL if the buffer couldn't be created
+StreamBuffer* createStreamBuffer(GLenum target, uint32_t capacity){
+	StreamBuffer* buffer = allocateMemoryForType<StreamBuffer>();
+	
+	buffer->target = target;
+	buffer->persistent = g_persistentMapping;
+	
+	// the first write goes to region 0
+	buffer->region = STREAM_BUFFER_REGIONS - 1;
+	
+	if(capacity < STREAM_BUFFER_MIN_CAPACITY) capacity = STREAM_BUFFER_MIN_CAPACITY;
+	
+	for(uint32_t i = 0; i < STREAM_BUFFER_REGIONS; i++){
+		buffer->buffers[i] = 0;
+		buffer->mapped[i] = NULL;
+		buffer->frames[i] = 0;
+		
+		// persistent regions generate their own buffers
+		if(!buffer->persistent){
+			glGenBuffers(1, &buffer->buffers[i]);
+			
+			// FIXME: actual error checking using gl methods
+			if(buffer->buffers[i] == 0){
+				glDeleteBuffers(i, buffer->buffers);
+				free(buffer);
+				
+				return NULL;
+			}
+		}
+		
+		allocateStreamBufferRegion(buffer, i, capacity);
+	}
+	
+	return buffer;
+}
+
+// replace the contents of a stream buffer with size bytes of data, written into the next region
+// returns the buffer object of that region, which whatever reads the data (vao, buffer texture, uniform block binding) has to be pointed at
+GLuint writeStreamBuffer(StreamBuffer* buffer, uint32_t size, const void* data){
+	// move on to the next region, once the gpu is done with the frame it was last written in
+	uint32_t region = (buffer->region + 1) % STREAM_BUFFER_REGIONS;
+	
+	waitStreamBufferFrame(buffer->frames[region]);
+	
+	buffer->region = region;
+	buffer->frames[region] = g_streamFrame;
+	
+	// grow to the next power of two
+	if(buffer->capacities[region] < size){
+		uint32_t capacity = buffer->capacities[region];
+		
+		while(capacity < size){
+			capacity *= 2;
+		}
+		
+		allocateStreamBufferRegion(buffer, region, capacity);
+	}
+	
+	if(size > 0){
+		if(buffer->mapped[region]){
+			memcpy(buffer->mapped[region], data, size);
+		} else {
+			// the fence already guarantees the gpu is done with the region, so there's no need for the driver to synchronize
+			glBindBuffer(buffer->target, buffer->buffers[region]);
+			
+			void* destination = glMapBufferRange(buffer->target, 0, size, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_UNSYNCHRONIZED_BIT);
+			
+			if(destination){
+				memcpy(destination, data, size);
+				glUnmapBuffer(buffer->target);
+			} else {
+				glBufferSubData(buffer->target, 0, size, data);
+			}
+			
+			glBindBuffer(buffer->target, 0);
+		}
+	}
+	
+	streamBufferStats.writes++;
+	streamBufferStats.bytesWritten += size;
+	
+	return buffer->buffers[region];
+}
+
+// get the buffer object holding the most recent write
+GLuint getStreamBufferBuffer(StreamBuffer* buffer){
+	return buffer->buffers[buffer->region];
+}
+
+// delete a stream buffer and every region's buffer object
+// gl keeps the storage around until the gpu is done with it, so regions still being read are fine
+void deleteStreamBuffer(StreamBuffer* buffer){
+	for(uint32_t i = 0; i < STREAM_BUFFER_REGIONS; i++){
+		if(buffer->buffers[i] != 0) glDeleteBuffers(1, &buffer->buffers[i]);
+	}
+	
+	free(buffer);
+}
\ No newline at end of file
@@ -1,16 +1,48 @@
 // texture management
 
 #include <texture.h>
+#include <glstate.h>
 #include <utils.h>
 #include <glad/glad.h>
 
 #define STB_IMAGE_IMPLEMENTATION
 #include <stb/stb_image.h>
 
+#include <algorithm>
+#include <map>
+
+// give a texture data's texture its image (width x height x channels, bottom row first) and mipmaps
+// pixels can also be an offset into the bound GL_PIXEL_UNPACK_BUFFER (see updateTextureLoads)
+void setTextureDataImage(TextureData* textureData, const void* pixels){
+	// bind texture
+	bindGlTexture(0, GL_TEXTURE_2D, textureData->texture); // bind texture so function calls affect it
+	
+	// assign parameters
+	// TODO: custom texture params
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	
+	// generate texture
+	if(textureData->channels == 3)
+		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, textureData->width, textureData->height, 0, GL_RGB, GL_UNSIGNED_BYTE, pixels);
+	else if(textureData->channels == 4)
+		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, textureData->width, textureData->height, 0, GL_RGBA, GL_UNSIGNED_BYTE, pixels);
+	
+	// generate mipmaps
+	glGenerateMipmap(GL_TEXTURE_2D);
+	
+	bindGlTexture(0, GL_TEXTURE_2D, 0);
+}
+
 // load a texture
 TextureData* createTextureData(const char* texturePath){
 	TextureData* textureData = allocateMemoryForType<TextureData>();
 	
+	textureData->array = NULL;
+	textureData->layer = 0;
+	
 	stbi_set_flip_vertically_on_load(true); // flip because opengl expects textures to start at end of buffer
 	
 	uint8_t *data = stbi_load(texturePath, &textureData->width, &textureData->height, &textureData->channels, 0);
@@ -19,27 +51,7 @@ TextureData* createTextureData(const char* texturePath){
 		// create texture
 		glGenTextures(1, &textureData->texture);
 		
-		// bind texture
-		glBindTexture(GL_TEXTURE_2D, textureData->texture); // bind texture so function calls affect it
-		
-		// assign parameters
-		// TODO: custom texture params
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);	
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-
-		// generate texture
-		if(textureData->channels == 3)
-			glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, textureData->width, textureData->height, 0, GL_RGB, GL_UNSIGNED_BYTE, data);
-		else if(textureData->channels == 4)
-			glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, textureData->width, textureData->height, 0, GL_RGBA, GL_UNSIGNED_BYTE, data);
-		
-		// generate mipmaps
-		glGenerateMipmap(GL_TEXTURE_2D);
-		
-		glBindTexture(GL_TEXTURE_2D, 0);
-		
+		setTextureDataImage(textureData, data);
 	} else {
 		printf("error loading texture %s\n", texturePath);
 		
@@ -56,6 +68,9 @@ TextureData* createTextureData(const char* texturePath){
 TextureData* createTextureDataRawCompressed(unsigned char* buffer, uint32_t length){
 	TextureData* textureData = allocateMemoryForType<TextureData>();
 	
+	textureData->array = NULL;
+	textureData->layer = 0;
+	
 	stbi_set_flip_vertically_on_load(true); // flip because opengl expects textures to start at end of buffer
 	
 	uint8_t *data = stbi_load_from_memory((const unsigned char*)buffer, length, &textureData->width, &textureData->height, &textureData->channels, 0);
@@ -64,27 +79,7 @@ TextureData* createTextureDataRawCompressed(unsigned char* buffer, uint32_t leng
 		// create texture
 		glGenTextures(1, &textureData->texture);
 		
-		// bind texture
-		glBindTexture(GL_TEXTURE_2D, textureData->texture); // bind texture so function calls affect it
-		
-		// assign parameters
-		// TODO: custom texture params
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);	
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-
-		// generate texture
-		if(textureData->channels == 3)
-			glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, textureData->width, textureData->height, 0, GL_RGB, GL_UNSIGNED_BYTE, data);
-		else if(textureData->channels == 4)
-			glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, textureData->width, textureData->height, 0, GL_RGBA, GL_UNSIGNED_BYTE, data);
-		
-		// generate mipmaps
-		glGenerateMipmap(GL_TEXTURE_2D);
-		
-		glBindTexture(GL_TEXTURE_2D, 0);
-		
+		setTextureDataImage(textureData, data);
 	} else {
 		printf("error loading raw texture\n");
 		
@@ -96,4 +91,126 @@ TextureData* createTextureDataRawCompressed(unsigned char* buffer, uint32_t leng
 	stbi_image_free(data);
 	
 	return textureData;
+}
+
+// texture arrays //
+
+// get the size class of a texture, the power of two its layer will be resized to when packed into a texture array
+int32_t getTextureSizeClass(int32_t width, int32_t height){
+	int32_t size = 1;
+	
+	while(size < width || size < height){
+		size *= 2;
+	}
+	
+	return std::min(size, MAX_TEXTURE_ARRAY_SIZE);
+}
+
+// bilinear resize of an rgba image
+void resizeImage(uint8_t* source, int32_t sourceWidth, int32_t sourceHeight, uint8_t* destination, int32_t width, int32_t height){
+	for(int32_t y = 0; y < height; y++){
+		// sample at pixel centers
+		float sy = std::max((y + 0.5f) * sourceHeight / height - 0.5f, 0.0f);
+		int32_t y0 = std::min((int32_t)sy, sourceHeight - 1);
+		int32_t y1 = std::min(y0 + 1, sourceHeight - 1);
+		float fy = sy - y0;
+		
+		for(int32_t x = 0; x < width; x++){
+			float sx = std::max((x + 0.5f) * sourceWidth / width - 0.5f, 0.0f);
+			int32_t x0 = std::min((int32_t)sx, sourceWidth - 1);
+			int32_t x1 = std::min(x0 + 1, sourceWidth - 1);
+			float fx = sx - x0;
+			
+			for(int32_t c = 0; c < 4; c++){
+				float top = source[(y0*sourceWidth + x0)*4 + c] * (1 - fx) + source[(y0*sourceWidth + x1)*4 + c] * fx;
+				float bottom = source[(y1*sourceWidth + x0)*4 + c] * (1 - fx) + source[(y1*sourceWidth + x1)*4 + c] * fx;
+				
+				destination[(y*width + x)*4 + c] = (uint8_t)(top * (1 - fy) + bottom * fy + 0.5f);
+			}
+		}
+	}
+}
+
+// pack textures into texture arrays, one array per size class (split every MAX_TEXTURE_ARRAY_LAYERS textures) with a layer per texture
+// each texture keeps its own GL_TEXTURE_2D, but gets its array and layer set so it can be drawn from the array instead
+// new arrays are added to arrays
+void packTextureArrays(std::vector<TextureData*>& textures, std::vector<TextureArray*>& arrays){
+	// group textures by size class
+	std::map<int32_t, std::vector<TextureData*>> classes;
+	
+	for(uint32_t i = 0; i < textures.size(); i++){
+		TextureData* textureData = textures[i];
+		
+		if(!textureData || textureData->array) continue;
+		
+		classes[getTextureSizeClass(textureData->width, textureData->height)].push_back(textureData);
+	}
+	
+	// textures are read back tightly packed, the previous alignment is put back once they're all packed
+	GLint packAlignment = 4;
+	
+	glGetIntegerv(GL_PACK_ALIGNMENT, &packAlignment);
+	glPixelStorei(GL_PACK_ALIGNMENT, 1);
+	
+	for(std::map<int32_t, std::vector<TextureData*>>::iterator it = classes.begin(); it != classes.end(); it++){
+		int32_t size = it->first;
+		
+		for(uint32_t first = 0; first < it->second.size(); first += MAX_TEXTURE_ARRAY_LAYERS){
+			std::vector<TextureData*> members(it->second.begin() + first, it->second.begin() + std::min<size_t>(first + MAX_TEXTURE_ARRAY_LAYERS, it->second.size()));
+			
+			TextureArray* array = allocateMemoryForType<TextureArray>();
+			
+			array->size = size;
+			array->layers = members.size();
+			
+			// create array
+			glGenTextures(1, &array->texture);
+			bindGlTexture(0, GL_TEXTURE_2D_ARRAY, array->texture);
+			
+			// same parameters as createTextureData
+			glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+			glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+			glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+			glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+			
+			glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_RGBA, size, size, array->layers, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+			
+			// copy each texture into its layer
+			std::vector<uint8_t> layer(size * size * 4);
+			
+			for(uint32_t i = 0; i < members.size(); i++){
+				TextureData* textureData = members[i];
+				
+				// read the texture back from its GL_TEXTURE_2D (simpler than keeping every decoded image around)
+				std::vector<uint8_t> pixels(textureData->width * textureData->height * 4);
+				
+				bindGlTexture(0, GL_TEXTURE_2D, textureData->texture);
+				glGetTexImage(GL_TEXTURE_2D, 0, GL_RGBA, GL_UNSIGNED_BYTE, &pixels[0]);
+				bindGlTexture(0, GL_TEXTURE_2D, 0);
+				
+				resizeImage(&pixels[0], textureData->width, textureData->height, &layer[0], size, size);
+				
+				glTexSubImage3D(GL_TEXTURE_2D_ARRAY, 0, 0, 0, i, size, size, 1, GL_RGBA, GL_UNSIGNED_BYTE, &layer[0]);
+				
+				textureData->array = array;
+				textureData->layer = i;
+			}
+			
+			glGenerateMipmap(GL_TEXTURE_2D_ARRAY);
+			
+			bindGlTexture(0, GL_TEXTURE_2D_ARRAY, 0);
+			
+			arrays.push_back(array);
+		}
+	}
+	
+	glPixelStorei(GL_PACK_ALIGNMENT, packAlignment);
+}
+
+// get the gl texture that has to be bound to draw with a texture (its array if it's been packed), 0 for no texture
+// objects with the same binding can be drawn together
+uint32_t getTextureBinding(TextureData* textureData){
+	if(!textureData) return 0;
+	
+	return textureData->array ? textureData->array->texture : textureData->texture;
 }
\ No newline at end of file
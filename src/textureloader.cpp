@@ -0,0 +1,468 @@
+// asynchronous texture loading
+// images are decoded by worker threads and uploaded on the gl thread through a pixel buffer, a bit at a time (see updateTextureLoads)
+// every texture gets its gl texture straight away, holding a 1x1 placeholder until its image is uploaded
+// since the texture name never changes, draw lists, batches and texture bindings made in the meantime stay valid
+// loading fails the same way whether it's asynchronous or not: an image whose header can't be read gives NULL straight away (like createTextureData),
+// and one that only fails to decode afterwards keeps its texture, showing TEXTURE_MISSING_COLOR
+
+#include <textureloader.h>
+#include <utils.h>
+
+#include <GLFW/glfw3.h>
+#include <stb/stb_image.h>
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstdio>
+#include <cstring>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <thread>
+
+// workers, NULL while the loader isn't running
+std::vector<std::thread*>* g_textureLoadWorkers = NULL;
+
+std::mutex g_textureLoadMutex;
+std::condition_variable g_textureLoadQueued; // signalled when a load is queued or the workers should stop
+std::condition_variable g_textureLoadDecoded; // signalled when a worker finishes decoding
+
+// guarded by g_textureLoadMutex
+std::deque<TextureLoad*> g_textureLoadQueue; // waiting for a worker
+std::vector<TextureLoad*> g_decodedTextureLoads; // waiting for the gl thread, in the order they finished
+bool g_textureLoaderQuit = false;
+
+// only touched on the gl thread
+uint32_t g_pendingTextureLoads = 0; // requested and not uploaded yet
+GLuint g_texturePixelBuffer = 0; // orphaned for every upload, so an upload never waits for the last one to be read
+std::vector<TextureLoadTiming> g_textureLoadTimings;
+
+// decoded images kept after they're uploaded, only while retention is on
+bool g_retainTextureImages = false;
+std::map<TextureData*, TextureImage*> g_textureImages;
+
+// read the header of a load's image, on the gl thread when it's requested
+// returns if it's an image stbi can decode, so unreadable files fail right away instead of after a worker gets to them
+bool checkTextureLoad(TextureLoad* load){
+	if(load->compressed) return stbi_info_from_memory(load->compressed->data(), load->compressed->size(), &load->width, &load->height, &load->channels) != 0;
+	
+	return stbi_info(load->path->c_str(), &load->width, &load->height, &load->channels) != 0;
+}
+
+// decode a load's image, on a worker (or the gl thread when loading synchronously)
+void decodeTextureLoad(TextureLoad* load){
+	double start = glfwGetTime();
+	
+	if(load->compressed){
+		load->pixels = stbi_load_from_memory(load->compressed->data(), load->compressed->size(), &load->width, &load->height, &load->channels, 0);
+	} else {
+		load->pixels = stbi_load(load->path->c_str(), &load->width, &load->height, &load->channels, 0);
+	}
+	
+	load->decodeTime = glfwGetTime() - start;
+}
+
+// body of a worker, decodes queued loads until the loader is stopped
+void runTextureLoadWorker(){
+	// flip because opengl expects textures to start at end of buffer (stbi's global flag belongs to the gl thread)
+	stbi_set_flip_vertically_on_load_thread(true);
+	
+	while(true){
+		TextureLoad* load = NULL;
+		
+		{
+			std::unique_lock<std::mutex> lock(g_textureLoadMutex);
+			
+			while(!g_textureLoaderQuit && g_textureLoadQueue.empty()){
+				g_textureLoadQueued.wait(lock);
+			}
+			
+			if(g_textureLoaderQuit) return;
+			
+			load = g_textureLoadQueue.front();
+			g_textureLoadQueue.pop_front();
+		}
+		
+		decodeTextureLoad(load);
+		
+		{
+			std::lock_guard<std::mutex> lock(g_textureLoadMutex);
+			
+			g_decodedTextureLoads.push_back(load);
+		}
+		
+		g_textureLoadDecoded.notify_all();
+	}
+}
+
+// start the worker threads, with this many threads (0 for every core but the gl thread's)
+// until this is called (and after stopTextureLoader) textures are loaded synchronously
+void startTextureLoader(uint32_t threadCount){
+	if(g_textureLoadWorkers) return;
+	
+	if(threadCount == 0) threadCount = std::max(std::thread::hardware_concurrency(), 2u) - 1;
+	
+	g_textureLoaderQuit = false;
+	g_textureLoadWorkers = new std::vector<std::thread*>();
+	
+	for(uint32_t i = 0; i < threadCount; i++){
+		g_textureLoadWorkers->push_back(new std::thread(runTextureLoadWorker));
+	}
+}
+
+void freeTextureLoad(TextureLoad* load){
+	stbi_image_free(load->pixels);
+	
+	delete load->path;
+	delete load->compressed;
+	
+	free(load);
+}
+
+// free every image kept for getTextureImage
+// decoded images come from stbi and missing ones from malloc, stbi allocates with malloc so both go to free
+void freeTextureImages(){
+	for(std::map<TextureData*, TextureImage*>::iterator it = g_textureImages.begin(); it != g_textureImages.end(); it++){
+		free(it->second->pixels);
+		free(it->second);
+	}
+	
+	g_textureImages.clear();
+}
+
+// stop the workers and free the kept images, has to be called on the gl thread once nothing uses getTextureImage anymore
+// textures that haven't been uploaded yet are finished first, so every callback still runs
+void stopTextureLoader(){
+	if(g_textureLoadWorkers){
+		finishTextureLoads();
+		
+		{
+			std::lock_guard<std::mutex> lock(g_textureLoadMutex);
+			
+			g_textureLoaderQuit = true;
+		}
+		
+		g_textureLoadQueued.notify_all();
+		
+		for(uint32_t i = 0; i < g_textureLoadWorkers->size(); i++){
+			g_textureLoadWorkers->at(i)->join();
+			
+			delete g_textureLoadWorkers->at(i);
+		}
+		
+		delete g_textureLoadWorkers;
+		g_textureLoadWorkers = NULL;
+	}
+	
+	// synchronous loads use the pixel buffer too
+	if(g_texturePixelBuffer){
+		glDeleteBuffers(1, &g_texturePixelBuffer);
+		
+		g_texturePixelBuffer = 0;
+	}
+	
+	freeTextureImages();
+}
+
+bool isTextureLoaderRunning(){
+	return g_textureLoadWorkers != NULL;
+}
+
+// keep a load's decoded image for getTextureImage, taking it from the load
+// images that couldn't be decoded are kept as TEXTURE_MISSING_COLOR, like their texture
+void retainTextureLoadImage(TextureLoad* load){
+	TextureImage* image = allocateMemoryForType<TextureImage>();
+	
+	if(load->pixels){
+		image->pixels = load->pixels;
+		image->width = load->width;
+		image->height = load->height;
+		image->channels = load->channels;
+		
+		load->pixels = NULL;
+	} else {
+		uint8_t missing[4] = TEXTURE_MISSING_COLOR;
+		
+		image->pixels = (uint8_t*)malloc(sizeof(missing));
+		image->width = 1;
+		image->height = 1;
+		image->channels = 4;
+		
+		memcpy(image->pixels, missing, sizeof(missing));
+	}
+	
+	g_textureImages[load->textureData] = image;
+}
+
+// upload a decoded load's image into its texture through the pixel buffer, and keep its timings
+// returns if the image could be decoded
+bool uploadTextureLoad(TextureLoad* load){
+	double start = glfwGetTime();
+	
+	TextureData* textureData = load->textureData;
+	
+	if(load->pixels){
+		textureData->width = load->width;
+		textureData->height = load->height;
+		textureData->channels = load->channels;
+		
+		GLsizeiptr size = (GLsizeiptr)load->width * load->height * load->channels;
+		
+		if(!g_texturePixelBuffer) glGenBuffers(1, &g_texturePixelBuffer);
+		
+		glBindBuffer(GL_PIXEL_UNPACK_BUFFER, g_texturePixelBuffer);
+		glBufferData(GL_PIXEL_UNPACK_BUFFER, size, NULL, GL_STREAM_DRAW);
+		
+		void* destination = glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, size, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+		
+		bool copied = false;
+		
+		if(destination){
+			memcpy(destination, load->pixels, size);
+			
+			// the copy is lost if the buffer was corrupted while it was mapped
+			copied = glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER) == GL_TRUE;
+		}
+		
+		// read from the pixel buffer, or straight from the image if it couldn't be written
+		if(copied){
+			setTextureDataImage(textureData, (const void*)0);
+			
+			glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+		} else {
+			glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+			
+			setTextureDataImage(textureData, load->pixels);
+		}
+	} else {
+		printf("error decoding texture %s\n", load->path->c_str());
+		
+		uint8_t missing[4] = TEXTURE_MISSING_COLOR;
+		
+		textureData->width = 1;
+		textureData->height = 1;
+		textureData->channels = 4;
+		
+		setTextureDataImage(textureData, missing);
+	}
+	
+	double time = glfwGetTime();
+	
+	TextureLoadTiming timing;
+	
+	timing.path = *load->path;
+	timing.width = load->width;
+	timing.height = load->height;
+	timing.decodeTime = load->decodeTime;
+	timing.uploadTime = time - start;
+	timing.latency = time - load->requestTime;
+	timing.loaded = load->pixels != NULL;
+	
+	g_textureLoadTimings.push_back(timing);
+	
+	if(g_retainTextureImages) retainTextureLoadImage(load);
+	
+	return timing.loaded;
+}
+
+// create texture data whose image is loaded by load, with a placeholder image until it's uploaded
+// has to be called on the gl thread, like the synchronous methods
+// if the loader isn't running the image is decoded and uploaded before returning
+// returns NULL if the image's header can't be read (like createTextureData), whether the loader is running or not
+TextureData* requestTextureLoad(TextureLoad* load){
+	load->textureData = NULL;
+	load->pixels = NULL;
+	load->width = 0;
+	load->height = 0;
+	load->channels = 0;
+	load->requestTime = glfwGetTime();
+	load->decodeTime = 0.0;
+	
+	if(!checkTextureLoad(load)){
+		printf("error loading texture %s\n", load->path->c_str());
+		
+		if(load->callback) load->callback(NULL, false, load->callbackData);
+		
+		freeTextureLoad(load);
+		
+		return NULL;
+	}
+	
+	TextureData* textureData = allocateMemoryForType<TextureData>();
+	
+	textureData->array = NULL;
+	textureData->layer = 0;
+	
+	load->textureData = textureData;
+	
+	glGenTextures(1, &textureData->texture);
+	
+	if(!g_textureLoadWorkers){
+		stbi_set_flip_vertically_on_load(true); // flip because opengl expects textures to start at end of buffer
+		
+		decodeTextureLoad(load);
+		
+		bool loaded = uploadTextureLoad(load);
+		
+		if(load->callback) load->callback(textureData, loaded, load->callbackData);
+		
+		freeTextureLoad(load);
+		
+		return textureData;
+	}
+	
+	// placeholder
+	uint8_t placeholder[4] = TEXTURE_PLACEHOLDER_COLOR;
+	
+	textureData->width = 1;
+	textureData->height = 1;
+	textureData->channels = 4;
+	
+	setTextureDataImage(textureData, placeholder);
+	
+	{
+		std::lock_guard<std::mutex> lock(g_textureLoadMutex);
+		
+		g_textureLoadQueue.push_back(load);
+	}
+	
+	g_textureLoadQueued.notify_one();
+	
+	g_pendingTextureLoads++;
+	
+	return textureData;
+}
+
+// load a texture without waiting for it, see createTextureData
+// callback (if it's not NULL) is called with callbackData once it's uploaded, the texture can be drawn before that, showing the placeholder
+TextureData* createTextureDataAsync(const char* texturePath, TextureLoadCallback callback, void* callbackData){
+	TextureLoad* load = allocateMemoryForType<TextureLoad>();
+	
+	load->path = new std::string(texturePath);
+	load->compressed = NULL;
+	load->callback = callback;
+	load->callbackData = callbackData;
+	
+	return requestTextureLoad(load);
+}
+
+// create texture data from a raw compressed image without waiting for it, see createTextureDataRawCompressed
+// buffer is copied, so it doesn't have to outlive the call
+TextureData* createTextureDataRawCompressedAsync(unsigned char* buffer, uint32_t length, TextureLoadCallback callback, void* callbackData){
+	TextureLoad* load = allocateMemoryForType<TextureLoad>();
+	
+	load->path = new std::string("(embedded)");
+	load->compressed = new std::vector<uint8_t>(buffer, buffer + length);
+	load->callback = callback;
+	load->callbackData = callbackData;
+	
+	return requestTextureLoad(load);
+}
+
+// upload decoded images, has to be called on the gl thread (the renderer does it every frame)
+// stops after uploadBudget bytes, but always uploads at least one image if there is one
+// returns how many textures finished loading
+uint32_t updateTextureLoads(uint32_t uploadBudget){
+	if(g_pendingTextureLoads == 0) return 0;
+	
+	std::vector<TextureLoad*> loads;
+	
+	{
+		std::lock_guard<std::mutex> lock(g_textureLoadMutex);
+		
+		uint64_t bytes = 0;
+		uint32_t count = 0;
+		
+		while(count < g_decodedTextureLoads.size() && (count == 0 || bytes < uploadBudget)){
+			TextureLoad* load = g_decodedTextureLoads[count];
+			
+			bytes += (uint64_t)load->width * load->height * load->channels;
+			count++;
+		}
+		
+		loads.assign(g_decodedTextureLoads.begin(), g_decodedTextureLoads.begin() + count);
+		g_decodedTextureLoads.erase(g_decodedTextureLoads.begin(), g_decodedTextureLoads.begin() + count);
+	}
+	
+	for(uint32_t i = 0; i < loads.size(); i++){
+		TextureLoad* load = loads[i];
+		
+		bool loaded = uploadTextureLoad(load);
+		
+		g_pendingTextureLoads--;
+		
+		if(load->callback) load->callback(load->textureData, loaded, load->callbackData);
+		
+		freeTextureLoad(load);
+	}
+	
+	return loads.size();
+}
+
+// wait for every texture requested so far to be decoded and upload them, on the gl thread
+// for anything that reads textures back (packing texture arrays, the software rasterizer)
+void finishTextureLoads(){
+	while(g_pendingTextureLoads > 0){
+		{
+			std::unique_lock<std::mutex> lock(g_textureLoadMutex);
+			
+			while(g_decodedTextureLoads.empty()){
+				g_textureLoadDecoded.wait(lock);
+			}
+		}
+		
+		updateTextureLoads(UINT32_MAX);
+	}
+}
+
+// textures requested and not uploaded yet
+uint32_t getPendingTextureLoadCount(){
+	return g_pendingTextureLoads;
+}
+
+// keep the decoded image of every texture loaded from now on, for anything that draws without gl (the software rasterizer)
+// off by default, since the images take as much memory again as the textures
+void setTextureImageRetention(bool enabled){
+	g_retainTextureImages = enabled;
+}
+
+// get the decoded image of a texture, once it's uploaded (see finishTextureLoads)
+// NULL if it was loaded while retention was off, isn't one the loader made, or stopTextureLoader freed it
+TextureImage* getTextureImage(TextureData* textureData){
+	std::map<TextureData*, TextureImage*>::iterator it = g_textureImages.find(textureData);
+	
+	return it != g_textureImages.end() ? it->second : NULL;
+}
+
+// timings of every texture loaded so far, in the order they finished
+std::vector<TextureLoadTiming>* getTextureLoadTimings(){
+	return &g_textureLoadTimings;
+}
+
+// used to sort timings, slowest to decode first
+bool compareTextureLoadDecodeTimes(const TextureLoadTiming& a, const TextureLoadTiming& b){
+	return a.decodeTime > b.decodeTime;
+}
+
+// print the total time spent loading textures, and every texture's timings
+void printTextureLoadTimings(){
+	std::vector<TextureLoadTiming> timings = g_textureLoadTimings;
+	
+	std::stable_sort(timings.begin(), timings.end(), compareTextureLoadDecodeTimes);
+	
+	double decodeTime = 0.0;
+	double uploadTime = 0.0;
+	
+	for(uint32_t i = 0; i < timings.size(); i++){
+		decodeTime += timings[i].decodeTime;
+		uploadTime += timings[i].uploadTime;
+	}
+	
+	printf("textures: %d loaded, %.3f ms decoding, %.3f ms uploading\n", (int32_t)timings.size(), decodeTime * 1000.0, uploadTime * 1000.0);
+	
+	for(uint32_t i = 0; i < timings.size(); i++){
+		TextureLoadTiming& timing = timings[i];
+		
+		printf("  %s (%dx%d): decode %.3f ms, upload %.3f ms, ready after %.3f ms%s\n", timing.path.c_str(), timing.width, timing.height, timing.decodeTime * 1000.0, timing.uploadTime * 1000.0, timing.latency * 1000.0, timing.loaded ? "" : ", failed");
+	}
+}
\ No newline at end of file
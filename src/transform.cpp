@@ -0,0 +1,119 @@
+// transform hierarchy
+
+#include <transform.h>
+#include <utils.h>
+
+#include <glm/ext.hpp>
+
+#include <algorithm>
+
+// build a matrix that scales, then rotates (x, then y, then z), then translates
+glm::mat4 composeTransformMatrix(glm::vec3 position, glm::vec3 rotation, glm::vec3 scale){
+	// translate
+	glm::mat4 matrix = glm::translate(glm::mat4(1.0f), position);
+	
+	// rotate around each axis
+	matrix = glm::rotate(matrix, rotation.z, glm::vec3(0.f, 0.f, 1.f));
+	matrix = glm::rotate(matrix, rotation.y, glm::vec3(0.f, 1.f, 0.f));
+	matrix = glm::rotate(matrix, rotation.x, glm::vec3(1.f, 0.f, 0.f));
+	
+	// scale
+	return glm::scale(matrix, scale);
+}
+
+// create a transform with no parent
+Transform* createTransform(glm::vec3 position, glm::vec3 rotation, glm::vec3 scale){
+	return createTransform(composeTransformMatrix(position, rotation, scale));
+}
+
+// create a transform with no parent from an existing matrix (like an assimp node's transformation)
+Transform* createTransform(glm::mat4 localMatrix){
+	Transform* transform = allocateMemoryForType<Transform>();
+	
+	transform->localMatrix = localMatrix;
+	transform->worldMatrix = glm::mat4(1.0f);
+	transform->normalMatrix = glm::mat3(1.0f);
+	transform->dirty = true;
+	transform->parent = NULL;
+	transform->children = new std::vector<Transform*>();
+	
+	return transform;
+}
+
+// assign translation, rotation, and scale values to a transform
+void setTransform(Transform* transform, glm::vec3 position, glm::vec3 rotation, glm::vec3 scale){
+	setTransformLocalMatrix(transform, composeTransformMatrix(position, rotation, scale));
+}
+
+void setTransformLocalMatrix(Transform* transform, glm::mat4 localMatrix){
+	transform->localMatrix = localMatrix;
+	
+	markTransformDirty(transform);
+}
+
+// attach a transform to a new parent (or detach it with NULL)
+void setTransformParent(Transform* transform, Transform* parent){
+	if(transform->parent == parent) return;
+	
+	// detach from old parent
+	if(transform->parent){
+		std::vector<Transform*>* siblings = transform->parent->children;
+		
+		siblings->erase(std::remove(siblings->begin(), siblings->end(), transform), siblings->end());
+	}
+	
+	transform->parent = parent;
+	
+	if(parent) parent->children->push_back(transform);
+	
+	markTransformDirty(transform);
+}
+
+// mark a transform and all of its descendants as needing their world matrices recomputed
+void markTransformDirty(Transform* transform){
+	// if it's already dirty then so are its descendants
+	if(transform->dirty) return;
+	
+	transform->dirty = true;
+	
+	for(uint32_t i = 0; i < transform->children->size(); i++){
+		markTransformDirty(transform->children->at(i));
+	}
+}
+
+// recompute a transform's cached matrices if they're out of date
+void updateTransform(Transform* transform){
+	if(!transform->dirty) return;
+	
+	if(transform->parent){
+		transform->worldMatrix = getTransformWorldMatrix(transform->parent) * transform->localMatrix;
+	} else {
+		transform->worldMatrix = transform->localMatrix;
+	}
+	
+	transform->normalMatrix = glm::transpose(glm::inverse(glm::mat3(transform->worldMatrix)));
+	transform->dirty = false;
+}
+
+glm::mat4& getTransformWorldMatrix(Transform* transform){
+	updateTransform(transform);
+	
+	return transform->worldMatrix;
+}
+
+glm::mat3& getTransformNormalMatrix(Transform* transform){
+	updateTransform(transform);
+	
+	return transform->normalMatrix;
+}
+
+glm::vec3 getTransformWorldPosition(Transform* transform){
+	return glm::vec3(getTransformWorldMatrix(transform)[3]);
+}
+
+// length of each world space axis, only exact if there's no shear
+glm::vec3 getTransformWorldScale(Transform* transform){
+	glm::mat4& world = getTransformWorldMatrix(transform);
+	
+	return glm::vec3(glm::length(glm::vec3(world[0])), glm::length(glm::vec3(world[1])), glm::length(glm::vec3(world[2])));
+}
\ No newline at end of file
@@ -1,10 +1,14 @@
 // world parser
 #include <world.h>
+#include <drawlist.h>
+#include <material.h>
+#include <textureloader.h>
 #include <utils.h>
 #include <shapes.h>
 #include <audio.h>
 
 #include <cctype>
+#include <cstring>
 
 #include <stdexcept>
 #include <ctgmath>
@@ -288,6 +292,9 @@ TexturedRenderableObject* createTexturedRenderableObject(RenderableObject* objec
 	texturedObject->renderableObject = object;
 	texturedObject->textureData = texture;
 	texturedObject->color = glm::vec3(0);
+	texturedObject->material = 0;
+	texturedObject->lightmapRect = glm::vec4(0);
+	texturedObject->world = 0;
 	texturedObject->visible = true;
 	
 	return texturedObject;
@@ -300,6 +307,9 @@ TexturedRenderableObject* createTexturedRenderableObject(RenderableObject* objec
 	texturedObject->renderableObject = object;
 	texturedObject->textureData = NULL;
 	texturedObject->color = color;
+	texturedObject->material = 0;
+	texturedObject->lightmapRect = glm::vec4(0);
+	texturedObject->world = 0;
 	texturedObject->visible = true;
 	
 	return texturedObject;
@@ -321,7 +331,7 @@ TexturedRenderableObject* createTexturedRenderableObject(VertexData* vertexData,
 
 // from existing renderable object and new texture data params
 TexturedRenderableObject* createTexturedRenderableObject(RenderableObject* object, const char* texturePath){
-	TextureData* texture = createTextureData(texturePath);
+	TextureData* texture = createTextureDataAsync(texturePath, NULL, NULL);
 	
 	return createTexturedRenderableObject(object, texture);
 }
@@ -329,7 +339,7 @@ TexturedRenderableObject* createTexturedRenderableObject(RenderableObject* objec
 // completely new
 TexturedRenderableObject* createTexturedRenderableObject(VertexData* vertexData, glm::vec3 position, glm::vec3 rotation, glm::vec3 scale, const char* texturePath){
 	RenderableObject* object = createRenderableObject(vertexData, position, rotation, scale);
-	TextureData* texture = createTextureData(texturePath);
+	TextureData* texture = createTextureDataAsync(texturePath, NULL, NULL);
 	
 	return createTexturedRenderableObject(object, texture);
 }
@@ -572,10 +582,10 @@ void updatePlayerPosition(Player* player, Scene* scene, Window* window, double d
 		float desiredHeight = player->currentBbox->position.y + scene->playerHeight*0.875;
 		float newHeight = currentHeight + (desiredHeight - currentHeight)* std::min(scene->heightSpeed * (float)delta, 1.0f);
 		
-		player->camera->position = glm::vec3(position.x, newHeight, position.z);
+		setCameraPosition(player->camera, glm::vec3(position.x, newHeight, position.z));
 	} else {
 		// no walkmap
-		player->camera->position = position;
+		setCameraPosition(player->camera, position);
 	}
 	
 	//printf("iterations: %d\n", iterations);
@@ -725,7 +735,7 @@ void textureBlockToScene(Block* block, Scene* scene){
 	if(textureName == "invisible") return;
 	
 	// load texture
-	(*scene->textures)[textureName] = createTextureData(texturePath.c_str());
+	(*scene->textures)[textureName] = createTextureDataAsync(texturePath.c_str(), NULL, NULL);
 }
 
 void vertexDataBlockToScene(Block* block, Scene* scene){
@@ -809,12 +819,18 @@ void objectBlockToScene(Block* block, Scene* scene){
 				return; // fail
 			}
 			
+			// every mesh is placed relative to the object's transform
+			Transform* root = createTransform(position, rotation, scale);
+			
 			// split model in textured renderable objects
 			for(uint32_t i = 0; i < model->meshes->size(); i++){
 				Mesh* mesh = model->meshes->at(i);
 				
 				// create renderable object from mesh
-				RenderableObject* object = createRenderableObject(mesh->vertexData, position, rotation, scale);
+				RenderableObject* object = createRenderableObject(mesh->vertexData, glm::vec3(0), glm::vec3(0), glm::vec3(1));
+				
+				setTransformLocalMatrix(object->transform, mesh->transform);
+				setTransformParent(object->transform, root);
 				
 				// create textured renderable object from renderable object and texture/color
 				TexturedRenderableObject* texturedObject;
@@ -825,6 +841,8 @@ void objectBlockToScene(Block* block, Scene* scene){
 					texturedObject = createTexturedRenderableObject(object, mesh->color);
 				}
 				
+				texturedObject->world = scene->worlds->size() - 1;
+				
 				// push to scene
 				std::vector<TexturedRenderableObject*>* objectVector = (*scene->staticObjects)[mesh->vertexData];
 				
@@ -874,6 +892,8 @@ void objectBlockToScene(Block* block, Scene* scene){
 			// create object
 			TexturedRenderableObject* object = createTexturedRenderableObject(vData, position, rotation, scale, texture);
 			
+			object->world = scene->worlds->size() - 1;
+			
 			// push to scene
 			std::vector<TexturedRenderableObject*>* objectVector = (*scene->staticObjects)[vData];
 			
@@ -1120,11 +1140,30 @@ Scene* createScene(Window* window, Player* player){
 	// initialize values
 	scene->window = window;
 	scene->player = player;
+	scene->worlds = new std::vector<std::string>();
 	scene->vertexData = new std::map<std::string, VertexData*>();
 	scene->textures = new std::map<std::string, TextureData*>();
+	scene->textureArrays = new std::vector<TextureArray*>();
 	scene->models = new std::map<std::string, Model*>();
 	scene->staticObjects = new std::map<VertexData*, std::vector<TexturedRenderableObject*>*>();
+	scene->materials = createMaterialTable();
+	scene->staticBatches = new std::vector<StaticBatch*>();
+	scene->instanceBuffer = NULL;
+	scene->instances = new std::vector<InstanceData>();
+	scene->instanceGroups = new std::vector<InstanceGroup>();
+	scene->drawCommandBuffer = NULL;
+	scene->drawCommands = new std::vector<DrawElementsIndirectCommand>();
+	scene->drawBuckets = new std::vector<MultiDrawBucket>();
+	scene->staticDrawList = createStaticDrawList();
 	scene->pointLights = new std::vector<PointLight*>();
+	scene->lightBuffer = NULL;
+	scene->cameraBuffer = NULL;
+	scene->lightDataBuffer = NULL;
+	scene->uploadedLights = new std::vector<PointLight*>();
+	memset(&scene->uploadedLightsBlock, 0, sizeof(LightsBlock));
+	scene->uploadedCamera = (CameraBlock){glm::mat4(0), glm::mat4(0), glm::mat4(0), glm::vec3(0), 0, glm::mat4(0)};
+	scene->lightClusters = NULL;
+	scene->lightmap = NULL;
 	scene->walkmap = new std::vector<BoundingBox*>();
 	scene->triggers = new std::map<std::string, std::vector<TriggerInfo*>*>();
 	scene->walkmapOffset = 0;
@@ -1140,6 +1179,34 @@ Scene* createScene(Window* window, Player* player){
 	return scene;
 }
 
+// pack the textures of every static object into texture arrays (see packTextureArrays)
+// should be called once the scene is done loading and before buildSceneStaticBatches
+void packSceneTextureArrays(Scene* scene){
+	// textures are read back to be packed, so they have to be done loading
+	finishTextureLoads();
+	
+	// collect unique textures
+	std::vector<TextureData*> textures;
+	
+	for (std::map<VertexData*, std::vector<TexturedRenderableObject*>*>::iterator it = scene->staticObjects->begin(); it != scene->staticObjects->end(); it++){
+		if(!it->second) continue;
+		
+		for(uint32_t i = 0; i < it->second->size(); i++){
+			TexturedRenderableObject* object = it->second->at(i);
+			
+			if(!object || !object->textureData) continue;
+			
+			if(std::find(textures.begin(), textures.end(), object->textureData) == textures.end()) textures.push_back(object->textureData);
+		}
+	}
+	
+	packTextureArrays(textures, *scene->textureArrays);
+	
+	// packed textures have a different binding and layer
+	invalidateStaticDrawList(scene->staticDrawList);
+	invalidateMaterialTable(scene->materials);
+}
+
 // parse a world file into an existing scene
 void parseWorldIntoScene(Scene* scene, const char* file){
 	// file buffer
@@ -1150,6 +1217,8 @@ void parseWorldIntoScene(Scene* scene, const char* file){
 		return;
 	}
 	
+	scene->worlds->push_back(std::string(file));
+	
 	// settings
 	char blockDelimiters[] = {textureBlockDelimiter, vertexDataBlockDelimiter, objectBlockDelimiter, lightBlockDelimiter, modelBlockDelimiter, walkBoxBlockDelimiter, settingsBlockDelimiter, triggerBlockDelimiter, audioBlockDelimiter};
 	
@@ -1237,6 +1306,10 @@ void parseWorldIntoScene(Scene* scene, const char* file){
 	// update walkmap offset
 	scene->walkmapOffset = scene->walkmap->size();
 	
+	// new static objects
+	assignSceneMaterials(scene);
+	invalidateStaticDrawList(scene->staticDrawList);
+	
 	// player setup
 	// determine currentBox if null
 	if(scene->player->currentBbox == NULL && scene->walkmap->size() > 0){
@@ -1250,7 +1323,7 @@ void parseWorldIntoScene(Scene* scene, const char* file){
 		
 		if(scene->player->currentBbox == NULL){
 			scene->player->currentBbox = scene->walkmap->at(0);
-			scene->player->camera->position = scene->player->currentBbox->position; // height should correct itself
+			setCameraPosition(scene->player->camera, scene->player->currentBbox->position); // height should correct itself
 		}
 	}
 }
@@ -0,0 +1,189 @@
+// render path tests
+// every render mode draws a fixed scene from fixed camera poses headless, against the recording backend over the null backend,
+// and the gl calls each frame makes are checked against exact counts, so changes to batching, instancing or the state cache show up here
+// run from bin (make test), the scene and shaders are loaded from ./res
+
+#include <batch.h>
+#include <engine.h>
+#include <glbackend.h>
+#include <permutation.h>
+#include <renderer.h>
+#include <renderthread.h>
+#include <textureloader.h>
+#include <world.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+// macros //
+
+// the scene every mode draws
+#define TEST_WORLD "./res/worlds/oldmuseum.world"
+
+#define TEST_SCREEN_WIDTH 800
+#define TEST_SCREEN_HEIGHT 600
+
+// camera poses (position, rotation) the scene is drawn from
+#define TEST_POSE_COUNT 3
+
+// frames drawn from each pose before the counted one, so texture uploads, light uploads and the state cache have settled
+#define TEST_WARMUP_FRAMES 2
+
+// structs //
+
+// gl calls made by one frame
+struct RenderTestCounts {
+	uint64_t draws; // every draw method, a multi-draw counts once
+	uint64_t vertexArrayBinds;
+	uint64_t textureBinds;
+	uint64_t uniformWrites; // glUniform*, not counting glUniformBlockBinding
+};
+
+// a render mode and the counts it's expected to make from each pose
+struct RenderTest {
+	const char* name;
+	SceneRenderMode mode;
+	
+	RenderTestCounts expected[TEST_POSE_COUNT];
+};
+
+// tests //
+
+glm::vec3 g_testPoses[TEST_POSE_COUNT][2] = {
+	{glm::vec3(0, 3, 0), glm::vec3(-0.3, 0.8, 0)},
+	{glm::vec3(5, 2, 5), glm::vec3(-0.1, 3.5, 0)},
+	{glm::vec3(-5, 2, -3), glm::vec3(-0.2, 0.3, 0)}
+};
+
+// the recording backend's counts of a list of methods, added up
+uint64_t getTestCallCount(const char** functions, uint32_t count){
+	uint64_t calls = 0;
+	
+	for(uint32_t i = 0; i < count; i++){
+		calls += getGlCallCount(functions[i]);
+	}
+	
+	return calls;
+}
+
+// what the recording backend saw since the last clear
+RenderTestCounts getTestCounts(){
+	const char* drawFunctions[] = {"glDrawArrays", "glDrawArraysInstanced", "glDrawElements", "glDrawElementsBaseVertex", "glDrawElementsInstancedBaseVertex", "glMultiDrawElementsIndirect"};
+	const char* uniformFunctions[] = {"glUniform1f", "glUniform1i", "glUniform2f", "glUniform3fv", "glUniform4fv", "glUniformMatrix3fv", "glUniformMatrix4fv"};
+	
+	RenderTestCounts counts;
+	
+	counts.draws = getTestCallCount(drawFunctions, sizeof(drawFunctions)/sizeof(const char*));
+	counts.vertexArrayBinds = getGlCallCount("glBindVertexArray");
+	counts.textureBinds = getGlCallCount("glBindTexture");
+	counts.uniformWrites = getTestCallCount(uniformFunctions, sizeof(uniformFunctions)/sizeof(const char*));
+	
+	return counts;
+}
+
+// compare one count, printing it if it's off
+bool checkTestCount(const char* name, uint32_t pose, const char* count, uint64_t actual, uint64_t expected){
+	if(actual == expected) return true;
+	
+	printf("    %s pose %d: %s %llu (expected %llu)\n", name, pose, count, (unsigned long long)actual, (unsigned long long)expected);
+	
+	return false;
+}
+
+// load the scene and draw it from every pose the way main would in the test's mode, checking the last frame from each
+bool runRenderTest(RenderTest* test, ShaderPermutations* lightingShaders){
+	PerspectiveCamera* camera = createPerspectiveCamera(glm::vec3(0), glm::vec3(0), glm::radians(45.f), (float)TEST_SCREEN_WIDTH, (float)TEST_SCREEN_HEIGHT, 0.1f, 100.f);
+	
+	Keymap keymap = (Keymap){0, 0, 0, 0, 0, 0, 0, 0};
+	
+	Player* player = createPlayer(camera, keymap);
+	Scene* scene = createScene(NULL, player);
+	
+	parseWorldIntoScene(scene, TEST_WORLD);
+	
+	// same setup as main
+	if(test->mode != RENDER_PER_OBJECT) packSceneTextureArrays(scene);
+	if(test->mode == RENDER_BATCHED) buildSceneStaticBatches(scene, 8.f);
+	
+	ShaderProgramEx* program = getShaderPermutation(lightingShaders, 0, SHADER_TEXTURED);
+	ShaderProgramEx* instancedProgram = getShaderPermutation(lightingShaders, SHADER_FEATURE_INSTANCED, SHADER_TEXTURED);
+	
+	FrameRenderer* frameRenderer = createFrameRenderer(NULL, scene, TEST_SCREEN_WIDTH, TEST_SCREEN_HEIGHT, test->mode, program, instancedProgram);
+	Renderer* renderer = createOpenGlRenderer(frameRenderer);
+	
+	FramePacket* packet = createFramePacket();
+	
+	bool passed = true;
+	
+	for(uint32_t i = 0; i < TEST_POSE_COUNT; i++){
+		updateCameraViewMatrix(camera, g_testPoses[i][0], g_testPoses[i][1]);
+		
+		for(uint32_t j = 0; j <= TEST_WARMUP_FRAMES; j++){
+			// only the last frame is counted
+			if(j == TEST_WARMUP_FRAMES) clearGlRecording();
+			
+			buildFramePacket(packet, scene, camera, test->mode);
+			
+			renderFrame(renderer, packet);
+		}
+		
+		RenderTestCounts counts = getTestCounts();
+		RenderTestCounts& expected = test->expected[i];
+		
+		passed &= checkTestCount(test->name, i, "draws", counts.draws, expected.draws);
+		passed &= checkTestCount(test->name, i, "vao binds", counts.vertexArrayBinds, expected.vertexArrayBinds);
+		passed &= checkTestCount(test->name, i, "texture binds", counts.textureBinds, expected.textureBinds);
+		passed &= checkTestCount(test->name, i, "uniform writes", counts.uniformWrites, expected.uniformWrites);
+	}
+	
+	printf("%s: %s\n", test->name, passed ? "passed" : "FAILED");
+	
+	return passed;
+}
+
+int main(int argc, char** argv){
+	// glfw is only needed for its timer
+	if(initGraphics() != SUCCESS){
+		printf("There was an error initializing graphics\n");
+		exit(EXIT_FAILURE);
+	}
+	
+	// no context, so the recording backend passes every call on to the null backend
+	setGlBackend(GL_BACKEND_RECORDING);
+	
+	initHeadlessGraphics(TEST_SCREEN_WIDTH, TEST_SCREEN_HEIGHT);
+	
+	// textures are loaded as the world is read (no texture loader), so every frame sees the same textures
+	ShaderPermutations* lightingShaders = createShaderPermutations("./res/shader/lighting/vertex.glsl", "./res/shader/lighting/fragment.glsl");
+	
+	precompileShaderPermutations(lightingShaders, 0);
+	precompileShaderPermutations(lightingShaders, SHADER_FEATURE_INSTANCED);
+	
+	RenderTest tests[] = {
+		// one draw per visible object, each writing its model and normal matrix, textures are only bound when they change
+		{"per object", RENDER_PER_OBJECT, {{16, 0, 5, 32}, {30, 0, 19, 60}, {19, 0, 7, 38}}},
+		
+		// one draw and texture array bind per instance group, everything per object comes from the instance buffer
+		{"instanced", RENDER_INSTANCED, {{3, 0, 3, 0}, {3, 0, 3, 0}, {3, 0, 3, 0}}},
+		
+		// the null backend has no glMultiDrawElementsIndirect, so this is the fallback, which draws the same as instanced
+		{"multi-draw", RENDER_MULTI_DRAW, {{3, 0, 3, 0}, {3, 0, 3, 0}, {3, 0, 3, 0}}},
+		
+		// a vao and texture array bind for each texture array's batches, then one draw per visible batch
+		{"batched", RENDER_BATCHED, {{5, 3, 3, 0}, {3, 3, 3, 0}, {4, 3, 3, 0}}}
+	};
+	
+	uint32_t testCount = sizeof(tests)/sizeof(RenderTest);
+	uint32_t failed = 0;
+	
+	for(uint32_t i = 0; i < testCount; i++){
+		if(!runRenderTest(&tests[i], lightingShaders)) failed++;
+	}
+	
+	printf("%d of %d render tests passed\n", testCount - failed, testCount);
+	
+	terminateGraphics();
+	
+	return failed == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
\ No newline at end of file